@@ -234,6 +234,7 @@ int sky_action_file_unload(sky_action_file *action_file)
         }
         
         action_file->action_count = 0;
+        action_file->version++;
     }
     
     return 0;
@@ -344,6 +345,7 @@ int sky_action_file_add_action(sky_action_file *action_file,
     action_file->actions = realloc(action_file->actions, sizeof(sky_action*) * action_file->action_count);
     check_mem(action_file->actions);
     action_file->actions[action_file->action_count-1] = action;
+    action_file->version++;
     
     return 0;
 
@@ -21,6 +21,9 @@ typedef struct sky_action_file sky_action_file;
 // stored in an associated table. Each table has one action file. Currently
 // actions only support a numeric ID and a name but additional fields may be
 // allowed in the future.
+//
+// The version is incremented whenever the actions change so that anything
+// compiled against them, such as cached queries, can tell when it is stale.
 
 
 //==============================================================================
@@ -33,6 +36,7 @@ struct sky_action_file {
     bstring path;
     sky_action **actions;
     uint32_t action_count;
+    uint32_t version;
 };
 
 
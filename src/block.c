@@ -11,6 +11,7 @@
 #include "block.h"
 #include "path.h"
 #include "path_iterator.h"
+#include "lz.h"
 
 
 //==============================================================================
@@ -28,6 +29,18 @@ int sky_block_split_with_event(sky_block *block, sky_event *event,
 int sky_block_span_with_event(sky_block *block, sky_event *new_event,
     void *path_ptr, uint32_t target_size, sky_block **target_block);
 
+int sky_block_get_event_insertion_ptr(void *path_ptr, sky_event *event,
+    void **event_ptr);
+
+int sky_block_search_directory(sky_block_directory_entry *entries,
+    uint32_t count, sky_object_id_t object_id, uint32_t *index);
+
+int sky_block_update_directory(sky_block *block, sky_object_id_t object_id,
+    size_t offset, size_t sz, bool path_exists);
+
+int sky_block_append_path_stat(sky_block_path_stat **paths,
+    uint32_t *path_count, sky_object_id_t object_id, size_t start_pos,
+    size_t end_pos, size_t sz);
 
 
 //==============================================================================
@@ -84,7 +97,7 @@ int sky_block_save(sky_block *block)
 
     // Retrieve the location of the block in memory.
     void *ptr = NULL;
-    rc = sky_block_get_ptr(block, &ptr);
+    rc = sky_block_get_raw_ptr(block, &ptr);
     check(rc == 0, "Unable to retrieve block data pointer");
     
     // Determine the page size.
@@ -196,53 +209,38 @@ error:
 // Header Management
 //--------------------------------------
 
-// Updates the block object id and timestamp ranges and saves the changes to
-// the header file as required.
+// Writes the block ranges into the memory-mapped header file and marks the
+// range as dirty. The change is synced to disk on the next header flush.
 //
-// block     - The block to update ranges for.
-// object_id - The object id being added to the block.
-// timestamp - The timestamp being added to the block.
+// block - The block to save.
 //
 // Returns 0 if successful, otherwise returns -1.
 int sky_block_save_header(sky_block *block)
 {
     int rc;
     check(block != NULL, "Block required");
+    check(block->data_file->header != NULL, "Header file must be mapped for block update");
 
-    // Open header file.
-    int fd = open(bdata(block->data_file->header_path), O_WRONLY);
-    check(fd != 0, "Unable to open header file for block update");
-    FILE *file = fdopen(fd, "w");
-    check(file != NULL, "Unable to open header file stream for block update");
-    
-    // Write to buffer.
-    size_t sz;
-    uint8_t *buffer[SKY_BLOCK_HEADER_SIZE];
-    rc = sky_block_pack(block, buffer, &sz);
-    check(rc == 0, "Unable to pack block header data");
-    
     // Determine header file position.
     off_t offset;
     rc = sky_block_get_header_offset(block, &offset);
     check(rc == 0, "Unable to determine block offset in header file");
-    rc = fseek(file, offset, SEEK_SET);
-    check(rc == 0, "Unable to position file at block position: %lld", offset);
+    check(offset + SKY_BLOCK_HEADER_SIZE <= block->data_file->header_length, "Block header out of range: %lld", (long long)offset);
     
-    // Write to file.
-    rc = fwrite(buffer, SKY_BLOCK_HEADER_SIZE, 1, file);
-    check(rc == 1, "Unable to write block to header file");
+    // Write directly into the header mapping.
+    size_t sz;
+    rc = sky_block_pack(block, block->data_file->header + offset, &sz);
+    check(rc == 0, "Unable to pack block header data");
     
-    // Close header file.
-    fclose(file);
-    close(fd);
+    // Mark the range for the next flush.
+    rc = sky_data_file_mark_header_dirty(block->data_file, offset, sz);
+    check(rc == 0, "Unable to mark block header as dirty");
 
     return 0;
 
 error:
-    if(file) fclose(file);
-    if(fd) close(fd);
     return -1;
-}    
+}
 
 // Updates the block object id and timestamp ranges and saves the changes to
 // the header file as required.
@@ -293,7 +291,7 @@ error:
 
 // Loops over all paths and events in the block to determine the object id
 // and timestamp ranges. This occurs when large changes occur to a block
-// (such as a block split).
+// (such as a block split). The block's path directory is rebuilt as well.
 //
 // block - The block to update.
 //
@@ -303,6 +301,10 @@ int sky_block_full_update(sky_block *block)
     int rc;
     check(block != NULL, "Block required");
 
+    // Rebuild the directory since paths may have moved.
+    rc = sky_block_build_directory(block);
+    check(rc == 0, "Unable to build block directory");
+
     // Initialize path iterator.
     sky_path_iterator iterator;
     sky_path_iterator_init(&iterator);
@@ -338,19 +340,15 @@ int sky_block_full_update(sky_block *block)
         // Use cursor to loop over each event.
         sky_cursor cursor;
         sky_cursor_init(&cursor);
-        sky_cursor_set_path(&cursor, ptr);
+        rc = sky_cursor_set_path(&cursor, ptr);
         check(rc == 0, "Unable to set cursor path");
             
         // Loop over cursor until we reach the event insertion point.
         while(!cursor.eof) {
-            sky_timestamp_t timestamp;
-            sky_action_id_t action_id;
-            sky_event_data_length_t data_length;
-
             // Retrieve current timestamp in cursor.
-            size_t hdrsz;
-            rc = sky_event_unpack_hdr(&timestamp, &action_id, &data_length, cursor.ptr, &hdrsz);
-            check(rc == 0, "Unable to unpack event header");
+            sky_timestamp_t timestamp;
+            rc = sky_cursor_get_timestamp(&cursor, &timestamp);
+            check(rc == 0, "Unable to retrieve event timestamp");
                 
             // Update timestamp ranges.
             if(!event_initialized || timestamp < block->min_timestamp) {
@@ -365,6 +363,7 @@ int sky_block_full_update(sky_block *block)
             rc = sky_cursor_next(&cursor);
             check(rc == 0, "Unable to move to next event");
         }
+        sky_cursor_set_path(&cursor, NULL);
         
         // Move to next path.
         rc = sky_path_iterator_next(&iterator);
@@ -381,81 +380,688 @@ error:
     return -1;
 }
 
-// Calculates the byte position of the block inside the header file using the
-// block's index.
+// Calculates the byte position of the block inside the header file using the
+// block's index.
+//
+// block  - The block to determine the position for.
+// offset - The offset, in bytes, from the beginning of the header file where
+//          the block data begins.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_get_header_offset(sky_block *block, off_t *offset)
+{
+    check(block != NULL, "Block required");
+    check(offset != NULL, "Offset pointer required");
+
+    *offset = ((uint32_t)SKY_HEADER_FILE_HDR_SIZE) + (block->index * ((uint32_t)SKY_BLOCK_HEADER_SIZE));
+    return 0;
+    
+error:
+    *offset = 0;
+    return -1;
+}
+
+//--------------------------------------
+// Block Position
+//--------------------------------------
+
+// Calculates the byte offset for the beginning on the block in the
+// data file based on the data file block size and the block index.
+//
+// block  - The block to calculate the byte offset of.
+// offset - A pointer to where the offset will be returned to.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_get_offset(sky_block *block, size_t *offset)
+{
+    check(block != NULL, "Block required");
+    check(block->data_file != NULL, "Data file required");
+    check(block->data_file->block_size != 0, "Data file must have a nonzero block size");
+
+    *offset = (block->data_file->block_size * block->index);
+    return 0;
+
+error:
+    *offset = 0;
+    return -1;
+}
+
+// Retrieves a pointer to the contents of the block. Compressed blocks are
+// read through the data file's block cache so the pointer is to the
+// decompressed block and it is only valid until the block is evicted from
+// the cache. Blocks must be decompressed with sky_block_inflate() before they are
+// written to.
+//
+// block - The block.
+// ptr   - A pointer to where the blocks starting address will be set.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_get_ptr(sky_block *block, void **ptr)
+{
+    int rc;
+    rc = sky_block_get_raw_ptr(block, ptr);
+    check(rc == 0, "Unable to retrieve block pointer");
+
+    // Read compressed blocks through the cache.
+    if(block->cache_entry != NULL || SKY_BLOCK_IS_COMPRESSED(*ptr)) {
+        sky_block_cache *cache;
+        rc = sky_data_file_get_block_cache(block->data_file, &cache);
+        check(rc == 0, "Unable to retrieve block cache");
+        rc = sky_block_cache_get(cache, block, *ptr, ptr);
+        check(rc == 0, "Unable to retrieve cached block");
+    }
+
+    return 0;
+
+error:
+    *ptr = NULL;
+    return -1;
+}
+
+// Calculates the pointer position for the beginning on the block in the
+// data file based on the data file block size and the block index. This is
+// the block as it is stored so compressed blocks are not decompressed.
+//
+// block - The block to calculate the byte offset of.
+// ptr   - A pointer to where the blocks starting address will be set.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_get_raw_ptr(sky_block *block, void **ptr)
+{
+    check(block != NULL, "Block required");
+    check(block->data_file != NULL, "Data file required");
+    check(block->data_file->data != NULL, "Data file must be mapped");
+
+    // Retrieve the offset.
+    size_t offset;
+    int rc = sky_block_get_offset(block, &offset);
+    check(rc == 0, "Unable to determine block offset");
+
+    // Calculate pointer based on data pointer.
+    *ptr = block->data_file->data + offset;
+    
+    return 0;
+
+error:
+    *ptr = NULL;
+    return -1;
+}
+
+
+// Asks the OS to start reading a block and the blocks stored directly after
+// it in the data file into memory so that they are already paged in by the
+// time they are scanned. Adjacent blocks are requested together so that a
+// run of blocks only costs one system call. This doesn't wait for the read.
+//
+// block - The first block.
+// count - The number of consecutive blocks to read, starting with the block.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_prefetch(sky_block *block, uint32_t count)
+{
+    int rc;
+    void *ptr;
+    check(count > 0, "Block count required");
+    check(block->index + count <= block->data_file->block_count, "Block range out of bounds: %d+%d", block->index, count);
+    rc = sky_block_get_raw_ptr(block, &ptr);
+    check(rc == 0, "Unable to retrieve block pointer");
+
+    // Advice has to start on a page boundary.
+    uintptr_t page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t)ptr) & ~(page_size - 1);
+    uintptr_t end = ((uintptr_t)ptr) + ((size_t)block->data_file->block_size * count);
+    rc = madvise((void*)start, end - start, MADV_WILLNEED);
+    check(rc == 0, "Unable to prefetch blocks: %d+%d", block->index, count);
+
+    return 0;
+
+error:
+    return -1;
+}
+
+
+//--------------------------------------
+// Directory
+//--------------------------------------
+
+// Checks whether the blocks of the block's data file store a path directory.
+//
+// block - The block.
+//
+// Returns true if the block has a directory. Otherwise returns false.
+bool sky_block_has_directory(sky_block *block)
+{
+    return (block != NULL && block->data_file != NULL && block->data_file->version >= SKY_DATA_FILE_DIRECTORY_VERSION);
+}
+
+// Retrieves the path directory stored at the end of the block. The entries
+// point directly into the data file so they are only valid until the block
+// is changed.
+//
+// block   - The block.
+// entries - A pointer to where the first directory entry is returned.
+// count   - A pointer to where the number of entries is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_get_directory(sky_block *block,
+                            sky_block_directory_entry **entries,
+                            uint32_t *count)
+{
+    int rc;
+    check(block != NULL, "Block required");
+    check(sky_block_has_directory(block), "Block does not have a directory");
+
+    void *block_ptr;
+    rc = sky_block_get_ptr(block, &block_ptr);
+    check(rc == 0, "Unable to retrieve block pointer");
+
+    uint32_t block_size = block->data_file->block_size;
+    *count = *((uint32_t*)(block_ptr + block_size - SKY_BLOCK_DIRECTORY_HEADER_SIZE));
+    check(SKY_BLOCK_DIRECTORY_SIZE(*count) <= block_size, "Block directory is corrupt: %d", block->index);
+    *entries = (sky_block_directory_entry*)(block_ptr + block_size - SKY_BLOCK_DIRECTORY_SIZE(*count));
+
+    return 0;
+
+error:
+    *entries = NULL;
+    *count = 0;
+    return -1;
+}
+
+// Calculates the number of bytes in the block that are available to store
+// path data. Blocks with a directory cannot store data where the directory
+// is stored.
+//
+// block    - The block.
+// capacity - A pointer to where the capacity is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_get_capacity(sky_block *block, size_t *capacity)
+{
+    int rc;
+    check(block != NULL, "Block required");
+    check(block->data_file != NULL, "Data file required");
+
+    *capacity = block->data_file->block_size;
+    if(sky_block_has_directory(block)) {
+        sky_block_directory_entry *entries;
+        uint32_t count;
+        rc = sky_block_get_directory(block, &entries, &count);
+        check(rc == 0, "Unable to retrieve block directory");
+        *capacity -= SKY_BLOCK_DIRECTORY_SIZE(count);
+    }
+
+    return 0;
+
+error:
+    *capacity = 0;
+    return -1;
+}
+
+// Calculates the number of bytes used by the paths in the block. Blocks with
+// a directory only decode the last path. Otherwise every path is walked.
+//
+// block  - The block.
+// length - A pointer to where the data length is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_get_data_length(sky_block *block, size_t *length)
+{
+    int rc;
+    check(block != NULL, "Block required");
+    check(length != NULL, "Length return address required");
+
+    if(sky_block_has_directory(block)) {
+        sky_block_directory_entry *entries;
+        uint32_t count;
+        rc = sky_block_get_directory(block, &entries, &count);
+        check(rc == 0, "Unable to retrieve block directory");
+
+        *length = 0;
+        if(count > 0) {
+            void *block_ptr;
+            rc = sky_block_get_ptr(block, &block_ptr);
+            check(rc == 0, "Unable to retrieve block pointer");
+            *length = entries[count-1].offset + sky_path_sizeof_raw(block_ptr + entries[count-1].offset);
+        }
+    }
+    else {
+        sky_path_iterator iterator;
+        sky_path_iterator_init(&iterator);
+        rc = sky_path_iterator_set_block(&iterator, block);
+        check(rc == 0, "Unable to set path iterator block");
+        while(!iterator.eof) {
+            rc = sky_path_iterator_next(&iterator);
+            check(rc == 0, "Unable to move to next path");
+        }
+        *length = iterator.block_data_length;
+    }
+
+    return 0;
+
+error:
+    *length = 0;
+    return -1;
+}
+
+// Rebuilds the path directory of the block from the paths stored in it.
+// This is used after large changes to a block such as a split. Nothing is
+// done if the block does not have a directory.
+//
+// block - The block.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_build_directory(sky_block *block)
+{
+    int rc;
+    check(block != NULL, "Block required");
+
+    if(!sky_block_has_directory(block)) {
+        return 0;
+    }
+
+    void *block_ptr;
+    rc = sky_block_get_ptr(block, &block_ptr);
+    check(rc == 0, "Unable to retrieve block pointer");
+    rc = sky_block_write_directory(block_ptr, block->data_file->block_size);
+    check(rc == 0, "Unable to write block directory");
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Writes a path directory for the paths stored at the beginning of a block
+// of memory. Any existing directory at the end of the block is replaced.
+// Path data is never stored over an existing directory so the paths are
+// only read up to the start of the existing directory.
+//
+// ptr        - A pointer to the start of the block.
+// block_size - The size of the block, in bytes.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_write_directory(void *ptr, uint32_t block_size)
+{
+    check(ptr != NULL, "Pointer required");
+    check(block_size >= SKY_BLOCK_DIRECTORY_HEADER_SIZE, "Block is too small for a directory");
+
+    // Count the paths that are stored before the existing directory.
+    uint32_t *count_ptr = (uint32_t*)(ptr + block_size - SKY_BLOCK_DIRECTORY_HEADER_SIZE);
+    check(SKY_BLOCK_DIRECTORY_SIZE(*count_ptr) <= block_size, "Block directory is corrupt");
+    size_t limit = block_size - SKY_BLOCK_DIRECTORY_SIZE(*count_ptr);
+    size_t length = 0;
+    uint32_t count = 0;
+    while(length + SKY_PATH_HEADER_LENGTH <= limit && *((sky_object_id_t*)(ptr + length)) != 0) {
+        length += sky_path_sizeof_raw(ptr + length);
+        count++;
+    }
+    check(length + SKY_BLOCK_DIRECTORY_SIZE(count) <= block_size, "Block is too small for its directory");
+
+    // Clear out the old directory and write the new one.
+    memset(ptr + length, 0, block_size - length);
+    sky_block_directory_entry *entries = (sky_block_directory_entry*)(ptr + block_size - SKY_BLOCK_DIRECTORY_SIZE(count));
+    size_t offset = 0;
+    uint32_t i;
+    for(i=0; i<count; i++) {
+        entries[i].object_id = *((sky_object_id_t*)(ptr + offset));
+        entries[i].offset = (uint32_t)offset;
+        offset += sky_path_sizeof_raw(ptr + offset);
+    }
+    *count_ptr = count;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Finds the first directory entry with an object id that is the same as or
+// after a given object id.
+//
+// entries   - The directory entries.
+// count     - The number of directory entries.
+// object_id - The object id to search for.
+// index     - A pointer to where the index of the entry is returned. This is
+//             the number of entries if there is no such entry.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_search_directory(sky_block_directory_entry *entries,
+                               uint32_t count, sky_object_id_t object_id,
+                               uint32_t *index)
+{
+    check(index != NULL, "Index return address required");
+
+    uint32_t min = 0;
+    uint32_t max = count;
+    while(min < max) {
+        uint32_t mid = min + ((max - min) / 2);
+        if(entries[mid].object_id < object_id) {
+            min = mid + 1;
+        }
+        else {
+            max = mid;
+        }
+    }
+    *index = min;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Updates the block directory after data has been inserted into a path. A
+// new entry is added if the data is a new path. The offsets of all paths
+// after the changed path are moved by the size of the inserted data.
+//
+// block       - The block.
+// object_id   - The object id of the changed path.
+// offset      - The offset of the changed path.
+// sz          - The number of bytes inserted.
+// path_exists - A flag stating if the path already existed in the block.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_update_directory(sky_block *block, sky_object_id_t object_id,
+                               size_t offset, size_t sz, bool path_exists)
+{
+    int rc;
+    check(block != NULL, "Block required");
+
+    sky_block_directory_entry *entries;
+    uint32_t count;
+    rc = sky_block_get_directory(block, &entries, &count);
+    check(rc == 0, "Unable to retrieve block directory");
+
+    uint32_t index;
+    rc = sky_block_search_directory(entries, count, object_id, &index);
+    check(rc == 0, "Unable to search block directory");
+
+    // Insert a new entry by moving the earlier entries down.
+    if(!path_exists) {
+        memmove(entries - 1, entries, index * SKY_BLOCK_DIRECTORY_ENTRY_SIZE);
+        entries--;
+        count++;
+        entries[index].object_id = object_id;
+        entries[index].offset = (uint32_t)offset;
+        *((uint32_t*)(entries + count)) = count;
+    }
+    else {
+        check(index < count && entries[index].object_id == object_id, "Path not found in block directory: %d", object_id);
+    }
+
+    // Move the paths after the changed path.
+    uint32_t i;
+    for(i=index+1; i<count; i++) {
+        entries[i].offset += sz;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+
+//--------------------------------------
+// Layout
+//--------------------------------------
+
+// Checks whether the paths in the block are stored in the compact encoding.
+// Since every path in a block uses the same layout only the first path is
+// checked.
+//
+// block - The block.
+//
+// Returns true if the block is compact. Otherwise returns false.
+bool sky_block_is_compact(sky_block *block)
+{
+    void *block_ptr;
+    if(sky_block_get_ptr(block, &block_ptr) != 0) {
+        return false;
+    }
+    return (*((sky_object_id_t*)block_ptr) != 0 && sky_path_is_compact(block_ptr));
+}
+
+// Converts the compact paths in a block back to the row-wise layout so that
+// events can be inserted into them. Compact paths grow when they are
+// expanded. Paths that no longer fit in the block are moved to new blocks at
+// the end of the data file so the caller needs to move them into sorted
+// order. Nothing is done if the block is already row-wise. Compressed blocks
+// are decompressed first.
+//
+// block - The block to convert.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_expand(sky_block *block)
+{
+    int rc;
+    size_t sz;
+    void *buffer = NULL;
+    check(block != NULL, "Block required");
+
+    rc = sky_block_inflate(block);
+    check(rc == 0, "Unable to decompress block");
+
+    if(!sky_block_is_compact(block)) {
+        return 0;
+    }
+
+    // Determine the length of the expanded paths.
+    sky_path_iterator iterator;
+    sky_path_iterator_init(&iterator);
+    rc = sky_path_iterator_set_block(&iterator, block);
+    check(rc == 0, "Unable to set path iterator block");
+
+    size_t length = 0;
+    while(!iterator.eof) {
+        void *path_ptr;
+        rc = sky_path_iterator_get_ptr(&iterator, &path_ptr);
+        check(rc == 0, "Unable to retrieve iterator's current pointer");
+        length += sky_path_sizeof_expanded(path_ptr);
+
+        rc = sky_path_iterator_next(&iterator);
+        check(rc == 0, "Unable to move to next path");
+    }
+    buffer = malloc(length); check_mem(buffer);
+
+    // Convert each path into the buffer.
+    sky_path_iterator_init(&iterator);
+    rc = sky_path_iterator_set_block(&iterator, block);
+    check(rc == 0, "Unable to set path iterator block");
+
+    void *ptr = buffer;
+    while(!iterator.eof) {
+        void *path_ptr;
+        rc = sky_path_iterator_get_ptr(&iterator, &path_ptr);
+        check(rc == 0, "Unable to retrieve iterator's current pointer");
+
+        if(sky_path_is_compact(path_ptr)) {
+            rc = sky_path_expand(path_ptr, ptr, &sz);
+            check(rc == 0, "Unable to expand path");
+        }
+        else {
+            sz = sky_path_sizeof_raw(path_ptr);
+            memcpy(ptr, path_ptr, sz);
+        }
+        ptr += sz;
+
+        rc = sky_path_iterator_next(&iterator);
+        check(rc == 0, "Unable to move to next path");
+    }
+
+    // Blocks with a directory need room for an entry for each path.
+    sky_data_file *data_file = block->data_file;
+    size_t header_size = (sky_block_has_directory(block) ? SKY_BLOCK_DIRECTORY_HEADER_SIZE : 0);
+    size_t entry_size = (sky_block_has_directory(block) ? SKY_BLOCK_DIRECTORY_ENTRY_SIZE : 0);
+
+    // Copy as many paths as fit back into the block and move the rest into
+    // new blocks.
+    sky_block *target_block = block;
+    void *endptr = buffer + length;
+    ptr = buffer;
+    while(ptr < endptr) {
+        void *start = ptr;
+        size_t used = header_size;
+        while(ptr < endptr) {
+            size_t path_length = sky_path_sizeof_raw(ptr);
+            if(used + path_length + entry_size > data_file->block_size) {
+                break;
+            }
+            used += path_length + entry_size;
+            ptr += path_length;
+        }
+        check(ptr > start, "Expanded path is too large for a block");
+
+        if(target_block == NULL) {
+            rc = sky_data_file_create_block(data_file, &target_block);
+            check(rc == 0, "Unable to create new block");
+        }
+
+        void *block_ptr;
+        rc = sky_block_get_ptr(target_block, &block_ptr);
+        check(rc == 0, "Unable to retrieve block pointer");
+        memset(block_ptr, 0, data_file->block_size);
+        memcpy(block_ptr, start, ptr - start);
+
+        // Rebuild the directory and ranges of the block.
+        rc = sky_block_full_update(target_block);
+        check(rc == 0, "Unable to update block ranges");
+
+        // Save block to disk unless the data file is synced lazily.
+        if(data_file->autosync) {
+            rc = sky_block_save(target_block);
+            check(rc == 0, "Unable to save block");
+        }
+
+        target_block = NULL;
+    }
+
+    free(buffer);
+    return 0;
+
+error:
+    free(buffer);
+    return -1;
+}
+
+
+//--------------------------------------
+// Compression
+//--------------------------------------
+
+// Checks whether the block is stored compressed in the data file.
+//
+// block - The block.
+//
+// Returns true if the block is compressed. Otherwise returns false.
+bool sky_block_is_compressed(sky_block *block)
+{
+    void *block_ptr;
+    if(sky_block_get_raw_ptr(block, &block_ptr) != 0) {
+        return false;
+    }
+    return SKY_BLOCK_IS_COMPRESSED(block_ptr);
+}
+
+// Compresses the contents of a block. The compressed block can be larger
+// than the block if the data doesn't compress so the caller should only
+// store it if it is smaller.
 //
-// block  - The block to determine the position for.
-// offset - The offset, in bytes, from the beginning of the header file where
-//          the block data begins.
+// ptr        - A pointer to the block data.
+// block_size - The size of the block.
+// addr       - The address to write the compressed block to.
+// capacity   - The size of the buffer at addr. This needs to be at least
+//              SKY_BLOCK_COMPRESSED_HEADER_SIZE + SKY_LZ_BOUND(block_size).
+// sz         - A pointer to where the compressed block size is returned.
 //
 // Returns 0 if successful, otherwise returns -1.
-int sky_block_get_header_offset(sky_block *block, off_t *offset)
+int sky_block_compress(void *ptr, uint32_t block_size, void *addr,
+                       size_t capacity, size_t *sz)
 {
-    check(block != NULL, "Block required");
-    check(offset != NULL, "Offset pointer required");
+    int rc;
+    size_t length;
+    check(ptr != NULL, "Block pointer required");
+    check(addr != NULL, "Address required");
+    check(capacity >= SKY_BLOCK_COMPRESSED_HEADER_SIZE + SKY_LZ_BOUND(block_size), "Compression buffer too small");
+
+    rc = sky_lz_compress(ptr, block_size, addr + SKY_BLOCK_COMPRESSED_HEADER_SIZE, capacity - SKY_BLOCK_COMPRESSED_HEADER_SIZE, &length);
+    check(rc == 0, "Unable to compress block");
+
+    *((sky_object_id_t*)addr) = 0;
+    *((uint32_t*)(addr + sizeof(sky_object_id_t))) = SKY_BLOCK_COMPRESSED_MAGIC;
+    *((uint32_t*)(addr + sizeof(sky_object_id_t) + sizeof(uint32_t))) = (uint32_t)length;
+    *sz = SKY_BLOCK_COMPRESSED_HEADER_SIZE + length;
 
-    *offset = ((uint32_t)SKY_HEADER_FILE_HDR_SIZE) + (block->index * ((uint32_t)SKY_BLOCK_HEADER_SIZE));
     return 0;
-    
+
 error:
-    *offset = 0;
+    *sz = 0;
     return -1;
 }
 
-//--------------------------------------
-// Block Position
-//--------------------------------------
-
-// Calculates the byte offset for the beginning on the block in the
-// data file based on the data file block size and the block index.
+// Decompresses a compressed block.
 //
-// block  - The block to calculate the byte offset of.
-// offset - A pointer to where the offset will be returned to.
+// ptr        - A pointer to the compressed block.
+// block_size - The size of the block.
+// addr       - The address to write the block to.
 //
 // Returns 0 if successful, otherwise returns -1.
-int sky_block_get_offset(sky_block *block, size_t *offset)
+int sky_block_decompress(void *ptr, uint32_t block_size, void *addr)
 {
-    check(block != NULL, "Block required");
-    check(block->data_file != NULL, "Data file required");
-    check(block->data_file->block_size != 0, "Data file must have a nonzero block size");
+    int rc;
+    check(ptr != NULL, "Block pointer required");
+    check(addr != NULL, "Address required");
+    check(SKY_BLOCK_IS_COMPRESSED(ptr), "Block is not compressed");
+
+    uint32_t length = *((uint32_t*)(ptr + sizeof(sky_object_id_t) + sizeof(uint32_t)));
+    check(SKY_BLOCK_COMPRESSED_HEADER_SIZE + length <= block_size, "Compressed block is corrupt");
+    rc = sky_lz_decompress(ptr + SKY_BLOCK_COMPRESSED_HEADER_SIZE, length, addr, block_size);
+    check(rc == 0, "Unable to decompress block");
 
-    *offset = (block->data_file->block_size * block->index);
     return 0;
 
 error:
-    *offset = 0;
     return -1;
 }
 
-// Calculates the pointer position for the beginning on the block in the
-// data file based on the data file block size and the block index.
+// Decompresses a compressed block back into its slot in the data file so
+// that it can be written to. Nothing is done if the block is not compressed.
 //
-// block - The block to calculate the byte offset of.
-// ptr   - A pointer to where the blocks starting address will be set.
+// block - The block to decompress.
 //
 // Returns 0 if successful, otherwise returns -1.
-int sky_block_get_ptr(sky_block *block, void **ptr)
+int sky_block_inflate(sky_block *block)
 {
+    int rc;
     check(block != NULL, "Block required");
-    check(block->data_file != NULL, "Data file required");
-    check(block->data_file->data != NULL, "Data file must be mapped");
 
-    // Retrieve the offset.
-    size_t offset;
-    int rc = sky_block_get_offset(block, &offset);
-    check(rc == 0, "Unable to determine block offset");
+    if(!sky_block_is_compressed(block)) {
+        return 0;
+    }
+
+    // Copy the cached block over the compressed data and drop it from the
+    // cache.
+    void *raw_ptr, *ptr;
+    rc = sky_block_get_raw_ptr(block, &raw_ptr);
+    check(rc == 0, "Unable to retrieve block pointer");
+    rc = sky_block_get_ptr(block, &ptr);
+    check(rc == 0, "Unable to retrieve decompressed block");
+    memcpy(raw_ptr, ptr, block->data_file->block_size);
+    rc = sky_block_cache_remove(block->data_file->block_cache, block);
+    check(rc == 0, "Unable to remove block from cache");
+
+    if(block->data_file->autosync) {
+        rc = sky_block_save(block);
+        check(rc == 0, "Unable to save block");
+    }
 
-    // Calculate pointer based on data pointer.
-    *ptr = block->data_file->data + offset;
-    
     return 0;
 
 error:
-    *ptr = NULL;
     return -1;
 }
 
-
 //--------------------------------------
 // Spanning
 //--------------------------------------
@@ -524,9 +1130,13 @@ int sky_block_span_with_event(sky_block *block, sky_event *new_event,
     uint32_t event_count = 0;
     sky_path_event_stat *events;
 
-    // Retrieve block size.
+    // Retrieve the space available to a spanned path. Spanned blocks only
+    // hold a single path so a directory only needs room for one entry.
     sky_data_file *data_file = block->data_file;
-    uint32_t block_size = data_file->block_size;
+    size_t block_size = data_file->block_size;
+    if(sky_block_has_directory(block)) {
+        block_size -= SKY_BLOCK_DIRECTORY_SIZE(1);
+    }
     
     // Retrieve block pointer.
     void *block_ptr = NULL;
@@ -591,8 +1201,9 @@ int sky_block_span_with_event(sky_block *block, sky_event *new_event,
                 rc = sky_data_file_create_block(data_file, &new_block);
                 check(rc == 0, "Unable to create new block");
 
-                // Restore path pointer.
+                // Restore pointers in case remap relocated data.
                 path_ptr = data_file->data + path_off;
+                ptr = path_ptr + start_pos;
 
                 // Retrieve the new block's pointer.
                 rc = sky_block_get_ptr(new_block, &new_block_ptr);
@@ -620,9 +1231,12 @@ int sky_block_span_with_event(sky_block *block, sky_event *new_event,
                 check(rc == 0, "Unable to write path header");
             }
 
-            // Update block ranges.
-            rc = sky_block_full_update(new_block);
-            check(rc == 0, "Unable to update block ranges");
+            // Update block ranges. The original block still contains the
+            // rest of the path at this point so it is updated at the end.
+            if(new_block != block) {
+                rc = sky_block_full_update(new_block);
+                check(rc == 0, "Unable to update block ranges");
+            }
 
             // If new block contains the event timestamp in range then
             // set it as the target block.
@@ -661,7 +1275,8 @@ error:
 
 // Generates an index of stats on all the paths in the block. If an event is
 // passed in then it also generates stats on the path the event would be
-// added to or a new path that would be created from that event.
+// added to or a new path that would be created from that event. Blocks with
+// a directory use the directory offsets instead of decoding each path.
 //
 // block      - The block to calculate stats on.
 // event      - A soon-to-be-added event to calculate into the paths. If null then
@@ -682,12 +1297,6 @@ int sky_block_get_path_stats(sky_block *block, sky_event *event,
     rc = sky_block_get_ptr(block, &block_ptr);
     check(rc == 0, "Unable to retrieve block pointer");
     
-    // Initialize path iterator.
-    sky_path_iterator iterator;
-    sky_path_iterator_init(&iterator);
-    rc = sky_path_iterator_set_block(&iterator, block);
-    check(rc == 0, "Unable to set path iterator block");
-
     // Calculate size of the event.
     size_t event_length = (event != NULL ? sky_event_sizeof(event) : 0);
 
@@ -695,57 +1304,78 @@ int sky_block_get_path_stats(sky_block *block, sky_event *event,
     *path_count = 0;
     *paths = NULL;
  
-    // Loop over iterator to calculate sizes of the paths.
+    // Read the path positions from the directory if there is one.
     sky_object_id_t last_object_id = 0;
-    while(!iterator.eof) {
-        // Retrieve path pointer.
-        void *path_ptr = NULL;
-        rc = sky_path_iterator_get_ptr(&iterator, &path_ptr);
-        check(rc == 0, "Unable to retrieve iterator's current pointer");
+    size_t block_data_length = 0;
+    if(sky_block_has_directory(block)) {
+        sky_block_directory_entry *entries;
+        uint32_t count;
+        rc = sky_block_get_directory(block, &entries, &count);
+        check(rc == 0, "Unable to retrieve block directory");
+        rc = sky_block_get_data_length(block, &block_data_length);
+        check(rc == 0, "Unable to determine block data length");
+
+        uint32_t i;
+        for(i=0; i<count; i++) {
+            sky_object_id_t object_id = entries[i].object_id;
+            size_t start_pos = entries[i].offset;
+            size_t end_pos = (i < count-1 ? entries[i+1].offset : block_data_length);
+
+            // Check if event is a new path inserted before this path.
+            if(event != NULL && event->object_id > last_object_id && event->object_id < object_id) {
+                rc = sky_block_append_path_stat(paths, path_count, event->object_id, start_pos, start_pos, SKY_PATH_HEADER_LENGTH + event_length);
+                check(rc == 0, "Unable to append path stat");
+            }
 
-        // Check if event is a new path inserted between the last path and
-        // this current path.
-        if(event != NULL && event->object_id > last_object_id && event->object_id < iterator.current_object_id) {
-            // Increment paths array.
-            (*path_count)++;
-            *paths = realloc(*paths, sizeof(sky_block_path_stat) * (*path_count));
-            sky_block_path_stat *stat = &((*paths)[(*path_count)-1]);
-            stat->object_id = event->object_id;
-            stat->start_pos = stat->end_pos = (path_ptr - block_ptr);
-            stat->sz = SKY_PATH_HEADER_LENGTH + event_length;
+            // Add insertion event length if this is the matching path.
+            size_t sz = (end_pos - start_pos) + (event != NULL && event->object_id == object_id ? event_length : 0);
+            rc = sky_block_append_path_stat(paths, path_count, object_id, start_pos, end_pos, sz);
+            check(rc == 0, "Unable to append path stat");
+            last_object_id = object_id;
         }
+    }
+    // Otherwise loop over the paths to calculate their sizes.
+    else {
+        sky_path_iterator iterator;
+        sky_path_iterator_init(&iterator);
+        rc = sky_path_iterator_set_block(&iterator, block);
+        check(rc == 0, "Unable to set path iterator block");
+
+        while(!iterator.eof) {
+            // Retrieve path pointer.
+            void *path_ptr = NULL;
+            rc = sky_path_iterator_get_ptr(&iterator, &path_ptr);
+            check(rc == 0, "Unable to retrieve iterator's current pointer");
+
+            // Check if event is a new path inserted between the last path and
+            // this current path.
+            size_t start_pos = path_ptr - block_ptr;
+            if(event != NULL && event->object_id > last_object_id && event->object_id < iterator.current_object_id) {
+                rc = sky_block_append_path_stat(paths, path_count, event->object_id, start_pos, start_pos, SKY_PATH_HEADER_LENGTH + event_length);
+                check(rc == 0, "Unable to append path stat");
+            }
+            
+            // Calculate current path stats and add insertion event length if
+            // this is the matching path.
+            size_t path_length = sky_path_sizeof_raw(path_ptr);
+            size_t sz = path_length + (event != NULL && event->object_id == iterator.current_object_id ? event_length : 0);
+            rc = sky_block_append_path_stat(paths, path_count, iterator.current_object_id, start_pos, start_pos + path_length, sz);
+            check(rc == 0, "Unable to append path stat");
+
+            // Save off this object id.
+            last_object_id = iterator.current_object_id;
         
-        // Calculate current path stats.
-        size_t path_length = sky_path_sizeof_raw(path_ptr);
-        (*path_count)++;
-        *paths = realloc(*paths, sizeof(sky_block_path_stat) * (*path_count));
-        sky_block_path_stat *stat = &((*paths)[(*path_count)-1]);
-        stat->object_id = iterator.current_object_id;
-        stat->start_pos = path_ptr - block_ptr;
-        stat->end_pos = stat->start_pos + path_length;
-        stat->sz = path_length;
-    
-        // Add insertion event length if this is the matching path.
-        if(event != NULL && event->object_id == iterator.current_object_id) {
-            stat->sz += event_length;
+            // Move to next path.
+            rc = sky_path_iterator_next(&iterator);
+            check(rc == 0, "Unable to move to next path");
         }
-
-        // Save off this object id.
-        last_object_id = iterator.current_object_id;
-    
-        // Move to next path.
-        rc = sky_path_iterator_next(&iterator);
-        check(rc == 0, "Unable to move to next path");
+        block_data_length = iterator.block_data_length;
     }
 
     // Check if event is a new path inserted at the end.
     if(event != NULL && event->object_id > last_object_id) {
-        (*path_count)++;
-        *paths = realloc(*paths, sizeof(sky_block_path_stat) * (*path_count));
-        sky_block_path_stat *stat = &((*paths)[(*path_count)-1]);
-        stat->object_id = event->object_id;
-        stat->start_pos = stat->end_pos = iterator.block_data_length;
-        stat->sz = SKY_PATH_HEADER_LENGTH + event_length;
+        rc = sky_block_append_path_stat(paths, path_count, event->object_id, block_data_length, block_data_length, SKY_PATH_HEADER_LENGTH + event_length);
+        check(rc == 0, "Unable to append path stat");
     }
     
     return 0;
@@ -757,6 +1387,37 @@ error:
     return -1;
 }
 
+// Appends a path stat to the end of a list of path stats.
+//
+// paths      - A pointer to the list of path stats.
+// path_count - A pointer to the number of path stats.
+// object_id  - The object id of the path.
+// start_pos  - The starting position of the path in the block.
+// end_pos    - The ending position of the path in the block.
+// sz         - The size of the path once the pending event is added.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_append_path_stat(sky_block_path_stat **paths,
+                               uint32_t *path_count, sky_object_id_t object_id,
+                               size_t start_pos, size_t end_pos, size_t sz)
+{
+    sky_block_path_stat *new_paths = realloc(*paths, sizeof(sky_block_path_stat) * ((*path_count)+1));
+    check_mem(new_paths);
+    *paths = new_paths;
+
+    sky_block_path_stat *stat = &((*paths)[*path_count]);
+    stat->object_id = object_id;
+    stat->start_pos = start_pos;
+    stat->end_pos = end_pos;
+    stat->sz = sz;
+    (*path_count)++;
+
+    return 0;
+
+error:
+    return -1;
+}
+
 
 
 //--------------------------------------
@@ -779,6 +1440,12 @@ int sky_block_add_event(sky_block *block, sky_event *event)
     check(block->data_file != NULL, "Block data file required");
     check(block->data_file->block_size > 0, "Block data file must have a nonzero block size");
 
+    // Events can only be inserted into uncompressed row-wise paths. Blocks
+    // are expanded by the data file since expanding can move paths into new
+    // blocks.
+    check(!sky_block_is_compressed(block), "Events cannot be added to compressed blocks");
+    check(!sky_block_is_compact(block), "Events can only be added to row-wise blocks");
+
     // Store the block pointer.
     void *block_ptr;
     rc = sky_block_get_ptr(block, &block_ptr);
@@ -800,10 +1467,17 @@ int sky_block_add_event(sky_block *block, sky_event *event)
     bool path_exists = (event_ptr != NULL);
     size_t event_length = sky_event_sizeof(event);
     size_t sz = event_length + (!path_exists ? SKY_PATH_HEADER_LENGTH : 0);
+
+    // Determine the space available for data. A new path also needs a new
+    // entry in the block directory.
+    size_t capacity;
+    rc = sky_block_get_capacity(block, &capacity);
+    check(rc == 0, "Unable to determine block capacity");
+    size_t directory_sz = (sky_block_has_directory(block) && !path_exists ? SKY_BLOCK_DIRECTORY_ENTRY_SIZE : 0);
     
     // If adding the event will cause a split then go ahead and split and
     // recall this function.
-    if(block_data_length + sz > block->data_file->block_size) {
+    if(block_data_length + sz + directory_sz > capacity) {
         sky_block *target_block;
         rc = sky_block_split_with_event(block, event, &target_block);
         check(rc == 0, "Unable to split block");
@@ -844,10 +1518,18 @@ int sky_block_add_event(sky_block *block, sky_event *event)
     size_t event_sz;
     rc = sky_event_pack(event, event_ptr, &event_sz);
     check(rc == 0, "Unable to pack event");
+
+    // Add the path to the directory and move the paths after it.
+    if(sky_block_has_directory(block)) {
+        rc = sky_block_update_directory(block, event->object_id, path_ptr - block_ptr, event_length + (!path_exists ? SKY_PATH_HEADER_LENGTH : 0), path_exists);
+        check(rc == 0, "Unable to update block directory");
+    }
     
-    // Save block to disk.
-    rc = sky_block_save(block);
-    check(rc == 0, "Unable to save block");
+    // Save block to disk unless the data file is synced lazily.
+    if(block->data_file->autosync) {
+        rc = sky_block_save(block);
+        check(rc == 0, "Unable to save block");
+    }
     
     // Update header.
     rc = sky_block_update(block, event->object_id, event->timestamp);
@@ -859,6 +1541,173 @@ error:
     return -1;
 }
 
+// Merges a sorted batch of events into the block in a single pass. The block
+// is rewritten once and the header is updated once for the whole batch. If
+// the merged data will not fit in the block then the block is left untouched
+// and the caller is expected to fall back to adding the events individually.
+//
+// Events must be sorted by object id and then by timestamp. Events with the
+// same timestamp as an existing event are inserted before it, which matches
+// the ordering of sky_block_add_event().
+//
+// block  - The block to add the events to.
+// events - The sorted events to add to the block.
+// count  - The number of events.
+// ret    - A pointer to where the flag stating if the events were added
+//          is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_add_events(sky_block *block, sky_event **events, uint32_t count,
+                         bool *ret)
+{
+    int rc;
+    size_t sz;
+    void *buffer = NULL;
+    check(block != NULL, "Block required");
+    check(events != NULL, "Events required");
+    check(ret != NULL, "Return pointer required");
+    check(block->data_file != NULL, "Block data file required");
+    check(block->data_file->block_size > 0, "Block data file must have a nonzero block size");
+
+    *ret = false;
+    if(count == 0) {
+        *ret = true;
+        return 0;
+    }
+
+    // Events can only be merged into uncompressed row-wise paths. Other
+    // blocks are left for the caller to expand and add to one event at a time.
+    if(sky_block_is_compressed(block) || sky_block_is_compact(block)) {
+        return 0;
+    }
+
+    uint32_t block_size = block->data_file->block_size;
+    buffer = calloc(block_size, 1); check_mem(buffer);
+
+    // Initialize path iterator.
+    sky_path_iterator iterator;
+    sky_path_iterator_init(&iterator);
+    rc = sky_path_iterator_set_block(&iterator, block);
+    check(rc == 0, "Unable to set path iterator block");
+
+    // Merge the existing paths and the new events into the buffer. Blocks
+    // with a directory lose space at the end of the block for each path.
+    bool has_directory = sky_block_has_directory(block);
+    void *out = buffer;
+    void *endptr = buffer + block_size - (has_directory ? SKY_BLOCK_DIRECTORY_HEADER_SIZE : 0);
+    uint32_t index = 0;
+    while(!iterator.eof || index < count) {
+        void *path_ptr = NULL;
+        if(!iterator.eof) {
+            rc = sky_path_iterator_get_ptr(&iterator, &path_ptr);
+            check(rc == 0, "Unable to retrieve iterator's current pointer");
+        }
+        if(has_directory) {
+            endptr -= SKY_BLOCK_DIRECTORY_ENTRY_SIZE;
+        }
+
+        // Copy the existing path as-is if no events belong before it or in it.
+        if(path_ptr != NULL && (index == count || events[index]->object_id > iterator.current_object_id)) {
+            size_t path_length = sky_path_sizeof_raw(path_ptr);
+            if(out + path_length > endptr) goto exit;
+            memcpy(out, path_ptr, path_length);
+            out += path_length;
+        }
+        // Otherwise write the path and merge in its new events.
+        else {
+            sky_object_id_t object_id = events[index]->object_id;
+            bool path_exists = (path_ptr != NULL && object_id == iterator.current_object_id);
+            void *path_out = out;
+            if(out + SKY_PATH_HEADER_LENGTH > endptr) goto exit;
+            out += SKY_PATH_HEADER_LENGTH;
+
+            void *event_ptr = (path_exists ? path_ptr + SKY_PATH_HEADER_LENGTH : NULL);
+            void *event_endptr = (path_exists ? path_ptr + sky_path_sizeof_raw(path_ptr) : NULL);
+            while(event_ptr < event_endptr || (index < count && events[index]->object_id == object_id)) {
+                // Use the new event if it sorts before the existing event.
+                bool use_new = (index < count && events[index]->object_id == object_id);
+                if(use_new && event_ptr < event_endptr) {
+                    sky_timestamp_t timestamp;
+                    sky_action_id_t action_id;
+                    sky_event_data_length_t data_length;
+                    rc = sky_event_unpack_hdr(&timestamp, &action_id, &data_length, event_ptr, &sz);
+                    check(rc == 0, "Unable to unpack event header");
+                    use_new = (timestamp >= events[index]->timestamp);
+                }
+
+                if(use_new) {
+                    if(out + sky_event_sizeof(events[index]) > endptr) goto exit;
+                    rc = sky_event_pack(events[index], out, &sz);
+                    check(rc == 0, "Unable to pack event");
+                    out += sz;
+                    index++;
+                }
+                else {
+                    size_t event_length = sky_event_sizeof_raw(event_ptr);
+                    if(out + event_length > endptr) goto exit;
+                    memcpy(out, event_ptr, event_length);
+                    out += event_length;
+                    event_ptr += event_length;
+                }
+            }
+
+            // Write the path header now that its length is known.
+            rc = sky_path_pack_hdr(object_id, (out - path_out) - SKY_PATH_HEADER_LENGTH, path_out, &sz);
+            check(rc == 0, "Unable to pack path header");
+            
+            // Only move the iterator forward if the path was consumed.
+            if(!path_exists) {
+                continue;
+            }
+        }
+
+        rc = sky_path_iterator_next(&iterator);
+        check(rc == 0, "Unable to move to next path");
+    }
+
+    // Write the directory for the merged paths.
+    if(has_directory) {
+        rc = sky_block_write_directory(buffer, block_size);
+        check(rc == 0, "Unable to write block directory");
+    }
+
+    // Copy the merged data back into the block.
+    void *block_ptr;
+    rc = sky_block_get_ptr(block, &block_ptr);
+    check(rc == 0, "Unable to retrieve block pointer");
+    memcpy(block_ptr, buffer, block_size);
+
+    // Save block to disk unless the data file is synced lazily.
+    if(block->data_file->autosync) {
+        rc = sky_block_save(block);
+        check(rc == 0, "Unable to save block");
+    }
+
+    // Update header once using the batch's range. Object ids and timestamps
+    // are widened independently so the first and last event cover the ids.
+    sky_timestamp_t min_timestamp = events[0]->timestamp;
+    sky_timestamp_t max_timestamp = events[0]->timestamp;
+    uint32_t i;
+    for(i=1; i<count; i++) {
+        if(events[i]->timestamp < min_timestamp) min_timestamp = events[i]->timestamp;
+        if(events[i]->timestamp > max_timestamp) max_timestamp = events[i]->timestamp;
+    }
+    rc = sky_block_update(block, events[0]->object_id, min_timestamp);
+    check(rc == 0, "Unable to write block to header");
+    rc = sky_block_update(block, events[count-1]->object_id, max_timestamp);
+    check(rc == 0, "Unable to write block to header");
+
+    *ret = true;
+
+exit:
+    free(buffer);
+    return 0;
+
+error:
+    free(buffer);
+    return -1;
+}
+
 // Calculates the information needed to perform an insertion of an event into
 // a block. The path pointer points to where the path is or should be inserted
 // into. The event pointer points to where the event should be inserted into.
@@ -866,6 +1715,9 @@ error:
 // data length is how many bytes in the block are actually used to store data
 // (and are not empty).
 //
+// Blocks with a directory find the path with a binary search. Otherwise the
+// paths are walked until the path or the insertion point is found.
+//
 // block     - The block to add the event to.
 // event     - The event to add to the block.
 // path_ptr  - A pointer to where the path pointer should be returned to.
@@ -882,59 +1734,55 @@ int sky_block_get_insertion_info(sky_block *block, sky_event *event,
     check(block != NULL, "Block required");
     check(event != NULL, "Event required");
 
+    // Initialize path and event pointers.
+    *path_ptr  = NULL;
+    *event_ptr = NULL;
+
+    // Search the directory for the path or the insertion point.
+    if(sky_block_has_directory(block)) {
+        sky_block_directory_entry *entries;
+        uint32_t count;
+        rc = sky_block_get_directory(block, &entries, &count);
+        check(rc == 0, "Unable to retrieve block directory");
+
+        uint32_t index;
+        rc = sky_block_search_directory(entries, count, event->object_id, &index);
+        check(rc == 0, "Unable to search block directory");
+
+        if(index < count) {
+            void *block_ptr;
+            rc = sky_block_get_ptr(block, &block_ptr);
+            check(rc == 0, "Unable to retrieve block pointer");
+            *path_ptr = block_ptr + entries[index].offset;
+
+            if(entries[index].object_id == event->object_id) {
+                rc = sky_block_get_event_insertion_ptr(*path_ptr, event, event_ptr);
+                check(rc == 0, "Unable to find event insertion point");
+            }
+        }
+
+        rc = sky_block_get_data_length(block, block_data_length);
+        check(rc == 0, "Unable to determine block data length");
+        return 0;
+    }
+
     // Initialize path iterator.
     sky_path_iterator iterator;
     sky_path_iterator_init(&iterator);
     rc = sky_path_iterator_set_block(&iterator, block);
     check(rc == 0, "Unable to set path iterator block");
 
-    // Initialize path and event pointers.
-    *path_ptr  = NULL;
-    *event_ptr = NULL;
-    
     // Loop over iterator until we find the path or insertion point.
     while(!iterator.eof) {
         // If we reached the correct path then retrieve the path pointer
-        // and then use a cursor to find the insertion point.
+        // and then find the insertion point.
         if(event->object_id == iterator.current_object_id) {
             // Save path pointer.
             rc = sky_path_iterator_get_ptr(&iterator, path_ptr);
             check(rc == 0, "Unable to retrieve iterator's current pointer");
             
-            // Use cursor to find event insertion point.
-            sky_cursor cursor;
-            sky_cursor_init(&cursor);
-            sky_cursor_set_path(&cursor, *path_ptr);
-            check(rc == 0, "Unable to set cursor path");
-            
-            // Loop over cursor until we reach the event insertion point.
-            while(!cursor.eof) {
-                sky_timestamp_t timestamp;
-                sky_action_id_t action_id;
-                sky_event_data_length_t data_length;
-
-                // Retrieve current timestamp in cursor.
-                size_t hdrsz;
-                rc = sky_event_unpack_hdr(&timestamp, &action_id, &data_length, cursor.ptr, &hdrsz);
-                check(rc == 0, "Unable to unpack event header");
-                
-                // Retrieve event insertion pointer once the timestamp is
-                // reached.
-                if(timestamp >= event->timestamp) {
-                    *event_ptr = cursor.ptr;
-                    break;
-                }
-                
-                // Move to next event.
-                rc = sky_cursor_next(&cursor);
-                check(rc == 0, "Unable to move to next event");
-            }
-            
-            // If no insertion point was found then append the event to the
-            // end of the path.
-            if(*event_ptr == NULL) {
-                *event_ptr = (*path_ptr) + sky_path_sizeof_raw(*path_ptr);
-            }
+            rc = sky_block_get_event_insertion_ptr(*path_ptr, event, event_ptr);
+            check(rc == 0, "Unable to find event insertion point");
         }
         // If we are beyond the object id then exit and use the current
         // pointer as the insertion point.
@@ -961,6 +1809,147 @@ error:
     return -1;
 }
 
+// Finds where an event should be inserted into a path. Events are inserted
+// before the first event with the same or a later timestamp. If there is no
+// such event then the end of the path is returned.
+//
+// path_ptr  - A pointer to the raw path.
+// event     - The event being inserted.
+// event_ptr - A pointer to where the event pointer should be returned to.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_get_event_insertion_ptr(void *path_ptr, sky_event *event,
+                                      void **event_ptr)
+{
+    int rc;
+    check(path_ptr != NULL, "Path pointer required");
+    check(event != NULL, "Event required");
+
+    *event_ptr = NULL;
+
+    // Use cursor to find event insertion point.
+    sky_cursor cursor;
+    sky_cursor_init(&cursor);
+    sky_cursor_set_path(&cursor, path_ptr);
+    
+    // Loop over cursor until we reach the event insertion point.
+    while(!cursor.eof) {
+        // Retrieve current timestamp in cursor.
+        sky_timestamp_t timestamp;
+        rc = sky_cursor_get_timestamp(&cursor, &timestamp);
+        check(rc == 0, "Unable to retrieve event timestamp");
+        
+        // Retrieve event insertion pointer once the timestamp is
+        // reached.
+        if(timestamp >= event->timestamp) {
+            *event_ptr = cursor.ptr;
+            break;
+        }
+        
+        // Move to next event.
+        rc = sky_cursor_next(&cursor);
+        check(rc == 0, "Unable to move to next event");
+    }
+    sky_cursor_set_path(&cursor, NULL);
+    
+    // If no insertion point was found then append the event to the
+    // end of the path.
+    if(*event_ptr == NULL) {
+        *event_ptr = path_ptr + sky_path_sizeof_raw(path_ptr);
+    }
+
+    return 0;
+
+error:
+    sky_cursor_set_path(&cursor, NULL);
+    *event_ptr = NULL;
+    return -1;
+}
+
+// Checks whether an identical event exists in the block. An event matches if
+// it is in the same path, has the same timestamp and has the same serialized
+// contents.
+//
+// block - The block to search.
+// event - The event to search for.
+// ret   - A pointer to where the result flag is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_contains_event(sky_block *block, sky_event *event, bool *ret)
+{
+    int rc;
+    void *buffer = NULL;
+    sky_cursor cursor;
+    sky_cursor_init(&cursor);
+    check(block != NULL, "Block required");
+    check(event != NULL, "Event required");
+    check(ret != NULL, "Return pointer required");
+
+    *ret = false;
+
+    // Find where the event would be inserted.
+    void *path_ptr, *event_ptr;
+    size_t block_data_length;
+    rc = sky_block_get_insertion_info(block, event, &path_ptr, &event_ptr, &block_data_length);
+    check(rc == 0, "Unable to determine insertion info");
+
+    // If the path doesn't exist then the event doesn't either.
+    if(event_ptr == NULL) {
+        return 0;
+    }
+
+    // Serialize the event for comparison.
+    size_t event_length = sky_event_sizeof(event);
+    buffer = malloc(event_length); check_mem(buffer);
+    size_t sz;
+    rc = sky_event_pack(event, buffer, &sz);
+    check(rc == 0, "Unable to pack event");
+    void *data_ptr = NULL;
+    uint32_t data_length = sky_event_sizeof_data(event);
+    if(data_length > 0) {
+        data_ptr = buffer + (event_length - data_length);
+    }
+
+    // Compare the action and data of each event with the same timestamp.
+    rc = sky_cursor_set_path(&cursor, path_ptr);
+    check(rc == 0, "Unable to set cursor path");
+    while(!cursor.eof) {
+        sky_timestamp_t timestamp;
+        rc = sky_cursor_get_timestamp(&cursor, &timestamp);
+        check(rc == 0, "Unable to retrieve event timestamp");
+        if(timestamp > event->timestamp) {
+            break;
+        }
+        else if(timestamp == event->timestamp) {
+            sky_action_id_t action_id;
+            void *current_data_ptr;
+            uint32_t current_data_length;
+            rc = sky_cursor_get_action_id(&cursor, &action_id);
+            check(rc == 0, "Unable to retrieve action id");
+            rc = sky_cursor_get_data_ptr(&cursor, &current_data_ptr, &current_data_length);
+            check(rc == 0, "Unable to retrieve data pointer");
+            if(action_id == event->action_id && current_data_length == data_length &&
+               (data_length == 0 || memcmp(current_data_ptr, data_ptr, data_length) == 0))
+            {
+                *ret = true;
+                break;
+            }
+        }
+
+        rc = sky_cursor_next(&cursor);
+        check(rc == 0, "Unable to move to next event");
+    }
+    sky_cursor_set_path(&cursor, NULL);
+
+    free(buffer);
+    return 0;
+
+error:
+    sky_cursor_set_path(&cursor, NULL);
+    free(buffer);
+    return -1;
+}
+
 // Iterates over a block and splits it into smaller blocks. The block attempts
 // to create blocks which are half the maximum size although this is not
 // always possible because of path sizes.
@@ -990,8 +1979,16 @@ int sky_block_split_with_event(sky_block *block, sky_event *event,
 
     // Calculate target block size.
     sky_data_file *data_file = block->data_file;
-    uint32_t block_size = data_file->block_size;
-    uint32_t target_size = (block_size / 2);
+    uint32_t target_size = (data_file->block_size / 2);
+
+    // Blocks with a directory lose space for the directory header and for
+    // an entry for each path.
+    size_t block_size = data_file->block_size;
+    size_t entry_size = 0;
+    if(sky_block_has_directory(block)) {
+        block_size -= SKY_BLOCK_DIRECTORY_HEADER_SIZE;
+        entry_size = SKY_BLOCK_DIRECTORY_ENTRY_SIZE;
+    }
 
     // Retrieve a list of path sizes in the current block (plus new event).
     rc = sky_block_get_path_stats(block, event, &paths, &path_count);
@@ -1006,7 +2003,7 @@ int sky_block_split_with_event(sky_block *block, sky_event *event,
         sky_block_path_stat *path = &(paths[i]);
 
         // If this path will exceed the block size then create a span.
-        if(path->sz > block_size) {
+        if(path->sz + entry_size > block_size) {
             // Retrieve the block pointer.
             void *block_ptr = NULL;
             rc = sky_block_get_ptr(block, &block_ptr);
@@ -1063,13 +2060,13 @@ int sky_block_split_with_event(sky_block *block, sky_event *event,
             sky_block_path_stat *next_path = (i < path_count-1 ? &(paths[i+1]) : NULL);
 
             // Add the path size to the running total.
-            sz += path->sz;
+            sz += path->sz + entry_size;
 
             // If we exceeded the target size or if there is remaining data
             // in an already split block then move everything to a new block.
             bool exceeds_target_size = (sz >= target_size);
             bool is_last_path = (i == path_count-1 && last_index > 0);
-            bool next_path_exceeds_max = (next_path != NULL && sz + next_path->sz > block_size);
+            bool next_path_exceeds_max = (next_path != NULL && sz + next_path->sz + entry_size > block_size);
             if(exceeds_target_size || is_last_path || next_path_exceeds_max) {
                 sky_block_path_stat *last_path = &(paths[last_index]);
 
@@ -9,6 +9,7 @@ typedef struct sky_block sky_block;
 #include "bstring.h"
 #include "file.h"
 #include "types.h"
+#include "block_cache.h"
 #include "data_file.h"
 #include "event.h"
 
@@ -24,6 +25,33 @@ typedef struct sky_block sky_block;
 //
 // The block also stores whether it is spanned, meaning that the
 // object that it contains is stored across multiple blocks.
+//
+// In version 2 data files each block ends with a path directory. The paths
+// are still stored from the start of the block but the last four bytes of the
+// block hold the number of paths and the directory entries are stored just
+// before that in object id order:
+//
+//     BLOCK = PATH* FREE_SPACE DIRECTORY_ENTRY* PATH_COUNT
+//     DIRECTORY_ENTRY = OBJECT_ID OFFSET
+//
+// The directory is kept up to date on every insert so that paths can be
+// found with a binary search and the size of each path is known without
+// decoding it.
+//
+// Compaction can store the paths of a block in the compact encoding. All of
+// the paths in a block use the same layout. Compact blocks are converted back
+// to the row-wise layout before events are added to them, which can move
+// some of their paths into new blocks.
+//
+// Compaction can also compress whole blocks. A compressed block starts with
+// a zero object id so it can't be mistaken for a path, followed by a magic
+// number and the length of the compressed data:
+//
+//     COMPRESSED_BLOCK = 0x00000000 MAGIC LENGTH DATA
+//
+// sky_block_get_ptr() returns the decompressed block from the data file's
+// block cache so compressed blocks are read like any other block. Compressed
+// blocks are decompressed in place before events are added to them.
 
 
 //==============================================================================
@@ -32,7 +60,19 @@ typedef struct sky_block sky_block;
 //
 //==============================================================================
 
-#define SKY_BLOCK_HEADER_SIZE (sizeof(sky_object_id_t) * 2) + (sizeof(sky_timestamp_t) * 2)
+#define SKY_BLOCK_HEADER_SIZE ((sizeof(sky_object_id_t) * 2) + (sizeof(sky_timestamp_t) * 2))
+
+#define SKY_BLOCK_DIRECTORY_HEADER_SIZE sizeof(uint32_t)
+
+#define SKY_BLOCK_DIRECTORY_ENTRY_SIZE (sizeof(sky_object_id_t) + sizeof(uint32_t))
+
+#define SKY_BLOCK_DIRECTORY_SIZE(PATH_COUNT) (SKY_BLOCK_DIRECTORY_HEADER_SIZE + ((PATH_COUNT) * SKY_BLOCK_DIRECTORY_ENTRY_SIZE))
+
+#define SKY_BLOCK_COMPRESSED_MAGIC 0x5A594B53
+
+#define SKY_BLOCK_COMPRESSED_HEADER_SIZE (sizeof(sky_object_id_t) + (sizeof(uint32_t) * 2))
+
+#define SKY_BLOCK_IS_COMPRESSED(PTR) (*((sky_object_id_t*)(PTR)) == 0 && *((uint32_t*)((PTR) + sizeof(sky_object_id_t))) == SKY_BLOCK_COMPRESSED_MAGIC)
 
 struct sky_block {
     sky_data_file *data_file;
@@ -42,6 +82,8 @@ struct sky_block {
     sky_timestamp_t min_timestamp;
     sky_timestamp_t max_timestamp;
     bool spanned;
+    sky_block_cache_entry *cache_entry;
+    uint32_t version;
 };
 
 // This structure is used for splitting blocks. It contains positional
@@ -54,6 +96,13 @@ typedef struct sky_block_path_stat {
     size_t sz;
 } sky_block_path_stat;
 
+// An entry in a block's path directory. The offset is the position of the
+// path from the start of the block.
+typedef struct sky_block_directory_entry {
+    sky_object_id_t object_id;
+    uint32_t offset;
+} sky_block_directory_entry;
+
 
 //==============================================================================
 //
@@ -74,6 +123,8 @@ void sky_block_free(sky_block *block);
 // Persistence
 //--------------------------------------
 
+int sky_block_save(sky_block *block);
+
 int sky_block_pack(sky_block *block, void *ptr, size_t *sz);
 
 int sky_block_unpack(sky_block *block, void *ptr, size_t *sz);
@@ -96,6 +147,51 @@ int sky_block_get_offset(sky_block *block, size_t *offset);
 
 int sky_block_get_ptr(sky_block *block, void **ptr);
 
+int sky_block_get_raw_ptr(sky_block *block, void **ptr);
+
+int sky_block_prefetch(sky_block *block, uint32_t count);
+
+
+//--------------------------------------
+// Directory
+//--------------------------------------
+
+bool sky_block_has_directory(sky_block *block);
+
+int sky_block_get_directory(sky_block *block,
+    sky_block_directory_entry **entries, uint32_t *count);
+
+int sky_block_get_capacity(sky_block *block, size_t *capacity);
+
+int sky_block_get_data_length(sky_block *block, size_t *length);
+
+int sky_block_build_directory(sky_block *block);
+
+int sky_block_write_directory(void *ptr, uint32_t block_size);
+
+
+//--------------------------------------
+// Layout
+//--------------------------------------
+
+bool sky_block_is_compact(sky_block *block);
+
+int sky_block_expand(sky_block *block);
+
+
+//--------------------------------------
+// Compression
+//--------------------------------------
+
+bool sky_block_is_compressed(sky_block *block);
+
+int sky_block_compress(void *ptr, uint32_t block_size, void *addr,
+    size_t capacity, size_t *sz);
+
+int sky_block_decompress(void *ptr, uint32_t block_size, void *addr);
+
+int sky_block_inflate(sky_block *block);
+
 
 //--------------------------------------
 // Spanning
@@ -118,6 +214,11 @@ int sky_block_get_path_stats(sky_block *block, sky_event *event,
 
 int sky_block_add_event(sky_block *block, sky_event *event);
 
+int sky_block_add_events(sky_block *block, sky_event **events, uint32_t count,
+    bool *ret);
+
+int sky_block_contains_event(sky_block *block, sky_event *event, bool *ret);
+
 
 //--------------------------------------
 // Debugging
@@ -0,0 +1,268 @@
+#include <stdlib.h>
+
+#include "dbg.h"
+#include "block_cache.h"
+
+
+//==============================================================================
+//
+// Forward Declarations
+//
+//==============================================================================
+
+int sky_block_cache_unlink(sky_block_cache *cache, sky_block_cache_entry *entry);
+
+int sky_block_cache_move_to_tail(sky_block_cache *cache,
+    sky_block_cache_entry *entry);
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+// Creates a block cache.
+//
+// capacity   - The maximum number of blocks to cache.
+// block_size - The size of each block, in bytes.
+//
+// Returns a reference to a new block cache if successful. Otherwise returns
+// null.
+sky_block_cache *sky_block_cache_create(uint32_t capacity, uint32_t block_size)
+{
+    sky_block_cache *cache = NULL;
+    check(capacity >= SKY_BLOCK_CACHE_MIN_SIZE, "Block cache must hold at least %d blocks", SKY_BLOCK_CACHE_MIN_SIZE);
+    check(block_size > 0, "Block size required");
+
+    cache = calloc(1, sizeof(sky_block_cache)); check_mem(cache);
+    cache->capacity = capacity;
+    cache->block_size = block_size;
+    cache->entries = calloc(capacity, sizeof(sky_block_cache_entry));
+    check_mem(cache->entries);
+
+    return cache;
+
+error:
+    sky_block_cache_free(cache);
+    return NULL;
+}
+
+// Removes a block cache from memory. Any blocks that are still cached are
+// detached from the cache.
+//
+// cache - The block cache.
+void sky_block_cache_free(sky_block_cache *cache)
+{
+    if(cache) {
+        sky_block_cache_clear(cache);
+        uint32_t i;
+        if(cache->entries != NULL) {
+            for(i=0; i<cache->count; i++) {
+                free(cache->entries[i].data);
+            }
+        }
+        free(cache->entries);
+        free(cache);
+    }
+}
+
+
+//--------------------------------------
+// Cache Management
+//--------------------------------------
+
+// Retrieves the decompressed contents of a block. If the block is not cached
+// then it is decompressed into an unused entry or, once the cache is full,
+// into the most recently used entry after the two that must stay cached.
+//
+// cache          - The block cache.
+// block          - The block to retrieve.
+// compressed_ptr - A pointer to the compressed block in the data file.
+// ptr            - A pointer to where the decompressed block is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_cache_get(sky_block_cache *cache, sky_block *block,
+                        void *compressed_ptr, void **ptr)
+{
+    int rc;
+    check(cache != NULL, "Block cache required");
+    check(block != NULL, "Block required");
+
+    // Return the cached block if there is one.
+    if(block->cache_entry != NULL) {
+        cache->hit_count++;
+        rc = sky_block_cache_touch(cache, block->cache_entry);
+        check(rc == 0, "Unable to touch block cache entry");
+        *ptr = block->cache_entry->data;
+        return 0;
+    }
+    cache->miss_count++;
+
+    // Add another entry if every entry is in use and there is room.
+    // Unused entries are always kept at the tail of the list.
+    sky_block_cache_entry *entry = cache->tail;
+    if(entry == NULL || (entry->block != NULL && cache->count < cache->capacity)) {
+        entry = &cache->entries[cache->count];
+        entry->data = malloc(cache->block_size);
+        check_mem(entry->data);
+        cache->count++;
+
+        entry->prev = cache->tail;
+        entry->next = NULL;
+        if(cache->tail) cache->tail->next = entry;
+        cache->tail = entry;
+        if(cache->head == NULL) cache->head = entry;
+    }
+    // Once the cache is full, replace the most recently used block that a
+    // path iterator can't still be holding. Under LRU a scan over more blocks
+    // than the cache holds evicts every block before it is read again.
+    else if(entry->block != NULL && cache->count > SKY_BLOCK_CACHE_MIN_SIZE) {
+        uint32_t i;
+        entry = cache->head;
+        for(i=0; i<SKY_BLOCK_CACHE_MIN_SIZE; i++) {
+            entry = entry->next;
+        }
+    }
+
+    // Evict the block in the entry.
+    if(entry->block != NULL) {
+        entry->block->cache_entry = NULL;
+        entry->block = NULL;
+    }
+
+    // Decompress the block and move it to the front.
+    rc = sky_block_decompress(compressed_ptr, cache->block_size, entry->data);
+    check(rc == 0, "Unable to decompress block: %d", block->index);
+    entry->block = block;
+    block->cache_entry = entry;
+    rc = sky_block_cache_touch(cache, entry);
+    check(rc == 0, "Unable to touch block cache entry");
+
+    *ptr = entry->data;
+    return 0;
+
+error:
+    *ptr = NULL;
+    return -1;
+}
+
+// Marks an entry as the most recently used entry.
+//
+// cache - The block cache.
+// entry - The entry that was used.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_cache_touch(sky_block_cache *cache, sky_block_cache_entry *entry)
+{
+    check(cache != NULL, "Block cache required");
+    check(entry != NULL, "Block cache entry required");
+
+    if(cache->head != entry) {
+        sky_block_cache_unlink(cache, entry);
+        entry->next = cache->head;
+        cache->head->prev = entry;
+        cache->head = entry;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Removes a block from the cache. This is used when a block is decompressed
+// in the data file so that it is no longer read through the cache.
+//
+// cache - The block cache.
+// block - The block to remove.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_cache_remove(sky_block_cache *cache, sky_block *block)
+{
+    int rc;
+    check(cache != NULL, "Block cache required");
+    check(block != NULL, "Block required");
+
+    sky_block_cache_entry *entry = block->cache_entry;
+    if(entry != NULL) {
+        block->cache_entry = NULL;
+        entry->block = NULL;
+        rc = sky_block_cache_move_to_tail(cache, entry);
+        check(rc == 0, "Unable to move block cache entry");
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Removes all blocks from the cache. The decompressed buffers are kept so
+// that they can be reused.
+//
+// cache - The block cache.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_cache_clear(sky_block_cache *cache)
+{
+    check(cache != NULL, "Block cache required");
+
+    sky_block_cache_entry *entry;
+    for(entry=cache->head; entry!=NULL; entry=entry->next) {
+        if(entry->block != NULL) {
+            entry->block->cache_entry = NULL;
+            entry->block = NULL;
+        }
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+
+//--------------------------------------
+// List Management
+//--------------------------------------
+
+// Removes an entry from the list.
+//
+// cache - The block cache.
+// entry - The entry to remove.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_cache_unlink(sky_block_cache *cache, sky_block_cache_entry *entry)
+{
+    if(entry->prev) entry->prev->next = entry->next;
+    if(entry->next) entry->next->prev = entry->prev;
+    if(cache->head == entry) cache->head = entry->next;
+    if(cache->tail == entry) cache->tail = entry->prev;
+    entry->prev = NULL;
+    entry->next = NULL;
+    return 0;
+}
+
+// Moves an entry to the end of the list so that it is reused first.
+//
+// cache - The block cache.
+// entry - The entry to move.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_block_cache_move_to_tail(sky_block_cache *cache,
+                                 sky_block_cache_entry *entry)
+{
+    if(cache->tail != entry) {
+        sky_block_cache_unlink(cache, entry);
+        entry->prev = cache->tail;
+        if(cache->tail) cache->tail->next = entry;
+        cache->tail = entry;
+        if(cache->head == NULL) cache->head = entry;
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+#ifndef _block_cache_h
+#define _block_cache_h
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+typedef struct sky_block_cache sky_block_cache;
+
+typedef struct sky_block_cache_entry sky_block_cache_entry;
+
+#include "block.h"
+
+
+//==============================================================================
+//
+// Overview
+//
+//==============================================================================
+
+// The block cache holds the decompressed contents of compressed blocks. It
+// stores a fixed number of blocks in a list ordered by use. Each cached block
+// keeps a reference to its entry so a cache hit doesn't need a lookup.
+//
+// A pointer into a cached block stays valid until the block is evicted. A
+// path iterator looks at the start of the next block before the caller is
+// done with the last path of the current block so the cache always holds at
+// least two blocks and the two most recently used blocks are never evicted.
+// Compressed blocks are never spanned so this covers every path. The cache
+// is not thread safe.
+//
+// Queries scan blocks in order so once the cache is full a new block replaces
+// the most recently used block after those two rather than the least
+// recently used one. A scan over more blocks than the cache holds then keeps
+// most of the cache from one pass to the next instead of missing on every
+// block. The blocks that don't fit are still decompressed on every scan so
+// compression stays off unless a table or compaction asks for it.
+
+
+//==============================================================================
+//
+// Typedefs
+//
+//==============================================================================
+
+#define SKY_BLOCK_CACHE_DEFAULT_SIZE 64
+
+#define SKY_BLOCK_CACHE_MIN_SIZE 2
+
+struct sky_block_cache_entry {
+    sky_block *block;
+    void *data;
+    sky_block_cache_entry *prev;
+    sky_block_cache_entry *next;
+};
+
+struct sky_block_cache {
+    uint32_t block_size;
+    uint32_t capacity;
+    uint32_t count;
+    sky_block_cache_entry *entries;
+    sky_block_cache_entry *head;
+    sky_block_cache_entry *tail;
+    uint64_t hit_count;
+    uint64_t miss_count;
+};
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+sky_block_cache *sky_block_cache_create(uint32_t capacity, uint32_t block_size);
+
+void sky_block_cache_free(sky_block_cache *cache);
+
+
+//--------------------------------------
+// Cache Management
+//--------------------------------------
+
+int sky_block_cache_get(sky_block_cache *cache, sky_block *block,
+    void *compressed_ptr, void **ptr);
+
+int sky_block_cache_touch(sky_block_cache *cache, sky_block_cache_entry *entry);
+
+int sky_block_cache_remove(sky_block_cache *cache, sky_block *block);
+
+int sky_block_cache_clear(sky_block_cache *cache);
+
+#endif
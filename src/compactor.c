@@ -0,0 +1,827 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "dbg.h"
+#include "mem.h"
+#include "compactor.h"
+#include "path.h"
+#include "path_iterator.h"
+#include "lz.h"
+
+
+//==============================================================================
+//
+// Forward Declarations
+//
+//==============================================================================
+
+int sky_compactor_add_path(sky_compactor *compactor, sky_object_id_t object_id,
+    sky_compactor_segment *segments, uint32_t segment_count, bool large);
+
+int sky_compactor_expand_segments(sky_compactor *compactor,
+    sky_compactor_segment *segments, uint32_t segment_count);
+
+int sky_compactor_close_path(sky_compactor *compactor,
+    sky_object_id_t object_id, size_t path_start);
+
+int sky_compactor_add_extents(sky_compactor *compactor,
+    sky_data_file *data_file, uint32_t *index, sky_object_id_t object_id);
+
+int sky_compactor_write_extent(sky_compactor *compactor,
+    sky_object_id_t object_id, uint32_t event_count, size_t path_length);
+
+int sky_compactor_add_event(sky_compactor *compactor, sky_object_id_t object_id,
+    sky_compactor_event *event);
+
+int sky_compactor_flush_block(sky_compactor *compactor);
+
+int sky_compactor_write_header(sky_compactor *compactor, bstring path,
+    uint32_t version);
+
+int sky_compactor_reset(sky_compactor *compactor);
+
+int compare_compactor_events(const void *_a, const void *_b);
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+// Creates a compactor.
+//
+// Returns a compactor.
+sky_compactor *sky_compactor_create()
+{
+    sky_compactor *compactor = calloc(1, sizeof(sky_compactor));
+    check_mem(compactor);
+    compactor->fill_factor = SKY_COMPACTOR_DEFAULT_FILL_FACTOR;
+    return compactor;
+
+error:
+    sky_compactor_free(compactor);
+    return NULL;
+}
+
+// Frees a compactor.
+//
+// Returns nothing.
+void sky_compactor_free(sky_compactor *compactor)
+{
+    if(compactor) {
+        sky_compactor_reset(compactor);
+        free(compactor);
+    }
+}
+
+// Releases the state used during a compaction.
+//
+// compactor - The compactor.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_compactor_reset(sky_compactor *compactor)
+{
+    check(compactor != NULL, "Compactor required");
+
+    if(compactor->file) fclose(compactor->file);
+    compactor->file = NULL;
+    if(compactor->extent_file) fclose(compactor->extent_file);
+    compactor->extent_file = NULL;
+    free(compactor->buffer);
+    compactor->buffer = NULL;
+    compactor->buffer_length = 0;
+    compactor->path_count = 0;
+    compactor->compact_path = false;
+    compactor->previous_timestamp = 0;
+    compactor->spanned_path = false;
+    free(compactor->compress_buffer);
+    compactor->compress_buffer = NULL;
+    free(compactor->scratch);
+    compactor->scratch = NULL;
+    compactor->scratch_capacity = 0;
+    sky_block_free(compactor->block);
+    compactor->block = NULL;
+
+    uint32_t i;
+    for(i=0; i<compactor->block_count; i++) {
+        sky_block_free(compactor->blocks[i]);
+    }
+    free(compactor->blocks);
+    compactor->blocks = NULL;
+    compactor->block_count = 0;
+    free(compactor->events);
+    compactor->events = NULL;
+    compactor->event_capacity = 0;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+
+//--------------------------------------
+// Compaction
+//--------------------------------------
+
+// Rewrites a data file so that its paths are packed into blocks in object id
+// order. Blocks are filled up to the compactor's fill factor so that there is
+// room for new events to be inserted without immediately splitting. Paths
+// that are larger than a block are split into consecutive spanned blocks
+// unless they are written to extents.
+//
+// The data file must be synced before compaction since it is replaced on
+// disk. The data file is reloaded once compaction is complete.
+//
+// compactor - The compactor.
+// data_file - The data file to compact.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_compactor_compact(sky_compactor *compactor, sky_data_file *data_file)
+{
+    int rc;
+    bstring data_path = NULL;
+    bstring header_path = NULL;
+    bstring extent_path = NULL;
+    sky_compactor_segment *segments = NULL;
+    check(compactor != NULL, "Compactor required");
+    check(data_file != NULL, "Data file required");
+    check(data_file->data != NULL, "Data file must be loaded to compact");
+    check(data_file->snapshots == NULL, "Data file can't be compacted while a snapshot is open");
+    check(compactor->fill_factor > 0 && compactor->fill_factor <= 1, "Fill factor must be between 0 and 1");
+
+    // Determine the format version of the compacted data file.
+    uint32_t version = (compactor->version > 0 ? compactor->version : data_file->version);
+    check(version >= SKY_DATA_FILE_VERSION && version <= SKY_DATA_FILE_COMPACT_VERSION, "Unsupported data file version: %d", version);
+
+    // Initialize the output state.
+    sky_compactor_reset(compactor);
+    compactor->has_directory = (version >= SKY_DATA_FILE_DIRECTORY_VERSION);
+    compactor->compact = (version >= SKY_DATA_FILE_COMPACT_VERSION);
+    compactor->block_size = data_file->block_size;
+    compactor->target_size = (size_t)(compactor->fill_factor * data_file->block_size);
+    compactor->buffer = calloc(1, compactor->block_size); check_mem(compactor->buffer);
+    if(compactor->compress) {
+        compactor->compress_buffer = malloc(SKY_BLOCK_COMPRESSED_HEADER_SIZE + SKY_LZ_BOUND(compactor->block_size));
+        check_mem(compactor->compress_buffer);
+    }
+    compactor->block = sky_block_create(NULL); check_mem(compactor->block);
+    segments = calloc(data_file->block_count, sizeof(*segments));
+    check_mem(segments);
+
+    // Open the temporary data file.
+    data_path = bformat("%s.compact", bdata(data_file->path)); check_mem(data_path);
+    header_path = bformat("%s.compact", bdata(data_file->header_path)); check_mem(header_path);
+    int fd = open(bdata(data_path), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    check(fd != -1, "Unable to open compaction file: %s", bdata(data_path));
+    compactor->file = fdopen(fd, "w");
+    if(compactor->file == NULL) close(fd);
+    check(compactor->file != NULL, "Unable to open compaction file: %s", bdata(data_path));
+
+    // Open the temporary extent file.
+    if(data_file->extent_path != NULL) {
+        compactor->large_path_threshold = data_file->large_path_threshold;
+        extent_path = bformat("%s.compact", bdata(data_file->extent_path)); check_mem(extent_path);
+        fd = open(bdata(extent_path), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+        check(fd != -1, "Unable to open extent compaction file: %s", bdata(extent_path));
+        compactor->extent_file = fdopen(fd, "w");
+        if(compactor->extent_file == NULL) close(fd);
+        check(compactor->extent_file != NULL, "Unable to open extent compaction file: %s", bdata(extent_path));
+    }
+
+    // Copy paths in sorted block order. Consecutive paths with the same
+    // object id are parts of a single path that was split across blocks so
+    // they are combined. Paths stored in extents are merged in by object id.
+    uint32_t i;
+    uint32_t extent_index = 0;
+    uint32_t segment_count = 0;
+    sky_object_id_t object_id = 0;
+    for(i=0; i<data_file->block_count; i++) {
+        sky_path_iterator iterator;
+        sky_path_iterator_init(&iterator);
+        rc = sky_path_iterator_set_block(&iterator, data_file->blocks[i]);
+        check(rc == 0, "Unable to set path iterator block");
+
+        while(!iterator.eof) {
+            // Write out the previous path once a new object is reached.
+            if(segment_count > 0 && iterator.current_object_id != object_id) {
+                rc = sky_compactor_add_path(compactor, object_id, segments, segment_count, false);
+                check(rc == 0, "Unable to add path");
+                segment_count = 0;
+            }
+
+            // Write out any extents that come before the new object.
+            if(segment_count == 0) {
+                rc = sky_compactor_add_extents(compactor, data_file, &extent_index, iterator.current_object_id);
+                check(rc == 0, "Unable to add extents");
+            }
+
+            void *path_ptr;
+            rc = sky_path_iterator_get_ptr(&iterator, &path_ptr);
+            check(rc == 0, "Unable to retrieve path pointer");
+            object_id = iterator.current_object_id;
+            segments[segment_count].ptr = path_ptr + SKY_PATH_HEADER_LENGTH;
+            segments[segment_count].length = sky_path_sizeof_raw(path_ptr) - SKY_PATH_HEADER_LENGTH;
+            segments[segment_count].encoded = sky_path_is_compact(path_ptr);
+            segment_count++;
+
+            rc = sky_path_iterator_next(&iterator);
+            check(rc == 0, "Unable to move to next path");
+        }
+    }
+    if(segment_count > 0) {
+        rc = sky_compactor_add_path(compactor, object_id, segments, segment_count, false);
+        check(rc == 0, "Unable to add path");
+    }
+    rc = sky_compactor_add_extents(compactor, data_file, &extent_index, 0);
+    check(rc == 0, "Unable to add extents");
+
+    // Write the last block. A data file always has at least one block.
+    if(compactor->buffer_length > 0 || compactor->block_count == 0) {
+        rc = sky_compactor_flush_block(compactor);
+        check(rc == 0, "Unable to flush block");
+    }
+
+    // Sync and close the new data file. The file is sized explicitly since
+    // the last block may end in a hole.
+    rc = fflush(compactor->file);
+    check(rc == 0, "Unable to flush compaction file");
+    rc = ftruncate(fileno(compactor->file), (off_t)compactor->block_count * compactor->block_size);
+    check(rc == 0, "Unable to size compaction file");
+    rc = fsync(fileno(compactor->file));
+    check(rc == 0, "Unable to sync compaction file");
+    fclose(compactor->file);
+    compactor->file = NULL;
+
+    // Sync and close the new extent file.
+    if(compactor->extent_file != NULL) {
+        rc = fflush(compactor->extent_file);
+        check(rc == 0, "Unable to flush extent compaction file");
+        rc = fsync(fileno(compactor->extent_file));
+        check(rc == 0, "Unable to sync extent compaction file");
+        fclose(compactor->extent_file);
+        compactor->extent_file = NULL;
+    }
+
+    // Write the new header file.
+    rc = sky_compactor_write_header(compactor, header_path, version);
+    check(rc == 0, "Unable to write compaction header");
+
+    // Swap in the new files and reload.
+    rc = sky_data_file_unload(data_file);
+    check(rc == 0, "Unable to unload data file");
+    rc = rename(bdata(data_path), bdata(data_file->path));
+    check(rc == 0, "Unable to replace data file: %s", bdata(data_file->path));
+    rc = rename(bdata(header_path), bdata(data_file->header_path));
+    check(rc == 0, "Unable to replace header file: %s", bdata(data_file->header_path));
+    if(extent_path != NULL) {
+        rc = rename(bdata(extent_path), bdata(data_file->extent_path));
+        check(rc == 0, "Unable to replace extent file: %s", bdata(data_file->extent_path));
+    }
+    rc = sky_data_file_load(data_file);
+    check(rc == 0, "Unable to reload data file");
+
+    sky_compactor_reset(compactor);
+    free(segments);
+    bdestroy(data_path);
+    bdestroy(header_path);
+    bdestroy(extent_path);
+    return 0;
+
+error:
+    sky_compactor_reset(compactor);
+    if(data_path) unlink(bdata(data_path));
+    if(header_path) unlink(bdata(header_path));
+    if(extent_path) unlink(bdata(extent_path));
+    free(segments);
+    bdestroy(data_path);
+    bdestroy(header_path);
+    bdestroy(extent_path);
+    return -1;
+}
+
+// Adds a path to the compacted output. The path is added to the current
+// block if it fits within the fill factor. Otherwise it is added to a new
+// block. Paths larger than a block are split across consecutive blocks that
+// only contain the one path. Large paths are written to extents instead.
+//
+// Events are written in timestamp order. Events with the same timestamp keep
+// their original order.
+//
+// compactor     - The compactor.
+// object_id     - The object id of the path.
+// segments      - The runs of event data that make up the path.
+// segment_count - The number of segments.
+// large         - A flag stating if the path is currently in an extent.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_compactor_add_path(sky_compactor *compactor, sky_object_id_t object_id,
+                           sky_compactor_segment *segments,
+                           uint32_t segment_count, bool large)
+{
+    int rc;
+    size_t sz;
+    check(compactor != NULL, "Compactor required");
+
+    // Compact segments are read back as rows.
+    rc = sky_compactor_expand_segments(compactor, segments, segment_count);
+    check(rc == 0, "Unable to expand segments");
+
+    // Collect references to each event in the path. The stored length is
+    // the length of the path once it is written to a block.
+    uint32_t i;
+    uint32_t event_count = 0;
+    bool sorted = true;
+    size_t path_length = SKY_PATH_HEADER_LENGTH;
+    size_t stored_length = SKY_PATH_HEADER_LENGTH;
+    for(i=0; i<segment_count; i++) {
+        void *ptr = segments[i].ptr;
+        void *endptr = segments[i].ptr + segments[i].length;
+        while(ptr < endptr) {
+            // Grow the event list if needed.
+            if(event_count == compactor->event_capacity) {
+                compactor->event_capacity = (compactor->event_capacity > 0 ? compactor->event_capacity * 2 : 64);
+                compactor->events = realloc(compactor->events, sizeof(*compactor->events) * compactor->event_capacity);
+                check_mem(compactor->events);
+            }
+
+            sky_compactor_event *event = &compactor->events[event_count];
+            sky_action_id_t action_id;
+            sky_event_data_length_t data_length;
+            rc = sky_event_unpack_hdr(&event->timestamp, &action_id, &data_length, ptr, &sz);
+            check(rc == 0, "Unable to unpack event header");
+            event->ptr = ptr;
+            event->length = sky_event_sizeof_raw(ptr);
+            event->size = event->length;
+            event->index = event_count;
+            if(event_count > 0 && event->timestamp < compactor->events[event_count-1].timestamp) {
+                sorted = false;
+            }
+
+            path_length += event->length;
+            stored_length += event->size;
+            ptr += event->length;
+            event_count++;
+        }
+    }
+    if(event_count == 0) {
+        return 0;
+    }
+
+    // Restore timestamp order if the path was stored out of order.
+    if(!sorted) {
+        qsort(compactor->events, event_count, sizeof(*compactor->events), compare_compactor_events);
+    }
+
+    // Write large paths to extents. Without a threshold, paths that are
+    // already in extents stay there.
+    if(compactor->extent_file != NULL) {
+        bool use_extent = (compactor->large_path_threshold > 0 ? path_length > compactor->large_path_threshold : large);
+        if(use_extent) {
+            rc = sky_compactor_write_extent(compactor, object_id, event_count, path_length);
+            check(rc == 0, "Unable to write extent");
+            return 0;
+        }
+    }
+
+    // Store the path compactly if it is smaller and if it can still be
+    // expanded into a single block.
+    compactor->compact_path = false;
+    if(compactor->compact && path_length + SKY_BLOCK_DIRECTORY_SIZE(1) <= compactor->block_size) {
+        size_t compact_length = SKY_PATH_HEADER_LENGTH;
+        sky_timestamp_t previous_timestamp = 0;
+        for(i=0; i<event_count; i++) {
+            compactor->events[i].size = sky_event_sizeof_compact(compactor->events[i].ptr, previous_timestamp);
+            compact_length += compactor->events[i].size;
+            previous_timestamp = compactor->events[i].timestamp;
+        }
+        compactor->compact_path = (compact_length < path_length);
+        if(compactor->compact_path) {
+            stored_length = compact_length;
+        }
+        else {
+            for(i=0; i<event_count; i++) {
+                compactor->events[i].size = compactor->events[i].length;
+            }
+        }
+    }
+
+    // Blocks with a directory also need room for the directory once the
+    // path is added.
+    size_t directory_size = (compactor->has_directory ? SKY_BLOCK_DIRECTORY_SIZE(compactor->path_count+1) : 0);
+    bool spanned = (stored_length + (compactor->has_directory ? SKY_BLOCK_DIRECTORY_SIZE(1) : 0) > compactor->block_size);
+
+    // Start a new block if the path doesn't fit or if it needs to span.
+    if(compactor->buffer_length > 0 && (spanned || compactor->buffer_length + stored_length + directory_size > compactor->target_size)) {
+        rc = sky_compactor_flush_block(compactor);
+        check(rc == 0, "Unable to flush block");
+        directory_size = (compactor->has_directory ? SKY_BLOCK_DIRECTORY_SIZE(1) : 0);
+    }
+
+    // Spanned blocks are filled up to the fill factor. Smaller paths are never
+    // split.
+    compactor->spanned_path = spanned;
+    size_t limit = (spanned ? compactor->target_size : compactor->block_size) - directory_size;
+
+    // Copy events one at a time, splitting the path when the limit is reached.
+    // Compact paths are encoded as they are copied.
+    size_t path_start = compactor->buffer_length;
+    compactor->buffer_length += SKY_PATH_HEADER_LENGTH;
+    compactor->previous_timestamp = 0;
+    compactor->path_count++;
+    for(i=0; i<event_count; i++) {
+        sky_compactor_event *event = &compactor->events[i];
+
+        // Close out this part of the path and move to a new block.
+        if(compactor->buffer_length + event->size > limit && compactor->buffer_length > path_start + SKY_PATH_HEADER_LENGTH) {
+            rc = sky_compactor_close_path(compactor, object_id, path_start);
+            check(rc == 0, "Unable to close path");
+            rc = sky_compactor_flush_block(compactor);
+            check(rc == 0, "Unable to flush block");
+            path_start = 0;
+            compactor->buffer_length = SKY_PATH_HEADER_LENGTH;
+            compactor->previous_timestamp = 0;
+            compactor->path_count = 1;
+        }
+
+        rc = sky_compactor_add_event(compactor, object_id, event);
+        check(rc == 0, "Unable to add event");
+    }
+
+    // Write the path header.
+    rc = sky_compactor_close_path(compactor, object_id, path_start);
+    check(rc == 0, "Unable to close path");
+
+    // Spanned blocks cannot share space with other paths.
+    if(spanned) {
+        rc = sky_compactor_flush_block(compactor);
+        check(rc == 0, "Unable to flush block");
+    }
+    compactor->spanned_path = false;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Converts the compact segments of a path back to rows so that their events
+// can be copied. The converted segments are stored in the compactor's scratch
+// buffer and the segments are updated to point at them.
+//
+// compactor     - The compactor.
+// segments      - The runs of event data that make up the path.
+// segment_count - The number of segments.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_compactor_expand_segments(sky_compactor *compactor,
+                                  sky_compactor_segment *segments,
+                                  uint32_t segment_count)
+{
+    int rc;
+    size_t sz;
+    check(compactor != NULL, "Compactor required");
+
+    // Determine the length of the expanded segments.
+    uint32_t i;
+    size_t length = 0;
+    for(i=0; i<segment_count; i++) {
+        if(segments[i].encoded) {
+            length += sky_path_sizeof_expanded(segments[i].ptr - SKY_PATH_HEADER_LENGTH);
+        }
+    }
+    if(length == 0) {
+        return 0;
+    }
+    if(length > compactor->scratch_capacity) {
+        void *scratch = realloc(compactor->scratch, length);
+        check_mem(scratch);
+        compactor->scratch = scratch;
+        compactor->scratch_capacity = length;
+    }
+
+    // Convert each segment.
+    void *ptr = compactor->scratch;
+    for(i=0; i<segment_count; i++) {
+        if(segments[i].encoded) {
+            rc = sky_path_expand(segments[i].ptr - SKY_PATH_HEADER_LENGTH, ptr, &sz);
+            check(rc == 0, "Unable to expand path");
+            segments[i].ptr = ptr + SKY_PATH_HEADER_LENGTH;
+            segments[i].length = sz - SKY_PATH_HEADER_LENGTH;
+            segments[i].encoded = false;
+            ptr += sz;
+        }
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Writes the header of the path that was started at a given position in the
+// current block. Compact paths are flagged in their header.
+//
+// compactor  - The compactor.
+// object_id  - The object id of the path.
+// path_start - The position of the path in the block buffer.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_compactor_close_path(sky_compactor *compactor,
+                             sky_object_id_t object_id, size_t path_start)
+{
+    int rc;
+    size_t sz;
+    check(compactor != NULL, "Compactor required");
+
+    void *path_ptr = compactor->buffer + path_start;
+    rc = sky_path_pack_hdr(object_id, compactor->buffer_length - path_start - SKY_PATH_HEADER_LENGTH, path_ptr, &sz);
+    check(rc == 0, "Unable to pack path header");
+
+    if(compactor->compact_path) {
+        *((sky_path_event_data_length_t*)(path_ptr + sizeof(sky_object_id_t))) |= SKY_PATH_FLAG_COMPACT;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Adds the paths of all extents before a given object id to the compacted
+// output.
+//
+// compactor - The compactor.
+// data_file - The data file being compacted.
+// index     - A pointer to the index of the next extent to add.
+// object_id - The object id to stop at. If this is zero then all remaining
+//             extents are added.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_compactor_add_extents(sky_compactor *compactor,
+                              sky_data_file *data_file, uint32_t *index,
+                              sky_object_id_t object_id)
+{
+    int rc;
+    check(compactor != NULL, "Compactor required");
+    check(data_file != NULL, "Data file required");
+
+    while(*index < data_file->extent_count) {
+        sky_extent *extent = data_file->extents[*index];
+        if(object_id != 0 && extent->object_id >= object_id) {
+            break;
+        }
+
+        void *path_ptr;
+        rc = sky_extent_get_ptr(extent, &path_ptr);
+        check(rc == 0, "Unable to retrieve extent pointer");
+        sky_compactor_segment segment;
+        segment.ptr = path_ptr + SKY_PATH_HEADER_LENGTH;
+        segment.length = sky_path_sizeof_raw(path_ptr) - SKY_PATH_HEADER_LENGTH;
+        segment.encoded = false;
+        rc = sky_compactor_add_path(compactor, extent->object_id, &segment, 1, true);
+        check(rc == 0, "Unable to add extent path");
+
+        (*index)++;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Writes the collected events of a path to a new extent. The extent is
+// given enough spare capacity so that the path fills it up to the fill
+// factor.
+//
+// compactor   - The compactor.
+// object_id   - The object id of the path.
+// event_count - The number of collected events.
+// path_length - The length of the path, in bytes.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_compactor_write_extent(sky_compactor *compactor,
+                               sky_object_id_t object_id, uint32_t event_count,
+                               size_t path_length)
+{
+    int rc;
+    size_t sz;
+    uint8_t buffer[SKY_EXTENT_HEADER_SIZE + SKY_PATH_HEADER_LENGTH];
+    check(compactor != NULL, "Compactor required");
+    check(event_count > 0, "Events required");
+
+    // Write the extent header.
+    sky_extent extent;
+    memset(&extent, 0, sizeof(extent));
+    extent.object_id = object_id;
+    extent.min_timestamp = compactor->events[0].timestamp;
+    extent.max_timestamp = compactor->events[event_count-1].timestamp;
+    extent.capacity = (size_t)(path_length / compactor->fill_factor);
+    if(extent.capacity < path_length) {
+        extent.capacity = path_length;
+    }
+    rc = sky_extent_pack(&extent, buffer, &sz);
+    check(rc == 0, "Unable to pack extent header");
+    rc = sky_path_pack_hdr(object_id, path_length - SKY_PATH_HEADER_LENGTH, buffer + sz, &sz);
+    check(rc == 0, "Unable to pack path header");
+    rc = fwrite(buffer, sizeof(buffer), 1, compactor->extent_file);
+    check(rc == 1, "Unable to write extent header");
+
+    // Write the events.
+    uint32_t i;
+    for(i=0; i<event_count; i++) {
+        rc = fwrite(compactor->events[i].ptr, compactor->events[i].length, 1, compactor->extent_file);
+        check(rc == 1, "Unable to write extent event");
+    }
+
+    // Pad out the spare capacity.
+    uint8_t zeros[1024];
+    memset(zeros, 0, sizeof(zeros));
+    size_t remaining = extent.capacity - path_length;
+    while(remaining > 0) {
+        size_t n = (remaining < sizeof(zeros) ? remaining : sizeof(zeros));
+        rc = fwrite(zeros, n, 1, compactor->extent_file);
+        check(rc == 1, "Unable to write extent padding");
+        remaining -= n;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Copies a raw event into the current block and updates the block ranges.
+//
+// compactor - The compactor.
+// object_id - The object id of the path the event belongs to.
+// event     - A reference to the raw event.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_compactor_add_event(sky_compactor *compactor, sky_object_id_t object_id,
+                            sky_compactor_event *event)
+{
+    int rc;
+    check(compactor != NULL, "Compactor required");
+    check(event != NULL, "Event required");
+    size_t capacity = compactor->block_size - (compactor->has_directory ? SKY_BLOCK_DIRECTORY_SIZE(compactor->path_count) : 0);
+    check(compactor->buffer_length + event->size <= capacity, "Event is too large for block");
+
+    // Encode compact events. Otherwise copy the event as-is.
+    if(compactor->compact_path) {
+        size_t sz;
+        rc = sky_event_pack_compact(event->ptr, compactor->previous_timestamp, compactor->buffer + compactor->buffer_length, &sz);
+        check(rc == 0 && sz == event->size, "Unable to pack compact event");
+        compactor->buffer_length += sz;
+        compactor->previous_timestamp = event->timestamp;
+    }
+    else {
+        memcpy(compactor->buffer + compactor->buffer_length, event->ptr, event->length);
+        compactor->buffer_length += event->length;
+    }
+
+    // Update the block ranges.
+    sky_block *block = compactor->block;
+    sky_timestamp_t timestamp = event->timestamp;
+    bool is_empty = (block->min_object_id == 0 && block->max_object_id == 0);
+    if(is_empty || object_id < block->min_object_id) block->min_object_id = object_id;
+    if(is_empty || object_id > block->max_object_id) block->max_object_id = object_id;
+    if(is_empty || timestamp < block->min_timestamp) block->min_timestamp = timestamp;
+    if(is_empty || timestamp > block->max_timestamp) block->max_timestamp = timestamp;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Writes the current block to the compacted data file and starts a new block.
+//
+// compactor - The compactor.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_compactor_flush_block(sky_compactor *compactor)
+{
+    int rc;
+    check(compactor != NULL, "Compactor required");
+
+    // Write the block data and its directory.
+    if(compactor->has_directory) {
+        rc = sky_block_write_directory(compactor->buffer, compactor->block_size);
+        check(rc == 0, "Unable to write block directory");
+    }
+
+    // Compressed blocks are followed by a hole up to the next block. Blocks
+    // are only compressed if that saves at least an eighth of the block since
+    // smaller savings free up little disk space but still have to be
+    // decompressed on every read.
+    size_t sz = 0;
+    if(compactor->compress && !compactor->spanned_path) {
+        rc = sky_block_compress(compactor->buffer, compactor->block_size, compactor->compress_buffer, SKY_BLOCK_COMPRESSED_HEADER_SIZE + SKY_LZ_BOUND(compactor->block_size), &sz);
+        check(rc == 0, "Unable to compress block");
+    }
+    if(sz > 0 && sz <= compactor->block_size - (compactor->block_size / 8)) {
+        rc = fwrite(compactor->compress_buffer, sz, 1, compactor->file);
+        check(rc == 1, "Unable to write compressed block to compaction file");
+        rc = fseeko(compactor->file, compactor->block_size - sz, SEEK_CUR);
+        check(rc == 0, "Unable to seek past compressed block");
+    }
+    else {
+        rc = fwrite(compactor->buffer, compactor->block_size, 1, compactor->file);
+        check(rc == 1, "Unable to write block to compaction file");
+    }
+
+    // Save the block ranges for the header.
+    compactor->blocks = realloc(compactor->blocks, sizeof(*compactor->blocks) * (compactor->block_count+1));
+    check_mem(compactor->blocks);
+    compactor->block->index = compactor->block_count;
+    compactor->blocks[compactor->block_count++] = compactor->block;
+    compactor->block = sky_block_create(NULL); check_mem(compactor->block);
+
+    // Clear the buffer.
+    memset(compactor->buffer, 0, compactor->block_size);
+    compactor->buffer_length = 0;
+    compactor->path_count = 0;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Writes a header file for the compacted blocks and syncs it to disk.
+//
+// compactor - The compactor.
+// path      - The path of the header file to write.
+// version   - The format version of the compacted data file.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_compactor_write_header(sky_compactor *compactor, bstring path,
+                               uint32_t version)
+{
+    int rc;
+    size_t sz;
+    uint8_t buffer[SKY_BLOCK_HEADER_SIZE];
+    FILE *file = NULL;
+    check(compactor != NULL, "Compactor required");
+    check(path != NULL, "Header path required");
+
+    file = fopen(bdata(path), "w");
+    check(file != NULL, "Unable to open compaction header file: %s", bdata(path));
+
+    // Write database format version.
+    rc = fwrite(&version, sizeof(version), 1, file);
+    check(rc == 1, "Unable to write version");
+
+    // Write block size.
+    rc = fwrite(&compactor->block_size, sizeof(compactor->block_size), 1, file);
+    check(rc == 1, "Unable to write block size");
+
+    // Write block ranges in block order.
+    uint32_t i;
+    for(i=0; i<compactor->block_count; i++) {
+        rc = sky_block_pack(compactor->blocks[i], buffer, &sz);
+        check(rc == 0, "Unable to pack block header");
+        rc = fwrite(buffer, sz, 1, file);
+        check(rc == 1, "Unable to write block header");
+    }
+
+    // Sync to disk.
+    rc = fflush(file);
+    check(rc == 0, "Unable to flush compaction header file");
+    rc = fsync(fileno(file));
+    check(rc == 0, "Unable to sync compaction header file");
+    fclose(file);
+
+    return 0;
+
+error:
+    if(file) fclose(file);
+    return -1;
+}
+
+// Compares two event references by timestamp and then by original position.
+int compare_compactor_events(const void *_a, const void *_b)
+{
+    sky_compactor_event *a = (sky_compactor_event *)_a;
+    sky_compactor_event *b = (sky_compactor_event *)_b;
+
+    if(a->timestamp != b->timestamp) {
+        return (a->timestamp > b->timestamp ? 1 : -1);
+    }
+    else if(a->index != b->index) {
+        return (a->index > b->index ? 1 : -1);
+    }
+    else {
+        return 0;
+    }
+}
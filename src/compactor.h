@@ -0,0 +1,126 @@
+#ifndef _sky_compactor_h
+#define _sky_compactor_h
+
+#include <stddef.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "bstring.h"
+#include "types.h"
+#include "block.h"
+#include "data_file.h"
+
+//==============================================================================
+//
+// Overview
+//
+//==============================================================================
+
+// The compactor rewrites a data file so that its blocks are physically stored
+// in object id order. Over time block splits leave blocks partially filled and
+// new blocks are always appended to the end of the data file so a full scan
+// jumps around the file. Compaction packs paths into as few blocks as
+// possible, up to a fill factor of the block size, and stores the blocks of a
+// spanned path next to each other.
+//
+// If the data file has an extent file then paths larger than the data file's
+// large path threshold are written to extents instead of spanned blocks. Each
+// extent is given spare capacity based on the fill factor. If no threshold is
+// set then paths that are already in extents are kept in extents. Freed
+// extent records are dropped.
+//
+// The compacted data file keeps the format version of the original data file
+// unless a version is set on the compactor. This can be used to upgrade a
+// version 1 data file so that its blocks have path directories.
+//
+// Compacting to version 3 stores the paths in blocks in the compact
+// encoding. Extents are always row-wise. A path is only stored compactly
+// if that makes it smaller and if it still fits in a single block once it
+// is expanded back to rows. Larger paths stay row-wise.
+//
+// If the compactor is set to compress then each block is compressed if that
+// makes it at least an eighth smaller. The data file is written sparsely so the space after a
+// compressed block is never allocated on disk. Spanned blocks are never
+// compressed since the parts of a spanned path are read at the same time.
+//
+// The compacted data is written to temporary files next to the data file and
+// header file and then renamed over them once they are synced to disk.
+
+
+//==============================================================================
+//
+// Typedefs
+//
+//==============================================================================
+
+#define SKY_COMPACTOR_DEFAULT_FILL_FACTOR 0.9
+
+// A contiguous run of event data within a path. A spanned path is made up of
+// one segment per block.
+typedef struct {
+    void *ptr;
+    size_t length;
+    bool encoded;
+} sky_compactor_segment;
+
+// A reference to a raw event within a path. The original position of the
+// event is kept so that events can be stably sorted by timestamp. The size is
+// the number of bytes the event takes up in the compacted block.
+typedef struct {
+    void *ptr;
+    size_t length;
+    size_t size;
+    sky_timestamp_t timestamp;
+    uint32_t index;
+} sky_compactor_event;
+
+typedef struct {
+    double fill_factor;
+    uint32_t version;
+    bool compress;
+    bool compact;
+    bool compact_path;
+    sky_timestamp_t previous_timestamp;
+    bool spanned_path;
+    bool has_directory;
+    uint32_t block_size;
+    size_t target_size;
+    FILE *file;
+    void *buffer;
+    size_t buffer_length;
+    uint32_t path_count;
+    void *compress_buffer;
+    void *scratch;
+    size_t scratch_capacity;
+    sky_block *block;
+    sky_block **blocks;
+    uint32_t block_count;
+    sky_compactor_event *events;
+    uint32_t event_capacity;
+    FILE *extent_file;
+    uint32_t large_path_threshold;
+} sky_compactor;
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+sky_compactor *sky_compactor_create();
+
+void sky_compactor_free(sky_compactor *compactor);
+
+//--------------------------------------
+// Compaction
+//--------------------------------------
+
+int sky_compactor_compact(sky_compactor *compactor, sky_data_file *data_file);
+
+#endif
@@ -13,6 +13,9 @@
 
 int sky_cursor_set_ptr(sky_cursor *cursor, void *ptr);
 int sky_cursor_set_eof(sky_cursor *cursor);
+int sky_cursor_decode_event(sky_cursor *cursor);
+int sky_cursor_move(sky_cursor *cursor);
+int sky_cursor_apply_window(sky_cursor *cursor);
 
 
 //==============================================================================
@@ -68,7 +71,8 @@ void sky_cursor_free(sky_cursor *cursor)
 // Path Management
 //--------------------------------------
 
-// Assigns a single path to the cursor.
+// Assigns a single path to the cursor. Passing a null pointer removes the
+// paths from the cursor and releases its path list.
 // 
 // cursor - The cursor.
 // ptr    - A pointer to the raw data where the path starts.
@@ -79,45 +83,52 @@ int sky_cursor_set_path(sky_cursor *cursor, void *ptr)
     int rc;
     check(cursor != NULL, "Cursor required");
 
-    // If data is not null then create an array of one pointer.
-    void **ptrs;
+    // Assign the path as a list of one pointer.
     if(ptr != NULL) {
-        ptrs = malloc(sizeof(void*)); check_mem(ptrs);
-        ptrs[0] = ptr;
-        rc = sky_cursor_set_paths(cursor, ptrs, 1);
+        rc = sky_cursor_set_paths(cursor, &ptr, 1);
         check(rc == 0, "Unable to set path data to cursor");
     }
     // Otherwise clear out pointer paths.
     else {
         rc = sky_cursor_set_paths(cursor, NULL, 0);
         check(rc == 0, "Unable to remove path data");
+        free(cursor->paths);
+        cursor->paths = NULL;
+        cursor->path_capacity = 0;
     }
 
     return 0;
 
 error:
-    if(ptrs) free(ptrs);
     return -1;
 }
 
-// Assigns a list of path pointers to the cursor.
+// Assigns a list of path pointers to the cursor. The pointers are copied into
+// the cursor's path list which is only reallocated if it is too small.
 // 
 // cursor - The cursor.
 // ptrs   - An array to pointers of raw paths.
+// count  - The number of paths.
 //
 // Returns 0 if successful, otherwise returns -1.
 int sky_cursor_set_paths(sky_cursor *cursor, void **ptrs, int count)
 {
     int rc;
     check(cursor != NULL, "Cursor required");
+    check(count >= 0, "Path count cannot be negative");
     
-    // Free old path list.
-    if(cursor->paths != NULL) {
-        free(cursor->paths);
+    // Grow the path list if needed.
+    if((uint32_t)count > cursor->path_capacity) {
+        void **paths = realloc(cursor->paths, count * sizeof(*paths));
+        check_mem(paths);
+        cursor->paths = paths;
+        cursor->path_capacity = count;
     }
 
-    // Assign path data list.
-    cursor->paths = ptrs;
+    // Copy path data list.
+    if(count > 0 && ptrs != cursor->paths) {
+        memcpy(cursor->paths, ptrs, count * sizeof(*ptrs));
+    }
     cursor->path_count = count;
     cursor->path_index = 0;
     cursor->event_index = 0;
@@ -127,11 +138,14 @@ int sky_cursor_set_paths(sky_cursor *cursor, void **ptrs, int count)
     if(count > 0) {
         rc = sky_cursor_set_ptr(cursor, cursor->paths[0]);
         check(rc == 0, "Unable to set paths");
+        rc = sky_cursor_apply_window(cursor);
+        check(rc == 0, "Unable to apply time window");
     }
     // Otherwise clear out the pointer.
     else {
         cursor->ptr = NULL;
         cursor->endptr = NULL;
+        cursor->compact = false;
     }
     
     return 0;
@@ -141,6 +155,72 @@ error:
 }
 
 
+// Restricts the cursor to events in a time window. Events before the start
+// of the window are skipped and the cursor is at EOF once it reaches an event
+// at or after the end. The window should be set before the paths are set.
+//
+// cursor - The cursor.
+// start  - The first timestamp in the window.
+// end    - The timestamp just after the window.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_cursor_set_window(sky_cursor *cursor, sky_timestamp_t start,
+                          sky_timestamp_t end)
+{
+    int rc;
+    check(cursor != NULL, "Cursor required");
+
+    cursor->windowed = true;
+    cursor->window_start = start;
+    cursor->window_end = end;
+
+    rc = sky_cursor_apply_window(cursor);
+    check(rc == 0, "Unable to apply time window");
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Moves the cursor past any events before its time window and sets EOF if
+// the current event is after the window. Paths are sorted by timestamp so no
+// later events can be in the window.
+//
+// cursor - The cursor.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_cursor_apply_window(sky_cursor *cursor)
+{
+    int rc;
+    if(!cursor->windowed || cursor->path_count == 0) {
+        return 0;
+    }
+
+    while(!cursor->eof) {
+        sky_timestamp_t timestamp;
+        rc = sky_cursor_get_timestamp(cursor, &timestamp);
+        check(rc == 0, "Unable to retrieve timestamp");
+        if(timestamp >= cursor->window_end) {
+            rc = sky_cursor_set_eof(cursor);
+            check(rc == 0, "Unable to set EOF on cursor");
+        }
+        else if(timestamp < cursor->window_start) {
+            rc = sky_cursor_move(cursor);
+            check(rc == 0, "Unable to move to next event");
+        }
+        else {
+            break;
+        }
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+
 //--------------------------------------
 // Pointer Management
 //--------------------------------------
@@ -159,6 +239,18 @@ int sky_cursor_set_ptr(sky_cursor *cursor, void *ptr)
     // Store position of first event and store position of end of path.
     cursor->ptr    = ptr + SKY_PATH_HEADER_LENGTH;
     cursor->endptr = ptr + sky_path_sizeof_raw(ptr);
+
+    // Compact timestamps are relative to the previous event.
+    cursor->compact = sky_path_is_compact(ptr);
+    if(cursor->compact) {
+        cursor->timestamp = 0;
+    }
+
+    // Decode the first event.
+    if(cursor->ptr < cursor->endptr) {
+        int rc = sky_cursor_decode_event(cursor);
+        check(rc == 0, "Unable to decode event");
+    }
     
     return 0;
 
@@ -173,19 +265,53 @@ error:
 // Iteration
 //--------------------------------------
 
+// Moves the cursor to the next event in its time window.
+//
+// cursor - The cursor.
+//
+// Returns 0 if successful, otherwise returns -1.
 int sky_cursor_next(sky_cursor *cursor)
+{
+    int rc;
+    rc = sky_cursor_move(cursor);
+    check(rc == 0, "Unable to move to next event");
+    rc = sky_cursor_apply_window(cursor);
+    check(rc == 0, "Unable to apply time window");
+    return 0;
+
+error:
+    return -1;
+}
+
+// Moves the cursor to the next event regardless of the time window.
+//
+// cursor - The cursor.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_cursor_move(sky_cursor *cursor)
 {
     int rc;
     check(cursor != NULL, "Cursor required");
     check(!cursor->eof, "No more events are available");
 
-    // Move to next event.
-    size_t event_length = sky_event_sizeof_raw(cursor->ptr);
-    cursor->ptr += event_length;
+    // Move to next event. Compact events end with their data.
+    if(cursor->compact) {
+        cursor->ptr = cursor->data_ptr + cursor->data_length;
+    }
+    else {
+        cursor->ptr += sky_event_sizeof_raw(cursor->ptr);
+    }
+    bool path_eof = (cursor->ptr >= cursor->endptr);
     cursor->event_index++;
 
+    // Decode the new event.
+    if(!path_eof) {
+        rc = sky_cursor_decode_event(cursor);
+        check(rc == 0, "Unable to decode event");
+    }
+
     // If pointer is beyond the last event then move to next path.
-    if(cursor->ptr >= cursor->endptr) {
+    if(path_eof) {
         cursor->path_index++;
 
         // Move to the next path if more paths are remaining.
@@ -201,7 +327,10 @@ int sky_cursor_next(sky_cursor *cursor)
     }
 
     // Make sure that we are point at an event.
-    if(!cursor->eof) {
+    if(!cursor->eof && cursor->compact) {
+        check(cursor->action_id != 0 || cursor->data_length > 0, "Cursor pointing at invalid compact event data: %p", cursor->ptr);
+    }
+    else if(!cursor->eof) {
         sky_event_flag_t flag = *((sky_event_flag_t*)cursor->ptr);
         check(flag & SKY_EVENT_FLAG_ACTION || flag & SKY_EVENT_FLAG_DATA, "Cursor pointing at invalid raw event data: %p", cursor->ptr);
     }
@@ -226,6 +355,64 @@ int sky_cursor_set_eof(sky_cursor *cursor)
     cursor->eof         = true;
     cursor->ptr         = NULL;
     cursor->endptr      = NULL;
+    cursor->compact     = false;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+
+// Decodes the header of the event at the cursor's pointer into the cursor's
+// timestamp, action id and data fields. The timestamp of the previous event
+// is read from the cursor for compact events.
+//
+// cursor - The cursor.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_cursor_decode_event(sky_cursor *cursor)
+{
+    check(cursor != NULL, "Cursor required");
+
+    // Compact events are decoded inline since this runs for every event in a
+    // scan. See sky_event_unpack_compact_hdr() for the layout.
+    if(cursor->compact) {
+        uint64_t length, delta, action_id = 0;
+        void *ptr = cursor->ptr;
+        SKY_EVENT_READ_VARINT(ptr, length);
+        void *endptr = ptr + length;
+        sky_event_flag_t flag = *((sky_event_flag_t*)ptr);
+        ptr += sizeof(sky_event_flag_t);
+        SKY_EVENT_READ_VARINT(ptr, delta);
+        if(flag & SKY_EVENT_FLAG_ACTION) {
+            SKY_EVENT_READ_VARINT(ptr, action_id);
+        }
+        check(ptr <= endptr, "Invalid compact event length");
+        cursor->timestamp += SKY_EVENT_ZIGZAG_DECODE(delta);
+        cursor->action_id = (sky_action_id_t)action_id;
+        cursor->data_length = endptr - ptr;
+        cursor->data_ptr = ptr;
+    }
+    // Row-wise events only store the action id and data length if they have
+    // an action or data.
+    else {
+        sky_event_flag_t flag = *((sky_event_flag_t*)cursor->ptr);
+        void *ptr = cursor->ptr + sizeof(sky_event_flag_t);
+        cursor->timestamp = *((sky_timestamp_t*)ptr);
+        ptr += sizeof(sky_timestamp_t);
+        cursor->action_id = 0;
+        if(flag & SKY_EVENT_FLAG_ACTION) {
+            cursor->action_id = *((sky_action_id_t*)ptr);
+            ptr += sizeof(sky_action_id_t);
+        }
+        cursor->data_length = 0;
+        cursor->data_ptr = NULL;
+        if(flag & SKY_EVENT_FLAG_DATA) {
+            cursor->data_length = *((sky_event_data_length_t*)ptr);
+            cursor->data_ptr = ptr + sizeof(sky_event_data_length_t);
+        }
+    }
 
     return 0;
 
@@ -238,6 +425,26 @@ error:
 // Event Management
 //--------------------------------------
 
+// Retrieves the timestamp of the current event.
+//
+// cursor    - The cursor.
+// timestamp - A pointer to where the timestamp should be returned to.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_cursor_get_timestamp(sky_cursor *cursor, sky_timestamp_t *timestamp)
+{
+    check(cursor != NULL, "Cursor required");
+    check(!cursor->eof, "Cursor cannot be EOF");
+    check(timestamp != NULL, "Timestamp return pointer required");
+
+    *timestamp = cursor->timestamp;
+    return 0;
+
+error:
+    if(timestamp) *timestamp = 0;
+    return -1;
+}
+
 // Retrieves a the action identifier of the current event.
 //
 // cursor    - The cursor.
@@ -250,14 +457,8 @@ int sky_cursor_get_action_id(sky_cursor *cursor, sky_action_id_t *action_id)
     check(!cursor->eof, "Cursor cannot be EOF");
     check(action_id != NULL, "Action id return pointer required");
 
-    // Retrieve the action id.
-    if(*((sky_event_flag_t*)cursor->ptr) & SKY_EVENT_FLAG_ACTION) {
-        *action_id = *((sky_action_id_t*)(cursor->ptr + sizeof(sky_event_flag_t) + sizeof(sky_timestamp_t)));
-    }
-    else {
-        *action_id = 0;
-    }
-    
+    // Events without an action have an action id of zero.
+    *action_id = cursor->action_id;
     return 0;
 
 error:
@@ -281,27 +482,8 @@ int sky_cursor_get_data_ptr(sky_cursor *cursor, void **data_ptr,
     check(data_ptr != NULL, "Data return pointer required");
     check(data_length != NULL, "Data length return pointer required");
 
-    // Retrieve the data section if this event has data.
-    if(*((sky_event_flag_t*)cursor->ptr) & SKY_EVENT_FLAG_DATA) {
-        // Move past the initial header (flag, timestamp, action_id).
-        void *ptr = cursor->ptr;
-        ptr += sizeof(sky_event_flag_t) + sizeof(sky_timestamp_t);
-        if(*((sky_event_flag_t*)cursor->ptr) & SKY_EVENT_FLAG_ACTION) {
-            ptr += sizeof(sky_action_id_t);
-        }
-
-        // At the end of the header is the data length.
-        *data_length = *((sky_event_data_length_t*)(ptr));
-        
-        // After the data length begins the data section.
-        *data_ptr = ptr + sizeof(sky_event_data_length_t);
-    }
-    // If this is an action-only event then return null.
-    else {
-        *data_ptr = NULL;
-        *data_length = 0;
-    }
-    
+    *data_length = cursor->data_length;
+    *data_ptr = (cursor->data_length > 0 ? cursor->data_ptr : NULL);
     return 0;
 
 error:
@@ -310,3 +492,50 @@ error:
     return -1;
 }
 
+// Writes the current event in the row-wise event format.
+//
+// cursor - The cursor.
+// ptr    - The pointer to where the event is written.
+// sz     - The number of bytes written.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_cursor_pack_event(sky_cursor *cursor, void *ptr, size_t *sz)
+{
+    int rc;
+    check(cursor != NULL, "Cursor required");
+    check(!cursor->eof, "Cursor cannot be EOF");
+    check(ptr != NULL, "Pointer required");
+
+    // Row-wise events are copied as-is.
+    if(!cursor->compact) {
+        size_t event_length = sky_event_sizeof_raw(cursor->ptr);
+        memcpy(ptr, cursor->ptr, event_length);
+        if(sz != NULL) *sz = event_length;
+        return 0;
+    }
+
+    sky_timestamp_t timestamp;
+    sky_action_id_t action_id;
+    void *data_ptr;
+    uint32_t data_length;
+    rc = sky_cursor_get_timestamp(cursor, &timestamp);
+    check(rc == 0, "Unable to retrieve timestamp");
+    rc = sky_cursor_get_action_id(cursor, &action_id);
+    check(rc == 0, "Unable to retrieve action id");
+    rc = sky_cursor_get_data_ptr(cursor, &data_ptr, &data_length);
+    check(rc == 0, "Unable to retrieve data");
+
+    size_t hdrsz;
+    rc = sky_event_pack_hdr(timestamp, action_id, data_length, ptr, &hdrsz);
+    check(rc == 0, "Unable to pack event header");
+    if(data_length > 0) {
+        memcpy(ptr + hdrsz, data_ptr, data_length);
+    }
+    if(sz != NULL) *sz = hdrsz + data_length;
+
+    return 0;
+
+error:
+    if(sz != NULL) *sz = 0;
+    return -1;
+}
@@ -7,6 +7,7 @@
 
 #include "bstring.h"
 #include "types.h"
+#include "event.h"
 
 
 //==============================================================================
@@ -20,11 +21,40 @@
 // data file. It also abstracts away the underlying storage of the events by
 // seamlessly combining spanned blocks into a single path.
 //
+// Compact paths are decoded one event at a time as the cursor moves since
+// each timestamp is stored relative to the previous event, so callers should
+// use the accessor functions rather than decoding events at the cursor's
+// pointer themselves.
+//
+// The header of the current event is decoded into the cursor's timestamp,
+// action id and data fields whenever the cursor moves, whatever the format
+// of the path. Compiled queries read these fields directly so they don't
+// need to know how the path is stored.
+//
+// The cursor keeps its own copy of the list of path pointers. The list is
+// only grown when more paths are set than it can hold so a cursor that is
+// reused for every path in a scan doesn't allocate memory per path. Setting
+// a null path releases the list.
+//
+// A cursor can be restricted to a time window. Events before the window are
+// skipped and the cursor stops at the first event after it.
+//
 // The current API to the cursor is simple. It provides forward-only access to
 // basic event data in a path. However, future releases will allow bidirectional
 // traversal, event search, & object state management.
 
 
+//==============================================================================
+//
+// Definitions
+//
+//==============================================================================
+
+// The largest row-wise event header that `sky_cursor_pack_event()` can write.
+#define SKY_CURSOR_MAX_EVENT_HEADER_LENGTH \
+    (SKY_EVENT_HEADER_LENGTH + sizeof(sky_action_id_t) + sizeof(sky_event_data_length_t))
+
+
 //==============================================================================
 //
 // Typedefs
@@ -34,11 +64,20 @@
 typedef struct sky_cursor {
     void **paths;
     uint32_t path_count;
+    uint32_t path_capacity;
     uint32_t path_index;
     uint32_t event_index;
     void *ptr;
     void *endptr;
     bool eof;
+    bool compact;
+    sky_timestamp_t timestamp;
+    sky_action_id_t action_id;
+    sky_event_data_length_t data_length;
+    void *data_ptr;
+    bool windowed;
+    sky_timestamp_t window_start;
+    sky_timestamp_t window_end;
 } sky_cursor;
 
 
@@ -69,6 +108,9 @@ int sky_cursor_set_path(sky_cursor *cursor, void *ptr);
 
 int sky_cursor_set_paths(sky_cursor *cursor, void **ptrs, int count);
 
+int sky_cursor_set_window(sky_cursor *cursor, sky_timestamp_t start,
+    sky_timestamp_t end);
+
 
 //--------------------------------------
 // Iteration
@@ -81,10 +123,14 @@ int sky_cursor_next(sky_cursor *cursor);
 // Event Management
 //--------------------------------------
 
+int sky_cursor_get_timestamp(sky_cursor *cursor, sky_timestamp_t *timestamp);
+
 int sky_cursor_get_action_id(sky_cursor *cursor, sky_action_id_t *action_id);
 
 int sky_cursor_get_data_ptr(sky_cursor *cursor, void **data_ptr,
     uint32_t *data_length);
 
+int sky_cursor_pack_event(sky_cursor *cursor, void *ptr, size_t *sz);
+
 
 #endif
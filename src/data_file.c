@@ -2,12 +2,16 @@
 #include <inttypes.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <errno.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "dbg.h"
 #include "mem.h"
 #include "bstring.h"
 #include "file.h"
+#include "timestamp.h"
+#include "path.h"
 #include "data_file.h"
 
 //==============================================================================
@@ -18,14 +22,49 @@
 
 int sky_data_file_unmap(sky_data_file *data_file);
 
+int sky_data_file_resize(sky_data_file *data_file, size_t length);
+
+int sky_data_file_map(sky_data_file *data_file, size_t length);
+
+int sky_data_file_map_reservation(sky_data_file *data_file, int fd,
+    void **ptr, size_t *capacity, size_t length);
+
 int sky_data_file_load_header(sky_data_file *data_file);
 int sky_data_file_unload_header(sky_data_file *data_file);
 int sky_data_file_create_header(sky_data_file *data_file);
+int sky_data_file_map_header(sky_data_file *data_file);
+int sky_data_file_count_header_blocks(sky_data_file *data_file,
+    uint32_t slot_count, uint32_t *ret);
+int sky_data_file_resize_header(sky_data_file *data_file, size_t length);
 
 int sky_data_file_normalize(sky_data_file *data_file);
 
+int sky_data_file_load_extents(sky_data_file *data_file);
+int sky_data_file_unload_extents(sky_data_file *data_file);
+int sky_data_file_open_extents(sky_data_file *data_file);
+int sky_data_file_grow_extents(sky_data_file *data_file, size_t length);
+
+int sky_data_file_move_large_path(sky_data_file *data_file, sky_block *block,
+    sky_event *event, sky_extent **ret);
+
+int sky_data_file_search_blocks(sky_data_file *data_file,
+    sky_object_id_t object_id, uint32_t *index);
+
+int sky_data_file_find_block_index(sky_data_file *data_file, sky_block *key,
+    sky_block *block, uint32_t count, uint32_t *index);
+
+int sky_data_file_reposition_block(sky_data_file *data_file, uint32_t index,
+    uint32_t count);
+
+int sky_data_file_restore_block_order(sky_data_file *data_file,
+    sky_block *block, sky_block *key, uint32_t block_count);
+
 int compare_blocks(const void *_a, const void *_b);
 
+int compare_event_refs(const void *_a, const void *_b);
+
+int compare_extents(const void *_a, const void *_b);
+
 
 //==============================================================================
 //
@@ -45,7 +84,11 @@ sky_data_file *sky_data_file_create()
 {
     sky_data_file *data_file = calloc(sizeof(sky_data_file), 1);
     check_mem(data_file);
+    data_file->version = SKY_DATA_FILE_VERSION;
     data_file->block_size = SKY_DEFAULT_BLOCK_SIZE;
+    data_file->reservation_size = SKY_DATA_FILE_DEFAULT_RESERVATION_SIZE;
+    data_file->chunk_size = SKY_DATA_FILE_DEFAULT_CHUNK_SIZE;
+    data_file->autosync = true;
     return data_file;
     
 error:
@@ -63,6 +106,8 @@ void sky_data_file_free(sky_data_file *data_file)
         data_file->path = NULL;
         sky_data_file_unload(data_file);
         sky_data_file_unload_header(data_file);
+        if(data_file->extent_path) bdestroy(data_file->extent_path);
+        data_file->extent_path = NULL;
         free(data_file);
     }
 }
@@ -120,13 +165,39 @@ error:
     return -1;
 }
 
+// Sets the file path for the extent file. Large paths are only moved into
+// extents if an extent path is set.
+//
+// data_file - The data file object.
+// path      - The file path to set.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_set_extent_path(sky_data_file *data_file, bstring path)
+{
+    check(data_file != NULL, "Data file required");
+
+    if(data_file->extent_path) {
+        bdestroy(data_file->extent_path);
+    }
+
+    data_file->extent_path = bstrcpy(path);
+    if(path) check_mem(data_file->extent_path);
+
+    return 0;
+
+error:
+    data_file->extent_path = NULL;
+    return -1;
+}
+
 
 //--------------------------------------
 // Persistence
 //--------------------------------------
 
 // Loads the data file into memory as a memory-mapped file. If the data file
-// is already loaded into memory then it is remapped.
+// is already loaded into memory then the file is grown to fit any new blocks.
+// The mapping only moves if the file has outgrown its reserved address space.
 //
 // data_file - The data file to load.
 //
@@ -134,7 +205,6 @@ error:
 int sky_data_file_load(sky_data_file *data_file)
 {
     int rc;
-    void *ptr;
     check(data_file != NULL, "Data file required");
     check(data_file->path != NULL, "Data file path required");
 
@@ -150,42 +220,161 @@ int sky_data_file_load(sky_data_file *data_file)
     // Calculate the data length.
     size_t data_length = data_file->block_count * data_file->block_size;
 
-    // Close mapping if remapping isn't supported.
-    if(!MREMAP_AVAILABLE) {
-        rc = sky_data_file_unmap(data_file);
-        check(rc == 0, "Unable to unmap data file");
-    }
-
-    // Open the data file and map it if it is not currently open.
+    // Open the data file if it is not currently open.
     if(data_file->data_fd == 0) {
         data_file->data_fd = open(bdata(data_file->path), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
         check(data_file->data_fd != -1, "Failed to open data file descriptor: %s",  bdata(data_file->path));
 
-        // Truncate the file to the appropriate size (larger or smaller).
-        rc = ftruncate(data_file->data_fd, data_length);
-        check(rc == 0, "Unable to truncate data file");
+        struct stat st;
+        rc = fstat(data_file->data_fd, &st);
+        check(rc == 0, "Unable to stat data file: %s", bdata(data_file->path));
+        data_file->file_length = st.st_size;
+    }
+
+    // Resize the file so that all blocks are backed by the file.
+    rc = sky_data_file_resize(data_file, data_length);
+    check(rc == 0, "Unable to resize data file");
+
+    // Map the file or extend the mapping.
+    rc = sky_data_file_map(data_file, data_length);
+    check(rc == 0, "Unable to map data file");
+
+    data_file->data_length = data_length;
+
+    // Load large path extents if they haven't been loaded yet.
+    rc = sky_data_file_load_extents(data_file);
+    check(rc == 0, "Unable to load extents");
+
+    return 0;
+
+error:
+    sky_data_file_unload(data_file);
+    return -1;
+}
+
+// Resizes the data file so that it is at least a given length. If no chunk
+// size is set then the file is sized exactly to the length. Otherwise the file
+// is only grown and space is preallocated a chunk at a time.
+//
+// data_file - The data file.
+// length    - The minimum number of bytes the file should hold.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_resize(sky_data_file *data_file, size_t length)
+{
+    int rc;
+    check(data_file != NULL, "Data file required");
+
+    // Size the file exactly if chunking is disabled.
+    if(data_file->chunk_size == 0) {
+        if(length != data_file->file_length) {
+            rc = ftruncate(data_file->data_fd, length);
+            check(rc == 0, "Unable to truncate data file");
+            data_file->file_length = length;
+        }
+        return 0;
+    }
+
+    // Otherwise grow the file to the next chunk boundary.
+    if(length > data_file->file_length) {
+        size_t file_length = ((length + data_file->chunk_size - 1) / data_file->chunk_size) * data_file->chunk_size;
+#if FALLOCATE_AVAILABLE
+        rc = fallocate(data_file->data_fd, 0, data_file->file_length, file_length - data_file->file_length);
+        if(rc != 0 && (errno == EOPNOTSUPP || errno == ENOSYS)) {
+            rc = ftruncate(data_file->data_fd, file_length);
+        }
+#else
+        rc = ftruncate(data_file->data_fd, file_length);
+#endif
+        check(rc == 0, "Unable to grow data file");
+        data_file->file_length = file_length;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Maps the data file into a reserved range of address space that is large
+// enough to hold a given length.
+//
+// data_file - The data file.
+// length    - The number of bytes that need to be mapped.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_map(sky_data_file *data_file, size_t length)
+{
+    check(data_file != NULL, "Data file required");
+    return sky_data_file_map_reservation(data_file, data_file->data_fd, &data_file->data, &data_file->data_capacity, length);
+
+error:
+    return -1;
+}
+
+// Maps a file into a reserved range of address space that is large enough to
+// hold a given length. Pages past the end of the file are never accessed so
+// the reservation doesn't use any memory. If the reservation is too small
+// then it is doubled until the length fits and the file is remapped.
+//
+// data_file - The data file.
+// fd        - The file descriptor of the file to map.
+// ptr       - A pointer to the current mapping. This is updated if the file
+//             is mapped or remapped.
+// capacity  - A pointer to the size of the current reservation.
+// length    - The number of bytes that need to be mapped.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_map_reservation(sky_data_file *data_file, int fd,
+                                  void **ptr, size_t *capacity, size_t length)
+{
+    void *addr;
+    check(data_file != NULL, "Data file required");
+
+    // Nothing to do if the length fits in the current mapping.
+    if(*ptr != NULL && length <= *capacity) {
+        return 0;
+    }
+
+    // Determine the size of the reservation.
+    size_t sz = (*capacity > 0 ? *capacity : data_file->reservation_size);
+    if(sz == 0) {
+        sz = length;
+    }
+    while(sz < length) {
+        sz *= 2;
+    }
 
-        // Memory map the data file.
-        ptr = mmap(0, data_length, PROT_READ | PROT_WRITE, MAP_SHARED, data_file->data_fd, 0);
-        check(ptr != MAP_FAILED, "Unable to memory map data file");
+    // Map the file for the first time.
+    if(*ptr == NULL) {
+        addr = mmap(0, sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fd, 0);
+        check(addr != MAP_FAILED, "Unable to memory map file");
     }
-    // If we already have the data mapped then simply remap it to the
-    // appropriate size.
+    // Otherwise move to a larger reservation and track the cost.
     else {
+        sky_timestamp_t t0, t1;
+        sky_timestamp_now(&t0);
 #if MREMAP_AVAILABLE
-        ptr = mremap(data_file->data, data_file->data_length, data_length, MREMAP_MAYMOVE);
-        check(ptr != MAP_FAILED, "Unable to remap data file");
+        addr = mremap(*ptr, *capacity, sz, MREMAP_MAYMOVE);
+        check(addr != MAP_FAILED, "Unable to remap file");
+#else
+        munmap(*ptr, *capacity);
+        *ptr = NULL;
+        *capacity = 0;
+        addr = mmap(0, sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fd, 0);
+        check(addr != MAP_FAILED, "Unable to memory map file");
 #endif
+        sky_timestamp_now(&t1);
+        data_file->remap_count++;
+        data_file->remap_time += (t1 - t0);
     }
 
-    // Update the data file.
-    data_file->data = ptr;
-    data_file->data_length = data_length;
+    *ptr = addr;
+    *capacity = sz;
 
     return 0;
 
 error:
-    sky_data_file_unload(data_file);
     return -1;
 }
 
@@ -196,13 +385,21 @@ error:
 // Returns 0 if successful, otherwise returns -1.
 int sky_data_file_unload(sky_data_file *data_file)
 {
+    check(data_file->snapshots == NULL, "Data file can't be unloaded while a snapshot is open");
+
     // Unload header.
     sky_data_file_unload_header(data_file);
     
     // Unmap the data file.
     sky_data_file_unmap(data_file);
+
+    // Unmap the extent file.
+    sky_data_file_unload_extents(data_file);
     
     return 0;
+
+error:
+    return -1;
 }
 
 // Unmaps the data file but does not unload the header.
@@ -212,29 +409,81 @@ int sky_data_file_unload(sky_data_file *data_file)
 // Returns 0 if successful, otherwise returns -1.
 int sky_data_file_unmap(sky_data_file *data_file)
 {
+    // Cached blocks may be stale once the file is mapped again.
+    if(data_file->block_cache != NULL) {
+        sky_block_cache_clear(data_file->block_cache);
+    }
+
     // Unmap file.
     if(data_file->data != NULL) {
-        munmap(data_file->data, data_file->data_length);
+        munmap(data_file->data, data_file->data_capacity);
     }
     
-    // Close file descriptor.
+    // Trim the unused end of the last chunk and close the file descriptor.
     if(data_file->data_fd != 0) {
+        if(data_file->file_length > data_file->data_length) {
+            if(ftruncate(data_file->data_fd, data_file->data_length) != 0) {
+                log_err("Unable to trim data file: %s", bdata(data_file->path));
+            }
+        }
         close(data_file->data_fd);
     }
     
     data_file->data_fd = 0;
     data_file->data = NULL;
     data_file->data_length = 0;
+    data_file->data_capacity = 0;
+    data_file->file_length = 0;
     
     return 0;
 }
 
 
+// Syncs the entire memory-mapped data file and the header file to disk. This
+// is used to checkpoint the data file when blocks are not synced on every
+// write.
+//
+// data_file - The data file to sync.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_sync(sky_data_file *data_file)
+{
+    int rc;
+    check(data_file != NULL, "Data file required");
+
+    // Sync the data file.
+    if(data_file->data != NULL) {
+        rc = msync(data_file->data, data_file->data_length, MS_SYNC);
+        check(rc == 0, "Unable to sync data file to disk");
+    }
+
+    // Sync the extent file.
+    if(data_file->extent_data != NULL && data_file->extent_data_length > 0) {
+        rc = msync(data_file->extent_data, data_file->extent_data_length, MS_SYNC);
+        check(rc == 0, "Unable to sync extent file to disk");
+    }
+
+    // Sync the header file.
+    rc = sky_data_file_flush_header(data_file);
+    check(rc == 0, "Unable to flush header file");
+    if(data_file->header_fd != 0) {
+        rc = fsync(data_file->header_fd);
+        check(rc == 0, "Unable to sync header file to disk");
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+
 //--------------------------------------
 // Header File Management
 //--------------------------------------
 
-// Loads header information for the data file.
+// Loads header information for the data file. The header file is
+// memory-mapped and the block ranges are read from the mapping.
 //
 // data_file - The data file object associated with the header file.
 //
@@ -243,9 +492,6 @@ int sky_data_file_load_header(sky_data_file *data_file)
 {
     int rc;
     size_t sz;
-    FILE *file;
-    uint32_t version = 1;
-    uint8_t buffer[SKY_BLOCK_HEADER_SIZE];
 
     // Unload existing header information.
     rc = sky_data_file_unload_header(data_file);
@@ -257,49 +503,59 @@ int sky_data_file_load_header(sky_data_file *data_file)
         check(rc == 0, "Unable to create header file");
     }
     
-    file = fopen(bdata(data_file->header_path), "r");
-    check(file, "Failed to open header file for reading: %s",  bdata(data_file->header_path));
+    // Determine the number of blocks from the file size, leaving out any
+    // unused slots at the end of the last chunk.
+    off_t file_length = sky_file_get_size(data_file->header_path);
+    check(file_length >= (off_t)SKY_HEADER_FILE_HDR_SIZE, "Header file is truncated: %s", bdata(data_file->header_path));
+    data_file->header_fd = open(bdata(data_file->header_path), O_RDWR);
+    check(data_file->header_fd != -1, "Failed to open header file descriptor: %s",  bdata(data_file->header_path));
+    data_file->header_file_length = file_length;
+    uint32_t block_count = 0;
+    rc = sky_data_file_count_header_blocks(data_file, (file_length - SKY_HEADER_FILE_HDR_SIZE) / SKY_BLOCK_HEADER_SIZE, &block_count);
+    check(rc == 0, "Unable to count header blocks");
+
+    // Allocate blocks.
+    if(block_count > 0) {
+        data_file->blocks = calloc(block_count, sizeof(sky_block*));
+        check_mem(data_file->blocks);
+        uint32_t i;
+        for(i=0; i<block_count; i++) {
+            data_file->blocks[i] = sky_block_create(data_file);
+            check_mem(data_file->blocks[i]);
+            data_file->blocks[i]->index = i;
+        }
+    }
+    data_file->block_count = block_count;
+
+    // Map the header file.
+    rc = sky_data_file_map_header(data_file);
+    check(rc == 0, "Unable to map header file");
+    void *ptr = data_file->header;
 
     // Read database format version.
-    rc = fread(&version, sizeof(version), 1, file);
-    check(rc == 1, "Unable to read version");
+    uint32_t version = *((uint32_t*)ptr);
+    check(version >= SKY_DATA_FILE_VERSION && version <= SKY_DATA_FILE_COMPACT_VERSION, "Unsupported header version: %d", version);
+    data_file->version = version;
+    ptr += sizeof(version);
 
     // Read block size.
-    rc = fread(&data_file->block_size, sizeof(data_file->block_size), 1, file);
-    check(rc == 1, "Unable to read block size");
-
-    // Read blocks until end of file.
-    off_t file_length = sky_file_get_size(data_file->header_path);
-    while(ftell(file) < file_length && !feof(file)) {
-        sky_block *block = sky_block_create(data_file); check_mem(block);
-        block->index = data_file->block_count;
+    data_file->block_size = *((uint32_t*)ptr);
+    ptr += sizeof(data_file->block_size);
 
-        // Read into buffer.
-        rc = fread(buffer, SKY_BLOCK_HEADER_SIZE, 1, file);
-        check(rc == 1, "Unable to read block #%d", block->index);
-        
-        // Unpack from buffer.
-        rc = sky_block_unpack(block, buffer, &sz);
-        check(rc == 0, "Unable to unpack block #%d", block->index);
-        
-        // Append to blocks
-        data_file->block_count++;
-        data_file->blocks = realloc(data_file->blocks, sizeof(sky_block*) * data_file->block_count);
-        check_mem(data_file->blocks);
-        data_file->blocks[data_file->block_count-1] = block;
+    // Unpack blocks.
+    uint32_t i;
+    for(i=0; i<data_file->block_count; i++) {
+        rc = sky_block_unpack(data_file->blocks[i], ptr, &sz);
+        check(rc == 0, "Unable to unpack block #%d", i);
+        ptr += sz;
     }
 
-    // Close the file.
-    fclose(file);
-
     rc = sky_data_file_normalize(data_file);
     check(rc == 0, "Unable to normalize data file");
     
-
     return 0;
 
 error:
-    if(file) fclose(file);
     sky_data_file_unload_header(data_file);
     return -1;
 }
@@ -313,6 +569,10 @@ int sky_data_file_unload_header(sky_data_file *data_file)
 {
     check(data_file != NULL, "Data file required");
     
+    // The cached blocks are about to be freed.
+    sky_block_cache_free(data_file->block_cache);
+    data_file->block_cache = NULL;
+
     if(data_file->blocks) {
         uint32_t i;
         for(i=0; i<data_file->block_count; i++) {
@@ -327,6 +587,26 @@ int sky_data_file_unload_header(sky_data_file *data_file)
     data_file->blocks = NULL;
     data_file->block_count = 0;
     
+    // Unmap the header file.
+    if(data_file->header != NULL) {
+        munmap(data_file->header, data_file->header_capacity);
+    }
+    if(data_file->header_fd != 0) {
+        if(data_file->header_file_length > data_file->header_length && data_file->header_length > 0) {
+            if(ftruncate(data_file->header_fd, data_file->header_length) != 0) {
+                log_err("Unable to trim header file: %s", bdata(data_file->header_path));
+            }
+        }
+        close(data_file->header_fd);
+    }
+    data_file->header_fd = 0;
+    data_file->header = NULL;
+    data_file->header_length = 0;
+    data_file->header_file_length = 0;
+    data_file->header_capacity = 0;
+    data_file->header_dirty_start = 0;
+    data_file->header_dirty_end = 0;
+
     return 0;
     
 error:
@@ -345,14 +625,14 @@ int sky_data_file_create_header(sky_data_file *data_file)
     check(data_file != NULL, "Data file required");
     check(data_file->header_path != NULL, "Data file header path required");
     check(!sky_file_exists(data_file->header_path), "Header file already exists");
+    check(data_file->version >= SKY_DATA_FILE_VERSION && data_file->version <= SKY_DATA_FILE_COMPACT_VERSION, "Unsupported data file version: %d", data_file->version);
 
     // Open the file for writing.
     FILE *file = fopen(bdata(data_file->header_path), "w");
     check(file, "Failed to open header file for writing: %s",  bdata(data_file->header_path));
 
     // Write database format version.
-    uint32_t version = SKY_DATA_FILE_VERSION;
-    rc = fwrite(&version, sizeof(version), 1, file);
+    rc = fwrite(&data_file->version, sizeof(data_file->version), 1, file);
     check(rc == 1, "Unable to write version");
 
     // Write block size.
@@ -375,11 +655,249 @@ error:
     return -1;
 }
 
+// Maps the header file into memory. The header file is resized to fit the
+// current number of blocks. The header is mapped into a reserved range of
+// address space so that it only needs to be remapped when it outgrows the
+// reservation.
+//
+// data_file - The data file object associated with the header file.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_map_header(sky_data_file *data_file)
+{
+    int rc;
+    void *ptr;
+    check(data_file != NULL, "Data file required");
+    check(data_file->header_path != NULL, "Data file header path required");
+
+    // Calculate the header length.
+    size_t header_length = SKY_HEADER_FILE_HDR_SIZE + (data_file->block_count * SKY_BLOCK_HEADER_SIZE);
+    if(header_length == data_file->header_length) {
+        return 0;
+    }
+
+    // Open the header file if it's not open yet.
+    if(data_file->header_fd == 0) {
+        data_file->header_fd = open(bdata(data_file->header_path), O_RDWR);
+        check(data_file->header_fd != -1, "Failed to open header file descriptor: %s",  bdata(data_file->header_path));
+    }
+
+    // Resize the file to fit all the blocks.
+    size_t old_length = data_file->header_length;
+    size_t old_file_length = data_file->header_file_length;
+    rc = sky_data_file_resize_header(data_file, header_length);
+    check(rc == 0, "Unable to resize header file");
+
+    // Determine the size of the reservation.
+    size_t capacity = (data_file->header_capacity > 0 ? data_file->header_capacity : SKY_HEADER_FILE_DEFAULT_RESERVATION_SIZE);
+    while(capacity < data_file->header_file_length) {
+        capacity *= 2;
+    }
+
+    // Map the header file if it isn't mapped yet.
+    if(data_file->header == NULL) {
+        ptr = mmap(0, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, data_file->header_fd, 0);
+        check(ptr != MAP_FAILED, "Unable to memory map header file");
+    }
+    // Otherwise remap it if it outgrew the reservation.
+    else if(capacity > data_file->header_capacity) {
+        sky_timestamp_t t0, t1;
+        sky_timestamp_now(&t0);
+#if MREMAP_AVAILABLE
+        ptr = mremap(data_file->header, data_file->header_capacity, capacity, MREMAP_MAYMOVE);
+        check(ptr != MAP_FAILED, "Unable to remap header file");
+#else
+        rc = sky_data_file_flush_header(data_file);
+        check(rc == 0, "Unable to flush header before remap");
+        munmap(data_file->header, data_file->header_capacity);
+        data_file->header = NULL;
+        ptr = mmap(0, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, data_file->header_fd, 0);
+        check(ptr != MAP_FAILED, "Unable to memory map header file");
+#endif
+        sky_timestamp_now(&t1);
+        data_file->remap_count++;
+        data_file->remap_time += (t1 - t0);
+    }
+    else {
+        ptr = data_file->header;
+    }
+
+    data_file->header = ptr;
+    data_file->header_length = header_length;
+    data_file->header_capacity = capacity;
+
+    // Clear the slots of new blocks since they may have been unused slots.
+    if(old_length > 0 && header_length > old_length) {
+        memset(ptr + old_length, 0, header_length - old_length);
+        rc = sky_data_file_mark_header_dirty(data_file, old_length, header_length - old_length);
+        check(rc == 0, "Unable to mark header dirty");
+    }
+    // Mark the slots of removed blocks as unused.
+    else if(old_length > header_length && data_file->header_file_length > header_length) {
+        memset(ptr + header_length, SKY_HEADER_FILE_UNUSED_SLOT_BYTE, old_length - header_length);
+        rc = sky_data_file_mark_header_dirty(data_file, header_length, old_length - header_length);
+        check(rc == 0, "Unable to mark header dirty");
+    }
+
+    // Mark the slots in a newly grown chunk as unused.
+    if(data_file->header_file_length > old_file_length) {
+        size_t start = (old_file_length > header_length ? old_file_length : header_length);
+        if(data_file->header_file_length > start) {
+            memset(ptr + start, SKY_HEADER_FILE_UNUSED_SLOT_BYTE, data_file->header_file_length - start);
+            rc = sky_data_file_mark_header_dirty(data_file, start, data_file->header_file_length - start);
+            check(rc == 0, "Unable to mark header dirty");
+        }
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Resizes the header file so that it is at least a given length. The header
+// file follows the chunking of the data file: it is sized exactly if chunking
+// is disabled and otherwise it is only grown, a chunk at a time.
+//
+// data_file - The data file object associated with the header file.
+// length    - The minimum number of bytes the header file should hold.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_resize_header(sky_data_file *data_file, size_t length)
+{
+    int rc;
+    check(data_file != NULL, "Data file required");
+
+    size_t file_length = length;
+    if(data_file->chunk_size > 0) {
+        if(length <= data_file->header_file_length) {
+            return 0;
+        }
+        file_length = ((length + SKY_HEADER_FILE_CHUNK_SIZE - 1) / SKY_HEADER_FILE_CHUNK_SIZE) * SKY_HEADER_FILE_CHUNK_SIZE;
+    }
+    
+    if(file_length != data_file->header_file_length) {
+        rc = ftruncate(data_file->header_fd, file_length);
+        check(rc == 0, "Unable to resize header file");
+        data_file->header_file_length = file_length;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Counts the blocks in the header file. Unused slots at the end of the
+// file are left over from chunked growth and are not counted.
+//
+// data_file  - The data file object associated with the header file.
+// slot_count - The number of block slots that fit in the header file.
+// ret        - A pointer to where the number of blocks should be returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_count_header_blocks(sky_data_file *data_file,
+                                      uint32_t slot_count, uint32_t *ret)
+{
+    uint8_t slot[SKY_BLOCK_HEADER_SIZE];
+    uint8_t unused[SKY_BLOCK_HEADER_SIZE];
+    check(data_file != NULL, "Data file required");
+    check(ret != NULL, "Return pointer required");
+    memset(unused, SKY_HEADER_FILE_UNUSED_SLOT_BYTE, SKY_BLOCK_HEADER_SIZE);
+
+    // Walk backwards until a used slot is found.
+    while(slot_count > 0) {
+        off_t offset = SKY_HEADER_FILE_HDR_SIZE + ((off_t)(slot_count-1) * SKY_BLOCK_HEADER_SIZE);
+        ssize_t sz = pread(data_file->header_fd, slot, SKY_BLOCK_HEADER_SIZE, offset);
+        check(sz == SKY_BLOCK_HEADER_SIZE, "Unable to read header slot");
+        if(memcmp(slot, unused, SKY_BLOCK_HEADER_SIZE) != 0) {
+            break;
+        }
+        slot_count--;
+    }
+
+    *ret = slot_count;
+    return 0;
+
+error:
+    *ret = 0;
+    return -1;
+}
+
+// Marks a range of the header file as changed so that it will be synced to
+// disk on the next flush.
+//
+// data_file - The data file object associated with the header file.
+// offset    - The byte offset of the change in the header file.
+// sz        - The number of bytes changed.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_mark_header_dirty(sky_data_file *data_file, size_t offset,
+                                    size_t sz)
+{
+    check(data_file != NULL, "Data file required");
+    check(offset + sz <= (data_file->header_file_length > data_file->header_length ? data_file->header_file_length : data_file->header_length), "Header range out of bounds");
+
+    // Expand the dirty range to include the change.
+    if(data_file->header_dirty_end == 0) {
+        data_file->header_dirty_start = offset;
+        data_file->header_dirty_end = offset + sz;
+    }
+    else {
+        if(offset < data_file->header_dirty_start) {
+            data_file->header_dirty_start = offset;
+        }
+        if(offset + sz > data_file->header_dirty_end) {
+            data_file->header_dirty_end = offset + sz;
+        }
+    }
+    
+    return 0;
+
+error:
+    return -1;
+}
+
+// Syncs the changed pages of the header file to disk.
+//
+// data_file - The data file object associated with the header file.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_flush_header(sky_data_file *data_file)
+{
+    int rc;
+    check(data_file != NULL, "Data file required");
+
+    // Exit if nothing has changed.
+    if(data_file->header == NULL || data_file->header_dirty_end == 0) {
+        return 0;
+    }
+    
+    // Align the start of the range to the page size.
+    long page_size = sysconf(_SC_PAGE_SIZE);
+    size_t start = data_file->header_dirty_start - (data_file->header_dirty_start % page_size);
+    
+    // Sync the dirty pages.
+    rc = msync(data_file->header + start, data_file->header_dirty_end - start, MS_SYNC);
+    check(rc == 0, "Unable to sync header file to disk");
+
+    data_file->header_dirty_start = 0;
+    data_file->header_dirty_end = 0;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+
 //--------------------------------------
 // Block Management
 //--------------------------------------
 
-// Appends an empty block at the end of the data file.
+// Appends an empty block at the end of the data file. The block is also
+// appended to the end of the block list and it is up to the caller to move
+// it into sorted order once its ranges are set.
 //
 // data_file - The data file.
 // ret       - A pointer to where the new block should be returned to.
@@ -397,21 +915,23 @@ int sky_data_file_create_block(sky_data_file *data_file, sky_block **ret)
     // Create new block.
     sky_block *block = sky_block_create(data_file); check_mem(block);
     block->index = data_file->block_count-1;
+    block->version = data_file->epoch;
     data_file->blocks[data_file->block_count-1] = block;
 
+    // Resize header file.
+    rc = sky_data_file_map_header(data_file);
+    check(rc == 0, "Unable to remap header file");
+
     // Remap data file.
     rc = sky_data_file_load(data_file);
     check(rc == 0, "Unable to reload data file");
 
     // Clear block.
     void *ptr;
-    rc = sky_block_get_ptr(block, &ptr);
+    rc = sky_block_get_raw_ptr(block, &ptr);
     check(rc == 0, "Unable to retrieve block pointer");
     memset(ptr, 0, data_file->block_size);
 
-    // Re-sort blocks.
-    qsort(data_file->blocks, data_file->block_count, sizeof(sky_block*), compare_blocks);
-
     // Return the new block.
     *ret = block;
 
@@ -461,10 +981,15 @@ int sky_data_file_find_insertion_block(sky_data_file *data_file,
     sky_object_id_t object_id = event->object_id;
     sky_timestamp_t timestamp = event->timestamp;
 
-    // Loop over sorted blocks to find the appropriate insertion point.
+    // Skip over all blocks whose object id range ends before the object id.
+    // Block ranges do not overlap so no earlier block can be used.
     uint32_t i;
+    rc = sky_data_file_search_blocks(data_file, object_id, &i);
+    check(rc == 0, "Unable to search blocks");
+
+    // Loop over the remaining sorted blocks to find the insertion point.
     sky_block *block = NULL;
-    for(i=0; i<data_file->block_count; i++) {
+    for(; i<data_file->block_count; i++) {
         block = data_file->blocks[i];
         
         // If block is within range then use the block.
@@ -475,7 +1000,7 @@ int sky_data_file_find_insertion_block(sky_data_file *data_file,
                 // Find first block where timestamp is before the max.
                 while(i<data_file->block_count && data_file->blocks[i]->min_object_id == object_id) {
                     if(timestamp <= data_file->blocks[i]->max_timestamp) {
-                        *ret = block;
+                        *ret = data_file->blocks[i];
                         break;
                     }
                     i++;
@@ -501,12 +1026,27 @@ int sky_data_file_find_insertion_block(sky_data_file *data_file,
             *ret = block;
             break;
         }
+        // If the object id falls before a single object block then no later
+        // block can be used without overlapping the span. Use the previous
+        // block if it is a multi-object block.
+        else if(object_id < block->min_object_id) {
+            if(i > 0 && !data_file->blocks[i-1]->spanned) {
+                *ret = data_file->blocks[i-1];
+            }
+            break;
+        }
     }
     
     // If we haven't found a block then it means that the object id is after all
     // other object ids or that we are inserting before a single object block or
     // that we have no blocks.
-    if(*ret == NULL) {
+    if(*ret == NULL && i < data_file->block_count) {
+        rc = sky_data_file_create_block(data_file, ret);
+        check(rc == 0, "Unable to create block");
+        rc = sky_data_file_reposition_block(data_file, data_file->block_count-1, data_file->block_count);
+        check(rc == 0, "Unable to reposition new block");
+    }
+    else if(*ret == NULL) {
         // Find the last block if one exists.
         sky_block *last_block = (data_file->block_count > 0 ? data_file->blocks[data_file->block_count-1] : NULL);
         
@@ -514,10 +1054,12 @@ int sky_data_file_find_insertion_block(sky_data_file *data_file,
         if(last_block != NULL && !last_block->spanned) {
             *ret = last_block;
         }
-        // Otherwise just create a new block.
+        // Otherwise just create a new block and move it into sorted order.
         else {
             rc = sky_data_file_create_block(data_file, ret);
             check(rc == 0, "Unable to create block");
+            rc = sky_data_file_reposition_block(data_file, data_file->block_count-1, data_file->block_count);
+            check(rc == 0, "Unable to reposition new block");
         }
     }
     
@@ -615,6 +1157,510 @@ error:
     return -1;
 }
 
+// Retrieves the cache used to read compressed blocks. The cache is created
+// the first time it is needed and is never smaller than the minimum size.
+//
+// data_file - The data file.
+// ret       - A pointer to where the block cache is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_get_block_cache(sky_data_file *data_file,
+                                  sky_block_cache **ret)
+{
+    check(data_file != NULL, "Data file required");
+
+    if(data_file->block_cache == NULL) {
+        uint32_t capacity = (data_file->block_cache_size > 0 ? data_file->block_cache_size : SKY_BLOCK_CACHE_DEFAULT_SIZE);
+        if(capacity < SKY_BLOCK_CACHE_MIN_SIZE) {
+            capacity = SKY_BLOCK_CACHE_MIN_SIZE;
+        }
+        data_file->block_cache = sky_block_cache_create(capacity, data_file->block_size);
+        check_mem(data_file->block_cache);
+    }
+
+    *ret = data_file->block_cache;
+    return 0;
+
+error:
+    *ret = NULL;
+    return -1;
+}
+
+
+//--------------------------------------
+// Extent Management
+//--------------------------------------
+
+// Loads the extent file if one exists. Freed extent records are skipped. The
+// extent file is only created once the first path is moved into an extent.
+//
+// data_file - The data file.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_load_extents(sky_data_file *data_file)
+{
+    int rc;
+    size_t sz;
+    sky_extent *extent = NULL;
+    check(data_file != NULL, "Data file required");
+
+    // Skip if there is no extent file or it is already loaded.
+    if(data_file->extent_path == NULL || data_file->extent_fd != 0 || !sky_file_exists(data_file->extent_path)) {
+        return 0;
+    }
+
+    rc = sky_data_file_open_extents(data_file);
+    check(rc == 0, "Unable to open extent file");
+
+    // Read each extent record.
+    size_t offset = 0;
+    while(offset + SKY_EXTENT_HEADER_SIZE <= data_file->extent_data_length) {
+        extent = sky_extent_create(data_file); check_mem(extent);
+        extent->offset = offset;
+        rc = sky_extent_unpack(extent, data_file->extent_data + offset, &sz);
+        check(rc == 0, "Unable to unpack extent at offset %ld", offset);
+        check(offset + sz + extent->capacity <= data_file->extent_data_length, "Extent file is truncated: %s", bdata(data_file->extent_path));
+        offset += sz + extent->capacity;
+
+        if(extent->object_id == 0) {
+            sky_extent_free(extent);
+        }
+        else {
+            data_file->extents = realloc(data_file->extents, sizeof(*data_file->extents) * (data_file->extent_count+1));
+            check_mem(data_file->extents);
+            data_file->extents[data_file->extent_count++] = extent;
+        }
+        extent = NULL;
+    }
+
+    // Sort by object id. If a resize was interrupted before the old record
+    // was freed then only the last copy of the extent is kept.
+    qsort(data_file->extents, data_file->extent_count, sizeof(*data_file->extents), compare_extents);
+    uint32_t i, count = 0;
+    for(i=0; i<data_file->extent_count; i++) {
+        if(count > 0 && data_file->extents[count-1]->object_id == data_file->extents[i]->object_id) {
+            sky_extent_free(data_file->extents[count-1]);
+            count--;
+        }
+        data_file->extents[count++] = data_file->extents[i];
+    }
+    data_file->extent_count = count;
+
+    return 0;
+
+error:
+    sky_extent_free(extent);
+    sky_data_file_unload_extents(data_file);
+    return -1;
+}
+
+// Unmaps the extent file and frees the extent list.
+//
+// data_file - The data file.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_unload_extents(sky_data_file *data_file)
+{
+    check(data_file != NULL, "Data file required");
+
+    uint32_t i;
+    for(i=0; i<data_file->extent_count; i++) {
+        sky_extent_free(data_file->extents[i]);
+    }
+    free(data_file->extents);
+    data_file->extents = NULL;
+    data_file->extent_count = 0;
+
+    if(data_file->extent_data != NULL) {
+        munmap(data_file->extent_data, data_file->extent_capacity);
+    }
+    if(data_file->extent_fd != 0) {
+        close(data_file->extent_fd);
+    }
+    data_file->extent_fd = 0;
+    data_file->extent_data = NULL;
+    data_file->extent_data_length = 0;
+    data_file->extent_capacity = 0;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Opens the extent file, creating it if it doesn't exist, and maps it into
+// memory.
+//
+// data_file - The data file.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_open_extents(sky_data_file *data_file)
+{
+    int rc;
+    check(data_file != NULL, "Data file required");
+    check(data_file->extent_path != NULL, "Extent file path required");
+
+    data_file->extent_fd = open(bdata(data_file->extent_path), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    check(data_file->extent_fd != -1, "Failed to open extent file descriptor: %s", bdata(data_file->extent_path));
+
+    struct stat st;
+    rc = fstat(data_file->extent_fd, &st);
+    check(rc == 0, "Unable to stat extent file: %s", bdata(data_file->extent_path));
+    data_file->extent_data_length = st.st_size;
+
+    rc = sky_data_file_map_reservation(data_file, data_file->extent_fd, &data_file->extent_data, &data_file->extent_capacity, data_file->extent_data_length);
+    check(rc == 0, "Unable to map extent file");
+
+    return 0;
+
+error:
+    if(data_file->extent_fd == -1) data_file->extent_fd = 0;
+    return -1;
+}
+
+// Grows the extent file to a given length and extends the mapping over it.
+//
+// data_file - The data file.
+// length    - The new length of the extent file.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_grow_extents(sky_data_file *data_file, size_t length)
+{
+    int rc;
+    check(data_file != NULL, "Data file required");
+
+    if(data_file->extent_fd == 0) {
+        rc = sky_data_file_open_extents(data_file);
+        check(rc == 0, "Unable to open extent file");
+    }
+
+    rc = ftruncate(data_file->extent_fd, length);
+    check(rc == 0, "Unable to grow extent file");
+    rc = sky_data_file_map_reservation(data_file, data_file->extent_fd, &data_file->extent_data, &data_file->extent_capacity, length);
+    check(rc == 0, "Unable to map extent file");
+    data_file->extent_data_length = length;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Finds the extent that stores the path for a given object id.
+//
+// data_file - The data file.
+// object_id - The object id to search for.
+// ret       - A pointer to where the extent is returned. This is null if the
+//             object's path is not stored in an extent.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_find_extent(sky_data_file *data_file,
+                              sky_object_id_t object_id, sky_extent **ret)
+{
+    check(data_file != NULL, "Data file required");
+    check(ret != NULL, "Return pointer required");
+
+    *ret = NULL;
+
+    uint32_t min = 0, max = data_file->extent_count;
+    while(min < max) {
+        uint32_t mid = min + ((max - min) / 2);
+        sky_extent *extent = data_file->extents[mid];
+        if(extent->object_id == object_id) {
+            *ret = extent;
+            break;
+        }
+        else if(extent->object_id < object_id) {
+            min = mid + 1;
+        }
+        else {
+            max = mid;
+        }
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Appends a new extent with an empty path to the end of the extent file and
+// adds it to the extent list.
+//
+// data_file - The data file.
+// object_id - The object id of the path stored in the extent.
+// capacity  - The number of bytes reserved for the path.
+// ret       - A pointer to where the new extent is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_create_extent(sky_data_file *data_file,
+                                sky_object_id_t object_id, size_t capacity,
+                                sky_extent **ret)
+{
+    int rc;
+    sky_extent *extent = NULL;
+    check(data_file != NULL, "Data file required");
+    check(data_file->extent_path != NULL, "Extent file path required");
+    check(object_id != 0, "Object id required");
+    check(capacity >= SKY_PATH_HEADER_LENGTH, "Extent capacity too small");
+
+    // Find the position in the sorted extent list.
+    uint32_t index = 0, max = data_file->extent_count;
+    while(index < max) {
+        uint32_t mid = index + ((max - index) / 2);
+        if(data_file->extents[mid]->object_id < object_id) {
+            index = mid + 1;
+        }
+        else {
+            max = mid;
+        }
+    }
+    check(index == data_file->extent_count || data_file->extents[index]->object_id != object_id, "Extent already exists for object: %lld", (long long)object_id);
+
+    // Reserve space at the end of the file.
+    size_t offset = data_file->extent_data_length;
+    rc = sky_data_file_grow_extents(data_file, offset + SKY_EXTENT_HEADER_SIZE + capacity);
+    check(rc == 0, "Unable to grow extent file");
+
+    extent = sky_extent_create(data_file); check_mem(extent);
+    extent->object_id = object_id;
+    extent->version = data_file->epoch;
+    extent->offset = offset;
+    extent->capacity = capacity;
+
+    // Write an empty path.
+    void *path_ptr;
+    rc = sky_extent_get_ptr(extent, &path_ptr);
+    check(rc == 0, "Unable to retrieve extent pointer");
+    *((sky_object_id_t*)path_ptr) = object_id;
+    *((sky_path_event_data_length_t*)(path_ptr+sizeof(sky_object_id_t))) = 0;
+    rc = sky_extent_save(extent);
+    check(rc == 0, "Unable to save extent");
+
+    // Insert into the extent list.
+    data_file->extents = realloc(data_file->extents, sizeof(*data_file->extents) * (data_file->extent_count+1));
+    check_mem(data_file->extents);
+    memmove(&data_file->extents[index+1], &data_file->extents[index], sizeof(*data_file->extents) * (data_file->extent_count-index));
+    data_file->extents[index] = extent;
+    data_file->extent_count++;
+
+    *ret = extent;
+    return 0;
+
+error:
+    sky_extent_free(extent);
+    *ret = NULL;
+    return -1;
+}
+
+// Moves an extent to the end of the extent file with a new capacity. The old
+// record is freed once the path has been copied.
+//
+// data_file - The data file.
+// extent    - The extent to resize.
+// capacity  - The new number of bytes reserved for the path.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_resize_extent(sky_data_file *data_file, sky_extent *extent,
+                                size_t capacity)
+{
+    int rc;
+    check(data_file != NULL, "Data file required");
+    check(extent != NULL, "Extent required");
+
+    // Save the old record so it can be freed.
+    sky_extent old = *extent;
+
+    // Reserve space at the end of the file.
+    size_t offset = data_file->extent_data_length;
+    rc = sky_data_file_grow_extents(data_file, offset + SKY_EXTENT_HEADER_SIZE + capacity);
+    check(rc == 0, "Unable to grow extent file");
+
+    // Copy the path.
+    void *ptr;
+    rc = sky_extent_get_ptr(&old, &ptr);
+    check(rc == 0, "Unable to retrieve extent pointer");
+    size_t path_length = sky_path_sizeof_raw(ptr);
+    check(path_length <= capacity, "Extent capacity too small for path");
+    memcpy(data_file->extent_data + offset + SKY_EXTENT_HEADER_SIZE, ptr, path_length);
+
+    extent->offset = offset;
+    extent->capacity = capacity;
+    rc = sky_extent_save(extent);
+    check(rc == 0, "Unable to save extent");
+
+    // Free the old record.
+    old.object_id = 0;
+    rc = sky_extent_save(&old);
+    check(rc == 0, "Unable to free old extent");
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Moves an object's path out of a block and into a new extent if adding an
+// event to it would grow it past the large path threshold. Paths in spanned
+// blocks are left in place.
+//
+// data_file - The data file.
+// block     - The block the event would be inserted into.
+// event     - The event being added.
+// ret       - A pointer to where the new extent is returned. This is null if
+//             the path was not moved.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_move_large_path(sky_data_file *data_file, sky_block *block,
+                                  sky_event *event, sky_extent **ret)
+{
+    int rc;
+    size_t sz;
+    sky_block_path_stat *paths = NULL;
+    uint32_t path_count = 0;
+    check(data_file != NULL, "Data file required");
+    check(block != NULL, "Block required");
+    check(event != NULL, "Event required");
+
+    *ret = NULL;
+    if(data_file->large_path_threshold == 0 || data_file->extent_path == NULL || block->spanned) {
+        return 0;
+    }
+
+    // Find the object's path in the block.
+    rc = sky_block_get_path_stats(block, NULL, &paths, &path_count);
+    check(rc == 0, "Unable to calculate path stats");
+    sky_block_path_stat *stat = NULL;
+    uint32_t i;
+    for(i=0; i<path_count; i++) {
+        if(paths[i].object_id == event->object_id) {
+            stat = &paths[i];
+            break;
+        }
+    }
+
+    // Only move the path if it would grow past the threshold.
+    size_t event_length = sky_event_sizeof(event);
+    if(stat != NULL && stat->sz + event_length > data_file->large_path_threshold) {
+        size_t path_length = stat->sz;
+        size_t block_data_length = paths[path_count-1].end_pos;
+
+        // Leave room for the path to double before the extent has to move.
+        sky_extent *extent;
+        size_t capacity = (path_length + event_length) * 2;
+        rc = sky_data_file_create_extent(data_file, event->object_id, capacity, &extent);
+        check(rc == 0, "Unable to create extent");
+
+        // Copy the path into the extent and find its timestamp range.
+        void *block_ptr, *path_ptr;
+        rc = sky_block_get_ptr(block, &block_ptr);
+        check(rc == 0, "Unable to retrieve block pointer");
+        rc = sky_extent_get_ptr(extent, &path_ptr);
+        check(rc == 0, "Unable to retrieve extent pointer");
+        memcpy(path_ptr, block_ptr + stat->start_pos, path_length);
+
+        void *ptr = path_ptr + SKY_PATH_HEADER_LENGTH;
+        void *endptr = path_ptr + path_length;
+        bool initialized = false;
+        while(ptr < endptr) {
+            sky_timestamp_t timestamp;
+            sky_action_id_t action_id;
+            sky_event_data_length_t data_length;
+            rc = sky_event_unpack_hdr(&timestamp, &action_id, &data_length, ptr, &sz);
+            check(rc == 0, "Unable to unpack event header");
+            if(!initialized || timestamp < extent->min_timestamp) extent->min_timestamp = timestamp;
+            if(!initialized || timestamp > extent->max_timestamp) extent->max_timestamp = timestamp;
+            initialized = true;
+            ptr += sky_event_sizeof_raw(ptr);
+        }
+        rc = sky_extent_save(extent);
+        check(rc == 0, "Unable to save extent");
+
+        // Remove the path from the block.
+        memmove(block_ptr + stat->start_pos, block_ptr + stat->end_pos, block_data_length - stat->end_pos);
+        memset(block_ptr + block_data_length - path_length, 0, path_length);
+        if(data_file->autosync) {
+            rc = sky_block_save(block);
+            check(rc == 0, "Unable to save block");
+        }
+        rc = sky_block_full_update(block);
+        check(rc == 0, "Unable to update block ranges");
+
+        *ret = extent;
+    }
+
+    free(paths);
+    return 0;
+
+error:
+    free(paths);
+    *ret = NULL;
+    return -1;
+}
+
+
+//--------------------------------------
+// Snapshots
+//--------------------------------------
+
+// Preserves the current contents of a block for each open snapshot before
+// the block is changed. A block only needs to be preserved the first time it
+// changes after a snapshot is opened.
+//
+// data_file - The data file.
+// block     - The block that is about to change.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_preserve_block(sky_data_file *data_file, sky_block *block)
+{
+    int rc;
+    check(data_file != NULL, "Data file required");
+    check(block != NULL, "Block required");
+
+    if(block->version != data_file->epoch) {
+        sky_snapshot *snapshot;
+        for(snapshot=data_file->snapshots; snapshot!=NULL; snapshot=snapshot->next) {
+            rc = sky_snapshot_preserve_block(snapshot, block);
+            check(rc == 0, "Unable to preserve block for snapshot");
+        }
+        block->version = data_file->epoch;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Preserves the current path of an extent for each open snapshot before the
+// extent is changed.
+//
+// data_file - The data file.
+// extent    - The extent that is about to change.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_preserve_extent(sky_data_file *data_file,
+                                  sky_extent *extent)
+{
+    int rc;
+    check(data_file != NULL, "Data file required");
+    check(extent != NULL, "Extent required");
+
+    if(extent->version != data_file->epoch) {
+        sky_snapshot *snapshot;
+        for(snapshot=data_file->snapshots; snapshot!=NULL; snapshot=snapshot->next) {
+            rc = sky_snapshot_preserve_extent(snapshot, extent);
+            check(rc == 0, "Unable to preserve extent for snapshot");
+        }
+        extent->version = data_file->epoch;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
 
 //--------------------------------------
 // Event Management
@@ -631,18 +1677,66 @@ int sky_data_file_add_event(sky_data_file *data_file, sky_event *event)
     int rc;
     check(data_file != NULL, "Data file required");
     check(event != NULL, "Event required");
-    
-    // Find insertion block.
-    sky_block *block;
-    rc = sky_data_file_find_insertion_block(data_file, event, &block);
-    check(rc == 0, "Unable to find insertion block");
-    
-    // Add the event to the block.
-    rc = sky_block_add_event(block, event);
-    check(rc == 0, "Unable to add event to block");
 
-    // Re-sort blocks.
-    qsort(data_file->blocks, data_file->block_count, sizeof(sky_block*), compare_blocks);
+    // Use the object's extent if its path has been moved out of the blocks.
+    sky_extent *extent;
+    rc = sky_data_file_find_extent(data_file, event->object_id, &extent);
+    check(rc == 0, "Unable to find extent");
+
+    if(extent == NULL) {
+        // Find insertion block.
+        sky_block *block;
+        rc = sky_data_file_find_insertion_block(data_file, event, &block);
+        check(rc == 0, "Unable to find insertion block");
+
+        // Keep the current version of the block for any open snapshots.
+        rc = sky_data_file_preserve_block(data_file, block);
+        check(rc == 0, "Unable to preserve block");
+        
+        // Save the block's sort key so it can be found again if it changes.
+        sky_block key = *block;
+        uint32_t block_count = data_file->block_count;
+
+        // Compact blocks are converted back to rows before they change. If
+        // expanding the block moved paths into new blocks then the insertion
+        // block is found again.
+        rc = sky_block_expand(block);
+        check(rc == 0, "Unable to expand block");
+        if(data_file->block_count != block_count) {
+            rc = sky_data_file_restore_block_order(data_file, block, &key, block_count);
+            check(rc == 0, "Unable to restore block order");
+            rc = sky_data_file_add_event(data_file, event);
+            check(rc == 0, "Unable to add event to data file");
+            return 0;
+        }
+
+        // Move the path to an extent if it has grown too large. Otherwise add
+        // the event to the block.
+        rc = sky_data_file_move_large_path(data_file, block, event, &extent);
+        check(rc == 0, "Unable to move large path");
+        if(extent == NULL) {
+            rc = sky_block_add_event(block, event);
+            check(rc == 0, "Unable to add event to block");
+        }
+
+        // Keep the block list sorted.
+        rc = sky_data_file_restore_block_order(data_file, block, &key, block_count);
+        check(rc == 0, "Unable to restore block order");
+    }
+
+    // Add the event to the extent.
+    if(extent != NULL) {
+        rc = sky_data_file_preserve_extent(data_file, extent);
+        check(rc == 0, "Unable to preserve extent");
+        rc = sky_extent_add_event(extent, event);
+        check(rc == 0, "Unable to add event to extent");
+    }
+
+    // Flush header changes unless the data file is synced lazily.
+    if(data_file->autosync) {
+        rc = sky_data_file_flush_header(data_file);
+        check(rc == 0, "Unable to flush header");
+    }
     
     return 0;
 
@@ -650,11 +1744,335 @@ error:
     return -1;
 }
 
+// Adds a batch of events to the data file. The events are sorted by object id
+// and timestamp and grouped by their insertion block so that each block is
+// rewritten once and its header is updated once. If a group does not fit in
+// its block then its events are added one at a time so the block can split.
+//
+// data_file - The data file to add the events to.
+// events    - An array of events to add.
+// count     - The number of events.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_add_events(sky_data_file *data_file, sky_event **events,
+                             uint32_t count)
+{
+    int rc;
+    sky_event_ref *refs = NULL;
+    sky_event **group = NULL;
+    check(data_file != NULL, "Data file required");
+    check(events != NULL || count == 0, "Events required");
+
+    if(count == 0) {
+        return 0;
+    }
+
+    // Sort the batch by object id and timestamp. Events with the same
+    // timestamp are kept in reverse order since each one is inserted before
+    // the last when added individually.
+    refs = calloc(count, sizeof(*refs)); check_mem(refs);
+    group = calloc(count, sizeof(*group)); check_mem(group);
+    uint32_t i;
+    for(i=0; i<count; i++) {
+        check(events[i] != NULL, "Event required");
+        check(events[i]->object_id != 0, "Event object id required");
+        refs[i].event = events[i];
+        refs[i].index = i;
+    }
+    qsort(refs, count, sizeof(*refs), compare_event_refs);
+
+    // Apply events one insertion block at a time.
+    i = 0;
+    while(i < count) {
+        // Events for paths stored in extents are appended individually.
+        sky_extent *extent = NULL;
+        if(data_file->extent_count > 0) {
+            rc = sky_data_file_find_extent(data_file, refs[i].event->object_id, &extent);
+            check(rc == 0, "Unable to find extent");
+        }
+        if(extent != NULL) {
+            rc = sky_data_file_add_event(data_file, refs[i++].event);
+            check(rc == 0, "Unable to add event to data file");
+            continue;
+        }
+
+        sky_block *block;
+        rc = sky_data_file_find_insertion_block(data_file, refs[i].event, &block);
+        check(rc == 0, "Unable to find insertion block");
+
+        // Gather the following events that would go into the same block. A
+        // multi-object block takes every event up to its max object id, or
+        // every remaining event if it is the last block. Spanned blocks are
+        // split by timestamp so their events are added individually.
+        bool is_last = (block == data_file->blocks[data_file->block_count-1]);
+        uint32_t group_count = 0;
+        group[group_count++] = refs[i++].event;
+        while(!block->spanned && i < count && (is_last || refs[i].event->object_id <= block->max_object_id)) {
+            if(data_file->extent_count > 0) {
+                rc = sky_data_file_find_extent(data_file, refs[i].event->object_id, &extent);
+                check(rc == 0, "Unable to find extent");
+                if(extent != NULL) break;
+            }
+            group[group_count++] = refs[i++].event;
+        }
+
+        // Merge the group into the block in one pass.
+        sky_block key = *block;
+        uint32_t block_count = data_file->block_count;
+        bool added = false;
+        if(group_count > 1) {
+            rc = sky_data_file_preserve_block(data_file, block);
+            check(rc == 0, "Unable to preserve block");
+            rc = sky_block_add_events(block, group, group_count, &added);
+            check(rc == 0, "Unable to add events to block");
+        }
+
+        // Fall back to individual inserts if the group didn't fit.
+        if(added) {
+            rc = sky_data_file_restore_block_order(data_file, block, &key, block_count);
+            check(rc == 0, "Unable to restore block order");
+        }
+        else {
+            uint32_t j;
+            for(j=0; j<group_count; j++) {
+                rc = sky_data_file_add_event(data_file, group[j]);
+                check(rc == 0, "Unable to add event to data file");
+            }
+        }
+    }
+
+    // Flush header changes unless the data file is synced lazily.
+    if(data_file->autosync) {
+        rc = sky_data_file_flush_header(data_file);
+        check(rc == 0, "Unable to flush header");
+    }
+
+    free(refs);
+    free(group);
+    return 0;
+
+error:
+    free(refs);
+    free(group);
+    return -1;
+}
+
+
+// Checks whether an identical event already exists in the data file. Every
+// block whose object id range includes the event's object is searched. This
+// is a read-only lookup for tests and never creates a block.
+//
+// data_file - The data file to search.
+// event     - The event to search for.
+// ret       - A pointer to where the result flag is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_contains_event(sky_data_file *data_file, sky_event *event,
+                                 bool *ret)
+{
+    int rc;
+    check(data_file != NULL, "Data file required");
+    check(event != NULL, "Event required");
+    check(ret != NULL, "Return pointer required");
+
+    *ret = false;
+
+    // Search the object's extent if it has one.
+    sky_extent *extent;
+    rc = sky_data_file_find_extent(data_file, event->object_id, &extent);
+    check(rc == 0, "Unable to find extent");
+    if(extent != NULL) {
+        rc = sky_extent_contains_event(extent, event, ret);
+        check(rc == 0, "Unable to search extent for event");
+        return 0;
+    }
+
+    // Search each block that the object's path could be stored in.
+    uint32_t i;
+    rc = sky_data_file_search_blocks(data_file, event->object_id, &i);
+    check(rc == 0, "Unable to search blocks");
+    for(; i<data_file->block_count && !*ret; i++) {
+        sky_block *block = data_file->blocks[i];
+        if(event->object_id < block->min_object_id) {
+            break;
+        }
+        rc = sky_block_contains_event(block, event, ret);
+        check(rc == 0, "Unable to search block for event");
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
 
 //--------------------------------------
 // Block Sorting
 //--------------------------------------
 
+// Performs a binary search for the first block in the sorted block list
+// whose maximum object id is greater than or equal to a given object id.
+// Since block object id ranges do not overlap, the maximum object ids are
+// in nondecreasing order.
+//
+// data_file - The data file.
+// object_id - The object id to search for.
+// index     - A pointer to where the block index should be returned. This is
+//             the block count if no block is found.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_search_blocks(sky_data_file *data_file,
+                                sky_object_id_t object_id, uint32_t *index)
+{
+    check(data_file != NULL, "Data file required");
+    check(index != NULL, "Index return pointer required");
+
+    uint32_t min = 0;
+    uint32_t max = data_file->block_count;
+    while(min < max) {
+        uint32_t mid = min + ((max - min) / 2);
+        if(data_file->blocks[mid]->max_object_id < object_id) {
+            min = mid + 1;
+        }
+        else {
+            max = mid;
+        }
+    }
+    *index = min;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Finds the current position of a block in the sorted block list. The
+// block's ranges may have changed since it was sorted so a copy of the block
+// from before the change is used for comparison.
+//
+// data_file - The data file.
+// key       - A copy of the block from when it was last sorted.
+// block     - The block to find.
+// count     - The number of blocks at the start of the list to search.
+// index     - A pointer to where the block's position should be returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_find_block_index(sky_data_file *data_file, sky_block *key,
+                                   sky_block *block, uint32_t count,
+                                   uint32_t *index)
+{
+    check(data_file != NULL, "Data file required");
+    check(key != NULL, "Key required");
+    check(index != NULL, "Index return pointer required");
+
+    // Binary search using the saved key in place of the changed block.
+    uint32_t min = 0;
+    uint32_t max = count;
+    while(min < max) {
+        uint32_t mid = min + ((max - min) / 2);
+        sky_block *item = (data_file->blocks[mid] == block ? key : data_file->blocks[mid]);
+        if(compare_blocks(&item, &key) < 0) {
+            min = mid + 1;
+        }
+        else {
+            max = mid;
+        }
+    }
+    check(min < count && data_file->blocks[min] == block, "Block not found in sorted block list");
+    *index = min;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Moves a single block to its sorted position within the first blocks of
+// the block list. All other blocks in that range must already be sorted.
+//
+// data_file - The data file.
+// index     - The current position of the out-of-order block.
+// count     - The number of blocks at the start of the list to sort within.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_reposition_block(sky_data_file *data_file, uint32_t index,
+                                   uint32_t count)
+{
+    check(data_file != NULL, "Data file required");
+    check(count <= data_file->block_count, "Block count out of range");
+    check(index < count, "Block index out of range");
+
+    sky_block **blocks = data_file->blocks;
+    sky_block *block = blocks[index];
+
+    // Remove the block from the list.
+    memmove(&blocks[index], &blocks[index+1], (count-index-1) * sizeof(*blocks));
+
+    // Search for the insertion point among the remaining blocks.
+    uint32_t min = 0;
+    uint32_t max = count-1;
+    while(min < max) {
+        uint32_t mid = min + ((max - min) / 2);
+        if(compare_blocks(&blocks[mid], &block) < 0) {
+            min = mid + 1;
+        }
+        else {
+            max = mid;
+        }
+    }
+
+    // Insert the block back into the list.
+    memmove(&blocks[min+1], &blocks[min], (count-min-1) * sizeof(*blocks));
+    blocks[min] = block;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Moves a block back into sorted order after events have been added to it.
+// Any blocks created by splitting the block are appended to the end of the
+// block list so they are moved into sorted order as well.
+//
+// data_file   - The data file.
+// block       - The block that events were added to.
+// key         - A copy of the block from before the events were added.
+// block_count - The number of blocks before the events were added.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_data_file_restore_block_order(sky_data_file *data_file,
+                                      sky_block *block, sky_block *key,
+                                      uint32_t block_count)
+{
+    int rc;
+    check(data_file != NULL, "Data file required");
+    check(block != NULL, "Block required");
+    check(key != NULL, "Key required");
+
+    // Move the insertion block if its sort key changed.
+    if(block->min_object_id != key->min_object_id || block->min_timestamp != key->min_timestamp) {
+        uint32_t index;
+        rc = sky_data_file_find_block_index(data_file, key, block, block_count, &index);
+        check(rc == 0, "Unable to find block index");
+        rc = sky_data_file_reposition_block(data_file, index, block_count);
+        check(rc == 0, "Unable to reposition block");
+    }
+
+    // Move any blocks created by a split from the end into sorted order.
+    uint32_t i;
+    for(i=block_count; i<data_file->block_count; i++) {
+        rc = sky_data_file_reposition_block(data_file, i, i+1);
+        check(rc == 0, "Unable to reposition new block");
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
 // Compares two blocks and sorts them based on starting min object identifier
 // and then by id.
 int compare_blocks(const void *_a, const void *_b)
@@ -692,3 +2110,40 @@ int compare_blocks(const void *_a, const void *_b)
     }
 }
 
+// Compares two event references by object id, then by timestamp and then by
+// reverse batch position.
+int compare_event_refs(const void *_a, const void *_b)
+{
+    sky_event_ref *a = (sky_event_ref *)_a;
+    sky_event_ref *b = (sky_event_ref *)_b;
+
+    if(a->event->object_id != b->event->object_id) {
+        return (a->event->object_id > b->event->object_id ? 1 : -1);
+    }
+    else if(a->event->timestamp != b->event->timestamp) {
+        return (a->event->timestamp > b->event->timestamp ? 1 : -1);
+    }
+    else if(a->index != b->index) {
+        return (a->index < b->index ? 1 : -1);
+    }
+    else {
+        return 0;
+    }
+}
+
+// Compares two extents by object id and then by position in the extent file.
+int compare_extents(const void *_a, const void *_b)
+{
+    sky_extent **a = (sky_extent **)_a;
+    sky_extent **b = (sky_extent **)_b;
+
+    if((*a)->object_id != (*b)->object_id) {
+        return ((*a)->object_id > (*b)->object_id ? 1 : -1);
+    }
+    else if((*a)->offset != (*b)->offset) {
+        return ((*a)->offset > (*b)->offset ? 1 : -1);
+    }
+    else {
+        return 0;
+    }
+}
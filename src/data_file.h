@@ -10,7 +10,9 @@ typedef struct sky_data_file sky_data_file;
 #include "file.h"
 #include "types.h"
 #include "block.h"
+#include "extent.h"
 #include "event.h"
+#include "snapshot.h"
 
 //==============================================================================
 //
@@ -20,8 +22,58 @@ typedef struct sky_data_file sky_data_file;
 
 // The header file stores information about how the table's data file is
 // structured. The beginning of the file lists the database format version
-// (4-bytes), block size (4-bytes) and block count (4-bytes). From there the
-// blocks are listed out in 
+// (4-bytes) and block size (4-bytes). From there the blocks are listed out in
+// order of block index.
+//
+// The header file is memory-mapped while the data file is loaded so block
+// range updates are simple stores into the mapping. The byte range that has
+// changed since the last flush is tracked so that only the dirty pages are
+// synced to disk on a flush.
+//
+// The data file is mapped once into a large reservation of address space so
+// that adding blocks never moves the mapping. The mapping is only moved if
+// the file outgrows the reservation and these remaps are counted.
+//
+// The data file and the header file grow in large preallocated chunks so
+// that adding a block doesn't resize either file. Both are trimmed to their
+// exact lengths when the data file is unloaded. Header slots past the last
+// block are filled with 0xFF bytes so that a header file left at its chunked
+// length, such as after a crash, still loads the right number of blocks.
+// Setting the chunk size to zero sizes both files exactly on every change.
+//
+// Paths that grow past the large path threshold are moved out of the blocks
+// and into extents in a separate extent file. Each object id is stored either
+// in the blocks or in an extent but never in both. The extent list is kept
+// in object id order.
+//
+// Version 2 data files store a path directory at the end of each block so
+// that a path can be found with a binary search instead of walking the
+// block. Version 1 data files are still read and written with the original
+// block layout. New data files use version 1 unless another version is set
+// before the data file is loaded.
+//
+// Version 3 data files also have path directories and compaction stores
+// their paths in the compact encoding. Events are still added to blocks
+// row-wise so a version 3 data file can mix compact and row-wise blocks. The
+// cursor reads both.
+//
+// Compaction can also compress blocks. A compressed block only takes up the
+// start of its slot in the data file and the rest of the slot is left as a
+// hole in the file so it takes up no disk space. Compressed blocks are read
+// through a small cache of decompressed blocks that is created the first time
+// one is read. Adding an event to a compressed block decompresses it back
+// into its slot.
+//
+// Snapshots of the data file can be opened so that a scan isn't affected by
+// events added during it. Blocks and extents are preserved for the open
+// snapshots with sky_data_file_preserve_block() and
+// sky_data_file_preserve_extent() before they are changed.
+//
+// Blocks are stored in the order they were created so a scan in object id
+// order doesn't read the data file sequentially. Path iterators ask the OS
+// to read ahead the next few blocks that they will scan instead of relying
+// on the kernel's readahead. The prefetch count sets how many blocks ahead
+// are requested.
 
 
 //==============================================================================
@@ -34,19 +86,71 @@ typedef struct sky_data_file sky_data_file;
 
 #define SKY_DATA_FILE_VERSION  1
 
-#define SKY_HEADER_FILE_HDR_SIZE sizeof(uint32_t) + sizeof(uint32_t)
+#define SKY_DATA_FILE_DIRECTORY_VERSION 2
+
+#define SKY_DATA_FILE_COMPACT_VERSION 3
+
+#define SKY_HEADER_FILE_HDR_SIZE (sizeof(uint32_t) + sizeof(uint32_t))
+
+#define SKY_DATA_FILE_DEFAULT_CHUNK_SIZE 0x1000000
+
+#define SKY_HEADER_FILE_CHUNK_SIZE 0x10000
+
+#define SKY_HEADER_FILE_UNUSED_SLOT_BYTE 0xFF
+
+#define SKY_DATA_FILE_DEFAULT_RESERVATION_SIZE 0x400000000ULL
+
+#define SKY_HEADER_FILE_DEFAULT_RESERVATION_SIZE 0x1000000
+
+#define SKY_DATA_FILE_DEFAULT_PREFETCH_COUNT 8
 
 struct sky_data_file {
     bstring path;
     bstring header_path;
+    uint32_t version;
     uint32_t block_size;
     sky_block **blocks;
     uint32_t block_count;
     int data_fd;
     void *data;
     size_t data_length;
+    size_t data_capacity;
+    size_t file_length;
+    size_t chunk_size;
+    size_t reservation_size;
+    int header_fd;
+    void *header;
+    size_t header_length;
+    size_t header_file_length;
+    size_t header_capacity;
+    size_t header_dirty_start;
+    size_t header_dirty_end;
+    bool autosync;
+    uint32_t remap_count;
+    sky_timestamp_t remap_time;
+    bstring extent_path;
+    int extent_fd;
+    void *extent_data;
+    size_t extent_data_length;
+    size_t extent_capacity;
+    sky_extent **extents;
+    uint32_t extent_count;
+    uint32_t large_path_threshold;
+    sky_block_cache *block_cache;
+    uint32_t block_cache_size;
+    uint32_t prefetch_count;
+    uint32_t epoch;
+    sky_snapshot *snapshots;
 };
 
+// This structure is used for sorting batches of events. It stores the
+// original position of the event in the batch so that events with the same
+// timestamp are inserted in a consistent order.
+typedef struct sky_event_ref {
+    sky_event *event;
+    uint32_t index;
+} sky_event_ref;
+
 
 //==============================================================================
 //
@@ -71,6 +175,8 @@ int sky_data_file_set_path(sky_data_file *data_file, bstring path);
 
 int sky_data_file_set_header_path(sky_data_file *data_file, bstring path);
 
+int sky_data_file_set_extent_path(sky_data_file *data_file, bstring path);
+
 
 //--------------------------------------
 // Persistence
@@ -80,6 +186,18 @@ int sky_data_file_load(sky_data_file *data_file);
 
 int sky_data_file_unload(sky_data_file *data_file);
 
+int sky_data_file_sync(sky_data_file *data_file);
+
+
+//--------------------------------------
+// Header Management
+//--------------------------------------
+
+int sky_data_file_mark_header_dirty(sky_data_file *data_file, size_t offset,
+    size_t sz);
+
+int sky_data_file_flush_header(sky_data_file *data_file);
+
 
 //--------------------------------------
 // Block Management
@@ -93,6 +211,33 @@ int sky_data_file_find_insertion_block(sky_data_file *data_file,
 int sky_data_file_move_to_new_block(sky_data_file *data_file, void **ptr,
     size_t sz, sky_block **new_block);
 
+int sky_data_file_get_block_cache(sky_data_file *data_file,
+    sky_block_cache **ret);
+
+
+//--------------------------------------
+// Extent Management
+//--------------------------------------
+
+int sky_data_file_find_extent(sky_data_file *data_file,
+    sky_object_id_t object_id, sky_extent **ret);
+
+int sky_data_file_create_extent(sky_data_file *data_file,
+    sky_object_id_t object_id, size_t capacity, sky_extent **ret);
+
+int sky_data_file_resize_extent(sky_data_file *data_file, sky_extent *extent,
+    size_t capacity);
+
+
+//--------------------------------------
+// Snapshots
+//--------------------------------------
+
+int sky_data_file_preserve_block(sky_data_file *data_file, sky_block *block);
+
+int sky_data_file_preserve_extent(sky_data_file *data_file,
+    sky_extent *extent);
+
 
 //--------------------------------------
 // Event Management
@@ -100,4 +245,10 @@ int sky_data_file_move_to_new_block(sky_data_file *data_file, void **ptr,
 
 int sky_data_file_add_event(sky_data_file *data_file, sky_event *event);
 
+int sky_data_file_add_events(sky_data_file *data_file, sky_event **events,
+    uint32_t count);
+
+int sky_data_file_contains_event(sky_data_file *data_file, sky_event *event,
+    bool *ret);
+
 #endif
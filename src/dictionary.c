@@ -0,0 +1,406 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dbg.h"
+#include "file.h"
+#include "minipack.h"
+#include "dictionary.h"
+
+
+//==============================================================================
+//
+// Forward Declarations
+//
+//==============================================================================
+
+uint32_t sky_dictionary_hash(void *data, uint32_t length);
+
+int sky_dictionary_resize(sky_dictionary *dictionary, uint32_t bucket_count);
+
+int sky_dictionary_append(sky_dictionary *dictionary, bstring value);
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+// Creates a dictionary.
+//
+// Returns a reference to a new dictionary if successful. Otherwise returns
+// null.
+sky_dictionary *sky_dictionary_create()
+{
+    sky_dictionary *dictionary = calloc(1, sizeof(sky_dictionary));
+    check_mem(dictionary);
+    return dictionary;
+
+error:
+    sky_dictionary_free(dictionary);
+    return NULL;
+}
+
+// Removes a dictionary from memory.
+//
+// dictionary - The dictionary to free.
+void sky_dictionary_free(sky_dictionary *dictionary)
+{
+    if(dictionary) {
+        sky_dictionary_unload(dictionary);
+        if(dictionary->path) bdestroy(dictionary->path);
+        dictionary->path = NULL;
+        free(dictionary);
+    }
+}
+
+
+//--------------------------------------
+// Path
+//--------------------------------------
+
+// Sets the file path of a dictionary. A dictionary without a path is only
+// kept in memory.
+//
+// dictionary - The dictionary.
+// path       - The file path to set.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_dictionary_set_path(sky_dictionary *dictionary, bstring path)
+{
+    check(dictionary != NULL, "Dictionary required");
+
+    if(dictionary->path) bdestroy(dictionary->path);
+    dictionary->path = bstrcpy(path);
+    if(path) check_mem(dictionary->path);
+
+    return 0;
+
+error:
+    dictionary->path = NULL;
+    return -1;
+}
+
+
+//--------------------------------------
+// Persistence
+//--------------------------------------
+
+// Loads the strings in the dictionary file. A missing file is an empty
+// dictionary. A partially written string at the end of the file is left over
+// from a crash before the dictionary was synced and is removed.
+//
+// dictionary - The dictionary.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_dictionary_load(sky_dictionary *dictionary)
+{
+    int rc;
+    int c;
+    FILE *file = NULL;
+    bstring value = NULL;
+    check(dictionary != NULL, "Dictionary required");
+    check(dictionary->path != NULL, "Dictionary path required");
+
+    rc = sky_dictionary_unload(dictionary);
+    check(rc == 0, "Unable to unload dictionary");
+
+    if(sky_file_exists(dictionary->path)) {
+        file = fopen(bdata(dictionary->path), "r");
+        check(file, "Failed to open dictionary file: %s", bdata(dictionary->path));
+
+        long offset = 0;
+        while((c = fgetc(file)) != EOF) {
+            ungetc(c, file);
+            rc = sky_minipack_fread_bstring(file, &value);
+            if(rc != 0) {
+                log_warn("Discarding incomplete dictionary string at offset %ld: %s", offset, bdata(dictionary->path));
+                rc = truncate(bdata(dictionary->path), offset);
+                check(rc == 0, "Unable to truncate dictionary file: %s", bdata(dictionary->path));
+                break;
+            }
+            rc = sky_dictionary_append(dictionary, value);
+            check(rc == 0, "Unable to append dictionary string");
+            value = NULL;
+            offset = ftell(file);
+        }
+
+        fclose(file);
+    }
+
+    return 0;
+
+error:
+    bdestroy(value);
+    if(file) fclose(file);
+    return -1;
+}
+
+// Removes the strings in a dictionary from memory and closes the dictionary
+// file.
+//
+// dictionary - The dictionary.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_dictionary_unload(sky_dictionary *dictionary)
+{
+    if(dictionary) {
+        if(dictionary->file) {
+            sky_dictionary_sync(dictionary);
+            fclose(dictionary->file);
+            dictionary->file = NULL;
+        }
+
+        uint32_t i;
+        for(i=0; i<dictionary->count; i++) {
+            bdestroy(dictionary->strings[i]);
+        }
+        free(dictionary->strings);
+        dictionary->strings = NULL;
+        dictionary->count = 0;
+
+        free(dictionary->buckets);
+        dictionary->buckets = NULL;
+        dictionary->bucket_count = 0;
+    }
+
+    return 0;
+}
+
+// Writes any new strings to the dictionary file and syncs it to disk.
+//
+// dictionary - The dictionary.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_dictionary_sync(sky_dictionary *dictionary)
+{
+    int rc;
+    check(dictionary != NULL, "Dictionary required");
+
+    if(dictionary->dirty) {
+        rc = fflush(dictionary->file);
+        check(rc == 0, "Unable to flush dictionary file: %s", bdata(dictionary->path));
+        rc = fdatasync(fileno(dictionary->file));
+        check(rc == 0, "Unable to sync dictionary file: %s", bdata(dictionary->path));
+        dictionary->dirty = false;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+
+//--------------------------------------
+// Lookup
+//--------------------------------------
+
+// Finds the code for a string.
+//
+// dictionary - The dictionary.
+// data       - The string data.
+// length     - The length of the string, in bytes.
+// code       - A pointer to where the code should be returned. This is zero
+//              if the string is not in the dictionary.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_dictionary_find(sky_dictionary *dictionary, void *data,
+                        uint32_t length, uint32_t *code)
+{
+    check(dictionary != NULL, "Dictionary required");
+    check(data != NULL || length == 0, "String data required");
+    *code = 0;
+
+    if(dictionary->bucket_count == 0) {
+        return 0;
+    }
+
+    // Buckets hold codes and an empty bucket ends the probe.
+    uint32_t mask = dictionary->bucket_count - 1;
+    uint32_t index = sky_dictionary_hash(data, length) & mask;
+    while(dictionary->buckets[index] != 0) {
+        bstring str = dictionary->strings[dictionary->buckets[index]-1];
+        if((uint32_t)blength(str) == length && memcmp(bdata(str), data, length) == 0) {
+            *code = dictionary->buckets[index];
+            break;
+        }
+        index = (index + 1) & mask;
+    }
+
+    return 0;
+
+error:
+    *code = 0;
+    return -1;
+}
+
+// Retrieves the code for a string and adds the string to the dictionary if
+// it is not already there. New strings are appended to the dictionary file
+// but are not on disk until the dictionary is synced.
+//
+// dictionary - The dictionary.
+// value      - The string to add.
+// code       - A pointer to where the code should be returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_dictionary_add(sky_dictionary *dictionary, bstring value,
+                       uint32_t *code)
+{
+    int rc;
+    bstring str = NULL;
+    check(dictionary != NULL, "Dictionary required");
+    check(value != NULL, "String required");
+
+    rc = sky_dictionary_find(dictionary, bdata(value), blength(value), code);
+    check(rc == 0, "Unable to find dictionary string");
+    if(*code != 0) {
+        return 0;
+    }
+
+    if(dictionary->path != NULL) {
+        if(dictionary->file == NULL) {
+            dictionary->file = fopen(bdata(dictionary->path), "a");
+            check(dictionary->file, "Failed to open dictionary file: %s", bdata(dictionary->path));
+        }
+        rc = sky_minipack_fwrite_bstring(dictionary->file, value);
+        check(rc == 0, "Unable to write dictionary string");
+        dictionary->dirty = true;
+    }
+
+    str = bstrcpy(value); check_mem(str);
+    rc = sky_dictionary_append(dictionary, str);
+    check(rc == 0, "Unable to append dictionary string");
+    *code = dictionary->count;
+
+    return 0;
+
+error:
+    *code = 0;
+    return -1;
+}
+
+// Retrieves the string for a code. The returned string is owned by the
+// dictionary and stays valid until the dictionary is unloaded.
+//
+// dictionary - The dictionary.
+// code       - The code.
+// ret        - A pointer to where the string should be returned. This is
+//              null if there is no string for the code.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_dictionary_get(sky_dictionary *dictionary, uint32_t code,
+                       bstring *ret)
+{
+    check(dictionary != NULL, "Dictionary required");
+
+    if(code > 0 && code <= dictionary->count) {
+        *ret = dictionary->strings[code-1];
+    }
+    else {
+        *ret = NULL;
+    }
+
+    return 0;
+
+error:
+    *ret = NULL;
+    return -1;
+}
+
+
+//--------------------------------------
+// Hashing
+//--------------------------------------
+
+// Calculates the FNV-1a hash of a string.
+//
+// data   - The string data.
+// length - The length of the string, in bytes.
+//
+// Returns the hash.
+uint32_t sky_dictionary_hash(void *data, uint32_t length)
+{
+    uint32_t i;
+    uint32_t hash = 2166136261U;
+    for(i=0; i<length; i++) {
+        hash ^= ((uint8_t*)data)[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+// Rebuilds the hash table with a new number of buckets.
+//
+// dictionary   - The dictionary.
+// bucket_count - The number of buckets. This must be a power of two.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_dictionary_resize(sky_dictionary *dictionary, uint32_t bucket_count)
+{
+    uint32_t *buckets = calloc(bucket_count, sizeof(*buckets));
+    check_mem(buckets);
+
+    uint32_t i;
+    uint32_t mask = bucket_count - 1;
+    for(i=0; i<dictionary->count; i++) {
+        bstring str = dictionary->strings[i];
+        uint32_t index = sky_dictionary_hash(bdata(str), blength(str)) & mask;
+        while(buckets[index] != 0) {
+            index = (index + 1) & mask;
+        }
+        buckets[index] = i + 1;
+    }
+
+    free(dictionary->buckets);
+    dictionary->buckets = buckets;
+    dictionary->bucket_count = bucket_count;
+    return 0;
+
+error:
+    return -1;
+}
+
+// Adds a string to the end of the dictionary. The dictionary takes ownership
+// of the string.
+//
+// dictionary - The dictionary.
+// value      - The string to append.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_dictionary_append(sky_dictionary *dictionary, bstring value)
+{
+    int rc;
+
+    dictionary->strings = realloc(dictionary->strings, sizeof(*dictionary->strings) * (dictionary->count+1));
+    check_mem(dictionary->strings);
+    dictionary->strings[dictionary->count++] = value;
+
+    // Keep the table at most half full so probes stay short.
+    if(dictionary->count * 2 > dictionary->bucket_count) {
+        uint32_t bucket_count = dictionary->bucket_count * 2;
+        if(bucket_count < SKY_DICTIONARY_MIN_BUCKET_COUNT) {
+            bucket_count = SKY_DICTIONARY_MIN_BUCKET_COUNT;
+        }
+        rc = sky_dictionary_resize(dictionary, bucket_count);
+        check(rc == 0, "Unable to resize dictionary");
+    }
+    else {
+        uint32_t mask = dictionary->bucket_count - 1;
+        uint32_t index = sky_dictionary_hash(bdata(value), blength(value)) & mask;
+        while(dictionary->buckets[index] != 0) {
+            index = (index + 1) & mask;
+        }
+        dictionary->buckets[index] = dictionary->count;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
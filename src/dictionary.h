@@ -0,0 +1,98 @@
+#ifndef _dictionary_h
+#define _dictionary_h
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+typedef struct sky_dictionary sky_dictionary;
+
+#include "bstring.h"
+
+
+//==============================================================================
+//
+// Overview
+//
+//==============================================================================
+
+// A dictionary maps the values of a string property to small integer codes.
+// Events for a dictionary property store the code instead of the string so
+// that repeated values take a byte or two and can be compared as integers.
+//
+// Codes start at 1 so that a zeroed property never matches a value. Strings
+// are never removed so a code is stable for the life of the table. The file
+// is a series of minipack raw values in code order and new values are
+// appended to the end of the file as they are added. The file is kept open
+// while the dictionary is loaded and new strings are only synced when the
+// dictionary is synced, which the table does before logging the events that
+// use them. A string that was only partially written before a crash is
+// removed from the end of the file when it is loaded.
+
+
+//==============================================================================
+//
+// Typedefs
+//
+//==============================================================================
+
+#define SKY_DICTIONARY_MIN_BUCKET_COUNT 16
+
+struct sky_dictionary {
+    bstring path;
+    FILE *file;
+    bool dirty;
+    bstring *strings;
+    uint32_t count;
+    uint32_t *buckets;
+    uint32_t bucket_count;
+};
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+sky_dictionary *sky_dictionary_create();
+
+void sky_dictionary_free(sky_dictionary *dictionary);
+
+
+//--------------------------------------
+// Path
+//--------------------------------------
+
+int sky_dictionary_set_path(sky_dictionary *dictionary, bstring path);
+
+
+//--------------------------------------
+// Persistence
+//--------------------------------------
+
+int sky_dictionary_load(sky_dictionary *dictionary);
+
+int sky_dictionary_unload(sky_dictionary *dictionary);
+
+int sky_dictionary_sync(sky_dictionary *dictionary);
+
+
+//--------------------------------------
+// Lookup
+//--------------------------------------
+
+int sky_dictionary_find(sky_dictionary *dictionary, void *data,
+    uint32_t length, uint32_t *code);
+
+int sky_dictionary_add(sky_dictionary *dictionary, bstring value,
+    uint32_t *code);
+
+int sky_dictionary_get(sky_dictionary *dictionary, uint32_t code,
+    bstring *ret);
+
+#endif
@@ -34,6 +34,68 @@ sky_event_flag_t sky_event_get_flag(sky_action_id_t action_id, uint32_t data_len
     return flag;
 }
 
+// Calculates the number of bytes needed to store an unsigned variable length
+// integer. Each byte stores seven bits of the value and the high bit is set
+// on every byte except the last.
+//
+// value - The value.
+//
+// Returns the length of the variable length integer.
+size_t sky_event_sizeof_varint(uint64_t value)
+{
+    size_t sz = 1;
+    while(value >= 0x80) {
+        value >>= 7;
+        sz++;
+    }
+    return sz;
+}
+
+// Writes an unsigned variable length integer.
+//
+// ptr   - A pointer to where the integer is written.
+// value - The value to write.
+// sz    - The number of bytes written.
+void sky_event_pack_varint(void *ptr, uint64_t value, size_t *sz)
+{
+    uint8_t *bytes = (uint8_t*)ptr;
+    size_t i = 0;
+    while(value >= 0x80) {
+        bytes[i++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    bytes[i++] = (uint8_t)value;
+    *sz = i;
+}
+
+// Reads an unsigned variable length integer.
+//
+// ptr - A pointer to the integer.
+// sz  - The number of bytes read.
+//
+// Returns the value of the integer.
+uint64_t sky_event_unpack_varint(void *ptr, size_t *sz)
+{
+    uint64_t value;
+    void *start = ptr;
+    SKY_EVENT_READ_VARINT(ptr, value);
+    *sz = ptr - start;
+    return value;
+}
+
+// Maps a signed timestamp delta to an unsigned value so that small negative
+// deltas are also stored in a few bytes.
+uint64_t sky_event_zigzag_encode(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+// Maps an unsigned value back to a signed timestamp delta.
+int64_t sky_event_zigzag_decode(uint64_t value)
+{
+    return SKY_EVENT_ZIGZAG_DECODE(value);
+}
+
 
 //--------------------------------------
 // Data Allocation
@@ -483,6 +545,176 @@ error:
 
 
 
+//--------------------------------------
+// Compact Encoding
+//--------------------------------------
+
+// Calculates the number of bytes needed to store a raw event in the compact
+// encoding. The timestamp is stored as the difference from the previous
+// event in the path.
+//
+// ptr                - A pointer to the raw event data.
+// previous_timestamp - The timestamp of the previous event in the path or
+//                      zero if this is the first event.
+//
+// Returns the length of the compact event.
+size_t sky_event_sizeof_compact(void *ptr, sky_timestamp_t previous_timestamp)
+{
+    sky_timestamp_t timestamp;
+    sky_action_id_t action_id;
+    sky_event_data_length_t data_length;
+    if(sky_event_unpack_hdr(&timestamp, &action_id, &data_length, ptr, NULL) != 0) {
+        return 0;
+    }
+
+    size_t length = sizeof(sky_event_flag_t);
+    length += sky_event_sizeof_varint(sky_event_zigzag_encode(timestamp - previous_timestamp));
+    if(action_id != 0) {
+        length += sky_event_sizeof_varint(action_id);
+    }
+    length += data_length;
+
+    return sky_event_sizeof_varint(length) + length;
+}
+
+// Calculates the total length of an event stored in the compact encoding.
+// This only reads the leading length of the event.
+//
+// ptr - A pointer to the compact event.
+//
+// Returns the length of the compact event.
+size_t sky_event_sizeof_compact_raw(void *ptr)
+{
+    size_t sz;
+    size_t length = (size_t)sky_event_unpack_varint(ptr, &sz);
+    return sz + length;
+}
+
+// Converts a raw event into the compact encoding. The compact event starts
+// with its length, not including the length itself, so that the event can be
+// skipped without decoding it. The timestamp is stored as the zigzag encoded
+// difference from the previous event. The length, timestamp delta and action
+// id are variable length integers. The data length is not stored since it is
+// the remainder of the event length.
+//
+//   EVENT = LENGTH FLAG TIMESTAMP_DELTA ACTION_ID? DATA?
+//
+// ptr                - A pointer to the raw event data.
+// previous_timestamp - The timestamp of the previous event in the path or
+//                      zero if this is the first event.
+// addr               - A pointer to where the compact event is written.
+// sz                 - The number of bytes written.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_event_pack_compact(void *ptr, sky_timestamp_t previous_timestamp,
+                           void *addr, size_t *sz)
+{
+    int rc;
+    size_t _sz, hdrsz;
+    void *start = addr;
+    check(ptr != NULL, "Pointer required");
+    check(addr != NULL, "Address required");
+
+    sky_timestamp_t timestamp;
+    sky_action_id_t action_id;
+    sky_event_data_length_t data_length;
+    rc = sky_event_unpack_hdr(&timestamp, &action_id, &data_length, ptr, &hdrsz);
+    check(rc == 0, "Unable to unpack event header");
+
+    // Write the length of the remainder of the event.
+    uint64_t delta = sky_event_zigzag_encode(timestamp - previous_timestamp);
+    size_t length = sizeof(sky_event_flag_t) + sky_event_sizeof_varint(delta) + data_length;
+    if(action_id != 0) {
+        length += sky_event_sizeof_varint(action_id);
+    }
+    sky_event_pack_varint(addr, length, &_sz);
+    addr += _sz;
+
+    // Write the flag and the timestamp delta.
+    *((sky_event_flag_t*)addr) = sky_event_get_flag(action_id, data_length);
+    addr += sizeof(sky_event_flag_t);
+    sky_event_pack_varint(addr, delta, &_sz);
+    addr += _sz;
+
+    // Write the action id.
+    if(action_id != 0) {
+        sky_event_pack_varint(addr, action_id, &_sz);
+        addr += _sz;
+    }
+
+    // Copy the data.
+    memcpy(addr, ptr + hdrsz, data_length);
+    addr += data_length;
+
+    if(sz != NULL) {
+        *sz = (addr-start);
+    }
+
+    return 0;
+
+error:
+    if(sz != NULL) *sz = 0;
+    return -1;
+}
+
+// Reads the header of an event stored in the compact encoding. The event
+// data starts directly after the header.
+//
+// ptr                - A pointer to the compact event.
+// previous_timestamp - The timestamp of the previous event in the path or
+//                      zero if this is the first event.
+// timestamp          - A pointer to where the timestamp is returned.
+// action_id          - A pointer to where the action id is returned.
+// data_length        - A pointer to where the data length is returned.
+// sz                 - The number of header bytes read.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_event_unpack_compact_hdr(void *ptr, sky_timestamp_t previous_timestamp,
+                                 sky_timestamp_t *timestamp,
+                                 sky_action_id_t *action_id,
+                                 sky_event_data_length_t *data_length,
+                                 size_t *sz)
+{
+    uint64_t length, delta, value = 0;
+    void *start = ptr;
+    check(ptr != NULL, "Pointer required");
+
+    // Read the length of the remainder of the event.
+    SKY_EVENT_READ_VARINT(ptr, length);
+    void *endptr = ptr + length;
+
+    // Read the flag and the timestamp delta.
+    sky_event_flag_t flag = *((sky_event_flag_t*)ptr);
+    ptr += sizeof(sky_event_flag_t);
+    SKY_EVENT_READ_VARINT(ptr, delta);
+    *timestamp = previous_timestamp + SKY_EVENT_ZIGZAG_DECODE(delta);
+
+    // Read the action id.
+    if(flag & SKY_EVENT_FLAG_ACTION) {
+        SKY_EVENT_READ_VARINT(ptr, value);
+    }
+    *action_id = (sky_action_id_t)value;
+
+    // The rest of the event is data.
+    check(ptr <= endptr, "Invalid compact event length");
+    *data_length = endptr - ptr;
+
+    if(sz != NULL) {
+        *sz = (ptr-start);
+    }
+
+    return 0;
+
+error:
+    *timestamp = 0;
+    *action_id = 0;
+    *data_length = 0;
+    if(sz != NULL) *sz = 0;
+    return -1;
+}
+
+
+
 //--------------------------------------
 // Event Data
 //--------------------------------------
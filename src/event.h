@@ -50,6 +50,24 @@
 
 #define SKY_EVENT_HEADER_LENGTH sizeof(sky_event_flag_t) + sizeof(sky_timestamp_t)
 
+// Reads an unsigned variable length integer into VALUE and moves PTR past it.
+// This is a macro so that compact events can be decoded by the cursor without
+// a function call per field.
+#define SKY_EVENT_READ_VARINT(PTR, VALUE) do { \
+    uint8_t *_bytes = (uint8_t*)(PTR); \
+    uint64_t _value = _bytes[0] & 0x7F; \
+    size_t _i = 0; \
+    while(_bytes[_i] & 0x80) { \
+        _i++; \
+        _value |= ((uint64_t)(_bytes[_i] & 0x7F)) << (7*_i); \
+    } \
+    (VALUE) = _value; \
+    (PTR) += _i + 1; \
+} while(0)
+
+// Maps a zigzag encoded value back to a signed timestamp delta.
+#define SKY_EVENT_ZIGZAG_DECODE(VALUE) ((int64_t)((VALUE) >> 1) ^ -((int64_t)((VALUE) & 1)))
+
 
 //==============================================================================
 //
@@ -106,6 +124,22 @@ int sky_event_unpack_hdr(sky_timestamp_t *timestamp, sky_action_id_t *action_id,
     sky_event_data_length_t *data_length, void *ptr, size_t *sz);
 
 
+//--------------------------------------
+// Compact Encoding
+//--------------------------------------
+
+size_t sky_event_sizeof_compact(void *ptr, sky_timestamp_t previous_timestamp);
+
+size_t sky_event_sizeof_compact_raw(void *ptr);
+
+int sky_event_pack_compact(void *ptr, sky_timestamp_t previous_timestamp,
+    void *addr, size_t *sz);
+
+int sky_event_unpack_compact_hdr(void *ptr, sky_timestamp_t previous_timestamp,
+    sky_timestamp_t *timestamp, sky_action_id_t *action_id,
+    sky_event_data_length_t *data_length, size_t *sz);
+
+
 //--------------------------------------
 // Data Management
 //--------------------------------------
@@ -0,0 +1,394 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "dbg.h"
+#include "bstring.h"
+#include "mem.h"
+#include "extent.h"
+#include "path.h"
+
+
+//==============================================================================
+//
+// Forward Declarations
+//
+//==============================================================================
+
+int sky_extent_sync_range(sky_extent *extent, void *ptr, size_t length);
+
+int sky_extent_find_insertion_ptr(void *path_ptr, sky_timestamp_t timestamp,
+    void **ret);
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+// Creates an extent object.
+//
+// data_file - The data file that owns the extent.
+//
+// Returns a reference to a new extent object if successful. Otherwise
+// returns null.
+sky_extent *sky_extent_create(sky_data_file *data_file)
+{
+    sky_extent *extent = calloc(sizeof(sky_extent), 1);
+    check_mem(extent);
+
+    extent->data_file = data_file;
+
+    return extent;
+
+error:
+    sky_extent_free(extent);
+    return NULL;
+}
+
+// Removes an extent object from memory.
+void sky_extent_free(sky_extent *extent)
+{
+    if(extent) {
+        memset(extent, 0, sizeof(*extent));
+        free(extent);
+    }
+}
+
+
+//--------------------------------------
+// Serialization
+//--------------------------------------
+
+// Packs an extent header into memory at a given pointer.
+//
+// extent - The extent object to pack.
+// ptr    - The pointer to the current location.
+// sz     - The number of bytes written.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_extent_pack(sky_extent *extent, void *ptr, size_t *sz)
+{
+    check(extent != NULL, "Extent required");
+    check(ptr != NULL, "Pointer required");
+
+    *((sky_object_id_t*)ptr) = extent->object_id;
+    ptr += sizeof(sky_object_id_t);
+    *((sky_timestamp_t*)ptr) = extent->min_timestamp;
+    ptr += sizeof(sky_timestamp_t);
+    *((sky_timestamp_t*)ptr) = extent->max_timestamp;
+    ptr += sizeof(sky_timestamp_t);
+    *((uint64_t*)ptr) = (uint64_t)extent->capacity;
+    ptr += sizeof(uint64_t);
+
+    if(sz != NULL) {
+        *sz = SKY_EXTENT_HEADER_SIZE;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Unpacks an extent header from memory at the current pointer.
+//
+// extent - The extent object to unpack into.
+// ptr    - The pointer to the current location.
+// sz     - The number of bytes read.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_extent_unpack(sky_extent *extent, void *ptr, size_t *sz)
+{
+    check(extent != NULL, "Extent required");
+    check(ptr != NULL, "Pointer required");
+
+    extent->object_id = *((sky_object_id_t*)ptr);
+    ptr += sizeof(sky_object_id_t);
+    extent->min_timestamp = *((sky_timestamp_t*)ptr);
+    ptr += sizeof(sky_timestamp_t);
+    extent->max_timestamp = *((sky_timestamp_t*)ptr);
+    ptr += sizeof(sky_timestamp_t);
+    extent->capacity = (size_t)*((uint64_t*)ptr);
+    ptr += sizeof(uint64_t);
+
+    if(sz != NULL) {
+        *sz = SKY_EXTENT_HEADER_SIZE;
+    }
+
+    return 0;
+
+error:
+    if(sz != NULL) *sz = 0;
+    return -1;
+}
+
+
+//--------------------------------------
+// Persistence
+//--------------------------------------
+
+// Writes the extent header into the extent file mapping and syncs the whole
+// extent to disk unless the data file is synced lazily.
+//
+// extent - The extent to save.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_extent_save(sky_extent *extent)
+{
+    int rc;
+    check(extent != NULL, "Extent required");
+    check(extent->data_file->extent_data != NULL, "Extent file must be mapped");
+
+    void *ptr = extent->data_file->extent_data + extent->offset;
+    rc = sky_extent_pack(extent, ptr, NULL);
+    check(rc == 0, "Unable to pack extent header");
+
+    rc = sky_extent_sync_range(extent, ptr, SKY_EXTENT_HEADER_SIZE + extent->capacity);
+    check(rc == 0, "Unable to sync extent");
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Syncs a range of the extent file to disk. Nothing is synced if the data
+// file is synced lazily.
+//
+// extent - The extent being changed.
+// ptr    - The start of the changed range.
+// length - The number of bytes changed.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_extent_sync_range(sky_extent *extent, void *ptr, size_t length)
+{
+    check(extent != NULL, "Extent required");
+
+    if(!extent->data_file->autosync || length == 0) {
+        return 0;
+    }
+
+    // Align the start of the range to the page size.
+    long page_size = sysconf(_SC_PAGE_SIZE);
+    size_t offset = (ptr - extent->data_file->extent_data) % page_size;
+    int rc = msync(ptr - offset, length + offset, MS_SYNC);
+    check(rc == 0, "Unable to sync extent to disk");
+
+    return 0;
+
+error:
+    return -1;
+}
+
+
+//--------------------------------------
+// Extent Position
+//--------------------------------------
+
+// Calculates the address of the path stored in the extent.
+//
+// extent - The extent.
+// ptr    - A pointer to where the path address will be set.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_extent_get_ptr(sky_extent *extent, void **ptr)
+{
+    check(extent != NULL, "Extent required");
+    check(extent->data_file != NULL, "Data file required");
+    check(extent->data_file->extent_data != NULL, "Extent file must be mapped");
+
+    *ptr = extent->data_file->extent_data + extent->offset + SKY_EXTENT_HEADER_SIZE;
+    return 0;
+
+error:
+    *ptr = NULL;
+    return -1;
+}
+
+
+//--------------------------------------
+// Event Management
+//--------------------------------------
+
+// Adds an event to the path stored in the extent. Events after the last event
+// in the path are appended without scanning the path. If the path has
+// outgrown the extent then the extent is moved to a larger area of the
+// extent file first.
+//
+// extent - The extent to add the event to.
+// event  - The event to add.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_extent_add_event(sky_extent *extent, sky_event *event)
+{
+    int rc;
+    size_t sz;
+    check(extent != NULL, "Extent required");
+    check(event != NULL, "Event required");
+    check(event->object_id == extent->object_id, "Event object id does not match extent");
+
+    void *path_ptr;
+    rc = sky_extent_get_ptr(extent, &path_ptr);
+    check(rc == 0, "Unable to retrieve extent pointer");
+
+    size_t path_length = sky_path_sizeof_raw(path_ptr);
+    size_t event_length = sky_event_sizeof(event);
+    bool is_empty = (path_length == SKY_PATH_HEADER_LENGTH);
+
+    // Double the capacity if the event doesn't fit.
+    if(path_length + event_length > extent->capacity) {
+        size_t capacity = (extent->capacity > 0 ? extent->capacity : SKY_PATH_HEADER_LENGTH);
+        while(capacity < path_length + event_length) {
+            capacity *= 2;
+        }
+        rc = sky_data_file_resize_extent(extent->data_file, extent, capacity);
+        check(rc == 0, "Unable to resize extent");
+        rc = sky_extent_get_ptr(extent, &path_ptr);
+        check(rc == 0, "Unable to retrieve extent pointer");
+    }
+
+    // Append the event if it is after every other event. Otherwise insert it
+    // before the first event with the same or a later timestamp.
+    void *endptr = path_ptr + path_length;
+    void *event_ptr = endptr;
+    if(!is_empty && event->timestamp <= extent->max_timestamp) {
+        rc = sky_extent_find_insertion_ptr(path_ptr, event->timestamp, &event_ptr);
+        check(rc == 0, "Unable to find insertion point");
+    }
+    memmove(event_ptr + event_length, event_ptr, endptr - event_ptr);
+
+    rc = sky_event_pack(event, event_ptr, &sz);
+    check(rc == 0, "Unable to pack event");
+    *(sky_path_event_data_length_t*)(path_ptr+sizeof(sky_object_id_t)) += event_length;
+
+    // Update timestamp ranges.
+    if(is_empty || event->timestamp < extent->min_timestamp) {
+        extent->min_timestamp = event->timestamp;
+    }
+    if(is_empty || event->timestamp > extent->max_timestamp) {
+        extent->max_timestamp = event->timestamp;
+    }
+
+    // Write the header and sync only the changed part of the path.
+    void *ptr = extent->data_file->extent_data + extent->offset;
+    rc = sky_extent_pack(extent, ptr, NULL);
+    check(rc == 0, "Unable to pack extent header");
+    rc = sky_extent_sync_range(extent, ptr, SKY_PATH_HEADER_LENGTH + SKY_EXTENT_HEADER_SIZE);
+    check(rc == 0, "Unable to sync extent header");
+    rc = sky_extent_sync_range(extent, event_ptr, (endptr + event_length) - event_ptr);
+    check(rc == 0, "Unable to sync extent path");
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Checks whether an identical event exists in the extent. An event matches if
+// it has the same timestamp and has the same serialized contents.
+//
+// extent - The extent to search.
+// event  - The event to search for.
+// ret    - A pointer to where the result flag is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_extent_contains_event(sky_extent *extent, sky_event *event, bool *ret)
+{
+    int rc;
+    size_t sz;
+    void *buffer = NULL;
+    check(extent != NULL, "Extent required");
+    check(event != NULL, "Event required");
+    check(ret != NULL, "Return pointer required");
+
+    *ret = false;
+
+    // Skip the scan if the timestamp is out of range.
+    if(event->timestamp < extent->min_timestamp || event->timestamp > extent->max_timestamp) {
+        return 0;
+    }
+
+    void *path_ptr, *event_ptr;
+    rc = sky_extent_get_ptr(extent, &path_ptr);
+    check(rc == 0, "Unable to retrieve extent pointer");
+    rc = sky_extent_find_insertion_ptr(path_ptr, event->timestamp, &event_ptr);
+    check(rc == 0, "Unable to find insertion point");
+
+    // Serialize the event for comparison.
+    size_t event_length = sky_event_sizeof(event);
+    buffer = malloc(event_length); check_mem(buffer);
+    rc = sky_event_pack(event, buffer, &sz);
+    check(rc == 0, "Unable to pack event");
+
+    // Compare against each event with the same timestamp.
+    void *endptr = path_ptr + sky_path_sizeof_raw(path_ptr);
+    while(event_ptr < endptr) {
+        sky_timestamp_t timestamp;
+        sky_action_id_t action_id;
+        sky_event_data_length_t data_length;
+        rc = sky_event_unpack_hdr(&timestamp, &action_id, &data_length, event_ptr, &sz);
+        check(rc == 0, "Unable to unpack event header");
+        if(timestamp != event->timestamp) {
+            break;
+        }
+
+        size_t raw_length = sky_event_sizeof_raw(event_ptr);
+        if(raw_length == event_length && memcmp(event_ptr, buffer, event_length) == 0) {
+            *ret = true;
+            break;
+        }
+        event_ptr += raw_length;
+    }
+
+    free(buffer);
+    return 0;
+
+error:
+    free(buffer);
+    return -1;
+}
+
+// Finds the first event in a path with a timestamp that is the same as or
+// after a given timestamp. If there is no such event then the end of the path
+// is returned.
+//
+// path_ptr  - A pointer to the raw path.
+// timestamp - The timestamp to search for.
+// ret       - A pointer to where the event pointer is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_extent_find_insertion_ptr(void *path_ptr, sky_timestamp_t timestamp,
+                                  void **ret)
+{
+    int rc;
+    size_t sz;
+    check(path_ptr != NULL, "Path pointer required");
+
+    void *ptr = path_ptr + SKY_PATH_HEADER_LENGTH;
+    void *endptr = path_ptr + sky_path_sizeof_raw(path_ptr);
+    while(ptr < endptr) {
+        sky_timestamp_t event_timestamp;
+        sky_action_id_t action_id;
+        sky_event_data_length_t data_length;
+        rc = sky_event_unpack_hdr(&event_timestamp, &action_id, &data_length, ptr, &sz);
+        check(rc == 0, "Unable to unpack event header");
+        if(event_timestamp >= timestamp) {
+            break;
+        }
+        ptr += sky_event_sizeof_raw(ptr);
+    }
+
+    *ret = ptr;
+    return 0;
+
+error:
+    *ret = NULL;
+    return -1;
+}
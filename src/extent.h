@@ -0,0 +1,95 @@
+#ifndef _extent_h
+#define _extent_h
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+typedef struct sky_extent sky_extent;
+
+#include "bstring.h"
+#include "types.h"
+#include "data_file.h"
+#include "event.h"
+
+//==============================================================================
+//
+// Overview
+//
+//==============================================================================
+
+// An extent stores the path of a single large object outside of the fixed
+// size blocks of the data file. Extents are stored in a separate extent file
+// and each one is a variable sized record made up of a header and a reserved
+// area that holds the raw path:
+//
+//     EXTENT = OBJECT_ID MIN_TIMESTAMP MAX_TIMESTAMP CAPACITY PATH
+//
+// The path is stored contiguously so it can be read by a cursor as a single
+// range. The capacity is larger than the path so that new events can be
+// appended without moving it. When the path outgrows its capacity, the
+// extent is moved to the end of the extent file with double the capacity and
+// the old record is marked as free by zeroing its object id.
+
+
+//==============================================================================
+//
+// Typedefs
+//
+//==============================================================================
+
+#define SKY_EXTENT_HEADER_SIZE (sizeof(sky_object_id_t) + (sizeof(sky_timestamp_t) * 2) + sizeof(uint64_t))
+
+struct sky_extent {
+    sky_data_file *data_file;
+    size_t offset;
+    size_t capacity;
+    sky_object_id_t object_id;
+    sky_timestamp_t min_timestamp;
+    sky_timestamp_t max_timestamp;
+    uint32_t version;
+};
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+sky_extent *sky_extent_create(sky_data_file *data_file);
+
+void sky_extent_free(sky_extent *extent);
+
+
+//--------------------------------------
+// Persistence
+//--------------------------------------
+
+int sky_extent_pack(sky_extent *extent, void *ptr, size_t *sz);
+
+int sky_extent_unpack(sky_extent *extent, void *ptr, size_t *sz);
+
+int sky_extent_save(sky_extent *extent);
+
+
+//--------------------------------------
+// Extent Position
+//--------------------------------------
+
+int sky_extent_get_ptr(sky_extent *extent, void **ptr);
+
+
+//--------------------------------------
+// Event Management
+//--------------------------------------
+
+int sky_extent_add_event(sky_extent *extent, sky_event *event);
+
+int sky_extent_contains_event(sky_extent *extent, sky_event *event, bool *ret);
+
+
+#endif
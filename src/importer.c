@@ -44,6 +44,8 @@ int sky_importer_process_event(sky_importer *importer, bstring source,
 int sky_importer_process_event_data(sky_importer *importer, sky_event *event,
     bstring source, jsmntok_t *tokens, uint32_t *index);
 
+int sky_importer_flush_events(sky_importer *importer);
+
 
 bool sky_importer_tokstr_equal(bstring source, jsmntok_t *token,
     const char *str);
@@ -85,6 +87,14 @@ void sky_importer_free(sky_importer *importer)
     if(importer) {
         if(importer->path) bdestroy(importer->path);
         importer->path = NULL;
+
+        uint32_t i;
+        for(i=0; i<importer->event_count; i++) {
+            sky_event_free(importer->events[i]);
+        }
+        free(importer->events);
+        importer->events = NULL;
+        importer->event_count = 0;
         
         free(importer);
     }
@@ -491,6 +501,10 @@ int sky_importer_process_events(sky_importer *importer, bstring source,
         check(rc == 0, "Unable to process event import");
     }
     
+    // Add any remaining batched events.
+    rc = sky_importer_flush_events(importer);
+    check(rc == 0, "Unable to flush events");
+    
     return 0;
 
 error:
@@ -501,6 +515,7 @@ int sky_importer_process_event(sky_importer *importer, bstring source,
                                jsmntok_t *tokens, uint32_t *index)
 {
     int rc;
+    sky_event *event = NULL;
     check(importer != NULL, "Importer required");
     check(source != NULL, "Source required");
     check(tokens != NULL, "Tokens required");
@@ -514,8 +529,14 @@ int sky_importer_process_event(sky_importer *importer, bstring source,
         check(sky_table_open(importer->table) == 0, "Unable to open table");
     }
 
+    // Allocate the batch on first use.
+    if(importer->events == NULL) {
+        importer->events = calloc(SKY_IMPORTER_BATCH_SIZE, sizeof(*importer->events));
+        check_mem(importer->events);
+    }
+
     // Create the event object.
-    sky_event *event = sky_event_create(0, 0, 0); check_mem(event);
+    event = sky_event_create(0, 0, 0); check_mem(event);
         
     // Process over child tokens.
     int32_t i;
@@ -548,12 +569,45 @@ int sky_importer_process_event(sky_importer *importer, bstring source,
         }
     }
     
-    // Add event.
-    rc = sky_table_add_event(importer->table, event);
-    check(rc == 0, "Unable to add event");
+    // Batch the event and add the batch to the table once it is full.
+    importer->events[importer->event_count++] = event;
+    event = NULL;
+    if(importer->event_count == SKY_IMPORTER_BATCH_SIZE) {
+        rc = sky_importer_flush_events(importer);
+        check(rc == 0, "Unable to flush events");
+    }
     
     return 0;
 
+error:
+    sky_event_free(event);
+    return -1;
+}
+
+// Adds all batched events to the table in a single call and then frees them.
+//
+// importer - The importer.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_importer_flush_events(sky_importer *importer)
+{
+    int rc;
+    check(importer != NULL, "Importer required");
+
+    if(importer->event_count > 0) {
+        rc = sky_table_add_events(importer->table, importer->events, importer->event_count);
+        check(rc == 0, "Unable to add events");
+    }
+
+    uint32_t i;
+    for(i=0; i<importer->event_count; i++) {
+        sky_event_free(importer->events[i]);
+        importer->events[i] = NULL;
+    }
+    importer->event_count = 0;
+
+    return 0;
+
 error:
     return -1;
 }
@@ -15,10 +15,13 @@
 //
 //==============================================================================
 
+#define SKY_IMPORTER_BATCH_SIZE 4096
+
 typedef struct {
     bstring path;
     sky_table *table;
     sky_event **events;
+    uint32_t event_count;
 } sky_importer;
 
 
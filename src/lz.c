@@ -0,0 +1,290 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbg.h"
+#include "lz.h"
+
+
+//==============================================================================
+//
+// Forward Declarations
+//
+//==============================================================================
+
+int sky_lz_write_sequence(uint8_t **op, uint8_t *oend, uint8_t *literals,
+    size_t literal_length, size_t offset, size_t match_length);
+
+int sky_lz_write_length(uint8_t **op, uint8_t *oend, size_t length);
+
+int sky_lz_read_length(uint8_t **ip, uint8_t *iend, size_t *length);
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Compression
+//--------------------------------------
+
+// Compresses a buffer. Matches are found by hashing the next four bytes of
+// the input and checking the last position that had the same hash so each
+// byte of input is only looked at a few times.
+//
+// src           - The data to compress.
+// src_length    - The number of bytes to compress.
+// dest          - The buffer to write the compressed data to.
+// dest_capacity - The size of the destination buffer.
+// sz            - A pointer to where the compressed length is returned.
+//
+// Returns 0 if successful. Returns -1 if the compressed data does not fit in
+// the destination buffer.
+int sky_lz_compress(void *src, size_t src_length, void *dest,
+                    size_t dest_capacity, size_t *sz)
+{
+    int rc;
+    uint32_t table[1 << SKY_LZ_HASH_BITS];
+    check(src != NULL || src_length == 0, "Source required");
+    check(dest != NULL, "Destination required");
+    memset(table, 0, sizeof(table));
+
+    uint8_t *base = (uint8_t*)src;
+    uint8_t *ip = base;
+    uint8_t *anchor = base;
+    uint8_t *iend = base + src_length;
+    uint8_t *op = (uint8_t*)dest;
+    uint8_t *oend = op + dest_capacity;
+
+    // The table stores the position of the last sequence with each hash plus
+    // one so that a zero entry is empty.
+    while(ip + SKY_LZ_MIN_MATCH <= iend) {
+        uint32_t sequence;
+        memcpy(&sequence, ip, sizeof(sequence));
+        uint32_t hash = (sequence * 2654435761U) >> (32 - SKY_LZ_HASH_BITS);
+        uint32_t entry = table[hash];
+        table[hash] = (ip - base) + 1;
+
+        uint8_t *ref = base + entry - 1;
+        if(entry == 0 || ip - ref > SKY_LZ_MAX_OFFSET || memcmp(ref, ip, SKY_LZ_MIN_MATCH) != 0) {
+            ip++;
+            continue;
+        }
+
+        // Extend the match as far as possible.
+        size_t match_length = SKY_LZ_MIN_MATCH;
+        while(ip + match_length < iend && ref[match_length] == ip[match_length]) {
+            match_length++;
+        }
+
+        rc = sky_lz_write_sequence(&op, oend, anchor, ip - anchor, ip - ref, match_length);
+        check(rc == 0, "Unable to write sequence");
+        ip += match_length;
+        anchor = ip;
+    }
+
+    // The remaining input is written as literals.
+    rc = sky_lz_write_sequence(&op, oend, anchor, iend - anchor, 0, 0);
+    check(rc == 0, "Unable to write literals");
+
+    *sz = op - (uint8_t*)dest;
+    return 0;
+
+error:
+    *sz = 0;
+    return -1;
+}
+
+// Decompresses a buffer. The compressed data is validated as it is read so
+// corrupt data cannot write outside of the destination buffer.
+//
+// src         - The compressed data.
+// src_length  - The number of bytes of compressed data.
+// dest        - The buffer to write the decompressed data to.
+// dest_length - The expected length of the decompressed data.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_lz_decompress(void *src, size_t src_length, void *dest,
+                      size_t dest_length)
+{
+    int rc;
+    check(src != NULL, "Source required");
+    check(dest != NULL, "Destination required");
+
+    uint8_t *ip = (uint8_t*)src;
+    uint8_t *iend = ip + src_length;
+    uint8_t *op = (uint8_t*)dest;
+    uint8_t *oend = op + dest_length;
+
+    while(ip < iend) {
+        uint8_t token = *ip++;
+
+        // Copy literals.
+        size_t literal_length = token >> 4;
+        if(literal_length == 15) {
+            rc = sky_lz_read_length(&ip, iend, &literal_length);
+            check(rc == 0, "Unable to read literal length");
+        }
+        check(literal_length <= (size_t)(iend - ip) && literal_length <= (size_t)(oend - op), "Literals out of bounds");
+        if(literal_length <= 16 && iend - ip >= 16 && oend - op >= 16) {
+            memcpy(op, ip, 16);
+        }
+        else {
+            memcpy(op, ip, literal_length);
+        }
+        ip += literal_length;
+        op += literal_length;
+
+        // The last sequence has no match.
+        if(ip == iend) {
+            break;
+        }
+
+        // Copy the match. Short copies are done in fixed size chunks that
+        // can run past the end of the copy as long as there is room in the
+        // output. Matches can overlap the bytes they produce so short
+        // offsets are copied a byte at a time.
+        check(iend - ip >= 2, "Match offset out of bounds");
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        check(offset > 0 && offset <= (size_t)(op - (uint8_t*)dest), "Invalid match offset");
+
+        size_t match_length = token & 15;
+        if(match_length == 15) {
+            rc = sky_lz_read_length(&ip, iend, &match_length);
+            check(rc == 0, "Unable to read match length");
+        }
+        match_length += SKY_LZ_MIN_MATCH;
+        check(match_length <= (size_t)(oend - op), "Match out of bounds");
+
+        uint8_t *ref = op - offset;
+        if(offset >= 8 && (size_t)(oend - op) >= match_length + 8) {
+            uint8_t *end = op + match_length;
+            while(op < end) {
+                memcpy(op, ref, 8);
+                op += 8;
+                ref += 8;
+            }
+            op = end;
+        }
+        else if(offset >= match_length) {
+            memcpy(op, ref, match_length);
+            op += match_length;
+        }
+        else {
+            uint8_t *end = op + match_length;
+            while(op < end) {
+                *op++ = *ref++;
+            }
+        }
+    }
+
+    check(op == oend, "Decompressed length mismatch");
+    return 0;
+
+error:
+    return -1;
+}
+
+
+//--------------------------------------
+// Sequences
+//--------------------------------------
+
+// Writes a sequence of literals followed by a match. A match length of zero
+// writes only the literals and is used to end the compressed data.
+//
+// op             - A pointer to the current output position.
+// oend           - The end of the output buffer.
+// literals       - The literal bytes.
+// literal_length - The number of literal bytes.
+// offset         - The distance back to the start of the match.
+// match_length   - The length of the match.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_lz_write_sequence(uint8_t **op, uint8_t *oend, uint8_t *literals,
+                          size_t literal_length, size_t offset,
+                          size_t match_length)
+{
+    int rc;
+    check(*op < oend, "Output buffer full");
+
+    // Write the token.
+    uint8_t *token = (*op)++;
+    *token = (literal_length < 15 ? literal_length : 15) << 4;
+    if(match_length > 0) {
+        size_t length = match_length - SKY_LZ_MIN_MATCH;
+        *token |= (length < 15 ? length : 15);
+    }
+
+    // Write the literals.
+    if(literal_length >= 15) {
+        rc = sky_lz_write_length(op, oend, literal_length - 15);
+        check(rc == 0, "Unable to write literal length");
+    }
+    check(literal_length <= (size_t)(oend - *op), "Output buffer full");
+    memcpy(*op, literals, literal_length);
+    *op += literal_length;
+
+    // Write the match.
+    if(match_length > 0) {
+        check(oend - *op >= 2, "Output buffer full");
+        (*op)[0] = offset & 0xFF;
+        (*op)[1] = (offset >> 8) & 0xFF;
+        *op += 2;
+        if(match_length - SKY_LZ_MIN_MATCH >= 15) {
+            rc = sky_lz_write_length(op, oend, match_length - SKY_LZ_MIN_MATCH - 15);
+            check(rc == 0, "Unable to write match length");
+        }
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Writes the part of a length that doesn't fit in a token nibble.
+//
+// op     - A pointer to the current output position.
+// oend   - The end of the output buffer.
+// length - The remaining length.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_lz_write_length(uint8_t **op, uint8_t *oend, size_t length)
+{
+    while(length >= 255) {
+        check(*op < oend, "Output buffer full");
+        *(*op)++ = 255;
+        length -= 255;
+    }
+    check(*op < oend, "Output buffer full");
+    *(*op)++ = (uint8_t)length;
+    return 0;
+
+error:
+    return -1;
+}
+
+// Reads the part of a length that doesn't fit in a token nibble and adds it
+// to the length.
+//
+// ip     - A pointer to the current input position.
+// iend   - The end of the input.
+// length - A pointer to the length.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_lz_read_length(uint8_t **ip, uint8_t *iend, size_t *length)
+{
+    uint8_t value;
+    do {
+        check(*ip < iend, "Length out of bounds");
+        value = *(*ip)++;
+        *length += value;
+    } while(value == 255);
+    return 0;
+
+error:
+    return -1;
+}
@@ -0,0 +1,60 @@
+#ifndef _lz_h
+#define _lz_h
+
+#include <stddef.h>
+#include <inttypes.h>
+
+
+//==============================================================================
+//
+// Overview
+//
+//==============================================================================
+
+// This file provides a small LZ77 codec that is used to compress cold
+// blocks. It favors speed over compression ratio and has no dependencies.
+//
+// The compressed data is a series of sequences. Each sequence copies a run of
+// literal bytes and then copies a match from earlier in the output:
+//
+//     SEQUENCE = TOKEN LITERAL_LENGTH* LITERAL* OFFSET MATCH_LENGTH*
+//
+// The high four bits of the token hold the literal length and the low four
+// bits hold the match length minus the minimum match length. A nibble of 15
+// means that more length bytes follow, each added to the length, until a byte
+// that is less than 255. The offset is a little endian 16-bit distance back
+// into the output. The last sequence only contains literals.
+
+
+//==============================================================================
+//
+// Typedefs
+//
+//==============================================================================
+
+#define SKY_LZ_MIN_MATCH 4
+
+#define SKY_LZ_MAX_OFFSET 0xFFFF
+
+#define SKY_LZ_HASH_BITS 12
+
+#define SKY_LZ_BOUND(LENGTH) ((LENGTH) + ((LENGTH) / 255) + 16)
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Compression
+//--------------------------------------
+
+int sky_lz_compress(void *src, size_t src_length, void *dest,
+    size_t dest_capacity, size_t *sz);
+
+int sky_lz_decompress(void *src, size_t src_length, void *dest,
+    size_t dest_length);
+
+#endif
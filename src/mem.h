@@ -31,6 +31,30 @@
 #endif
 
 
+//--------------------------------------
+// FALLOCATE
+//--------------------------------------
+
+#ifdef __linux
+#define FALLOCATE_AVAILABLE 1
+#else
+#define FALLOCATE_AVAILABLE 0
+#endif
+
+
+//--------------------------------------
+// Prefetch
+//--------------------------------------
+
+// Loads the cache line at an address ahead of time. This is only a hint so
+// it never faults, even if the address isn't valid.
+#if defined(__GNUC__) || defined(__clang__)
+#define memprefetch(PTR) __builtin_prefetch(PTR)
+#else
+#define memprefetch(PTR)
+#endif
+
+
 //--------------------------------------
 // Memory writes
 //--------------------------------------
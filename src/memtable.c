@@ -0,0 +1,630 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbg.h"
+#include "path.h"
+#include "cursor.h"
+#include "memtable.h"
+
+
+//==============================================================================
+//
+// Forward Declarations
+//
+//==============================================================================
+
+int sky_memtable_entry_cmp(const void *a, const void *b);
+
+int sky_memtable_index_paths(sky_memtable *memtable);
+
+int sky_memtable_add_chunk(sky_memtable_buffer *buffer, uint32_t index,
+    size_t offset, sky_object_id_t object_id, size_t end);
+
+int sky_memtable_reserve_buffer(sky_memtable_buffer *buffer, size_t length);
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+// Creates a memtable.
+//
+// Returns a reference to a new memtable if successful. Otherwise returns
+// null.
+sky_memtable *sky_memtable_create()
+{
+    sky_memtable *memtable = calloc(1, sizeof(sky_memtable));
+    check_mem(memtable);
+    memtable->max_path_length = SKY_PATH_LENGTH_MASK;
+    return memtable;
+
+error:
+    sky_memtable_free(memtable);
+    return NULL;
+}
+
+// Removes a memtable from memory. Any events that have not been flushed are
+// discarded.
+//
+// memtable - The memtable to free.
+void sky_memtable_free(sky_memtable *memtable)
+{
+    if(memtable) {
+        free(memtable->entries);
+        memtable->entries = NULL;
+        free(memtable->data);
+        memtable->data = NULL;
+        free(memtable->paths);
+        memtable->paths = NULL;
+        free(memtable);
+    }
+}
+
+
+//--------------------------------------
+// Event Management
+//--------------------------------------
+
+// Adds an event to the memtable. The event is packed into the memtable so
+// the caller keeps ownership of it.
+//
+// memtable - The memtable.
+// event    - The event to add.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_memtable_add_event(sky_memtable *memtable, sky_event *event)
+{
+    int rc;
+    check(memtable != NULL, "Memtable required");
+    check(event != NULL, "Event required");
+    check(event->object_id != 0, "Object id required");
+
+    // Grow the event data.
+    size_t length = sky_event_sizeof(event);
+    if(memtable->data_length + length > memtable->data_capacity) {
+        size_t capacity = (memtable->data_capacity > 0 ? memtable->data_capacity * 2 : 4096);
+        while(memtable->data_length + length > capacity) {
+            capacity *= 2;
+        }
+        void *data = realloc(memtable->data, capacity); check_mem(data);
+        memtable->data = data;
+        memtable->data_capacity = capacity;
+    }
+    check(memtable->data_length + length <= UINT32_MAX, "Memtable is full");
+
+    // Grow the entries.
+    if(memtable->entry_count == memtable->entry_capacity) {
+        uint32_t capacity = (memtable->entry_capacity > 0 ? memtable->entry_capacity * 2 : 256);
+        sky_memtable_entry *entries = realloc(memtable->entries, sizeof(*entries) * capacity);
+        check_mem(entries);
+        memtable->entries = entries;
+        memtable->entry_capacity = capacity;
+    }
+
+    // Pack the event and append an entry for it.
+    size_t sz;
+    rc = sky_event_pack(event, memtable->data + memtable->data_length, &sz);
+    check(rc == 0 && sz == length, "Unable to pack event");
+
+    sky_memtable_entry *entry = &memtable->entries[memtable->entry_count++];
+    entry->object_id = event->object_id;
+    entry->timestamp = event->timestamp;
+    entry->offset = (uint32_t)memtable->data_length;
+    entry->length = (uint32_t)length;
+    memtable->data_length += length;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Removes all events from the memtable. The memory is kept so that it can be
+// reused.
+//
+// memtable - The memtable.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_memtable_clear(sky_memtable *memtable)
+{
+    check(memtable != NULL, "Memtable required");
+
+    memtable->entry_count = 0;
+    memtable->sorted_count = 0;
+    memtable->data_length = 0;
+    memtable->path_count = 0;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Creates a sorted copy of the memtable. The copy doesn't change when events
+// are added to or flushed from the original memtable.
+//
+// memtable - The memtable to copy.
+// ret      - A pointer to where the copy is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_memtable_copy(sky_memtable *memtable, sky_memtable **ret)
+{
+    int rc;
+    sky_memtable *copy = NULL;
+    check(memtable != NULL, "Memtable required");
+    check(ret != NULL, "Return address required");
+
+    rc = sky_memtable_sort(memtable);
+    check(rc == 0, "Unable to sort memtable");
+
+    copy = sky_memtable_create(); check_mem(copy);
+    copy->max_path_length = memtable->max_path_length;
+    if(memtable->entry_count > 0) {
+        copy->entries = malloc(sizeof(*copy->entries) * memtable->entry_count);
+        check_mem(copy->entries);
+        memcpy(copy->entries, memtable->entries, sizeof(*copy->entries) * memtable->entry_count);
+        copy->entry_count = copy->entry_capacity = copy->sorted_count = memtable->entry_count;
+
+        copy->data = malloc(memtable->data_length); check_mem(copy->data);
+        memcpy(copy->data, memtable->data, memtable->data_length);
+        copy->data_length = copy->data_capacity = memtable->data_length;
+
+        copy->paths = malloc(sizeof(*copy->paths) * memtable->path_count);
+        check_mem(copy->paths);
+        memcpy(copy->paths, memtable->paths, sizeof(*copy->paths) * memtable->path_count);
+        copy->path_count = memtable->path_count;
+    }
+
+    *ret = copy;
+    return 0;
+
+error:
+    sky_memtable_free(copy);
+    if(ret) *ret = NULL;
+    return -1;
+}
+
+// Unpacks every event in the memtable in object id and timestamp order. The
+// caller owns the returned events and the array.
+//
+// memtable - The memtable.
+// ret      - A pointer to where the array of events is returned.
+// count    - A pointer to where the number of events is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_memtable_get_events(sky_memtable *memtable, sky_event ***ret,
+                            uint32_t *count)
+{
+    int rc;
+    uint32_t i;
+    sky_event **events = NULL;
+    check(memtable != NULL, "Memtable required");
+    check(ret != NULL, "Return address required");
+    check(count != NULL, "Count address required");
+
+    *ret = NULL;
+    *count = 0;
+    if(memtable->entry_count == 0) {
+        return 0;
+    }
+
+    rc = sky_memtable_sort(memtable);
+    check(rc == 0, "Unable to sort memtable");
+    events = calloc(memtable->entry_count, sizeof(*events)); check_mem(events);
+    for(i=0; i<memtable->entry_count; i++) {
+        sky_memtable_entry *entry = &memtable->entries[i];
+        events[i] = sky_event_create(entry->object_id, 0, 0); check_mem(events[i]);
+
+        size_t sz;
+        rc = sky_event_unpack(events[i], memtable->data + entry->offset, &sz);
+        check(rc == 0, "Unable to unpack event");
+    }
+
+    *ret = events;
+    *count = memtable->entry_count;
+    return 0;
+
+error:
+    if(events != NULL) {
+        for(i=0; i<memtable->entry_count; i++) {
+            sky_event_free(events[i]);
+        }
+    }
+    free(events);
+    return -1;
+}
+
+// Adds every event in the memtable to a data file as a single batch and then
+// clears the memtable.
+//
+// memtable  - The memtable.
+// data_file - The data file to add the events to.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_memtable_flush(sky_memtable *memtable, sky_data_file *data_file)
+{
+    int rc;
+    uint32_t i;
+    uint32_t count = 0;
+    sky_event **events = NULL;
+    check(memtable != NULL, "Memtable required");
+    check(data_file != NULL, "Data file required");
+
+    if(memtable->entry_count == 0) {
+        return 0;
+    }
+
+    rc = sky_memtable_get_events(memtable, &events, &count);
+    check(rc == 0, "Unable to retrieve memtable events");
+
+    rc = sky_data_file_add_events(data_file, events, count);
+    check(rc == 0, "Unable to add events to data file");
+
+    for(i=0; i<count; i++) {
+        sky_event_free(events[i]);
+    }
+    free(events);
+
+    rc = sky_memtable_clear(memtable);
+    check(rc == 0, "Unable to clear memtable");
+
+    return 0;
+
+error:
+    for(i=0; i<count; i++) {
+        sky_event_free(events[i]);
+    }
+    free(events);
+    return -1;
+}
+
+
+//--------------------------------------
+// Paths
+//--------------------------------------
+
+// Sorts the entries by object id and timestamp and groups them into paths.
+// Only the entries added since the last sort are sorted and they are then
+// merged with the entries that were already sorted.
+//
+// memtable - The memtable.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_memtable_sort(sky_memtable *memtable)
+{
+    int rc;
+    sky_memtable_entry *entries = NULL;
+    check(memtable != NULL, "Memtable required");
+
+    if(memtable->sorted_count == memtable->entry_count) {
+        return 0;
+    }
+
+    // Sort the new entries.
+    uint32_t sorted_count = memtable->sorted_count;
+    uint32_t new_count = memtable->entry_count - sorted_count;
+    qsort(&memtable->entries[sorted_count], new_count, sizeof(*memtable->entries), sky_memtable_entry_cmp);
+
+    // Merge them with the sorted entries.
+    if(sorted_count > 0) {
+        entries = malloc(sizeof(*entries) * memtable->entry_capacity);
+        check_mem(entries);
+
+        uint32_t i = 0, j = sorted_count, k = 0;
+        while(i < sorted_count || j < memtable->entry_count) {
+            if(j == memtable->entry_count || (i < sorted_count && sky_memtable_entry_cmp(&memtable->entries[i], &memtable->entries[j]) <= 0)) {
+                entries[k++] = memtable->entries[i++];
+            }
+            else {
+                entries[k++] = memtable->entries[j++];
+            }
+        }
+
+        free(memtable->entries);
+        memtable->entries = entries;
+        entries = NULL;
+    }
+    memtable->sorted_count = memtable->entry_count;
+
+    rc = sky_memtable_index_paths(memtable);
+    check(rc == 0, "Unable to index memtable paths");
+
+    return 0;
+
+error:
+    free(entries);
+    return -1;
+}
+
+// Compares two entries by object id and timestamp. Entries with the same
+// object id and timestamp are kept in the order that they were added.
+//
+// a - The first entry.
+// b - The second entry.
+//
+// Returns -1 if the first entry comes first, 1 if the second entry comes
+// first.
+int sky_memtable_entry_cmp(const void *a, const void *b)
+{
+    sky_memtable_entry *x = (sky_memtable_entry*)a;
+    sky_memtable_entry *y = (sky_memtable_entry*)b;
+
+    if(x->object_id != y->object_id) {
+        return (x->object_id < y->object_id ? -1 : 1);
+    }
+    if(x->timestamp != y->timestamp) {
+        return (x->timestamp < y->timestamp ? -1 : 1);
+    }
+    if(x->offset != y->offset) {
+        return (x->offset < y->offset ? -1 : 1);
+    }
+    return 0;
+}
+
+// Groups the sorted entries into one path per object id.
+//
+// memtable - The memtable.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_memtable_index_paths(sky_memtable *memtable)
+{
+    uint32_t i;
+    uint32_t count = 0;
+    for(i=0; i<memtable->entry_count; i++) {
+        if(i == 0 || memtable->entries[i].object_id != memtable->entries[i-1].object_id) {
+            count++;
+        }
+    }
+
+    sky_memtable_path *paths = realloc(memtable->paths, sizeof(*paths) * (count > 0 ? count : 1));
+    check_mem(paths);
+    memtable->paths = paths;
+    memtable->path_count = 0;
+
+    for(i=0; i<memtable->entry_count; i++) {
+        if(i == 0 || memtable->entries[i].object_id != memtable->entries[i-1].object_id) {
+            sky_memtable_path *path = &memtable->paths[memtable->path_count++];
+            path->object_id = memtable->entries[i].object_id;
+            path->entry_index = i;
+            path->entry_count = 0;
+        }
+        memtable->paths[memtable->path_count-1].entry_count++;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Retrieves a row-wise path that combines a path in the memtable with the
+// same object's path in the data file. The memtable must be sorted first.
+// The path is written to the caller's buffer so it is only valid until the
+// next path is retrieved into the same buffer.
+//
+// memtable           - The memtable.
+// buffer             - The buffer to merge the path into.
+// index              - The index of the memtable path.
+// data_file_ptrs     - The segments of the object's path in the data file.
+// data_file_ptr_count - The number of segments. This is zero if the object
+//                      only exists in the memtable.
+// ptr                - A pointer to where the combined path is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_memtable_get_path_ptr(sky_memtable *memtable,
+                              sky_memtable_buffer *buffer, uint32_t index,
+                              void **data_file_ptrs,
+                              uint32_t data_file_ptr_count, void **ptr)
+{
+    int rc;
+    void **ptrs;
+    uint32_t count;
+    rc = sky_memtable_get_path_ptrs(memtable, buffer, index, data_file_ptrs, data_file_ptr_count, &ptrs, &count);
+    check(rc == 0, "Unable to retrieve memtable path");
+    check(count == 1, "Memtable path is too large to return as a single path");
+    *ptr = ptrs[0];
+    return 0;
+
+error:
+    *ptr = NULL;
+    return -1;
+}
+
+// Retrieves a path in the memtable combined with every segment of the same
+// object's path in the data file. The combined path is split into chunks of
+// at most the memtable's maximum path length so a large path doesn't exceed
+// the path length limit. The chunks and the list are kept in the caller's
+// buffer and are only valid until the next path is retrieved into it.
+//
+// memtable            - The memtable.
+// buffer              - The buffer to merge the path into.
+// index               - The index of the memtable path.
+// data_file_ptrs      - The segments of the object's path in the data file.
+// data_file_ptr_count - The number of segments. This is zero if the object
+//                       only exists in the memtable.
+// ptrs                - A pointer to where the list of chunks is returned.
+// count               - A pointer to where the number of chunks is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_memtable_get_path_ptrs(sky_memtable *memtable,
+                               sky_memtable_buffer *buffer, uint32_t index,
+                               void **data_file_ptrs,
+                               uint32_t data_file_ptr_count,
+                               void ***ptrs, uint32_t *count)
+{
+    int rc;
+    uint32_t i;
+    sky_cursor cursor;
+    sky_cursor_init(&cursor);
+    check(memtable != NULL, "Memtable required");
+    check(buffer != NULL, "Memtable buffer required");
+    check(memtable->sorted_count == memtable->entry_count, "Memtable must be sorted");
+    check(index < memtable->path_count, "Memtable path index out of range: %d", index);
+    check(memtable->max_path_length > 0, "Memtable max path length required");
+    check(ptrs != NULL, "Path list return address required");
+    check(count != NULL, "Path count return address required");
+
+    sky_memtable_path *path = &memtable->paths[index];
+    uint32_t entry_index = path->entry_index;
+    uint32_t end_index = path->entry_index + path->entry_count;
+
+    rc = sky_cursor_set_paths(&cursor, data_file_ptrs, data_file_ptr_count);
+    check(rc == 0, "Unable to set cursor paths");
+
+    // Merge the events by timestamp. A new chunk is started whenever the
+    // next event would make the current one too long.
+    uint32_t chunk_count = 0;
+    size_t chunk_start = 0;
+    size_t length = SKY_PATH_HEADER_LENGTH;
+    while(!cursor.eof || entry_index < end_index) {
+        bool use_entry = (entry_index < end_index);
+        if(use_entry && !cursor.eof) {
+            sky_timestamp_t timestamp;
+            rc = sky_cursor_get_timestamp(&cursor, &timestamp);
+            check(rc == 0, "Unable to retrieve timestamp");
+            use_entry = (memtable->entries[entry_index].timestamp < timestamp);
+        }
+
+        // Determine the largest size of the event.
+        size_t sz = 0;
+        if(use_entry) {
+            sz = memtable->entries[entry_index].length;
+        }
+        else {
+            void *data_ptr;
+            uint32_t data_length;
+            rc = sky_cursor_get_data_ptr(&cursor, &data_ptr, &data_length);
+            check(rc == 0, "Unable to retrieve event data");
+            sz = SKY_CURSOR_MAX_EVENT_HEADER_LENGTH + data_length;
+        }
+
+        // Close the chunk if the event doesn't fit.
+        size_t chunk_length = length - chunk_start - SKY_PATH_HEADER_LENGTH;
+        if(chunk_length > 0 && chunk_length + sz > memtable->max_path_length) {
+            rc = sky_memtable_add_chunk(buffer, chunk_count++, chunk_start, path->object_id, length);
+            check(rc == 0, "Unable to add memtable path chunk");
+            chunk_start = length;
+            length += SKY_PATH_HEADER_LENGTH;
+        }
+
+        rc = sky_memtable_reserve_buffer(buffer, length + sz);
+        check(rc == 0, "Unable to reserve memtable buffer");
+        if(use_entry) {
+            sky_memtable_entry *entry = &memtable->entries[entry_index++];
+            memcpy(buffer->data + length, memtable->data + entry->offset, entry->length);
+            length += entry->length;
+        }
+        else {
+            rc = sky_cursor_pack_event(&cursor, buffer->data + length, &sz);
+            check(rc == 0, "Unable to pack event");
+            length += sz;
+
+            rc = sky_cursor_next(&cursor);
+            check(rc == 0, "Unable to move to next event");
+        }
+    }
+
+    // Close the last chunk.
+    rc = sky_memtable_add_chunk(buffer, chunk_count++, chunk_start, path->object_id, length);
+    check(rc == 0, "Unable to add memtable path chunk");
+
+    // Convert the chunk offsets to pointers now that the buffer won't move.
+    for(i=0; i<chunk_count; i++) {
+        buffer->chunk_ptrs[i] = buffer->data + buffer->chunk_offsets[i];
+    }
+
+    sky_cursor_set_path(&cursor, NULL);
+    *ptrs = buffer->chunk_ptrs;
+    *count = chunk_count;
+    return 0;
+
+error:
+    sky_cursor_set_path(&cursor, NULL);
+    if(ptrs) *ptrs = NULL;
+    if(count) *count = 0;
+    return -1;
+}
+
+// Writes the path header of a chunk of a merged path and records its offset
+// in the buffer.
+//
+// buffer    - The buffer.
+// index     - The index of the chunk.
+// offset    - The offset of the chunk in the buffer.
+// object_id - The object id of the path.
+// end       - The offset of the end of the chunk in the buffer.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_memtable_add_chunk(sky_memtable_buffer *buffer, uint32_t index,
+                           size_t offset, sky_object_id_t object_id,
+                           size_t end)
+{
+    int rc;
+
+    // Grow the chunk lists.
+    if(index >= buffer->chunk_capacity) {
+        uint32_t capacity = (buffer->chunk_capacity > 0 ? buffer->chunk_capacity * 2 : 4);
+        size_t *offsets = realloc(buffer->chunk_offsets, sizeof(*offsets) * capacity);
+        check_mem(offsets);
+        buffer->chunk_offsets = offsets;
+        void **ptrs = realloc(buffer->chunk_ptrs, sizeof(*ptrs) * capacity);
+        check_mem(ptrs);
+        buffer->chunk_ptrs = ptrs;
+        buffer->chunk_capacity = capacity;
+    }
+
+    // Write the path header.
+    rc = sky_memtable_reserve_buffer(buffer, end);
+    check(rc == 0, "Unable to reserve memtable buffer");
+    *((sky_object_id_t*)(buffer->data + offset)) = object_id;
+    *((sky_path_event_data_length_t*)(buffer->data + offset + sizeof(sky_object_id_t))) = (sky_path_event_data_length_t)(end - offset - SKY_PATH_HEADER_LENGTH);
+    buffer->chunk_offsets[index] = offset;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Grows the path buffer to hold at least a given number of bytes.
+//
+// buffer - The buffer.
+// length - The number of bytes needed.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_memtable_reserve_buffer(sky_memtable_buffer *buffer, size_t length)
+{
+    if(length > buffer->capacity) {
+        size_t capacity = (buffer->capacity > 0 ? buffer->capacity : 4096);
+        while(length > capacity) {
+            capacity *= 2;
+        }
+        void *data = realloc(buffer->data, capacity); check_mem(data);
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    return 0;
+
+error:
+    return -1;
+}
+
+// Frees the memory held by a path buffer. The buffer can be reused
+// afterward.
+//
+// buffer - The buffer.
+void sky_memtable_release_buffer(sky_memtable_buffer *buffer)
+{
+    if(buffer) {
+        free(buffer->data);
+        free(buffer->chunk_offsets);
+        free(buffer->chunk_ptrs);
+        memset(buffer, 0, sizeof(*buffer));
+    }
+}
@@ -0,0 +1,131 @@
+#ifndef _memtable_h
+#define _memtable_h
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct sky_memtable sky_memtable;
+
+#include "types.h"
+#include "event.h"
+#include "data_file.h"
+
+
+//==============================================================================
+//
+// Overview
+//
+//==============================================================================
+
+// The memtable holds recently added events in memory so that inserts don't
+// have to shift the contents of a block or split it. Events are packed into
+// a single buffer as they are added and an index of entries is kept for
+// them. The index is sorted by object id and timestamp when the memtable is
+// read so inserts only append.
+//
+// Once the memtable grows past the table's memtable size it is flushed into
+// the data file as a single batch and cleared. The events are logged in the
+// write-ahead log before they are added to the memtable so the log is only
+// truncated after the memtable has been flushed.
+//
+// Queries read the memtable through the path iterator. Each path in the
+// memtable is merged by timestamp with every segment of the object's path in
+// the data file into a row-wise path in a buffer owned by the reader.
+// Events with the same timestamp are returned after the events in the data
+// file. A merged path longer than the maximum path length is split into
+// several chunks with the same object id, like a path in spanned blocks. The
+// buffer is reused for the next path. Reading a sorted memtable doesn't
+// change it so several iterators can read the same memtable at once as long
+// as each one has its own buffer.
+
+
+//==============================================================================
+//
+// Typedefs
+//
+//==============================================================================
+
+typedef struct sky_memtable_entry {
+    sky_object_id_t object_id;
+    sky_timestamp_t timestamp;
+    uint32_t offset;
+    uint32_t length;
+} sky_memtable_entry;
+
+typedef struct sky_memtable_path {
+    sky_object_id_t object_id;
+    uint32_t entry_index;
+    uint32_t entry_count;
+} sky_memtable_path;
+
+typedef struct sky_memtable_buffer {
+    void *data;
+    size_t capacity;
+    size_t *chunk_offsets;
+    void **chunk_ptrs;
+    uint32_t chunk_capacity;
+} sky_memtable_buffer;
+
+struct sky_memtable {
+    sky_memtable_entry *entries;
+    uint32_t entry_count;
+    uint32_t entry_capacity;
+    uint32_t sorted_count;
+    void *data;
+    size_t data_length;
+    size_t data_capacity;
+    sky_memtable_path *paths;
+    uint32_t path_count;
+    uint32_t max_path_length;
+};
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+sky_memtable *sky_memtable_create();
+
+void sky_memtable_free(sky_memtable *memtable);
+
+
+//--------------------------------------
+// Event Management
+//--------------------------------------
+
+int sky_memtable_add_event(sky_memtable *memtable, sky_event *event);
+
+int sky_memtable_clear(sky_memtable *memtable);
+
+int sky_memtable_copy(sky_memtable *memtable, sky_memtable **ret);
+
+int sky_memtable_get_events(sky_memtable *memtable, sky_event ***ret,
+    uint32_t *count);
+
+int sky_memtable_flush(sky_memtable *memtable, sky_data_file *data_file);
+
+
+//--------------------------------------
+// Paths
+//--------------------------------------
+
+int sky_memtable_sort(sky_memtable *memtable);
+
+int sky_memtable_get_path_ptr(sky_memtable *memtable,
+    sky_memtable_buffer *buffer, uint32_t index, void **data_file_ptrs,
+    uint32_t data_file_ptr_count, void **ptr);
+
+int sky_memtable_get_path_ptrs(sky_memtable *memtable,
+    sky_memtable_buffer *buffer, uint32_t index, void **data_file_ptrs,
+    uint32_t data_file_ptr_count, void ***ptrs, uint32_t *count);
+
+void sky_memtable_release_buffer(sky_memtable_buffer *buffer);
+
+#endif
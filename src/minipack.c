@@ -21,13 +21,15 @@
 int sky_minipack_fread_bstring(FILE *file, bstring *ret)
 {
     size_t sz;
+    char *buffer = NULL;
+    bstring str = NULL;
     
     // Read string length.
     uint32_t length = minipack_fread_raw(file, &sz);
     check(sz != 0, "Unable to read raw byte element at byte %ld", ftell(file));
 
     // Initialize buffer.
-    char *buffer = malloc(length+1); check_mem(buffer);
+    buffer = malloc(length+1); check_mem(buffer);
     buffer[length] = 0;
 
     // Read into buffer.
@@ -35,7 +37,7 @@ int sky_minipack_fread_bstring(FILE *file, bstring *ret)
     check(sz == length, "Expected %d bytes, received %ld bytes at byte %ld", length, sz, ftell(file));
 
     // Create bstring from buffer and return.
-    bstring str = blk2bstr(buffer, length); check_mem(str);
+    str = blk2bstr(buffer, length); check_mem(str);
     *ret = str;
     
     // Clean up.
@@ -44,6 +46,7 @@ int sky_minipack_fread_bstring(FILE *file, bstring *ret)
     return 0;
     
 error:
+    free(buffer);
     if(str) bdestroy(str);
     str = NULL;
     *ret = NULL;
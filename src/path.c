@@ -148,7 +148,7 @@ size_t sky_path_sizeof_raw(void *ptr)
     sz += sizeof(sky_object_id_t);
     
     // Read events length.
-    size_t event_data_length = *((sky_path_event_data_length_t*)(ptr + sz));
+    size_t event_data_length = *((sky_path_event_data_length_t*)(ptr + sz)) & SKY_PATH_LENGTH_MASK;
     sz += sizeof(sky_path_event_data_length_t);
     sz += event_data_length;
     
@@ -247,6 +247,7 @@ int sky_path_unpack(sky_path *path, void *ptr, size_t *sz)
     // Validate.
     check(path != NULL, "Path required");
     check(ptr != NULL, "Pointer required");
+    check(!sky_path_is_compact(ptr), "Only row-wise paths can be unpacked");
 
     // Read object id & event data length.
     path->object_id = *((sky_object_id_t*)ptr);
@@ -282,6 +283,162 @@ error:
     return -1;
 }
 
+
+//--------------------------------------
+// Compact Encoding
+//--------------------------------------
+
+// Checks whether a raw path is stored in the compact encoding.
+//
+// ptr - A pointer to raw, packed path data.
+//
+// Returns true if the path is compact, otherwise returns false.
+bool sky_path_is_compact(void *ptr)
+{
+    sky_path_event_data_length_t length = *((sky_path_event_data_length_t*)(ptr + sizeof(sky_object_id_t)));
+    return (length & SKY_PATH_FLAG_COMPACT) != 0;
+}
+
+// Converts a row-wise path into the compact encoding at a different memory
+// location. The compact path can be slightly larger than the row-wise path
+// if its events have large timestamp deltas and large data sections.
+//
+// ptr  - A pointer to the row-wise path.
+// addr - A pointer to where the compact path is written.
+// sz   - The number of bytes written.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_pack_compact(void *ptr, void *addr, size_t *sz)
+{
+    int rc;
+    size_t event_sz;
+    check(ptr != NULL, "Path pointer required");
+    check(addr != NULL, "Address required");
+    check(!sky_path_is_compact(ptr), "Path must be row-wise");
+
+    // Encode each event against the timestamp of the previous event.
+    void *event_ptr = ptr + SKY_PATH_HEADER_LENGTH;
+    void *endptr = ptr + sky_path_sizeof_raw(ptr);
+    void *out = addr + SKY_PATH_HEADER_LENGTH;
+    sky_timestamp_t previous_timestamp = 0;
+    while(event_ptr < endptr) {
+        rc = sky_event_pack_compact(event_ptr, previous_timestamp, out, &event_sz);
+        check(rc == 0, "Unable to pack compact event");
+        out += event_sz;
+
+        previous_timestamp = *((sky_timestamp_t*)(event_ptr + sizeof(sky_event_flag_t)));
+        event_ptr += sky_event_sizeof_raw(event_ptr);
+    }
+
+    // Write the header.
+    size_t length = (out - addr) - SKY_PATH_HEADER_LENGTH;
+    *((sky_object_id_t*)addr) = *((sky_object_id_t*)ptr);
+    *((sky_path_event_data_length_t*)(addr + sizeof(sky_object_id_t))) = length | SKY_PATH_FLAG_COMPACT;
+
+    if(sz != NULL) {
+        *sz = out - addr;
+    }
+
+    return 0;
+
+error:
+    if(sz != NULL) *sz = 0;
+    return -1;
+}
+
+
+//--------------------------------------
+// Expansion
+//--------------------------------------
+
+// Calculates the length of a path once it is stored row-wise.
+//
+// ptr - A pointer to a path in any layout.
+//
+// Returns the length of the row-wise path.
+size_t sky_path_sizeof_expanded(void *ptr)
+{
+    if(!sky_path_is_compact(ptr)) {
+        return sky_path_sizeof_raw(ptr);
+    }
+
+    sky_cursor cursor;
+    sky_cursor_init(&cursor);
+    if(sky_cursor_set_path(&cursor, ptr) != 0) {
+        return 0;
+    }
+
+    size_t sz = SKY_PATH_HEADER_LENGTH;
+    while(!cursor.eof) {
+        sky_action_id_t action_id;
+        void *data_ptr;
+        uint32_t data_length;
+        sky_cursor_get_action_id(&cursor, &action_id);
+        sky_cursor_get_data_ptr(&cursor, &data_ptr, &data_length);
+        sz += SKY_EVENT_HEADER_LENGTH;
+        if(action_id != 0) {
+            sz += sizeof(sky_action_id_t);
+        }
+        if(data_length > 0) {
+            sz += sizeof(sky_event_data_length_t) + data_length;
+        }
+        sky_cursor_next(&cursor);
+    }
+    sky_cursor_set_path(&cursor, NULL);
+
+    return sz;
+}
+
+// Converts a compact path back into the row-wise layout at a different memory
+// location. The target must have room for the number of bytes returned by
+// sky_path_sizeof_expanded().
+//
+// ptr  - A pointer to the path.
+// addr - A pointer to where the row-wise path is written.
+// sz   - The number of bytes written.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_expand(void *ptr, void *addr, size_t *sz)
+{
+    int rc;
+    size_t event_sz, hdr_sz;
+    sky_cursor cursor;
+    sky_cursor_init(&cursor);
+    check(ptr != NULL, "Path pointer required");
+    check(addr != NULL, "Address required");
+    check(ptr != addr, "Path cannot be expanded in place");
+
+    rc = sky_cursor_set_path(&cursor, ptr);
+    check(rc == 0, "Unable to set cursor path");
+
+    // Pack each event after the header.
+    void *event_ptr = addr + SKY_PATH_HEADER_LENGTH;
+    while(!cursor.eof) {
+        rc = sky_cursor_pack_event(&cursor, event_ptr, &event_sz);
+        check(rc == 0, "Unable to pack event");
+        event_ptr += event_sz;
+
+        rc = sky_cursor_next(&cursor);
+        check(rc == 0, "Unable to move to next event");
+    }
+    sky_cursor_set_path(&cursor, NULL);
+
+    // Write the header.
+    rc = sky_path_pack_hdr(*((sky_object_id_t*)ptr), (event_ptr - addr) - SKY_PATH_HEADER_LENGTH, addr, &hdr_sz);
+    check(rc == 0, "Unable to pack path header");
+
+    if(sz != NULL) {
+        *sz = event_ptr - addr;
+    }
+
+    return 0;
+
+error:
+    sky_cursor_set_path(&cursor, NULL);
+    if(sz != NULL) *sz = 0;
+    return -1;
+}
+
 //--------------------------------------
 // Stats
 //--------------------------------------
@@ -300,13 +457,13 @@ int sky_path_get_event_stats(void *path_ptr, sky_event *event,
                              uint32_t *event_count)
 {
     int rc;
+    sky_cursor cursor;
+    sky_cursor_init(&cursor);
     check(path_ptr != NULL, "Path pointer required");
     check(events != NULL, "Events return address required");
     check(event_count != NULL, "Event count return address required");
 
     // Initialize cursor.
-    sky_cursor cursor;
-    sky_cursor_init(&cursor);
     rc = sky_cursor_set_path(&cursor, path_ptr);
     check(rc == 0, "Unable to set cursor for path");
 
@@ -367,9 +524,11 @@ int sky_path_get_event_stats(void *path_ptr, sky_event *event,
         stat->sz = event_length;
     }
     
+    sky_cursor_set_path(&cursor, NULL);
     return 0;
 
 error:
+    sky_cursor_set_path(&cursor, NULL);
     free(*events);
     *events = NULL;
     *event_count = 0;
@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include <inttypes.h>
+#include <stdbool.h>
 
 #include "event.h"
 
@@ -14,6 +15,17 @@
 //==============================================================================
 
 // A path is a collection of events that is associated with an object.
+//
+// Paths are normally stored row-wise with each event packed after the last:
+//
+//   PATH  = OBJECT_ID LENGTH EVENT*
+//
+// Version 3 data files can also store paths in a compact encoding. Compact
+// paths have the second highest bit set in their length and store each event
+// with a leading length, a timestamp delta from the previous event and a
+// variable length action id. See sky_event_pack_compact() for the event
+// format. Compact paths are usually much smaller than row-wise paths but
+// they have to be expanded before events can be inserted into them.
 
 
 //==============================================================================
@@ -26,6 +38,10 @@
 
 #define SKY_PATH_HEADER_LENGTH (sizeof(sky_object_id_t) + sizeof(sky_path_event_data_length_t))
 
+#define SKY_PATH_FLAG_COMPACT 0x40000000
+
+#define SKY_PATH_LENGTH_MASK 0x3FFFFFFF
+
 
 //==============================================================================
 //
@@ -85,6 +101,24 @@ int sky_path_unpack_hdr(sky_object_id_t *object_id, uint32_t *event_data_length,
     void *addr, size_t *length);
 
 
+//--------------------------------------
+// Compact Encoding
+//--------------------------------------
+
+bool sky_path_is_compact(void *ptr);
+
+int sky_path_pack_compact(void *ptr, void *addr, size_t *length);
+
+
+//--------------------------------------
+// Expansion
+//--------------------------------------
+
+size_t sky_path_sizeof_expanded(void *ptr);
+
+int sky_path_expand(void *ptr, void *addr, size_t *length);
+
+
 //--------------------------------------
 // Stats
 //--------------------------------------
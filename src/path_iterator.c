@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 
 #include "path_iterator.h"
 #include "block.h"
@@ -15,11 +16,46 @@
 
 int sky_path_iterator_get_ptr(sky_path_iterator *iterator, void **ptr);
 
+int sky_path_iterator_get_data_file_ptr(sky_path_iterator *iterator,
+    void **ptr);
+
+int sky_path_iterator_get_data_file_ptrs(sky_path_iterator *iterator,
+    void ***ptrs, uint32_t *count);
+
 int sky_path_iterator_get_current_block(sky_path_iterator *iterator,
     sky_block **block);
 
+int sky_path_iterator_reset(sky_path_iterator *iterator);
+
+int sky_path_iterator_move(sky_path_iterator *iterator);
+
 int sky_path_iterator_fast_forward(sky_path_iterator *iterator);
 
+int sky_path_iterator_apply_range(sky_path_iterator *iterator);
+
+int sky_path_iterator_release_partitions(sky_path_iterator *iterator);
+
+int sky_path_iterator_get_partitions_ptr(sky_path_iterator *iterator,
+    void **ptr);
+
+int sky_path_iterator_next_partitions(sky_path_iterator *iterator);
+
+int sky_path_iterator_fast_forward_partitions(sky_path_iterator *iterator);
+
+int sky_path_iterator_reserve_buffer(sky_path_iterator *iterator,
+    size_t length);
+
+int sky_path_iterator_reserve_spans(sky_path_iterator *iterator,
+    uint32_t count);
+
+bool sky_path_iterator_in_window(sky_path_iterator *iterator,
+    sky_timestamp_t min_timestamp, sky_timestamp_t max_timestamp);
+
+bool sky_path_iterator_skip_block(sky_path_iterator *iterator,
+    uint32_t index);
+
+int sky_path_iterator_prefetch(sky_path_iterator *iterator);
+
 
 //==============================================================================
 //
@@ -70,6 +106,7 @@ void sky_path_iterator_free(sky_path_iterator *iterator)
 {
     if(iterator) {
         iterator->data_file = NULL;
+        sky_path_iterator_release_partitions(iterator);
         free(iterator);
     }
 }
@@ -89,14 +126,42 @@ int sky_path_iterator_set_data_file(sky_path_iterator *iterator, sky_data_file *
 {
     int rc;
     check(iterator != NULL, "Iterator required");
+    sky_path_iterator_release_partitions(iterator);
     iterator->data_file   = data_file;
+    iterator->snapshot    = NULL;
+    iterator->memtable    = NULL;
+
+    rc = sky_path_iterator_reset(iterator);
+    check(rc == 0, "Unable to reset iterator");
+
+    return 0;
+    
+error:
+    return -1;
+}
+
+// Moves an iterator over a data file back to the first path.
+//
+// iterator - The iterator.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_reset(sky_path_iterator *iterator)
+{
+    int rc;
     iterator->block_index = 0;
     iterator->block       = NULL;
     iterator->byte_index  = 0;
+    iterator->extent_index = 0;
+    iterator->extent      = NULL;
+    iterator->memtable_index = 0;
+    iterator->prefetch_index = 0;
+    iterator->eof         = false;
 
     // Position iterator at the first path.
     rc = sky_path_iterator_fast_forward(iterator);
     check(rc == 0, "Unable to find next available path");
+    rc = sky_path_iterator_apply_range(iterator);
+    check(rc == 0, "Unable to find first path in range");
 
     return 0;
     
@@ -114,10 +179,16 @@ int sky_path_iterator_set_block(sky_path_iterator *iterator, sky_block *block)
 {
     int rc;
     check(iterator != NULL, "Iterator required");
+    sky_path_iterator_release_partitions(iterator);
     iterator->block       = block;
     iterator->data_file   = NULL;
+    iterator->snapshot    = NULL;
     iterator->block_index = 0;
     iterator->byte_index  = 0;
+    iterator->extent_index = 0;
+    iterator->extent      = NULL;
+    iterator->memtable    = NULL;
+    iterator->memtable_index = 0;
 
     // Position iterator at the first path.
     rc = sky_path_iterator_fast_forward(iterator);
@@ -130,6 +201,335 @@ error:
 }
 
 
+// Attaches a memtable to an iterator that is iterating over a data file. The
+// iterator is moved back to the first path.
+//
+// iterator - The iterator.
+// memtable - The memtable to merge into the data file's paths.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_set_memtable(sky_path_iterator *iterator,
+                                   sky_memtable *memtable)
+{
+    int rc;
+    check(iterator != NULL, "Iterator required");
+    check(iterator->data_file != NULL, "Memtables can only be merged into a data file");
+
+    if(memtable != NULL) {
+        rc = sky_memtable_sort(memtable);
+        check(rc == 0, "Unable to sort memtable");
+    }
+
+    iterator->memtable = memtable;
+    rc = sky_path_iterator_reset(iterator);
+    check(rc == 0, "Unable to reset iterator");
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Assigns a snapshot of a data file as the source. The snapshot's copy of
+// the memtable is merged into the paths if it has one.
+//
+// iterator - The iterator.
+// snapshot - The open snapshot to iterate over.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_set_snapshot(sky_path_iterator *iterator,
+                                   sky_snapshot *snapshot)
+{
+    int rc;
+    check(iterator != NULL, "Iterator required");
+    check(snapshot != NULL, "Snapshot required");
+    check(snapshot->data_file != NULL, "Snapshot must be open");
+
+    sky_path_iterator_release_partitions(iterator);
+    iterator->data_file = snapshot->data_file;
+    iterator->block     = NULL;
+    iterator->snapshot  = snapshot;
+    iterator->memtable  = snapshot->memtable;
+    rc = sky_path_iterator_reset(iterator);
+    check(rc == 0, "Unable to reset iterator");
+
+    return 0;
+
+error:
+    return -1;
+}
+
+
+// Assigns snapshots of several partitions as the source. Paths for the same
+// object in more than one partition are returned as a single merged path.
+//
+// iterator  - The iterator.
+// snapshots - An array of open snapshots in time order.
+// count     - The number of snapshots.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_set_partitions(sky_path_iterator *iterator,
+                                     sky_snapshot **snapshots, uint32_t count)
+{
+    int rc;
+    uint32_t i;
+    check(iterator != NULL, "Iterator required");
+    check(snapshots != NULL || count == 0, "Snapshots required");
+
+    sky_path_iterator_release_partitions(iterator);
+    iterator->data_file = NULL;
+    iterator->block     = NULL;
+    iterator->snapshot  = NULL;
+    iterator->memtable  = NULL;
+
+    if(count > 0) {
+        iterator->partitions = calloc(count, sizeof(*iterator->partitions));
+        check_mem(iterator->partitions);
+        iterator->cursors = calloc(count, sizeof(*iterator->cursors));
+        check_mem(iterator->cursors);
+    }
+    iterator->partition_count = count;
+    for(i=0; i<count; i++) {
+        sky_path_iterator *partition = &iterator->partitions[i];
+        sky_path_iterator_init(partition);
+        sky_cursor_init(&iterator->cursors[i]);
+        partition->windowed = iterator->windowed;
+        partition->window_start = iterator->window_start;
+        partition->window_end = iterator->window_end;
+        partition->ranged = iterator->ranged;
+        partition->min_object_id = iterator->min_object_id;
+        partition->max_object_id = iterator->max_object_id;
+        rc = sky_path_iterator_set_snapshot(partition, snapshots[i]);
+        check(rc == 0, "Unable to set partition snapshot");
+    }
+
+    rc = sky_path_iterator_fast_forward_partitions(iterator);
+    check(rc == 0, "Unable to find next available path");
+
+    return 0;
+
+error:
+    sky_path_iterator_release_partitions(iterator);
+    return -1;
+}
+
+// Restricts the iterator to blocks and extents that overlap a time window.
+// The iterator is moved back to the first path.
+//
+// iterator - The iterator.
+// start    - The first timestamp in the window.
+// end      - The timestamp just after the window.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_set_window(sky_path_iterator *iterator,
+                                 sky_timestamp_t start, sky_timestamp_t end)
+{
+    int rc;
+    uint32_t i;
+    check(iterator != NULL, "Iterator required");
+
+    iterator->windowed = true;
+    iterator->window_start = start;
+    iterator->window_end = end;
+
+    if(iterator->partitions != NULL) {
+        for(i=0; i<iterator->partition_count; i++) {
+            rc = sky_path_iterator_set_window(&iterator->partitions[i], start, end);
+            check(rc == 0, "Unable to set partition time window");
+        }
+        rc = sky_path_iterator_fast_forward_partitions(iterator);
+        check(rc == 0, "Unable to find next available path");
+    }
+    else if(iterator->data_file != NULL) {
+        rc = sky_path_iterator_reset(iterator);
+        check(rc == 0, "Unable to reset iterator");
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Restricts the iterator to the paths of objects in a range of object ids.
+// The iterator is moved back to the first path in the range.
+//
+// iterator      - The iterator.
+// min_object_id - The first object id in the range.
+// max_object_id - The last object id in the range.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_set_range(sky_path_iterator *iterator,
+                                sky_object_id_t min_object_id,
+                                sky_object_id_t max_object_id)
+{
+    int rc;
+    uint32_t i;
+    check(iterator != NULL, "Iterator required");
+
+    iterator->ranged = true;
+    iterator->min_object_id = min_object_id;
+    iterator->max_object_id = max_object_id;
+
+    if(iterator->partitions != NULL) {
+        for(i=0; i<iterator->partition_count; i++) {
+            rc = sky_path_iterator_set_range(&iterator->partitions[i], min_object_id, max_object_id);
+            check(rc == 0, "Unable to set partition object id range");
+        }
+        rc = sky_path_iterator_fast_forward_partitions(iterator);
+        check(rc == 0, "Unable to find next available path");
+    }
+    else if(iterator->data_file != NULL) {
+        rc = sky_path_iterator_reset(iterator);
+        check(rc == 0, "Unable to reset iterator");
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Checks if a timestamp range overlaps the iterator's time window.
+//
+// iterator      - The iterator.
+// min_timestamp - The earliest timestamp in the range.
+// max_timestamp - The latest timestamp in the range.
+//
+// Returns true if the range overlaps the window or there is no window.
+bool sky_path_iterator_in_window(sky_path_iterator *iterator,
+                                 sky_timestamp_t min_timestamp,
+                                 sky_timestamp_t max_timestamp)
+{
+    return !iterator->windowed || (max_timestamp >= iterator->window_start && min_timestamp < iterator->window_end);
+}
+
+// Checks if a whole block can be skipped because it doesn't overlap the
+// time window or only has objects before the object id range. Spanned blocks
+// are kept for the time window since the rest of the path is in the
+// following blocks.
+//
+// iterator - The iterator.
+// index    - The position of the block in the data file or snapshot.
+//
+// Returns true if the block can be skipped, otherwise returns false.
+bool sky_path_iterator_skip_block(sky_path_iterator *iterator,
+                                  uint32_t index)
+{
+    if(!iterator->windowed && !iterator->ranged) {
+        return false;
+    }
+
+    sky_timestamp_t min_timestamp, max_timestamp;
+    sky_object_id_t max_object_id;
+    bool spanned;
+    if(iterator->snapshot != NULL) {
+        sky_snapshot_block *snapshot_block = &iterator->snapshot->blocks[index];
+        min_timestamp = snapshot_block->min_timestamp;
+        max_timestamp = snapshot_block->max_timestamp;
+        max_object_id = snapshot_block->max_object_id;
+        spanned = snapshot_block->spanned;
+    }
+    else {
+        sky_block *block = iterator->data_file->blocks[index];
+        min_timestamp = block->min_timestamp;
+        max_timestamp = block->max_timestamp;
+        max_object_id = block->max_object_id;
+        spanned = block->spanned;
+    }
+
+    bool in_window = sky_path_iterator_in_window(iterator, min_timestamp, max_timestamp);
+    return (!spanned && !in_window) || (iterator->ranged && max_object_id < iterator->min_object_id);
+}
+
+// Asks the OS to read ahead the blocks from the current block up to the data
+// file's prefetch count. Blocks that will be skipped, blocks that were
+// already requested and blocks that a snapshot has copied aren't requested.
+// Blocks that are stored next to each other in the data file, which is the
+// usual case after compaction, are requested together.
+//
+// iterator - The iterator.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_prefetch(sky_path_iterator *iterator)
+{
+    int rc;
+    sky_data_file *data_file = iterator->data_file;
+    sky_snapshot *snapshot = iterator->snapshot;
+    uint32_t block_count = (snapshot != NULL ? snapshot->block_count : data_file->block_count);
+    uint32_t prefetch_count = (data_file->prefetch_count > 0 ? data_file->prefetch_count : SKY_DATA_FILE_DEFAULT_PREFETCH_COUNT);
+    uint32_t end = iterator->block_index + prefetch_count;
+    if(end > block_count) {
+        end = block_count;
+    }
+
+    if(iterator->prefetch_index < iterator->block_index) {
+        iterator->prefetch_index = iterator->block_index;
+    }
+
+    // Collect runs of adjacent blocks and request each run at once.
+    sky_block *run = NULL;
+    uint32_t run_count = 0;
+    for(; iterator->prefetch_index < end; iterator->prefetch_index++) {
+        uint32_t index = iterator->prefetch_index;
+        if(sky_path_iterator_skip_block(iterator, index)) {
+            continue;
+        }
+        if(snapshot != NULL && snapshot->blocks[index].data != NULL) {
+            continue;
+        }
+        sky_block *block = (snapshot != NULL ? snapshot->blocks[index].block : data_file->blocks[index]);
+        if(run != NULL && block->index == run->index + run_count) {
+            run_count++;
+            continue;
+        }
+        if(run != NULL) {
+            rc = sky_block_prefetch(run, run_count);
+            check(rc == 0, "Unable to prefetch blocks");
+        }
+        run = block;
+        run_count = 1;
+    }
+    if(run != NULL) {
+        rc = sky_block_prefetch(run, run_count);
+        check(rc == 0, "Unable to prefetch blocks");
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Frees the child iterators and the merge buffers of an iterator. This is
+// called whenever another source is set.
+//
+// iterator - The iterator.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_release_partitions(sky_path_iterator *iterator)
+{
+    uint32_t i;
+    for(i=0; i<iterator->partition_count; i++) {
+        sky_path_iterator_release_partitions(&iterator->partitions[i]);
+        sky_cursor_set_path(&iterator->cursors[i], NULL);
+    }
+    free(iterator->partitions);
+    iterator->partitions = NULL;
+    iterator->partition_count = 0;
+    free(iterator->cursors);
+    iterator->cursors = NULL;
+    free(iterator->buffer);
+    iterator->buffer = NULL;
+    iterator->buffer_capacity = 0;
+    free(iterator->span_ptrs);
+    iterator->span_ptrs = NULL;
+    iterator->span_capacity = 0;
+    sky_memtable_release_buffer(&iterator->memtable_buffer);
+    return 0;
+}
+
+
 //--------------------------------------
 // Block Management
 //--------------------------------------
@@ -146,8 +546,13 @@ int sky_path_iterator_get_current_block(sky_path_iterator *iterator,
     check(iterator != NULL, "Iterator required");
     check(block != NULL, "Block return address required");
     
+    // If we are iterating over a snapshot then return the block that the
+    // snapshot recorded at the current position.
+    if(iterator->snapshot != NULL) {
+        *block = iterator->snapshot->blocks[iterator->block_index].block;
+    }
     // If we are iterating over a data file then return the current block.
-    if(iterator->data_file != NULL) {
+    else if(iterator->data_file != NULL) {
         *block = iterator->data_file->blocks[iterator->block_index];
     }
     // If we are iterating over a single block then just return that block.
@@ -162,15 +567,230 @@ error:
 }
 
 // Calculates the pointer address for a path that the iterator is currently
-// pointing to.
+// pointing to. Paths with events in the memtable are merged into the
+// iterator's memtable buffer.
 //
 // iterator - The iterator to calculate the address from.
+// ptr      - A pointer to where the address of the current path is returned.
 //
-// Returns a pointer to the address of the current path.
+// Returns 0 if successful, otherwise returns -1.
 int sky_path_iterator_get_ptr(sky_path_iterator *iterator, void **ptr)
 {
     int rc;
 
+    if(iterator->partitions != NULL) {
+        rc = sky_path_iterator_get_partitions_ptr(iterator, ptr);
+        check(rc == 0, "Unable to retrieve partition path");
+        return 0;
+    }
+
+    if(iterator->memtable_path) {
+        void **data_file_ptrs = NULL;
+        uint32_t data_file_ptr_count = 0;
+        if(!iterator->memtable_only) {
+            rc = sky_path_iterator_get_data_file_ptrs(iterator, &data_file_ptrs, &data_file_ptr_count);
+            check(rc == 0, "Unable to retrieve data file pointers");
+        }
+        rc = sky_memtable_get_path_ptr(iterator->memtable, &iterator->memtable_buffer, iterator->memtable_index, data_file_ptrs, data_file_ptr_count, ptr);
+        check(rc == 0, "Unable to retrieve memtable path");
+        return 0;
+    }
+
+    rc = sky_path_iterator_get_data_file_ptr(iterator, ptr);
+    check(rc == 0, "Unable to retrieve data file pointer");
+
+    // Load the next path's header while the caller reads this path.
+    if(iterator->extent == NULL) {
+        memprefetch(*ptr + sky_path_sizeof_raw(*ptr));
+    }
+    return 0;
+
+error:
+    *ptr = NULL;
+    return -1;
+}
+
+// Retrieves the pointers to every segment of the current path. Paths in
+// spanned blocks return one pointer per block in the span and empty segments
+// are left out. Paths with events in the memtable return the merged path,
+// which is split into several chunks if it is too large. All other paths
+// return a single pointer. The list is only valid until the next path is
+// retrieved.
+//
+// iterator - The iterator.
+// ptrs     - A pointer to where the list of path pointers is returned.
+// count    - A pointer to where the number of path pointers is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_get_ptrs(sky_path_iterator *iterator, void ***ptrs,
+                               uint32_t *count)
+{
+    int rc;
+    uint32_t i;
+    check(iterator != NULL, "Iterator required");
+    check(ptrs != NULL, "Path pointer list return address required");
+    check(count != NULL, "Path count return address required");
+
+    // A path that is only in one partition is returned from that partition
+    // so that its segments aren't merged.
+    if(iterator->partitions != NULL) {
+        sky_path_iterator *match = NULL;
+        uint32_t match_count = 0;
+        for(i=0; i<iterator->partition_count; i++) {
+            sky_path_iterator *partition = &iterator->partitions[i];
+            if(!partition->eof && partition->current_object_id == iterator->current_object_id) {
+                match = partition;
+                match_count++;
+            }
+        }
+        if(match_count == 1) {
+            return sky_path_iterator_get_ptrs(match, ptrs, count);
+        }
+
+        // Otherwise return the merged path as a list of one.
+        void *ptr;
+        rc = sky_path_iterator_get_partitions_ptr(iterator, &ptr);
+        check(rc == 0, "Unable to retrieve partition path");
+        rc = sky_path_iterator_reserve_spans(iterator, 1);
+        check(rc == 0, "Unable to reserve span list");
+        iterator->span_ptrs[0] = ptr;
+        *ptrs = iterator->span_ptrs;
+        *count = 1;
+        return 0;
+    }
+
+    // Memtable paths are merged with every segment in the data file.
+    if(iterator->memtable_path) {
+        void **data_file_ptrs = NULL;
+        uint32_t data_file_ptr_count = 0;
+        if(!iterator->memtable_only) {
+            rc = sky_path_iterator_get_data_file_ptrs(iterator, &data_file_ptrs, &data_file_ptr_count);
+            check(rc == 0, "Unable to retrieve data file pointers");
+        }
+        rc = sky_memtable_get_path_ptrs(iterator->memtable, &iterator->memtable_buffer, iterator->memtable_index, data_file_ptrs, data_file_ptr_count, ptrs, count);
+        check(rc == 0, "Unable to retrieve memtable path");
+        return 0;
+    }
+
+    rc = sky_path_iterator_get_data_file_ptrs(iterator, ptrs, count);
+    check(rc == 0, "Unable to retrieve data file pointers");
+
+    // Load the next path's header while the caller reads this path.
+    if(iterator->extent == NULL && *count == 1) {
+        memprefetch((*ptrs)[0] + sky_path_sizeof_raw((*ptrs)[0]));
+    }
+    return 0;
+
+error:
+    if(ptrs) *ptrs = NULL;
+    if(count) *count = 0;
+    return -1;
+}
+
+// Retrieves the pointers to every segment of the current path in the data
+// file. Paths in spanned blocks return one pointer per block in the span and
+// empty segments are left out. All other paths return a single pointer. The
+// list is owned by the iterator and is only valid until the next path is
+// retrieved.
+//
+// iterator - The iterator.
+// ptrs     - A pointer to where the list of path pointers is returned.
+// count    - A pointer to where the number of path pointers is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_get_data_file_ptrs(sky_path_iterator *iterator,
+                                         void ***ptrs, uint32_t *count)
+{
+    int rc;
+    uint32_t i;
+
+    // Determine the number of blocks the path spans.
+    uint32_t span_count = 1;
+    if(iterator->extent == NULL && iterator->data_file != NULL) {
+        if(iterator->snapshot != NULL) {
+            if(iterator->snapshot->blocks[iterator->block_index].spanned) {
+                rc = sky_snapshot_get_span_count(iterator->snapshot, iterator->block_index, &span_count);
+                check(rc == 0, "Unable to calculate span count");
+            }
+        }
+        else if(iterator->data_file->blocks[iterator->block_index]->spanned) {
+            sky_block **blocks = iterator->data_file->blocks;
+            sky_object_id_t object_id = blocks[iterator->block_index]->min_object_id;
+            while(iterator->block_index + span_count < iterator->data_file->block_count && blocks[iterator->block_index + span_count]->min_object_id == object_id) {
+                span_count++;
+            }
+        }
+    }
+
+    rc = sky_path_iterator_reserve_spans(iterator, span_count);
+    check(rc == 0, "Unable to reserve span list");
+
+    // Spanned blocks return each block's segment of the path.
+    if(span_count > 1) {
+        *count = 0;
+        for(i=0; i<span_count; i++) {
+            void *ptr;
+            if(iterator->snapshot != NULL) {
+                rc = sky_snapshot_get_block_ptr(iterator->snapshot, iterator->block_index + i, &ptr);
+                check(rc == 0, "Unable to retrieve snapshot block pointer");
+            }
+            else {
+                rc = sky_block_get_ptr(iterator->data_file->blocks[iterator->block_index + i], &ptr);
+                check(rc == 0, "Unable to retrieve block pointer");
+            }
+            if(sky_path_sizeof_raw(ptr) > SKY_PATH_HEADER_LENGTH) {
+                iterator->span_ptrs[(*count)++] = ptr;
+            }
+        }
+    }
+    // Otherwise return the path as a list of one.
+    else {
+        rc = sky_path_iterator_get_data_file_ptr(iterator, &iterator->span_ptrs[0]);
+        check(rc == 0, "Unable to retrieve data file pointer");
+        *count = 1;
+    }
+
+    *ptrs = iterator->span_ptrs;
+    return 0;
+
+error:
+    *ptrs = NULL;
+    *count = 0;
+    return -1;
+}
+
+// Calculates the pointer address of the current path in the data file.
+//
+// iterator - The iterator to calculate the address from.
+// ptr      - A pointer to where the address of the current path is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_get_data_file_ptr(sky_path_iterator *iterator,
+                                        void **ptr)
+{
+    int rc;
+
+    // If the current path is stored in an extent then return its pointer.
+    if(iterator->extent != NULL) {
+        if(iterator->snapshot != NULL) {
+            rc = sky_snapshot_get_extent_ptr(iterator->snapshot, iterator->extent_index, ptr);
+            check(rc == 0, "Unable to retrieve snapshot extent pointer");
+        }
+        else {
+            rc = sky_extent_get_ptr(iterator->extent, ptr);
+            check(rc == 0, "Unable to retrieve extent pointer");
+        }
+        return 0;
+    }
+
+    // Snapshots keep their own version of each block.
+    if(iterator->snapshot != NULL) {
+        rc = sky_snapshot_get_block_ptr(iterator->snapshot, iterator->block_index, ptr);
+        check(rc == 0, "Unable to retrieve snapshot block pointer");
+        *ptr += iterator->byte_index;
+        return 0;
+    }
+
     // Retrieve the current block.
     sky_block *block;
     rc = sky_path_iterator_get_current_block(iterator, &block);
@@ -201,26 +821,82 @@ error:
 //
 // Returns 0 if successful, otherwise returns -1.
 int sky_path_iterator_next(sky_path_iterator *iterator)
+{
+    int rc;
+    rc = sky_path_iterator_move(iterator);
+    check(rc == 0, "Unable to move to next path");
+    rc = sky_path_iterator_apply_range(iterator);
+    check(rc == 0, "Unable to find next path in range");
+    return 0;
+
+error:
+    return -1;
+}
+
+// Moves the iterator to the next path whether or not it is in the object id
+// range.
+// 
+// iterator - The iterator.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_move(sky_path_iterator *iterator)
 {
     int rc;
     check(iterator != NULL, "Iterator required");
-    check(iterator->data_file != NULL || iterator->block != NULL, "Iterator must have a source");
     check(!iterator->eof, "Iterator is at end-of-file");
 
+    if(iterator->partitions != NULL) {
+        rc = sky_path_iterator_next_partitions(iterator);
+        check(rc == 0, "Unable to move to next partition path");
+        return 0;
+    }
+
+    check(iterator->data_file != NULL || iterator->block != NULL, "Iterator must have a source");
+
     // Retrieve some data file info.
     sky_data_file *data_file = (iterator->data_file ? iterator->data_file : iterator->block->data_file);
+
+    // If the current path is only in the memtable then move to the next
+    // memtable path. Merged paths move both the memtable and the data file.
+    if(iterator->memtable_path) {
+        iterator->memtable_index++;
+        if(iterator->memtable_only) {
+            rc = sky_path_iterator_fast_forward(iterator);
+            check(rc == 0, "Unable to find next available path");
+            return 0;
+        }
+    }
+
+    // If the current path is in an extent then move to the next extent. The
+    // block position is left where it is.
+    if(iterator->extent != NULL) {
+        iterator->extent_index++;
+        iterator->extent = NULL;
+        rc = sky_path_iterator_fast_forward(iterator);
+        check(rc == 0, "Unable to find next available path");
+        return 0;
+    }
     
     // Retrieve current block.
     sky_block *block;
     rc = sky_path_iterator_get_current_block(iterator, &block);
     check(rc == 0, "Unable to retrieve current block");
+    bool spanned = block->spanned;
+    if(iterator->snapshot != NULL) {
+        spanned = iterator->snapshot->blocks[iterator->block_index].spanned;
+    }
 
     // If we are searching the data file and the current block is spanned then
     // move to the next block after the span.
-    if(iterator->data_file && block->spanned) {
+    if(iterator->data_file && spanned) {
         // Retrieve span count.
         uint32_t span_count;
-        rc = sky_block_get_span_count(block, &span_count);
+        if(iterator->snapshot != NULL) {
+            rc = sky_snapshot_get_span_count(iterator->snapshot, iterator->block_index, &span_count);
+        }
+        else {
+            rc = sky_block_get_span_count(block, &span_count);
+        }
         check(rc == 0, "Unable to calculate span count");
         
         // Move to the first block after the span.
@@ -231,7 +907,7 @@ int sky_path_iterator_next(sky_path_iterator *iterator)
     else {
         // Find current pointer.
         void *ptr;
-        rc = sky_path_iterator_get_ptr(iterator, &ptr);
+        rc = sky_path_iterator_get_data_file_ptr(iterator, &ptr);
         check(rc == 0, "Unable to retrieve the current pointer");
 
         // Read path size and move past it.
@@ -275,25 +951,57 @@ int sky_path_iterator_fast_forward(sky_path_iterator *iterator)
     check(iterator, "Iterator required");
     
     sky_data_file *data_file = iterator->data_file;
+    iterator->extent = NULL;
+    iterator->memtable_path = false;
+    iterator->memtable_only = false;
     
-    // Keep searching for data or the EOF until we find it.
+    // Keep searching for data or the end of the blocks until we find it.
+    bool blocks_eof = false;
     while(true) {
-        // If the block index is out of range then mark as EOF and exit.
-        uint32_t max_block_index = (data_file != NULL ? data_file->block_count-1 : 0);
-        if(iterator->block_index > max_block_index) {
-            iterator->block_index = 0;
-            iterator->byte_index  = 0;
-            iterator->eof = true;
+        // If the block index is out of range then there are no more paths in
+        // the blocks. A data file can have no blocks if all of its events are
+        // still in the memtable.
+        uint32_t block_count = (data_file != NULL ? data_file->block_count : 1);
+        if(iterator->snapshot != NULL) {
+            block_count = iterator->snapshot->block_count;
+        }
+        if(iterator->block_index >= block_count) {
+            blocks_eof = true;
             break;
         }
+
+        // Skip whole blocks outside of the time window or object id range
+        // and start reading ahead once a block is going to be scanned.
+        if(data_file != NULL && iterator->byte_index == 0) {
+            if(sky_path_iterator_skip_block(iterator, iterator->block_index)) {
+                iterator->block_index++;
+                continue;
+            }
+            rc = sky_path_iterator_prefetch(iterator);
+            check(rc == 0, "Unable to prefetch blocks");
+        }
         
         // If there is null data then move to the next block.
         void *ptr;
-        rc = sky_path_iterator_get_ptr(iterator, &ptr);
+        rc = sky_path_iterator_get_data_file_ptr(iterator, &ptr);
         check(rc == 0, "Unable to retrieve the current pointer");
         
-        // If there is null data then move to the next block.
-        if(*((uint8_t*)ptr) == 0) {
+        // If there is null data or no room left for a path header then move
+        // to the next block. The whole object id must be checked since ids
+        // can have zero bytes. Blocks with a directory only store paths up
+        // to the start of the directory.
+        size_t capacity;
+        if(iterator->snapshot != NULL) {
+            rc = sky_snapshot_get_block_capacity(iterator->snapshot, iterator->block_index, &capacity);
+        }
+        else {
+            sky_block *block;
+            rc = sky_path_iterator_get_current_block(iterator, &block);
+            check(rc == 0, "Unable to retrieve current block");
+            rc = sky_block_get_capacity(block, &capacity);
+        }
+        check(rc == 0, "Unable to determine block capacity");
+        if(iterator->byte_index + SKY_PATH_HEADER_LENGTH > capacity || *((sky_object_id_t*)ptr) == 0) {
             iterator->block_index++;
             iterator->byte_index = 0;
         }
@@ -304,9 +1012,288 @@ int sky_path_iterator_fast_forward(sky_path_iterator *iterator)
             break;
         }
     }
+
+    // Use the next extent instead if its object id comes first.
+    uint32_t extent_count = (data_file != NULL ? data_file->extent_count : 0);
+    if(iterator->snapshot != NULL) {
+        extent_count = iterator->snapshot->extent_count;
+    }
+    while(iterator->extent_index < extent_count) {
+        sky_extent *extent = (iterator->snapshot != NULL ? iterator->snapshot->extents[iterator->extent_index].extent : data_file->extents[iterator->extent_index]);
+        bool in_range = (!iterator->ranged || extent->object_id >= iterator->min_object_id);
+        if(in_range && sky_path_iterator_in_window(iterator, extent->min_timestamp, extent->max_timestamp)) {
+            break;
+        }
+        iterator->extent_index++;
+    }
+    if(iterator->extent_index < extent_count) {
+        sky_extent *extent = (iterator->snapshot != NULL ? iterator->snapshot->extents[iterator->extent_index].extent : data_file->extents[iterator->extent_index]);
+        if(blocks_eof || extent->object_id < iterator->current_object_id) {
+            iterator->extent = extent;
+            iterator->current_object_id = extent->object_id;
+        }
+    }
+
+    // Use the next memtable path if its object id comes first. If the object
+    // also has a path in the data file then the two are merged.
+    bool data_file_eof = (blocks_eof && iterator->extent == NULL);
+    sky_memtable *memtable = iterator->memtable;
+    if(memtable != NULL && iterator->ranged) {
+        while(iterator->memtable_index < memtable->path_count && memtable->paths[iterator->memtable_index].object_id < iterator->min_object_id) {
+            iterator->memtable_index++;
+        }
+    }
+    if(memtable != NULL && iterator->memtable_index < memtable->path_count) {
+        sky_object_id_t object_id = memtable->paths[iterator->memtable_index].object_id;
+        if(data_file_eof || object_id < iterator->current_object_id) {
+            iterator->memtable_path = true;
+            iterator->memtable_only = true;
+            iterator->current_object_id = object_id;
+        }
+        else if(object_id == iterator->current_object_id) {
+            iterator->memtable_path = true;
+        }
+    }
+
+    // Mark as EOF once there are no more blocks, extents or memtable paths.
+    if(data_file_eof && !iterator->memtable_path) {
+        iterator->block_index = 0;
+        iterator->byte_index  = 0;
+        iterator->eof = true;
+    }
     
     return 0;
     
 error:
     return -1;
 }
+
+
+// Moves the iterator past any paths before the object id range and marks it
+// as EOF once it moves past the end of the range.
+//
+// iterator - The iterator.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_apply_range(sky_path_iterator *iterator)
+{
+    int rc;
+    if(!iterator->ranged) {
+        return 0;
+    }
+
+    while(!iterator->eof) {
+        if(iterator->current_object_id > iterator->max_object_id) {
+            iterator->eof = true;
+        }
+        else if(iterator->current_object_id < iterator->min_object_id) {
+            rc = sky_path_iterator_move(iterator);
+            check(rc == 0, "Unable to move to next path");
+        }
+        else {
+            break;
+        }
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+
+//--------------------------------------
+// Partitions
+//--------------------------------------
+
+// Retrieves the current object's path across all partitions. The paths are
+// merged by timestamp into the iterator's buffer if more than one partition
+// has a path for the object.
+//
+// iterator - The iterator.
+// ptr      - A pointer to where the address of the current path is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_get_partitions_ptr(sky_path_iterator *iterator,
+                                         void **ptr)
+{
+    int rc;
+    uint32_t i;
+    check(!iterator->eof, "Iterator is at end-of-file");
+
+    // Position a cursor on each partition's path for the object.
+    // The cursors keep their path lists between paths.
+    uint32_t count = 0;
+    sky_path_iterator *match = NULL;
+    for(i=0; i<iterator->partition_count; i++) {
+        sky_path_iterator *partition = &iterator->partitions[i];
+        sky_cursor *cursor = &iterator->cursors[i];
+        cursor->eof = true;
+        if(!partition->eof && partition->current_object_id == iterator->current_object_id) {
+            match = partition;
+            count++;
+        }
+    }
+
+    // Return the path as-is if only one partition has it.
+    if(count == 1) {
+        rc = sky_path_iterator_get_ptr(match, ptr);
+        check(rc == 0, "Unable to retrieve partition path");
+        return 0;
+    }
+
+    // Position a cursor on every segment of each partition's path.
+    for(i=0; i<iterator->partition_count; i++) {
+        sky_path_iterator *partition = &iterator->partitions[i];
+        if(!partition->eof && partition->current_object_id == iterator->current_object_id) {
+            void **partition_ptrs;
+            uint32_t partition_ptr_count;
+            rc = sky_path_iterator_get_ptrs(partition, &partition_ptrs, &partition_ptr_count);
+            check(rc == 0, "Unable to retrieve partition path");
+            rc = sky_cursor_set_paths(&iterator->cursors[i], partition_ptrs, partition_ptr_count);
+            check(rc == 0, "Unable to set cursor paths");
+        }
+    }
+
+    // Merge the events by timestamp.
+    size_t length = SKY_PATH_HEADER_LENGTH;
+    while(true) {
+        sky_cursor *next = NULL;
+        sky_timestamp_t next_timestamp = 0;
+        for(i=0; i<iterator->partition_count; i++) {
+            sky_cursor *cursor = &iterator->cursors[i];
+            if(!cursor->eof) {
+                sky_timestamp_t timestamp;
+                rc = sky_cursor_get_timestamp(cursor, &timestamp);
+                check(rc == 0, "Unable to retrieve timestamp");
+                if(next == NULL || timestamp < next_timestamp) {
+                    next = cursor;
+                    next_timestamp = timestamp;
+                }
+            }
+        }
+        if(next == NULL) {
+            break;
+        }
+
+        void *data_ptr;
+        uint32_t data_length;
+        rc = sky_cursor_get_data_ptr(next, &data_ptr, &data_length);
+        check(rc == 0, "Unable to retrieve event data");
+        rc = sky_path_iterator_reserve_buffer(iterator, length + SKY_CURSOR_MAX_EVENT_HEADER_LENGTH + data_length);
+        check(rc == 0, "Unable to reserve iterator buffer");
+
+        size_t sz;
+        rc = sky_cursor_pack_event(next, iterator->buffer + length, &sz);
+        check(rc == 0, "Unable to pack event");
+        length += sz;
+
+        rc = sky_cursor_next(next);
+        check(rc == 0, "Unable to move to next event");
+    }
+
+    // Write the path header.
+    rc = sky_path_iterator_reserve_buffer(iterator, length);
+    check(rc == 0, "Unable to reserve iterator buffer");
+    check(length - SKY_PATH_HEADER_LENGTH <= SKY_PATH_LENGTH_MASK, "Merged path too large");
+    *((sky_object_id_t*)iterator->buffer) = iterator->current_object_id;
+    *((sky_path_event_data_length_t*)(iterator->buffer + sizeof(sky_object_id_t))) = (sky_path_event_data_length_t)(length - SKY_PATH_HEADER_LENGTH);
+
+    *ptr = iterator->buffer;
+    return 0;
+
+error:
+    *ptr = NULL;
+    return -1;
+}
+
+// Moves every partition that is on the current object to its next path.
+//
+// iterator - The iterator.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_next_partitions(sky_path_iterator *iterator)
+{
+    int rc;
+    uint32_t i;
+    for(i=0; i<iterator->partition_count; i++) {
+        sky_path_iterator *partition = &iterator->partitions[i];
+        if(!partition->eof && partition->current_object_id == iterator->current_object_id) {
+            rc = sky_path_iterator_next(partition);
+            check(rc == 0, "Unable to move partition to next path");
+        }
+    }
+
+    rc = sky_path_iterator_fast_forward_partitions(iterator);
+    check(rc == 0, "Unable to find next available path");
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Moves the iterator to the lowest object id of all the partitions or marks
+// it as EOF once every partition is at the end.
+//
+// iterator - The iterator.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_fast_forward_partitions(sky_path_iterator *iterator)
+{
+    uint32_t i;
+    iterator->eof = true;
+    for(i=0; i<iterator->partition_count; i++) {
+        sky_path_iterator *partition = &iterator->partitions[i];
+        if(!partition->eof && (iterator->eof || partition->current_object_id < iterator->current_object_id)) {
+            iterator->current_object_id = partition->current_object_id;
+            iterator->eof = false;
+        }
+    }
+    return 0;
+}
+
+// Grows the merge buffer to hold at least a given number of bytes.
+//
+// iterator - The iterator.
+// length   - The number of bytes needed.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_reserve_buffer(sky_path_iterator *iterator,
+                                     size_t length)
+{
+    if(length > iterator->buffer_capacity) {
+        size_t capacity = (iterator->buffer_capacity > 0 ? iterator->buffer_capacity : 4096);
+        while(length > capacity) {
+            capacity *= 2;
+        }
+        void *buffer = realloc(iterator->buffer, capacity); check_mem(buffer);
+        iterator->buffer = buffer;
+        iterator->buffer_capacity = capacity;
+    }
+    return 0;
+
+error:
+    return -1;
+}
+
+// Grows the span list to hold at least a given number of path pointers.
+//
+// iterator - The iterator.
+// count    - The number of path pointers needed.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_path_iterator_reserve_spans(sky_path_iterator *iterator,
+                                    uint32_t count)
+{
+    if(count > iterator->span_capacity) {
+        void **span_ptrs = realloc(iterator->span_ptrs, count * sizeof(*span_ptrs));
+        check_mem(span_ptrs);
+        iterator->span_ptrs = span_ptrs;
+        iterator->span_capacity = count;
+    }
+    return 0;
+
+error:
+    return -1;
+}
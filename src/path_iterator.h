@@ -6,6 +6,8 @@
 
 #include "bstring.h"
 #include "data_file.h"
+#include "memtable.h"
+#include "snapshot.h"
 #include "cursor.h"
 
 
@@ -21,13 +23,60 @@
 // is returned instead of a reference to a deserialized path. The cursor can be
 // used to iterate over the raw path data.
 //
+// When iterating over a data file, paths that are stored in extents are
+// returned in object id order along with the paths stored in blocks.
+//
+// A memtable can also be attached when iterating over a data file. Objects
+// that have events in the memtable are returned as a single path that merges
+// the memtable events into every segment of the object's path in the data
+// file. The merged paths are built in a buffer owned by the iterator. The
+// memtable must not be changed until the iteration is complete.
+//
 // The path iterator operates as a forward-only iterator. Jumping to the
 // previous path or jumping to a path by index is not allowed.
 //
-// The path iterator does not currently support full consistency if events are
-// added or removed after the iterator has been created and before the iteration
-// is complete. The biggest issue is that a block split can cause paths to not
-// be counted. This will be fixed in a future version.
+// Iterating over a data file directly is not consistent if events are added
+// after the iterator has been created and before the iteration is complete.
+// The biggest issue is that a block split can cause paths to not be counted.
+// Iterating over a snapshot of the data file instead returns the paths as
+// they were when the snapshot was opened, including the snapshot's copy of
+// the memtable. Reading a snapshot doesn't change it so several iterators on
+// different threads can share one.
+//
+// A partitioned table is iterated by setting a snapshot of each partition as
+// the source. The iterator keeps a child iterator for each snapshot and
+// returns one path per object in object id order. If only one partition has
+// a path for the object then that path is returned as-is. Otherwise the
+// paths are merged by timestamp into a buffer owned by the iterator. Events
+// with the same timestamp are returned in the order of the snapshots. The
+// child iterators and the buffer are freed when another source is set.
+//
+// A time window can be set so that blocks and extents whose timestamp range
+// doesn't overlap the window are skipped without being read. Spanned blocks
+// and memtable paths are still returned so cursors over the paths should be
+// restricted to the same window.
+//
+// An object id range can also be set so that only paths for objects in the
+// range are returned. Blocks and extents before the range are skipped using
+// their object ids and the iterator stops at the first object after the
+// range. Ranges are used to split a scan into pieces that can be run
+// separately since a path is never split between two ranges.
+//
+// A path that is too large for one block is split across consecutive spanned
+// blocks and `sky_path_iterator_get_ptr()` only returns the first segment.
+// `sky_path_iterator_get_ptrs()` returns every segment of the current path in
+// a list owned by the iterator so that the segments can be passed to a
+// cursor. Paths with events in the memtable are merged with every segment
+// and are returned as chunks when the merged path is too large for one path.
+// The list is reused for each path and is freed along with the child
+// iterators when another source is set.
+//
+// Each time the iterator moves into a block it asks the OS to read ahead
+// the data file's prefetch count of blocks in scan order, skipping blocks
+// that the window or range will skip. Blocks that are next to each other in
+// the data file are requested with a single call. The header of the next
+// path is also loaded into the CPU cache while the caller works on the
+// current path.
 
 
 //==============================================================================
@@ -44,6 +93,28 @@ typedef struct sky_path_iterator {
     bool eof;
     sky_object_id_t current_object_id;
     size_t block_data_length;
+    uint32_t extent_index;
+    sky_extent *extent;
+    sky_memtable *memtable;
+    sky_memtable_buffer memtable_buffer;
+    uint32_t memtable_index;
+    bool memtable_path;
+    bool memtable_only;
+    sky_snapshot *snapshot;
+    struct sky_path_iterator *partitions;
+    uint32_t partition_count;
+    sky_cursor *cursors;
+    void *buffer;
+    size_t buffer_capacity;
+    bool windowed;
+    sky_timestamp_t window_start;
+    sky_timestamp_t window_end;
+    bool ranged;
+    sky_object_id_t min_object_id;
+    sky_object_id_t max_object_id;
+    uint32_t prefetch_index;
+    void **span_ptrs;
+    uint32_t span_capacity;
 } sky_path_iterator;
 
 
@@ -76,6 +147,21 @@ int sky_path_iterator_set_data_file(sky_path_iterator *iterator,
 int sky_path_iterator_set_block(sky_path_iterator *iterator,
     sky_block *block);
 
+int sky_path_iterator_set_memtable(sky_path_iterator *iterator,
+    sky_memtable *memtable);
+
+int sky_path_iterator_set_snapshot(sky_path_iterator *iterator,
+    sky_snapshot *snapshot);
+
+int sky_path_iterator_set_partitions(sky_path_iterator *iterator,
+    sky_snapshot **snapshots, uint32_t count);
+
+int sky_path_iterator_set_window(sky_path_iterator *iterator,
+    sky_timestamp_t start, sky_timestamp_t end);
+
+int sky_path_iterator_set_range(sky_path_iterator *iterator,
+    sky_object_id_t min_object_id, sky_object_id_t max_object_id);
+
 
 //--------------------------------------
 // Iteration
@@ -83,6 +169,9 @@ int sky_path_iterator_set_block(sky_path_iterator *iterator,
 
 int sky_path_iterator_get_ptr(sky_path_iterator *iterator, void **ptr);
 
+int sky_path_iterator_get_ptrs(sky_path_iterator *iterator, void ***ptrs,
+    uint32_t *count);
+
 int sky_path_iterator_next(sky_path_iterator *iterator);
 
 
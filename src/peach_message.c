@@ -1,8 +1,14 @@
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <arpa/inet.h>
 
 #include "peach_message.h"
+#include "path_iterator.h"
+#include "query_cache.h"
+#include "block.h"
 #include "minipack.h"
+#include "timestamp.h"
 #include "mem.h"
 #include "dbg.h"
 
@@ -20,6 +26,34 @@
 typedef void (*sky_qip_path_map_func)(sky_qip_path *path, qip_map *map);
 typedef void (*sky_qip_result_serialize_func)(void *result, qip_serializer *serializer);
 
+#define SKY_PEACH_RANGES_PER_WORKER 16
+
+
+//==============================================================================
+//
+// Forward Declarations
+//
+//==============================================================================
+
+void sky_peach_message_free_workers(sky_peach_worker *workers,
+    uint32_t worker_count, sky_snapshot **snapshots, uint32_t snapshot_count);
+
+int sky_peach_message_split_ranges(sky_data_file **data_files, uint32_t count,
+    uint32_t max_count, sky_object_id_t **ret, uint32_t *ret_count);
+
+bool sky_peach_message_has_compressed_blocks(sky_peach_message *message,
+    sky_data_file **data_files, uint32_t count);
+
+int sky_peach_message_run_workers(sky_peach_message *message,
+    sky_peach_worker *workers, uint32_t worker_count,
+    sky_peach_schedule *schedule);
+
+void *sky_peach_message_run_worker(void *worker);
+
+int sky_peach_message_scan(sky_peach_worker *worker);
+
+int sky_peach_message_take_range(sky_peach_worker *worker, uint32_t *index);
+
 
 //==============================================================================
 //
@@ -38,6 +72,8 @@ sky_peach_message *sky_peach_message_create()
 {
     sky_peach_message *message = NULL;
     message = calloc(1, sizeof(sky_peach_message)); check_mem(message);
+    message->opt_level = -1;
+    message->yield_interval = SKY_PEACH_DEFAULT_YIELD_INTERVAL;
     return message;
 
 error:
@@ -68,12 +104,21 @@ void sky_peach_message_free(sky_peach_message *message)
 size_t sky_peach_message_sizeof(sky_peach_message *message)
 {
     size_t sz = 0;
+    if(message->windowed) {
+        sz += minipack_sizeof_int(message->window_start);
+        sz += minipack_sizeof_int(message->window_end);
+    }
+    if(message->opt_level >= 0) {
+        sz += minipack_sizeof_int(message->opt_level);
+    }
     sz += minipack_sizeof_raw(blength(message->query));
     sz += blength(message->query);
     return sz;
 }
 
-// Serializes an PEACH message to a memory location.
+// Serializes an PEACH message to a memory location. The start and end of the
+// time window are written before the query if the message has one, followed
+// by the optimization level if the message sets one.
 //
 // message - The message.
 // file    - The file stream to write to.
@@ -82,9 +127,24 @@ size_t sky_peach_message_sizeof(sky_peach_message *message)
 int sky_peach_message_pack(sky_peach_message *message, FILE *file)
 {
     int rc;
+    size_t sz;
     check(message != NULL, "Message required");
     check(file != NULL, "File stream required");
 
+    // Time window
+    if(message->windowed) {
+        rc = minipack_fwrite_int(file, message->window_start, &sz);
+        check(rc == 0, "Unable to write window start");
+        rc = minipack_fwrite_int(file, message->window_end, &sz);
+        check(rc == 0, "Unable to write window end");
+    }
+
+    // Optimization level
+    if(message->opt_level >= 0) {
+        rc = minipack_fwrite_int(file, message->opt_level, &sz);
+        check(rc == 0, "Unable to write optimization level");
+    }
+
     // Database name
     rc = sky_minipack_fwrite_bstring(file, message->query);
     check(rc == 0, "Unable to write query text");
@@ -104,9 +164,41 @@ error:
 int sky_peach_message_unpack(sky_peach_message *message, FILE *file)
 {
     int rc;
+    size_t sz;
     check(message != NULL, "Message required");
     check(file != NULL, "File stream required");
 
+    // Read the optional integers before the query string. Two integers are
+    // a time window, one is an optimization level and three are both.
+    int64_t values[3];
+    uint32_t count = 0;
+    while(true) {
+        int c = fgetc(file);
+        check(c != EOF, "Unable to read PEACH message");
+        check(ungetc(c, file) != EOF, "Unable to read PEACH message");
+        uint8_t type = (uint8_t)c;
+        if(minipack_is_raw(&type)) {
+            break;
+        }
+        check(count < 3, "Too many PEACH message options");
+        values[count++] = minipack_fread_int(file, &sz);
+        check(sz != 0, "Unable to read PEACH message option");
+    }
+
+    // Time window.
+    message->windowed = (count >= 2);
+    if(message->windowed) {
+        message->window_start = values[0];
+        message->window_end = values[1];
+    }
+
+    // Optimization level.
+    message->opt_level = -1;
+    if(count == 1 || count == 3) {
+        message->opt_level = (int32_t)values[count-1];
+        check(message->opt_level <= QIP_OPT_LEVEL_MAX, "Invalid optimization level: %d", message->opt_level);
+    }
+
     // Query
     rc = sky_minipack_fread_bstring(file, &message->query);
     check(rc == 0, "Unable to read query text");
@@ -122,7 +214,10 @@ error:
 // Processing
 //--------------------------------------
 
-// Runs a PEACH query against a table.
+// Runs a PEACH query against a table. The table is split into ranges of
+// object ids that are scanned by several workers in parallel if the query's
+// Result class has a merge() method to combine the results of two workers.
+// The message's yield function is called at the query's yield points.
 //
 // message - The message.
 // table   - The table to run the query against.
@@ -133,69 +228,488 @@ int sky_peach_message_process(sky_peach_message *message, sky_table *table,
                               FILE *output)
 {
     int rc;
+    uint32_t i;
+    sky_data_file **data_files = NULL;
+    uint32_t data_file_count = 0;
+    sky_snapshot **snapshots = NULL;
+    uint32_t snapshot_count = 0;
+    sky_peach_worker *workers = NULL;
+    uint32_t worker_count = 0;
+    sky_peach_schedule schedule;
+    memset(&schedule, 0, sizeof(schedule));
+    pthread_mutex_init(&schedule.mutex, NULL);
+    pthread_cond_init(&schedule.stopped, NULL);
+    pthread_cond_init(&schedule.resumed, NULL);
+    qip_serializer *serializer = NULL;
+    sky_qip_module *module = NULL;
+    bool cached = false;
     check(message != NULL, "Message required");
     check(table != NULL, "Table required");
     check(output != NULL, "Output stream required");
 
-    // Compile.
-    sky_qip_module *module = sky_qip_module_create(); check_mem(module);
-    module->table = table;
-    rc = sky_qip_module_compile(module, message->query);
-    check(rc == 0, "Unable to compile query");
-    sky_qip_path_map_func main_function = (sky_qip_path_map_func)module->main_function;
+    // Compile or reuse a module from the table's query cache.
+    if(table->query_cache != NULL) {
+        rc = sky_query_cache_get_module(table->query_cache, message->query, message->opt_level, &module, &cached);
+        check(rc == 0, "Unable to retrieve cached query");
+    }
+    else {
+        module = sky_qip_module_create(); check_mem(module);
+        module->table = table;
+        if(message->opt_level >= 0) {
+            module->compiler->opt_level = message->opt_level;
+        }
+        rc = sky_qip_module_compile(module, message->query);
+        check(rc == 0, "Unable to compile query");
+    }
 
-    // Initialize the path iterator.
-    sky_path_iterator iterator;
-    sky_path_iterator_init(&iterator);
-    rc = sky_path_iterator_set_data_file(&iterator, table->data_file);
-    check(rc == 0, "Unable to initialze path iterator");
+    // Find the partitions to scan. Only partitions that overlap the time
+    // window are loaded. The memtable is merged in through the table's main
+    // data file, which comes last.
+    if(table->partition_duration > 0) {
+        sky_timestamp_t min_timestamp = (message->windowed ? message->window_start : INT64_MIN);
+        sky_timestamp_t max_timestamp = (message->windowed ? message->window_end - 1 : INT64_MAX);
+        if(min_timestamp <= max_timestamp) {
+            rc = sky_table_get_partitions(table, min_timestamp, max_timestamp, &data_files, &data_file_count);
+            check(rc == 0, "Unable to retrieve partitions");
+        }
+    }
+    sky_data_file **new_data_files = realloc(data_files, (data_file_count + 1) * sizeof(*data_files));
+    check_mem(new_data_files);
+    data_files = new_data_files;
+    data_files[data_file_count++] = table->data_file;
+
+    // Use one worker per CPU unless the table sets a worker count. Results
+    // can only be combined if Result has a merge() method and compressed
+    // blocks share a cache that can only be read by one thread.
+    struct tagbstring result_str = bsStatic("Result");
+    struct tagbstring merge_str = bsStatic("merge");
+    worker_count = table->query_worker_count;
+    if(worker_count == 0) {
+        long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+        worker_count = (cpu_count > 0 ? (uint32_t)cpu_count : 1);
+    }
+    if(worker_count > 1 && !qip_module_has_class_method(module->_qip_module, &result_str, &merge_str)) {
+        worker_count = 1;
+    }
+    if(worker_count > 1 && sky_peach_message_has_compressed_blocks(message, data_files, data_file_count)) {
+        worker_count = 1;
+    }
 
-    // Initialize QIP args.
-    sky_qip_path *path = sky_qip_path_create();
-    qip_map *map = qip_map_create();
-    
-    // Iterate over each path.
-    uint32_t path_count = 0;
-    while(!iterator.eof) {
-        // Retrieve the path pointer.
-        rc = sky_path_iterator_get_ptr(&iterator, &path->path_ptr);
-        check(rc == 0, "Unable to retrieve the path iterator pointer");
-    
-        // Execute query.
-        main_function(path, map);
+    // Split the object ids into more ranges than there are workers so that
+    // workers that finish early can take some of the remaining work.
+    rc = sky_peach_message_split_ranges(data_files, data_file_count, worker_count * SKY_PEACH_RANGES_PER_WORKER, &schedule.boundaries, &schedule.range_count);
+    check(rc == 0, "Unable to split query into ranges");
+    if(worker_count > schedule.range_count) {
+        worker_count = schedule.range_count;
+    }
 
-        // Move to next path.
-        rc = sky_path_iterator_next(&iterator);
-        check(rc == 0, "Unable to find next path");
-        
-        path_count++;
+    // Open one snapshot of each data file so that events added during the
+    // query aren't seen by it. The snapshots are only read while the workers
+    // run so they are shared and each worker merges memtable paths into its
+    // own iterator's buffer.
+    snapshots = calloc(data_file_count, sizeof(*snapshots)); check_mem(snapshots);
+    for(i=0; i<data_file_count; i++) {
+        sky_memtable *memtable = (i == data_file_count-1 ? table->memtable : NULL);
+        snapshots[i] = sky_snapshot_create(); check_mem(snapshots[i]);
+        snapshot_count++;
+        rc = sky_snapshot_open(snapshots[i], data_files[i], memtable);
+        check(rc == 0, "Unable to open snapshot");
+    }
+
+    workers = calloc(worker_count, sizeof(*workers)); check_mem(workers);
+    for(i=0; i<worker_count; i++) {
+        sky_peach_worker *worker = &workers[i];
+        worker->message = message;
+        worker->main_function = module->main_function;
+        worker->snapshots = snapshots;
+        worker->snapshot_count = data_file_count;
+        worker->schedule = &schedule;
+        worker->map = qip_map_create(); check_mem(worker->map);
+        rc = qip_map_set_dense_count(worker->map, module->map_key_count);
+        check(rc == 0, "Unable to set map dense count");
+    }
+
+    rc = sky_peach_message_run_workers(message, workers, worker_count, &schedule);
+    check(rc == 0, "Unable to run query workers");
+
+    // Combine the results of each worker into the first worker's map.
+    qip_map *map = workers[0].map;
+    if(worker_count > 1) {
+        qip_map_merge_func result_merge = NULL;
+        rc = qip_module_get_class_method(module->_qip_module, &result_str, &merge_str, (void*)(&result_merge));
+        check(rc == 0 && result_merge != NULL, "Unable to find merge() method on class 'Result'");
+        for(i=1; i<worker_count; i++) {
+            qip_map_merge(module->_qip_module, map, workers[i].map, result_merge);
+        }
     }
-    //debug("Paths processed: %d", path_count);
 
     // Retrieve Result serialization function.
-    struct tagbstring result_str = bsStatic("Result");
     struct tagbstring serialize_str = bsStatic("serialize");
     sky_qip_result_serialize_func result_serialize = NULL;
     rc = qip_module_get_class_method(module->_qip_module, &result_str, &serialize_str, (void*)(&result_serialize));
     check(rc == 0 && result_serialize != NULL, "Unable to find serialize() method on class 'Result'");
 
-    // Serialize.
-    qip_serializer *serializer = qip_serializer_create();
+    // Serialize in key order.
+    qip_map_sort(map);
+    serializer = qip_serializer_create();
     qip_serializer_pack_map(module->_qip_module, serializer, map->count);
-    int64_t i;
-    for(i=0; i<map->count; i++) {
-        result_serialize(map->elements[i], serializer);
+    int64_t k;
+    for(k=0; k<map->count; k++) {
+        result_serialize(map->elements[k], serializer);
     }
 
     // Send response to output stream.
     rc = fwrite(serializer->data, serializer->length, 1, output);
     check(rc == 1, "Unable to write serialized data to stream");
     
-    qip_map_free(map);
-    sky_qip_module_free(module);
+    sky_peach_message_free_workers(workers, worker_count, snapshots, snapshot_count);
+    pthread_mutex_destroy(&schedule.mutex);
+    pthread_cond_destroy(&schedule.stopped);
+    pthread_cond_destroy(&schedule.resumed);
+    qip_serializer_free(serializer);
+    free(schedule.boundaries);
+    free(data_files);
+    if(!cached) sky_qip_module_free(module);
     return 0;
 
 error:
-    sky_qip_module_free(module);
+    sky_peach_message_free_workers(workers, worker_count, snapshots, snapshot_count);
+    pthread_mutex_destroy(&schedule.mutex);
+    pthread_cond_destroy(&schedule.stopped);
+    pthread_cond_destroy(&schedule.resumed);
+    qip_serializer_free(serializer);
+    free(schedule.boundaries);
+    free(data_files);
+    if(!cached) sky_qip_module_free(module);
     return -1;
-}
\ No newline at end of file
+}
+
+// Frees the workers of a query along with their result maps and the
+// snapshots that they share.
+//
+// workers        - The workers.
+// worker_count   - The number of workers.
+// snapshots      - The snapshots of each data file.
+// snapshot_count - The number of snapshots that were created.
+void sky_peach_message_free_workers(sky_peach_worker *workers,
+                                    uint32_t worker_count,
+                                    sky_snapshot **snapshots,
+                                    uint32_t snapshot_count)
+{
+    uint32_t i;
+    if(workers != NULL) {
+        for(i=0; i<worker_count; i++) {
+            qip_map_free(workers[i].map);
+            workers[i].map = NULL;
+        }
+        free(workers);
+    }
+    if(snapshots != NULL) {
+        for(i=0; i<snapshot_count; i++) {
+            sky_snapshot_free(snapshots[i]);
+        }
+        free(snapshots);
+    }
+}
+
+// Splits the object ids in a set of data files into ranges. Ranges start at
+// the first object of evenly spaced blocks in the data file with the most
+// blocks so a path is never split between two ranges.
+//
+// data_files - The data files to split.
+// count      - The number of data files.
+// max_count  - The maximum number of ranges.
+// ret        - A pointer to where the first object id of each range is
+//              returned.
+// ret_count  - A pointer to where the number of ranges is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_peach_message_split_ranges(sky_data_file **data_files, uint32_t count,
+                                   uint32_t max_count,
+                                   sky_object_id_t **ret, uint32_t *ret_count)
+{
+    uint32_t i;
+    check(data_files != NULL, "Data files required");
+    check(max_count > 0, "At least one range required");
+    check(ret != NULL && ret_count != NULL, "Return pointers required");
+
+    // Find the data file with the most blocks.
+    sky_data_file *largest = NULL;
+    for(i=0; i<count; i++) {
+        if(largest == NULL || data_files[i]->block_count > largest->block_count) {
+            largest = data_files[i];
+        }
+    }
+    uint32_t block_count = (largest != NULL ? largest->block_count : 0);
+
+    // The first range always starts at zero. Empty blocks and blocks in the
+    // middle of a spanned path don't start a new range.
+    *ret = calloc(max_count, sizeof(**ret)); check_mem(*ret);
+    *ret_count = 1;
+    for(i=1; i<max_count && block_count > 0; i++) {
+        sky_object_id_t object_id = largest->blocks[((uint64_t)i * block_count) / max_count]->min_object_id;
+        if(object_id > (*ret)[*ret_count-1]) {
+            (*ret)[(*ret_count)++] = object_id;
+        }
+    }
+
+    return 0;
+
+error:
+    if(ret) {
+        free(*ret);
+        *ret = NULL;
+    }
+    if(ret_count) *ret_count = 0;
+    return -1;
+}
+
+// Checks if any block that a query could read is compressed. Only blocks
+// that overlap the query's time window are checked.
+//
+// message    - The message.
+// data_files - The data files that the query reads.
+// count      - The number of data files.
+//
+// Returns true if a compressed block was found, otherwise returns false.
+bool sky_peach_message_has_compressed_blocks(sky_peach_message *message,
+                                             sky_data_file **data_files,
+                                             uint32_t count)
+{
+    uint32_t i, j;
+    for(i=0; i<count; i++) {
+        for(j=0; j<data_files[i]->block_count; j++) {
+            sky_block *block = data_files[i]->blocks[j];
+            if(message->windowed && (block->max_timestamp < message->window_start || block->min_timestamp >= message->window_end)) {
+                continue;
+            }
+            if(sky_block_is_compressed(block)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Runs the workers until every range has been scanned. A single worker runs
+// on the current thread if the query doesn't yield. Otherwise every worker
+// runs on its own thread and the current thread calls the yield function
+// each time all of the running workers have stopped at a yield point.
+//
+// message      - The message.
+// workers      - The workers.
+// worker_count - The number of workers.
+// schedule     - The ranges that the workers share.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_peach_message_run_workers(sky_peach_message *message,
+                                  sky_peach_worker *workers,
+                                  uint32_t worker_count,
+                                  sky_peach_schedule *schedule)
+{
+    int rc;
+    uint32_t i;
+    int yield_rc = 0;
+    bool started = true;
+
+    if(worker_count == 1 && message->yield == NULL) {
+        schedule->running_count = 1;
+        sky_peach_message_run_worker(&workers[0]);
+    }
+    else {
+        // Start the workers. They can't take a range until the lock is
+        // released so the running count is complete before any finish.
+        pthread_mutex_lock(&schedule->mutex);
+        sky_timestamp_now(&schedule->last_yield);
+        for(i=0; i<worker_count; i++) {
+            rc = pthread_create(&workers[i].thread, NULL, sky_peach_message_run_worker, &workers[i]);
+            if(rc != 0) {
+                schedule->failed = true;
+                started = false;
+                break;
+            }
+            workers[i].started = true;
+            schedule->running_count++;
+        }
+
+        // Yield whenever every running worker has stopped and then resume
+        // them. Workers are only woken without yielding if one has failed.
+        while(schedule->running_count > 0) {
+            if(schedule->yield_pending && schedule->stopped_count == schedule->running_count) {
+                if(!schedule->failed) {
+                    pthread_mutex_unlock(&schedule->mutex);
+                    yield_rc = message->yield(message->yield_data);
+                    pthread_mutex_lock(&schedule->mutex);
+                    schedule->failed = schedule->failed || (yield_rc != 0);
+                }
+                sky_timestamp_now(&schedule->last_yield);
+                schedule->yield_range = schedule->next_range;
+                schedule->yield_pending = false;
+                schedule->stopped_count = 0;
+                schedule->epoch++;
+                pthread_cond_broadcast(&schedule->resumed);
+            }
+            else {
+                pthread_cond_wait(&schedule->stopped, &schedule->mutex);
+            }
+        }
+        pthread_mutex_unlock(&schedule->mutex);
+
+        for(i=0; i<worker_count; i++) {
+            if(workers[i].started) {
+                pthread_join(workers[i].thread, NULL);
+                workers[i].started = false;
+            }
+        }
+        check(started, "Unable to start query worker");
+        check(yield_rc == 0, "Unable to yield query");
+    }
+    for(i=0; i<worker_count; i++) {
+        check(workers[i].rc == 0, "Unable to run query worker");
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// The thread entry point for a query worker. The result code is stored on
+// the worker and a failure stops the other workers at their next range.
+//
+// _worker - The worker.
+//
+// Returns null.
+void *sky_peach_message_run_worker(void *_worker)
+{
+    sky_peach_worker *worker = (sky_peach_worker*)_worker;
+    sky_peach_schedule *schedule = worker->schedule;
+    worker->rc = sky_peach_message_scan(worker);
+
+    pthread_mutex_lock(&schedule->mutex);
+    schedule->failed = schedule->failed || (worker->rc != 0);
+    schedule->running_count--;
+    pthread_cond_signal(&schedule->stopped);
+    pthread_mutex_unlock(&schedule->mutex);
+    return NULL;
+}
+
+// Runs the query against each path in the ranges that a worker takes from
+// the shared list.
+//
+// worker - The worker.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_peach_message_scan(sky_peach_worker *worker)
+{
+    int rc;
+    sky_peach_message *message = worker->message;
+    sky_peach_schedule *schedule = worker->schedule;
+    sky_qip_path_map_func main_function = (sky_qip_path_map_func)worker->main_function;
+    sky_path_iterator iterator;
+    sky_path_iterator_init(&iterator);
+    sky_qip_path *path = NULL;
+
+    // Initialize the path iterator. Blocks outside of the time window are
+    // skipped.
+    if(message->windowed) {
+        rc = sky_path_iterator_set_window(&iterator, message->window_start, message->window_end);
+        check(rc == 0, "Unable to set time window");
+    }
+    if(worker->snapshot_count == 1) {
+        rc = sky_path_iterator_set_snapshot(&iterator, worker->snapshots[0]);
+    }
+    else {
+        rc = sky_path_iterator_set_partitions(&iterator, worker->snapshots, worker->snapshot_count);
+    }
+    check(rc == 0, "Unable to initialze path iterator");
+
+    // Initialize QIP args.
+    path = sky_qip_path_create(); check_mem(path);
+    path->windowed = message->windowed;
+    path->window_start = message->window_start;
+    path->window_end = message->window_end;
+
+    while(true) {
+        uint32_t index;
+        rc = sky_peach_message_take_range(worker, &index);
+        check(rc == 0, "Unable to take next range");
+        if(index >= schedule->range_count) {
+            break;
+        }
+        sky_object_id_t min_object_id = schedule->boundaries[index];
+        sky_object_id_t max_object_id = (index+1 < schedule->range_count ? schedule->boundaries[index+1] - 1 : UINT32_MAX);
+        rc = sky_path_iterator_set_range(&iterator, min_object_id, max_object_id);
+        check(rc == 0, "Unable to set object id range");
+
+        // Iterate over each path.
+        while(!iterator.eof) {
+            // Retrieve the path segments.
+            rc = sky_path_iterator_get_ptrs(&iterator, &path->path_ptrs, &path->path_count);
+            check(rc == 0, "Unable to retrieve the path iterator pointers");
+            path->path_ptr = (path->path_count > 0 ? path->path_ptrs[0] : NULL);
+
+            // Execute query.
+            main_function(path, worker->map);
+
+            // Move to next path.
+            rc = sky_path_iterator_next(&iterator);
+            check(rc == 0, "Unable to find next path");
+        }
+    }
+
+    sky_qip_path_free(path);
+    sky_path_iterator_set_partitions(&iterator, NULL, 0);
+    return 0;
+
+error:
+    sky_qip_path_free(path);
+    sky_path_iterator_set_partitions(&iterator, NULL, 0);
+    return -1;
+}
+
+// Takes the next range for a worker. Once the yield interval has passed, the
+// worker stops here instead and waits until the caller has yielded. The
+// range count is returned if there are no ranges left or another worker has
+// failed.
+//
+// worker - The worker.
+// index  - A pointer to where the index of the range is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_peach_message_take_range(sky_peach_worker *worker, uint32_t *index)
+{
+    sky_peach_message *message = worker->message;
+    sky_peach_schedule *schedule = worker->schedule;
+
+    pthread_mutex_lock(&schedule->mutex);
+    while(true) {
+        if(schedule->failed || schedule->next_range >= schedule->range_count) {
+            *index = schedule->range_count;
+            break;
+        }
+
+        // Start a yield if the interval has passed since the last one and a
+        // range has been taken since then so the query always progresses.
+        if(message->yield != NULL && !schedule->yield_pending && schedule->next_range > schedule->yield_range) {
+            sky_timestamp_t now = 0;
+            sky_timestamp_now(&now);
+            schedule->yield_pending = (now - schedule->last_yield >= message->yield_interval);
+        }
+        if(!schedule->yield_pending) {
+            *index = schedule->next_range++;
+            break;
+        }
+
+        // Wait for the yield to finish.
+        uint32_t epoch = schedule->epoch;
+        schedule->stopped_count++;
+        pthread_cond_signal(&schedule->stopped);
+        while(schedule->epoch == epoch) {
+            pthread_cond_wait(&schedule->resumed, &schedule->mutex);
+        }
+    }
+    pthread_mutex_unlock(&schedule->mutex);
+
+    return 0;
+}
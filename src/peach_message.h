@@ -3,10 +3,14 @@
 
 #include <stdio.h>
 #include <inttypes.h>
+#include <stdbool.h>
+#include <pthread.h>
 
 #include "bstring.h"
 #include "types.h"
 #include "table.h"
+#include "snapshot.h"
+#include "qip/qip.h"
 
 
 //==============================================================================
@@ -15,11 +19,71 @@
 //
 //==============================================================================
 
-// A message for querying each path in the database.
+// The number of microseconds that a query scans before it stops at the
+// next yield point.
+#define SKY_PEACH_DEFAULT_YIELD_INTERVAL 20000
+
+// A function that a query calls at its yield points so that the caller can
+// handle other messages while the query runs. No worker is scanning while it
+// runs so it can add events to the table.
+typedef int (*sky_peach_yield_func)(void *data);
+
+// A message for querying each path in the database. The query can be
+// restricted to events in a time window and can choose how much the compiler
+// optimizes it. A negative optimization level uses the compiler's default.
+//
+// If a yield function is set then the workers stop at a yield point between
+// ranges once the yield interval has passed since the query started or last
+// yielded, and the function is called once they have all stopped. The query
+// reads snapshots of the table so events added by the yield function aren't
+// seen by it.
 typedef struct {
     bstring query;
+    bool windowed;
+    sky_timestamp_t window_start;
+    sky_timestamp_t window_end;
+    int32_t opt_level;
+    sky_peach_yield_func yield;
+    void *yield_data;
+    int64_t yield_interval;
 } sky_peach_message;
 
+// The object id ranges of a query and the state that its workers share to
+// take them. Range N starts at boundary N and ends before boundary N+1.
+// Workers that find a yield pending stop before taking another range and
+// wait for the epoch to change. At least one range is taken between yields.
+// Workers that run out of ranges finish.
+typedef struct sky_peach_schedule {
+    sky_object_id_t *boundaries;
+    uint32_t range_count;
+    uint32_t next_range;
+    uint32_t running_count;
+    uint32_t stopped_count;
+    uint32_t epoch;
+    bool yield_pending;
+    bool failed;
+    sky_timestamp_t last_yield;
+    uint32_t yield_range;
+    pthread_mutex_t mutex;
+    pthread_cond_t stopped;
+    pthread_cond_t resumed;
+} sky_peach_schedule;
+
+// A thread that runs part of a PEACH query. Workers read the same snapshots
+// of the table and each one scans into its own result map. The workers run
+// until every range has been taken, stopping at the query's yield points.
+typedef struct sky_peach_worker {
+    sky_peach_message *message;
+    void *main_function;
+    sky_snapshot **snapshots;
+    uint32_t snapshot_count;
+    sky_peach_schedule *schedule;
+    qip_map *map;
+    pthread_t thread;
+    bool started;
+    int rc;
+} sky_peach_worker;
+
 
 //==============================================================================
 //
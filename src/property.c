@@ -68,6 +68,8 @@ void sky_property_free(sky_property *property)
         property->data_type = NULL;
         if(property->name) bdestroy(property->name);
         property->name = NULL;
+        sky_dictionary_free(property->dictionary);
+        property->dictionary = NULL;
         free(property);
     }
 }
@@ -94,6 +96,10 @@ size_t sky_property_sizeof(sky_property *property)
     sz += blength(property->data_type);
     sz += minipack_sizeof_raw(strlen("name")) + strlen("name");
     sz += blength(property->name);
+    if(property->dictionary != NULL) {
+        sz += minipack_sizeof_raw(strlen("dictionary")) + strlen("dictionary");
+        sz += minipack_sizeof_bool();
+    }
     return sz;
 }
 
@@ -114,13 +120,14 @@ int sky_property_pack(sky_property *property, FILE *file)
     struct tagbstring type_str = bsStatic("type");
     struct tagbstring data_type_str = bsStatic("dataType");
     struct tagbstring name_str = bsStatic("name");
+    struct tagbstring dictionary_str = bsStatic("dictionary");
 
     // Update the type just in case.
     rc = sky_property_update_type(property);
     check(rc == 0, "Unable to update property type");
 
     // Map
-    minipack_fwrite_map(file, 4, &sz);
+    minipack_fwrite_map(file, (property->dictionary != NULL ? 5 : 4), &sz);
     check(sz > 0, "Unable to write map");
     
     // ID
@@ -141,6 +148,13 @@ int sky_property_pack(sky_property *property, FILE *file)
     check(sky_minipack_fwrite_bstring(file, &name_str) == 0, "Unable to write name key");
     check(sky_minipack_fwrite_bstring(file, property->name) == 0, "Unable to write name value");
 
+    // Dictionary
+    if(property->dictionary != NULL) {
+        check(sky_minipack_fwrite_bstring(file, &dictionary_str) == 0, "Unable to write dictionary key");
+        minipack_fwrite_bool(file, true, &sz);
+        check(sz > 0, "Unable to write dictionary value");
+    }
+
     return 0;
 
 error:
@@ -188,6 +202,14 @@ int sky_property_unpack(sky_property *property, FILE *file)
             rc = sky_minipack_fread_bstring(file, &property->name);
             check(rc == 0, "Unable to read property id");
         }
+        else if(biseqcstr(key, "dictionary")) {
+            bool dictionary = minipack_fread_bool(file, &sz);
+            check(sz > 0, "Unable to read property dictionary flag");
+            if(dictionary && property->dictionary == NULL) {
+                property->dictionary = sky_dictionary_create();
+                check_mem(property->dictionary);
+            }
+        }
         
         bdestroy(key);
     }
@@ -10,6 +10,7 @@ typedef struct sky_property sky_property;
 #include "bstring.h"
 #include "file.h"
 #include "property_file.h"
+#include "dictionary.h"
 
 //==============================================================================
 //
@@ -37,6 +38,7 @@ struct sky_property {
     sky_property_type_e type;
     bstring data_type;
     bstring name;
+    sky_dictionary *dictionary;
 };
 
 
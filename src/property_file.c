@@ -6,8 +6,19 @@
 #include "bstring.h"
 #include "file.h"
 #include "property_file.h"
+#include "event.h"
 #include "minipack.h"
 
+//==============================================================================
+//
+// Forward Declarations
+//
+//==============================================================================
+
+int sky_property_file_load_dictionary(sky_property_file *property_file,
+    sky_property *property);
+
+
 //==============================================================================
 //
 // Functions
@@ -142,6 +153,10 @@ int sky_property_file_load(sky_property_file *property_file)
             // Append to array.
             property->property_file = property_file;
             properties[i] = property;
+
+            // Load the string dictionary.
+            rc = sky_property_file_load_dictionary(property_file, property);
+            check(rc == 0, "Unable to load property dictionary");
         }
 
         // Close the file.
@@ -221,6 +236,7 @@ int sky_property_file_unload(sky_property_file *property_file)
         }
         
         property_file->property_count = 0;
+        property_file->version++;
     }
     
     return 0;
@@ -310,6 +326,7 @@ int sky_property_file_add_property(sky_property_file *property_file,
     check(property != NULL, "Property required");
     check(property->id == 0, "Property ID must be zero");
     check(property->property_file == NULL, "Property must not be attached to a property file");
+    check(property->dictionary == NULL || biseq(property->data_type, &SKY_DATA_TYPE_STRING), "Only string properties can use a dictionary");
     
     // Make sure an property with that name doesn't already exist.
     sky_property *_property;
@@ -350,6 +367,11 @@ int sky_property_file_add_property(sky_property_file *property_file,
     property_file->properties = realloc(property_file->properties, sizeof(sky_property*) * property_file->property_count);
     check_mem(property_file->properties);
     property_file->properties[property_file->property_count-1] = property;
+    property_file->version++;
+
+    // Load the string dictionary.
+    rc = sky_property_file_load_dictionary(property_file, property);
+    check(rc == 0, "Unable to load property dictionary");
     
     return 0;
 
@@ -357,3 +379,110 @@ error:
     return -1;
 }
 
+
+//--------------------------------------
+// Dictionaries
+//--------------------------------------
+
+// Loads the string dictionary for a property. Each dictionary is stored next
+// to the property file with the property id as the extension.
+//
+// property_file - The property file.
+// property      - The property.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_property_file_load_dictionary(sky_property_file *property_file,
+                                      sky_property *property)
+{
+    int rc;
+    bstring path = NULL;
+    check(property_file != NULL, "Property file required");
+    check(property != NULL, "Property required");
+
+    // Only properties with a dictionary need to be loaded.
+    if(property->dictionary == NULL || property_file->path == NULL) {
+        return 0;
+    }
+
+    path = bformat("%s.%d", bdata(property_file->path), property->id);
+    check_mem(path);
+    rc = sky_dictionary_set_path(property->dictionary, path);
+    check(rc == 0, "Unable to set dictionary path");
+    rc = sky_dictionary_load(property->dictionary);
+    check(rc == 0, "Unable to load dictionary: %s", bdata(path));
+
+    bdestroy(path);
+    return 0;
+
+error:
+    bdestroy(path);
+    return -1;
+}
+
+// Replaces the string values of dictionary properties on an event with their
+// dictionary codes. Strings that are not in a dictionary yet are added.
+//
+// property_file - The property file.
+// event         - The event to encode.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_property_file_encode_event(sky_property_file *property_file,
+                                   sky_event *event)
+{
+    int rc;
+    check(property_file != NULL, "Property file required");
+    check(event != NULL, "Event required");
+
+    uint32_t i;
+    for(i=0; i<event->data_count; i++) {
+        sky_event_data *data = event->data[i];
+        if(data->data_type != &SKY_DATA_TYPE_STRING) {
+            continue;
+        }
+
+        sky_property *property = NULL;
+        rc = sky_property_file_find_by_id(property_file, data->key, &property);
+        check(rc == 0, "Unable to find property: %d", data->key);
+        if(property == NULL || property->dictionary == NULL) {
+            continue;
+        }
+
+        uint32_t code;
+        rc = sky_dictionary_add(property->dictionary, data->string_value, &code);
+        check(rc == 0, "Unable to add string to dictionary");
+        bdestroy(data->string_value);
+        data->data_type = &SKY_DATA_TYPE_INT;
+        data->int_value = (int64_t)code;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Syncs the strings that were added to any dictionary since the last sync.
+// This should be done before the events that use the new codes are logged.
+//
+// property_file - The property file.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_property_file_sync_dictionaries(sky_property_file *property_file)
+{
+    int rc;
+    check(property_file != NULL, "Property file required");
+
+    uint32_t i;
+    for(i=0; i<property_file->property_count; i++) {
+        sky_property *property = property_file->properties[i];
+        if(property->dictionary != NULL) {
+            rc = sky_dictionary_sync(property->dictionary);
+            check(rc == 0, "Unable to sync dictionary for property: %d", property->id);
+        }
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
@@ -10,6 +10,7 @@ typedef struct sky_property_file sky_property_file;
 #include "file.h"
 #include "types.h"
 #include "property.h"
+#include "event.h"
 
 
 //==============================================================================
@@ -22,6 +23,7 @@ struct sky_property_file {
     bstring path;
     sky_property **properties;
     uint32_t property_count;
+    uint32_t version;
 };
 
 
@@ -72,4 +74,14 @@ int sky_property_file_find_by_name(sky_property_file *property_file,
 
 int sky_property_file_add_property(sky_property_file *property_file, sky_property *ret);
 
+
+//--------------------------------------
+// Dictionaries
+//--------------------------------------
+
+int sky_property_file_encode_event(sky_property_file *property_file,
+    sky_event *event);
+
+int sky_property_file_sync_dictionaries(sky_property_file *property_file);
+
 #endif
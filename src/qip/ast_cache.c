@@ -0,0 +1,222 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+
+#include "dbg.h"
+
+#include "ast_cache.h"
+#include "parser.h"
+
+
+//==============================================================================
+//
+// Globals
+//
+//==============================================================================
+
+// The cache used by compilers unless another one is set.
+qip_ast_cache qip_ast_cache_shared_cache = {NULL, 0, PTHREAD_MUTEX_INITIALIZER};
+
+
+//==============================================================================
+//
+// Forward Declarations
+//
+//==============================================================================
+
+int qip_ast_cache_parse(bstring name, bstring path, qip_ast_node **ret);
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+// Creates an AST cache.
+//
+// Returns a new AST cache.
+qip_ast_cache *qip_ast_cache_create()
+{
+    qip_ast_cache *cache = calloc(1, sizeof(qip_ast_cache));
+    check_mem(cache);
+    pthread_mutex_init(&cache->mutex, NULL);
+    return cache;
+
+error:
+    return NULL;
+}
+
+// Frees an AST cache and its ASTs.
+//
+// cache - The AST cache.
+void qip_ast_cache_free(qip_ast_cache *cache)
+{
+    if(cache) {
+        qip_ast_cache_clear(cache);
+        pthread_mutex_destroy(&cache->mutex);
+        free(cache);
+    }
+}
+
+// Removes all ASTs from the cache.
+//
+// cache - The AST cache.
+void qip_ast_cache_clear(qip_ast_cache *cache)
+{
+    if(cache) {
+        pthread_mutex_lock(&cache->mutex);
+        uint32_t i;
+        for(i=0; i<cache->entry_count; i++) {
+            bdestroy(cache->entries[i].path);
+            qip_ast_node_free(cache->entries[i].module);
+        }
+        free(cache->entries);
+        cache->entries = NULL;
+        cache->entry_count = 0;
+        pthread_mutex_unlock(&cache->mutex);
+    }
+}
+
+// Retrieves the AST cache that is shared by the process.
+//
+// Returns the shared AST cache.
+qip_ast_cache *qip_ast_cache_shared()
+{
+    return &qip_ast_cache_shared_cache;
+}
+
+
+//--------------------------------------
+// Loading
+//--------------------------------------
+
+// Loads a copy of the AST for a module file. The file is parsed and added
+// to the cache if it isn't cached yet or if it has changed since it was
+// parsed. No AST is returned if the file doesn't exist or if it has syntax
+// errors so that the caller can load it normally and report the errors.
+//
+// cache - The AST cache.
+// name  - The name of the module.
+// path  - The path to the module file.
+// ret   - A pointer to where a copy of the module AST is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int qip_ast_cache_load(qip_ast_cache *cache, bstring name, bstring path,
+                       qip_ast_node **ret)
+{
+    int rc;
+    uint32_t i;
+    bool locked = false;
+    qip_ast_node *module = NULL;
+    check(cache != NULL, "AST cache required");
+    check(name != NULL, "Module name required");
+    check(path != NULL, "Path required");
+    check(ret != NULL, "Return pointer required");
+    *ret = NULL;
+
+    // Ignore missing files.
+    struct stat info;
+    if(stat(bdata(path), &info) != 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    locked = true;
+
+    // Find the file's entry.
+    qip_ast_cache_entry *entry = NULL;
+    for(i=0; i<cache->entry_count; i++) {
+        if(biseq(cache->entries[i].path, path) == 1) {
+            entry = &cache->entries[i];
+            break;
+        }
+    }
+
+    // Parse the file if it isn't cached or if it has changed.
+    if(entry == NULL || entry->mtime != info.st_mtime || entry->size != info.st_size) {
+        rc = qip_ast_cache_parse(name, path, &module);
+        check(rc == 0, "Unable to parse module: %s", bdata(path));
+        if(module == NULL) {
+            pthread_mutex_unlock(&cache->mutex);
+            return 0;
+        }
+
+        if(entry == NULL) {
+            qip_ast_cache_entry *entries = realloc(cache->entries, (cache->entry_count + 1) * sizeof(*cache->entries));
+            check_mem(entries);
+            cache->entries = entries;
+            entry = &cache->entries[cache->entry_count++];
+            entry->path = bstrcpy(path);
+            entry->module = NULL;
+        }
+        qip_ast_node_free(entry->module);
+        entry->module = module;
+        entry->mtime = info.st_mtime;
+        entry->size = info.st_size;
+        module = NULL;
+    }
+
+    // Return a copy so that the cached AST isn't changed.
+    rc = qip_ast_node_copy(entry->module, ret);
+    check(rc == 0, "Unable to copy module AST: %s", bdata(path));
+
+    pthread_mutex_unlock(&cache->mutex);
+    return 0;
+
+error:
+    if(locked) pthread_mutex_unlock(&cache->mutex);
+    qip_ast_node_free(module);
+    if(ret) *ret = NULL;
+    return -1;
+}
+
+// Reads and parses a module file.
+//
+// name - The name of the module.
+// path - The path to the module file.
+// ret  - A pointer to where the module AST is returned. This is null if the
+//        file can't be read or has syntax errors.
+//
+// Returns 0 if successful, otherwise returns -1.
+int qip_ast_cache_parse(bstring name, bstring path, qip_ast_node **ret)
+{
+    int rc;
+    bstring text = NULL;
+    qip_parser *parser = NULL;
+    qip_ast_node *module = NULL;
+    *ret = NULL;
+
+    FILE *fp = fopen(bdata(path), "rb");
+    if(fp == NULL) {
+        return 0;
+    }
+    text = bread((bNread) fread, fp);
+    fclose(fp);
+    check_mem(text);
+
+    parser = qip_parser_create(); check_mem(parser);
+    rc = qip_parser_parse(parser, name, text, &module);
+    check(rc == 0, "Unable to parse module: %s", bdata(name));
+    if(parser->error_count == 0) {
+        *ret = module;
+        module = NULL;
+    }
+
+    qip_ast_node_free(module);
+    qip_parser_free(parser);
+    bdestroy(text);
+    return 0;
+
+error:
+    qip_ast_node_free(module);
+    qip_parser_free(parser);
+    bdestroy(text);
+    *ret = NULL;
+    return -1;
+}
@@ -0,0 +1,84 @@
+#ifndef _qip_ast_cache_h
+#define _qip_ast_cache_h
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "bstring.h"
+
+//==============================================================================
+//
+// Forward Declarations
+//
+//==============================================================================
+
+typedef struct qip_ast_cache qip_ast_cache;
+
+#include "node.h"
+
+
+//==============================================================================
+//
+// Overview
+//
+//==============================================================================
+
+// The AST cache holds the parsed ASTs of modules loaded from class paths so
+// that the standard library isn't read and parsed for every compilation.
+// Cached ASTs are never changed. Each compilation receives its own copy
+// since preprocessing and code generation modify the AST. A file is parsed
+// again once its modification time or size changes.
+//
+// Compilers use a single cache that is shared by the whole process unless
+// a different cache is set on them.
+
+
+//==============================================================================
+//
+// Typedefs
+//
+//==============================================================================
+
+typedef struct qip_ast_cache_entry {
+    bstring path;
+    time_t mtime;
+    off_t size;
+    qip_ast_node *module;
+} qip_ast_cache_entry;
+
+struct qip_ast_cache {
+    qip_ast_cache_entry *entries;
+    uint32_t entry_count;
+    pthread_mutex_t mutex;
+};
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+qip_ast_cache *qip_ast_cache_create();
+
+void qip_ast_cache_free(qip_ast_cache *cache);
+
+void qip_ast_cache_clear(qip_ast_cache *cache);
+
+qip_ast_cache *qip_ast_cache_shared();
+
+
+//--------------------------------------
+// Loading
+//--------------------------------------
+
+int qip_ast_cache_load(qip_ast_cache *cache, bstring name, bstring path,
+    qip_ast_node **ret);
+
+#endif
@@ -405,6 +405,7 @@ error:
 }
 
 // Retrieves a template class matching a type reference within a given module.
+// A partial specialization of the class is returned instead if one matches.
 //
 // node     - The node
 // type_ref - The type reference to match.
@@ -415,6 +416,7 @@ int qip_ast_module_get_template_class(qip_ast_node *node,
                                       qip_ast_node *type_ref,
                                       qip_ast_node **ret)
 {
+    int rc;
     check(node != NULL, "Node required");
     check(node->type == QIP_AST_TYPE_MODULE, "Node type must be 'module'");
     check(type_ref != NULL, "Type reference required");
@@ -430,10 +432,22 @@ int qip_ast_module_get_template_class(qip_ast_node *node,
     for(i=0; i<node->module.class_count; i++) {
         qip_ast_node *class = node->module.classes[i];
         
-        // Return class if match.
+        // Use the generic class if no specialization has been found.
         if(biseq(class->class.name, type_ref->type_ref.name) &&
            class->class.template_var_count == type_ref->type_ref.subtype_count)
         {
+            if(*ret == NULL) {
+                *ret = class;
+            }
+            continue;
+        }
+
+        // Return the specialization if it matches.
+        qip_ast_node *specialization_type_ref = NULL;
+        rc = qip_ast_class_get_specialization_type_ref(class, type_ref, &specialization_type_ref);
+        check(rc == 0, "Unable to match class specialization");
+        if(specialization_type_ref != NULL) {
+            qip_ast_node_free(specialization_type_ref);
             *ret = class;
             break;
         }
@@ -276,6 +276,94 @@ error:
     return -1;
 }
 
+// Creates the type reference used to apply a partial specialization to a
+// type reference. A partial specialization is named after the class it
+// specializes with some of the subtypes fixed, such as "Map<Int,U>", and
+// declares the remaining subtypes as template variables in the same order.
+// If the class matches the type reference then the returned type reference
+// has the class' name and the subtypes bound to its template variables.
+// Otherwise null is returned.
+//
+// node     - The class.
+// type_ref - The type reference to match.
+// ret      - A pointer to where the type reference is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int qip_ast_class_get_specialization_type_ref(qip_ast_node *node,
+                                              qip_ast_node *type_ref,
+                                              qip_ast_node **ret)
+{
+    int rc;
+    struct bstrList *names = NULL;
+    qip_ast_node *specialization_type_ref = NULL;
+    check(node != NULL, "Node required");
+    check(node->type == QIP_AST_TYPE_CLASS, "Node type expected to be 'class'");
+    check(type_ref != NULL, "Type reference required");
+    check(type_ref->type == QIP_AST_TYPE_TYPE_REF, "Node type expected to be 'type ref'");
+    check(ret != NULL, "Return pointer required");
+    *ret = NULL;
+
+    // Only templates named after another class are specializations.
+    bstring name = node->class.name;
+    int start = bstrchr(name, '<');
+    if(start == BSTR_ERR || node->class.template_var_count == 0 || bchar(name, blength(name)-1) != '>') {
+        return 0;
+    }
+
+    // The class must specialize the referenced class.
+    if(blength(type_ref->type_ref.name) != start || bstrncmp(name, type_ref->type_ref.name, start) != 0) {
+        return 0;
+    }
+
+    // Split the specialized subtypes.
+    struct tagbstring subtype_list;
+    bmid2tbstr(subtype_list, name, start+1, blength(name)-start-2);
+    names = bsplit(&subtype_list, ',');
+    check_mem(names);
+    if(names->qty != (int)type_ref->type_ref.subtype_count) {
+        bstrListDestroy(names);
+        return 0;
+    }
+
+    // Fixed subtypes must match the type reference and the rest are bound
+    // to the template variables.
+    specialization_type_ref = qip_ast_type_ref_create(name);
+    check_mem(specialization_type_ref);
+    unsigned int i, var_index = 0;
+    for(i=0; i<type_ref->type_ref.subtype_count; i++) {
+        qip_ast_node *subtype = type_ref->type_ref.subtypes[i];
+        if(var_index < node->class.template_var_count &&
+           biseq(names->entry[i], node->class.template_vars[var_index]->template_var.name))
+        {
+            qip_ast_node *subtype_copy = NULL;
+            rc = qip_ast_type_ref_copy(subtype, &subtype_copy);
+            check(rc == 0, "Unable to copy subtype");
+            rc = qip_ast_type_ref_add_subtype(specialization_type_ref, subtype_copy);
+            check(rc == 0, "Unable to add subtype");
+            var_index++;
+        }
+        else if(!biseq(names->entry[i], subtype->type_ref.name)) {
+            break;
+        }
+    }
+
+    // Return the type reference only if every subtype matched.
+    if(i == type_ref->type_ref.subtype_count && var_index == node->class.template_var_count) {
+        *ret = specialization_type_ref;
+        specialization_type_ref = NULL;
+    }
+
+    qip_ast_node_free(specialization_type_ref);
+    bstrListDestroy(names);
+    return 0;
+
+error:
+    qip_ast_node_free(specialization_type_ref);
+    if(names) bstrListDestroy(names);
+    if(ret) *ret = NULL;
+    return -1;
+}
+
 
 //--------------------------------------
 // Member Management
@@ -1529,7 +1617,8 @@ error:
 }
 
 // Generates a type reference to this class. If template variables are used
-// with this class then they are included.
+// with this class then they are included. Partial specializations reference
+// the class they specialize, so "Map<Int,U>" generates Map<Int,U>.
 //
 // node - The class node.
 // ret  - A pointer to where the new type ref should be returned.
@@ -1538,11 +1627,40 @@ error:
 int qip_ast_class_generate_type_ref(qip_ast_node *node, qip_ast_node **ret)
 {
     int rc;
+    struct bstrList *names = NULL;
+    qip_ast_node *type_ref = NULL;
     check(node != NULL, "Node required");
     check(ret != NULL, "Return pointer required");
     
+    // Split the name of partial specializations into the specialized class
+    // name and its subtypes.
+    bstring name = node->class.name;
+    int start = bstrchr(name, '<');
+    if(start != BSTR_ERR && node->class.template_var_count > 0 && bchar(name, blength(name)-1) == '>') {
+        struct tagbstring base_name, subtype_list;
+        bmid2tbstr(base_name, name, 0, start);
+        bmid2tbstr(subtype_list, name, start+1, blength(name)-start-2);
+        names = bsplit(&subtype_list, ',');
+        check_mem(names);
+
+        type_ref = qip_ast_type_ref_create(&base_name);
+        check_mem(type_ref);
+
+        int i;
+        for(i=0; i<names->qty; i++) {
+            qip_ast_node *subtype_ref = qip_ast_type_ref_create(names->entry[i]);
+            check_mem(subtype_ref);
+            rc = qip_ast_type_ref_add_subtype(type_ref, subtype_ref);
+            check(rc == 0, "Unable to add subtype");
+        }
+
+        bstrListDestroy(names);
+        *ret = type_ref;
+        return 0;
+    }
+
     // Create type ref;
-    qip_ast_node *type_ref = qip_ast_type_ref_create(node->class.name);
+    type_ref = qip_ast_type_ref_create(node->class.name);
     check_mem(type_ref);
     
     // Loop over template variables and add subtypes.
@@ -1564,6 +1682,8 @@ int qip_ast_class_generate_type_ref(qip_ast_node *node, qip_ast_node **ret)
     return 0;
 
 error:
+    if(names) bstrListDestroy(names);
+    qip_ast_node_free(type_ref);
     *ret = NULL;
     return -1;
 }
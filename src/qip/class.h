@@ -53,6 +53,9 @@ int qip_ast_class_add_template_var(qip_ast_node *node,
 int qip_ast_class_add_template_vars(qip_ast_node *node,
     qip_ast_node **template_vars, unsigned int template_var_count);
 
+int qip_ast_class_get_specialization_type_ref(qip_ast_node *node,
+    qip_ast_node *type_ref, qip_ast_node **ret);
+
 
 //--------------------------------------
 // Member Management
@@ -34,6 +34,8 @@ qip_compiler *qip_compiler_create()
     qip_compiler *compiler = calloc(1, sizeof(qip_compiler));
     check_mem(compiler);
     compiler->llvm_builder = LLVMCreateBuilder();
+    compiler->ast_cache = qip_ast_cache_shared();
+    compiler->opt_level = QIP_OPT_LEVEL_DEFAULT;
     
     return compiler;
     
@@ -131,25 +133,38 @@ int qip_compiler_compile(qip_compiler *compiler, qip_module *module, bstring sou
     // Continuously loop and parse QIP files until there are no more dependencies.
     bstring current_module_name = module->name;
     bstring current_module_source = source;
+    qip_ast_node *current_ast_module = NULL;
     do {
-        // Throw error if no source can be found.
-        check(current_module_source != NULL, "Source not found for '%s'", bdata(current_module_name));
-        
-        // Parse the text into a module AST.
         qip_ast_node *ast_module = NULL;
-        parser = qip_parser_create(); check_mem(parser);
-        rc = qip_parser_parse(parser, current_module_name, current_module_source, &ast_module);
-        check(rc == 0, "Error occurred while parsing QIP query: %s", bdata(current_module_name));
-
-        // If we have a syntax error then return the errors and exit.
-        if(parser->error_count > 0) {
-            module->errors = parser->errors;
-            module->error_count = parser->error_count;
-            parser->errors = NULL;
-            parser->error_count = 0;
-            qip_parser_free(parser);
-            parser = NULL;
-            break;
+
+        // Use the AST from the cache if the module was found there.
+        if(current_ast_module != NULL) {
+            ast_module = current_ast_module;
+            current_ast_module = NULL;
+        }
+        else {
+            // Throw error if no source can be found.
+            check(current_module_source != NULL, "Source not found for '%s'", bdata(current_module_name));
+            
+            // Parse the text into a module AST.
+            parser = qip_parser_create(); check_mem(parser);
+            rc = qip_parser_parse(parser, current_module_name, current_module_source, &ast_module);
+            if(current_module_source != source) {
+                bdestroy(current_module_source);
+            }
+            current_module_source = NULL;
+            check(rc == 0, "Error occurred while parsing QIP query: %s", bdata(current_module_name));
+
+            // If we have a syntax error then return the errors and exit.
+            if(parser->error_count > 0) {
+                module->errors = parser->errors;
+                module->error_count = parser->error_count;
+                parser->errors = NULL;
+                parser->error_count = 0;
+                qip_parser_free(parser);
+                parser = NULL;
+                break;
+            }
         }
 
         // If there is a main function then inject the arguments passed in.
@@ -194,8 +209,8 @@ int qip_compiler_compile(qip_compiler *compiler, qip_module *module, bstring sou
             // If we couldn't find the dependency then load it.
             if(class == NULL) {
                 current_module_name = dependency;
-                rc = qip_compiler_load_module_source(compiler, dependency, &current_module_source);
-                check(rc == 0, "Unable to load module source: %s", bdata(dependency));
+                rc = qip_compiler_load_module(compiler, dependency, &current_module_source, &current_ast_module);
+                check(rc == 0, "Unable to load module: %s", bdata(dependency));
                 break;
             }
         }
@@ -258,6 +273,12 @@ int qip_compiler_compile(qip_compiler *compiler, qip_module *module, bstring sou
         }
     }
 
+    // Optimize the generated code before any of it is executed.
+    if(module->error_count == 0) {
+        rc = qip_module_optimize(module, compiler->opt_level);
+        check(rc == 0, "Unable to optimize module");
+    }
+
     // qip_module_dump(module);
     
     // Initialize the global module variable.
@@ -302,6 +323,64 @@ error:
     return -1;
 }
 
+// Loads a module with a given name. Modules on the class paths are returned
+// as a copy of their parsed AST from the compiler's AST cache if it has
+// one. Otherwise the source code of the module is returned.
+//
+// compiler   - The compiler that is loading the module.
+// name       - The name of the QIP module.
+// source     - A pointer to where the module's source text is returned.
+// ast_module - A pointer to where the module's AST is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int qip_compiler_load_module(qip_compiler *compiler, bstring name,
+                             bstring *source, qip_ast_node **ast_module)
+{
+    int rc;
+    uint32_t i;
+    bstring path = NULL;
+    check(compiler != NULL, "Compiler required");
+    check(name != NULL, "Module name required");
+    check(source != NULL, "Source return pointer required");
+    check(ast_module != NULL, "AST module return pointer required");
+    *source = NULL;
+    *ast_module = NULL;
+
+    // Search the AST cache for class path modules.
+    if(compiler->ast_cache != NULL) {
+        for(i=0; i<compiler->class_path_count; i++) {
+            path = bformat("%s/%s.qip", bdata(compiler->class_paths[i]), bdata(name));
+            check_mem(path);
+            struct stat info;
+            bool exists = (stat(bdata(path), &info) == 0);
+            rc = qip_ast_cache_load(compiler->ast_cache, name, path, ast_module);
+            check(rc == 0, "Unable to load cached module: %s", bdata(path));
+            bdestroy(path);
+            path = NULL;
+            
+            // Only the first file found is used. Files with syntax errors
+            // aren't cached so they are loaded as source below.
+            if(*ast_module != NULL) {
+                return 0;
+            }
+            else if(exists) {
+                break;
+            }
+        }
+    }
+
+    // Fall back to loading the source.
+    rc = qip_compiler_load_module_source(compiler, name, source);
+    check(rc == 0, "Unable to load module source: %s", bdata(name));
+
+    return 0;
+
+error:
+    bdestroy(path);
+    if(ast_module) *ast_module = NULL;
+    return -1;
+}
+
 // Loads the source code for a module with a given name. This function
 // delegates to the load_module_source function pointer.
 //
@@ -391,4 +470,101 @@ int qip_compiler_process_dynamic_class(qip_compiler *compiler, qip_module *modul
     
 error:
     return -1;
-}
\ No newline at end of file
+}
+
+
+//======================================
+// External Function Generation
+//======================================
+
+// Gives the compiler caller a chance to generate the body of an external
+// function itself instead of calling out to the C function. This lets the
+// caller emit code that is specialized to the module being compiled. The
+// callback is optional and the C function is called when it is not set or
+// when it doesn't generate the body.
+//
+// compiler      - The compiler.
+// module        - The module.
+// function      - The function AST node.
+// function_name - The name of the external C function.
+// args          - The loaded arguments for the C function. The first
+//                 argument is always the module.
+// arg_count     - The number of arguments.
+// generated     - A pointer to where a flag stating if the body was
+//                 generated is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int qip_compiler_codegen_external_call(qip_compiler *compiler,
+                                       qip_module *module,
+                                       qip_ast_node *function,
+                                       bstring function_name,
+                                       LLVMValueRef *args,
+                                       unsigned int arg_count,
+                                       bool *generated)
+{
+    int rc;
+    check(compiler != NULL, "Compiler required");
+    check(module != NULL, "Module required");
+    check(function != NULL, "Function AST required");
+    check(function_name != NULL, "Function name required");
+    check(generated != NULL, "Generated return pointer required");
+    *generated = false;
+    
+    // Delegate to external interface if there is one.
+    if(compiler->codegen_external_call != NULL) {
+        rc = compiler->codegen_external_call(module, function, function_name, args, arg_count, generated);
+        check(rc == 0, "Unable to generate external function call: %s", bdata(function_name));
+    }
+    
+    return 0;
+    
+error:
+    if(generated) *generated = false;
+    return -1;
+}
+
+
+//======================================
+// Literal Generation
+//======================================
+
+// Gives the compiler caller a chance to generate the value of a literal
+// itself. This lets the caller turn literals into parameters that can be
+// changed after the module is compiled. The callback is optional and the
+// literal is generated as a constant when it is not set or when it doesn't
+// generate the value.
+//
+// compiler  - The compiler.
+// module    - The module.
+// node      - The literal AST node.
+// value     - A pointer to where the generated value is returned.
+// generated - A pointer to where a flag stating if the value was generated
+//             is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int qip_compiler_codegen_literal(qip_compiler *compiler,
+                                 qip_module *module,
+                                 qip_ast_node *node,
+                                 LLVMValueRef *value,
+                                 bool *generated)
+{
+    int rc;
+    check(compiler != NULL, "Compiler required");
+    check(module != NULL, "Module required");
+    check(node != NULL, "Literal AST required");
+    check(value != NULL, "Value return pointer required");
+    check(generated != NULL, "Generated return pointer required");
+    *generated = false;
+    
+    // Delegate to external interface if there is one.
+    if(compiler->codegen_literal != NULL) {
+        rc = compiler->codegen_literal(module, node, value, generated);
+        check(rc == 0, "Unable to generate literal");
+    }
+    
+    return 0;
+    
+error:
+    if(generated) *generated = false;
+    return -1;
+}
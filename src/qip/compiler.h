@@ -1,6 +1,7 @@
 #ifndef _qip_compiler_h
 #define _qip_compiler_h
 
+#include <stdbool.h>
 #include <llvm-c/ExecutionEngine.h>
 #include <llvm-c/Target.h>
 #include <llvm-c/Transforms/Scalar.h>
@@ -16,11 +17,26 @@
 
 typedef struct qip_compiler qip_compiler;
 
+// The optimization level that new compilers use.
+#define QIP_OPT_LEVEL_DEFAULT 2
+
+// The highest supported optimization level.
+#define QIP_OPT_LEVEL_MAX 3
+
+// The inlining threshold used at the highest optimization level. This is
+// the threshold LLVM uses for -O3. Its default threshold is 225.
+#define QIP_OPT_LEVEL_MAX_INLINE_THRESHOLD 250
+
 #include "module.h"
 #include "node.h"
+#include "ast_cache.h"
 
 typedef int (*qip_load_module_source_t)(qip_compiler *compiler, bstring name, bstring *source);
 typedef int (*qip_process_dynamic_class_t)(qip_module *module, qip_ast_node *class);
+typedef int (*qip_codegen_external_call_t)(qip_module *module, qip_ast_node *function,
+    bstring function_name, LLVMValueRef *args, unsigned int arg_count, bool *generated);
+typedef int (*qip_codegen_literal_t)(qip_module *module, qip_ast_node *node,
+    LLVMValueRef *value, bool *generated);
 
 
 //==============================================================================
@@ -37,6 +53,10 @@ struct qip_compiler {
     uint32_t dependency_count;
     qip_load_module_source_t load_module_source;
     qip_process_dynamic_class_t process_dynamic_class;
+    qip_codegen_external_call_t codegen_external_call;
+    qip_codegen_literal_t codegen_literal;
+    qip_ast_cache *ast_cache;
+    int32_t opt_level;
 };
 
 
@@ -69,6 +89,9 @@ int qip_compiler_compile(qip_compiler *compiler, qip_module *module, bstring sou
 
 int qip_compiler_add_class_path(qip_compiler *compiler, bstring path);
 
+int qip_compiler_load_module(qip_compiler *compiler, bstring name,
+    bstring *source, qip_ast_node **ast_module);
+
 int qip_compiler_load_module_source(qip_compiler *compiler, bstring name,
     bstring *source);
 
@@ -80,4 +103,21 @@ int qip_compiler_load_module_source(qip_compiler *compiler, bstring name,
 int qip_compiler_process_dynamic_class(qip_compiler *compiler,
     qip_module *module, qip_ast_node *class);
 
+
+//======================================
+// External Function Generation
+//======================================
+
+int qip_compiler_codegen_external_call(qip_compiler *compiler,
+    qip_module *module, qip_ast_node *function, bstring function_name,
+    LLVMValueRef *args, unsigned int arg_count, bool *generated);
+
+
+//======================================
+// Literal Generation
+//======================================
+
+int qip_compiler_codegen_literal(qip_compiler *compiler, qip_module *module,
+    qip_ast_node *node, LLVMValueRef *value, bool *generated);
+
 #endif
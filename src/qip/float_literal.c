@@ -87,9 +87,25 @@ int qip_ast_float_literal_codegen(qip_ast_node *node,
                                   qip_module *module,
                                   LLVMValueRef *value)
 {
+    int rc;
+    
+    // Allow the compiler caller to generate the literal.
+    if(module->compiler != NULL) {
+        bool generated = false;
+        rc = qip_compiler_codegen_literal(module->compiler, module, node, value, &generated);
+        check(rc == 0, "Unable to generate literal");
+        if(generated) {
+            return 0;
+        }
+    }
+
     LLVMContextRef context = LLVMGetModuleContext(module->llvm_module);
     *value = LLVMConstReal(LLVMDoubleTypeInContext(context), node->float_literal.value);
     return 0;
+
+error:
+    *value = NULL;
+    return -1;
 }
 
 
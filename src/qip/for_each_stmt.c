@@ -491,7 +491,7 @@ int qip_ast_for_each_stmt_validate_enumerable_enumerator(qip_ast_node *node,
                                                          qip_module *module)
 {
     int rc;
-    bstring msg;
+    bstring msg = NULL;
     check(node != NULL, "Node required");
     check(module != NULL, "Module required");
     
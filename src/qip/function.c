@@ -271,14 +271,16 @@ int qip_ast_function_codegen(qip_ast_node *node, qip_module *module,
     rc = LLVMVerifyFunction(func, LLVMPrintMessageAction);
     check(rc != 1, "Invalid function");
 
-    // Unset the current function.
-    rc = qip_module_pop_scope(module);
-    check(rc == 0, "Unable to remove function scope");
+    // Remove the placeholder alloca before the scope is freed.
     if(scope->llvm_last_alloca != NULL) {
         LLVMInstructionEraseFromParent(scope->llvm_last_alloca);
         scope->llvm_last_alloca = NULL;
     }
 
+    // Unset the current function.
+    rc = qip_module_pop_scope(module);
+    check(rc == 0, "Unable to remove function scope");
+
     // Reset the builder position at the end of the new function scope if
     // one still exists.
     qip_scope *new_scope = NULL;
@@ -311,6 +313,7 @@ int qip_ast_function_generate_external_call(qip_ast_node *node,
                                              LLVMBasicBlockRef block)
 {
     int rc;
+    LLVMValueRef *args = NULL;
     check(node != NULL, "Node required");
     check(block != NULL, "Block required");
     
@@ -334,7 +337,7 @@ int qip_ast_function_generate_external_call(qip_ast_node *node,
     // external functions so they have a context.
     unsigned int offset = 1;
     unsigned int total_arg_count = node->function.arg_count + offset;
-    LLVMValueRef *args = malloc(sizeof(LLVMValueRef) * total_arg_count); check_mem(args);
+    args = malloc(sizeof(LLVMValueRef) * total_arg_count); check_mem(args);
     args[0] = LLVMBuildLoad(builder, module->llvm_global_module_value, "");
     
     // Loop over function arguments to make call arguments.
@@ -355,6 +358,15 @@ int qip_ast_function_generate_external_call(qip_ast_node *node,
         check(args[i+offset] != NULL, "Unable to build load for function argument");
     }
     
+    // Let the compiler caller generate the function body if it wants to.
+    bool generated = false;
+    rc = qip_compiler_codegen_external_call(module->compiler, module, node, function_name, args, total_arg_count, &generated);
+    check(rc == 0, "Unable to delegate external function generation");
+    if(generated) {
+        free(args);
+        return 0;
+    }
+
     // Retrieve function.
     LLVMValueRef func = LLVMGetNamedFunction(module->llvm_module, bdata(function_name));
     check(func != NULL, "Unable to find external function: %s", bdata(function_name));
@@ -375,9 +387,11 @@ int qip_ast_function_generate_external_call(qip_ast_node *node,
         check(ret_value != NULL, "Unable to build external return value");
     }
     
+    free(args);
     return 0;
 
 error:
+    free(args);
     return -1;
 }
 
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 
 #include "map.h"
 #include "dbg.h"
@@ -10,6 +11,14 @@
 //
 //==============================================================================
 
+int qip_map_index_elements(qip_map *map);
+
+int qip_map_index_element(qip_map *map, void *elem);
+
+int qip_map_resize_buckets(qip_map *map, int64_t bucket_count);
+
+int64_t qip_map_hash(int64_t key);
+
 int qip_map_elem_cmp(const void *_a, const void *_b);
 
 
@@ -26,12 +35,8 @@ int qip_map_elem_cmp(const void *_a, const void *_b);
 // Creates a map.
 qip_map *qip_map_create()
 {
-    qip_map *map = malloc(sizeof(qip_map));
+    qip_map *map = calloc(1, sizeof(qip_map));
     check_mem(map);
-    map->elemsz = 0LL;
-    map->count = 0LL;
-    map->elements = NULL;
-    
     return map;
     
 error:
@@ -39,44 +44,95 @@ error:
     return NULL;
 }
 
-// Frees a map.
+// Frees a map and all of its elements.
 //
 // map - The map to free.
 void qip_map_free(qip_map *map)
 {
     if(map) {
-        uint32_t i;
-        for(i=0; i<map->count; i++) {
-            free(map->elements[i]);
-            map->elements[i] = NULL;
-        }
-        
-        if(map->elements) free(map->elements);
+        free(map->elements);
         map->elements = NULL;
+        free(map->buckets);
+        map->buckets = NULL;
+        free(map->dense);
+        map->dense = NULL;
+        if(map->pool != NULL) {
+            qip_mempool_free(map->pool);
+            map->pool = NULL;
+        }
 
         free(map);
     }
 }
 
 
+// Sets the number of keys that are directly indexed by the map's dense
+// table. Keys from zero up to, but not including, the dense count are looked
+// up without hashing. This can only be set before elements are added.
+//
+// map         - The map.
+// dense_count - The number of directly indexed keys.
+//
+// Returns 0 if successful, otherwise returns -1.
+int qip_map_set_dense_count(qip_map *map, int64_t dense_count)
+{
+    check(map != NULL, "Map required");
+    check(map->count == 0, "Dense count must be set on an empty map");
+    check(dense_count >= 0, "Dense count cannot be negative");
+
+    free(map->dense);
+    map->dense = NULL;
+    map->dense_count = 0;
+    if(dense_count > 0) {
+        map->dense = calloc(dense_count, sizeof(*map->dense));
+        check_mem(map->dense);
+        map->dense_count = dense_count;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+
 //======================================
 // Element Management
 //======================================
 
-// Allocates memory for a single element in the map.
+// Allocates memory for a single element in the map. The element can't be
+// found until its key is set and the map is refreshed. The memory pool is
+// created on first use since maps constructed by QIP code start zeroed.
 //
 // map - The map to allocate for.
 //
 // Returns a pointer to the new element.
 void *qip_map_elalloc(qip_module *module, qip_map *map)
 {
+    int rc;
+    void *elem = NULL;
     check(module != NULL, "Module required");
+    check(map != NULL, "Map required");
     
-    void *elem = calloc(map->elemsz, 1);
-    
-    map->count++;
-    map->elements = realloc(map->elements, sizeof(*map->elements) * map->count);
-    map->elements[map->count-1] = elem;
+    // Grow the element list by doubling it.
+    if(map->count == map->capacity) {
+        int64_t capacity = (map->capacity > 0 ? map->capacity * 2 : QIP_MAP_INITIAL_BUCKET_COUNT);
+        void **elements = realloc(map->elements, sizeof(*map->elements) * capacity);
+        check_mem(elements);
+        map->elements = elements;
+        map->capacity = capacity;
+    }
+
+    if(map->pool == NULL) {
+        map->pool = qip_mempool_create();
+        check_mem(map->pool);
+    }
+
+    rc = qip_mempool_malloc(map->pool, map->elemsz, &elem);
+    check(rc == 0, "Unable to allocate map element");
+    memset(elem, 0, map->elemsz);
+
+    map->elements[map->count++] = elem;
     
     return elem;
 
@@ -94,40 +150,57 @@ void *qip_map_find(qip_module *module, qip_map *map, int64_t key)
 {
     check(module != NULL, "Module required");
 
-    // Exit if there are no elements.
-    if(map->count == 0) {
+    // Keys in the dense range are indexed directly.
+    if((uint64_t)key < (uint64_t)map->dense_count) {
+        return map->dense[key];
+    }
+
+    // Exit if there are no hashed elements.
+    if(map->bucket_count == 0) {
         return NULL;
     }
     
-    // Perform a binary search to find the element.
-    void *key_ptr = &key;
-    void *ret = bsearch(&key_ptr, map->elements, map->count, sizeof(*map->elements), qip_map_elem_cmp);
-    
-    if(ret != NULL) {
-        return *((void**)ret);
-    }
-    else {
-        return NULL;
+    // Probe from the key's bucket until the key or an empty bucket is found.
+    int64_t mask = map->bucket_count - 1;
+    int64_t index = qip_map_hash(key) & mask;
+    while(map->buckets[index] != NULL) {
+        if(*((int64_t*)map->buckets[index]) == key) {
+            return map->buckets[index];
+        }
+        index = (index + 1) & mask;
     }
 
+    return NULL;
+
 error:
     return NULL;
 }
 
+// Finds an element in a map with an integer key. This is the lookup used by
+// Map<Int,U> so that embedders can generate it inline for dense keys.
+//
+// map - The map.
+// key - The key to search for.
+//
+// Returns a pointer to the element if found. Otherwise returns null.
+void *qip_map_find_int(qip_module *module, qip_map *map, int64_t key)
+{
+    return qip_map_find(module, map, key);
+}
+
 // Internally refreshes the map. This must be performed whenever a new element
-// is added and initialized.
+// is added and initialized so that it can be found by its key.
 //
 // map - The map.
 //
 // Returns nothing.
 void qip_map_refresh(qip_module *module, qip_map *map)
 {
+    int rc;
     check(module != NULL, "Module required");
 
-    // Sort the elements by hash code for faster lookup.
-    if(map->elements) {
-        qsort(map->elements, map->count, sizeof(*map->elements), qip_map_elem_cmp);
-    }
+    rc = qip_map_index_elements(map);
+    check(rc == 0, "Unable to index map elements");
 
     return;
     
@@ -136,6 +209,206 @@ error:
 }
 
 
+// Copies the elements of another map into a map. Elements whose key is
+// already in the map are combined using a merge function. The other map is
+// left empty.
+//
+// map   - The map to merge into.
+// other - The map to merge from.
+// merge - The function that combines two elements with the same key.
+//
+// Returns nothing.
+void qip_map_merge(qip_module *module, qip_map *map, qip_map *other,
+                   qip_map_merge_func merge)
+{
+    int rc;
+    check(module != NULL, "Module required");
+    check(map != NULL && other != NULL, "Maps required");
+    check(merge != NULL, "Merge function required");
+
+    // Maps that haven't been used yet don't know their element size.
+    if(map->elemsz == 0) {
+        map->elemsz = other->elemsz;
+    }
+    check(other->count == 0 || map->elemsz == other->elemsz, "Map element sizes must match");
+
+    // Combine elements that are in both maps and copy the rest.
+    int64_t i;
+    for(i=0; i<other->count; i++) {
+        void *elem = other->elements[i];
+        void *existing = qip_map_find(module, map, *((int64_t*)elem));
+        if(existing != NULL) {
+            merge(existing, elem);
+        }
+        else {
+            void *copy = qip_map_elalloc(module, map);
+            check(copy != NULL, "Unable to allocate merged element");
+            memcpy(copy, elem, map->elemsz);
+            rc = qip_map_index_elements(map);
+            check(rc == 0, "Unable to index merged element");
+        }
+    }
+
+    // Empty the other map.
+    other->count = 0;
+    other->indexed_count = 0;
+    if(other->buckets != NULL) {
+        memset(other->buckets, 0, sizeof(*other->buckets) * other->bucket_count);
+    }
+    if(other->dense != NULL) {
+        memset(other->dense, 0, sizeof(*other->dense) * other->dense_count);
+    }
+    if(other->pool != NULL) {
+        qip_mempool_free_blocks(other->pool);
+    }
+    return;
+
+error:
+    return;
+}
+
+// Sorts the elements of the map by key. Lookups are not affected so this
+// can be done at any time, such as before the elements are serialized.
+//
+// map - The map.
+//
+// Returns nothing.
+void qip_map_sort(qip_map *map)
+{
+    int rc;
+    check(map != NULL, "Map required");
+
+    // Index every element first since indexing follows element order.
+    rc = qip_map_index_elements(map);
+    check(rc == 0, "Unable to index map elements");
+
+    if(map->count > 0) {
+        qsort(map->elements, map->count, sizeof(*map->elements), qip_map_elem_cmp);
+    }
+    return;
+
+error:
+    return;
+}
+
+
+//======================================
+// Hash Table
+//======================================
+
+// Adds every element that was allocated since the last refresh to the hash
+// table.
+//
+// map - The map.
+//
+// Returns 0 if successful, otherwise returns -1.
+int qip_map_index_elements(qip_map *map)
+{
+    int rc;
+    check(map != NULL, "Map required");
+
+    for(; map->indexed_count < map->count; map->indexed_count++) {
+        rc = qip_map_index_element(map, map->elements[map->indexed_count]);
+        check(rc == 0, "Unable to index map element");
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Adds a single element to the dense table if its key is in range or to the
+// hash table otherwise. The hash table is doubled in size once the indexed
+// elements would fill three quarters of it.
+//
+// map  - The map.
+// elem - The element.
+//
+// Returns 0 if successful, otherwise returns -1.
+int qip_map_index_element(qip_map *map, void *elem)
+{
+    int rc;
+    check(map != NULL, "Map required");
+    check(elem != NULL, "Element required");
+
+    int64_t key = *((int64_t*)elem);
+    if((uint64_t)key < (uint64_t)map->dense_count) {
+        map->dense[key] = elem;
+        return 0;
+    }
+
+    if((map->indexed_count + 1) * 4 > map->bucket_count * 3) {
+        int64_t bucket_count = (map->bucket_count > 0 ? map->bucket_count * 2 : QIP_MAP_INITIAL_BUCKET_COUNT);
+        rc = qip_map_resize_buckets(map, bucket_count);
+        check(rc == 0, "Unable to resize map buckets");
+    }
+
+    int64_t mask = map->bucket_count - 1;
+    int64_t index = qip_map_hash(key) & mask;
+    while(map->buckets[index] != NULL) {
+        index = (index + 1) & mask;
+    }
+    map->buckets[index] = elem;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Rebuilds the hash table with a different number of buckets.
+//
+// map          - The map.
+// bucket_count - The new number of buckets. This must be a power of two.
+//
+// Returns 0 if successful, otherwise returns -1.
+int qip_map_resize_buckets(qip_map *map, int64_t bucket_count)
+{
+    int64_t i;
+    check(map != NULL, "Map required");
+    check(bucket_count > 0 && (bucket_count & (bucket_count - 1)) == 0, "Bucket count must be a power of two");
+
+    void **buckets = calloc(bucket_count, sizeof(*buckets));
+    check_mem(buckets);
+
+    int64_t mask = bucket_count - 1;
+    for(i=0; i<map->bucket_count; i++) {
+        void *elem = map->buckets[i];
+        if(elem != NULL) {
+            int64_t index = qip_map_hash(*((int64_t*)elem)) & mask;
+            while(buckets[index] != NULL) {
+                index = (index + 1) & mask;
+            }
+            buckets[index] = elem;
+        }
+    }
+
+    free(map->buckets);
+    map->buckets = buckets;
+    map->bucket_count = bucket_count;
+    return 0;
+
+error:
+    return -1;
+}
+
+// Mixes the bits of a key so that sequential keys are spread across the
+// hash table.
+//
+// key - The key.
+//
+// Returns the hash of the key.
+int64_t qip_map_hash(int64_t key)
+{
+    uint64_t hash = (uint64_t)key;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return (int64_t)(hash & INT64_MAX);
+}
+
+
 //======================================
 // Element Sorting
 //======================================
@@ -156,4 +429,4 @@ int qip_map_elem_cmp(const void *_a, const void *_b)
     else {
         return 0;
     }
-}
\ No newline at end of file
+}
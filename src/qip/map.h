@@ -3,6 +3,7 @@
 
 #include <inttypes.h>
 #include "module.h"
+#include "mempool.h"
 
 //==============================================================================
 //
@@ -10,15 +11,41 @@
 //
 //==============================================================================
 
+// The initial number of buckets in a map's hash table. This must be a power
+// of two.
+#define QIP_MAP_INITIAL_BUCKET_COUNT 16
+
 // The map struct holds the size of each element in bytes (elemsz), the number
-// of elements in the map (count), the size of the buffer (bcount), and a
-// pointer to where the elements are stored.
+// of elements in the map (count) and a pointer to where the elements are
+// stored in the order they were added.
+//
+// Elements are looked up by their key through an open-addressing hash table
+// of element pointers with linear probing. The first 8 bytes of every element
+// is its key. Elements are allocated from a memory pool owned by the map so
+// adding an element doesn't allocate unless a pool block is full.
+//
+// Maps can also have a dense table that directly indexes elements whose key
+// is between zero and the dense count. These elements are never hashed. The
+// dense count is set by the caller when it knows the range of the keys, such
+// as action ids.
+//
+// The fields must stay in the same order as the properties of the Map class.
 typedef struct {
     int64_t elemsz;
     int64_t count;
     void **elements;
+    int64_t capacity;
+    void **buckets;
+    int64_t bucket_count;
+    int64_t indexed_count;
+    qip_mempool *pool;
+    void **dense;
+    int64_t dense_count;
 } qip_map;
 
+// Combines an element from another map into the element with the same key.
+typedef void (*qip_map_merge_func)(void *elem, void *other);
+
 
 //==============================================================================
 //
@@ -34,6 +61,8 @@ qip_map *qip_map_create();
 
 void qip_map_free(qip_map *map);
 
+int qip_map_set_dense_count(qip_map *map, int64_t dense_count);
+
 
 //======================================
 // Element Management
@@ -43,6 +72,13 @@ void *qip_map_elalloc(qip_module *module, qip_map *map);
 
 void *qip_map_find(qip_module *module, qip_map *map, int64_t key);
 
+void *qip_map_find_int(qip_module *module, qip_map *map, int64_t key);
+
 void qip_map_refresh(qip_module *module, qip_map *map);
 
+void qip_map_merge(qip_module *module, qip_map *map, qip_map *other,
+    qip_map_merge_func merge);
+
+void qip_map_sort(qip_map *map);
+
 #endif
@@ -390,6 +390,7 @@ int qip_module_generate_template_type(qip_module *module,
 {
     int rc;
     qip_ast_template *template = NULL;
+    qip_ast_node *specialization_type_ref = NULL;
     check(module != NULL, "Module required");
     check(type_ref != NULL, "Type reference required");
     check(type_ref->type == QIP_AST_TYPE_TYPE_REF, "Node type must be 'type ref'");
@@ -430,8 +431,13 @@ int qip_module_generate_template_type(qip_module *module,
         check_mem(generated_class->class.name);
         qip_ast_class_free_template_vars(generated_class);
     
+        // Partial specializations are applied with the subtypes that are
+        // bound to their own template variables.
+        rc = qip_ast_class_get_specialization_type_ref(template_class, type_ref, &specialization_type_ref);
+        check(rc == 0, "Unable to match class specialization");
+
         // Create template & apply the template.
-        template = qip_ast_template_create(template_class, type_ref);
+        template = qip_ast_template_create(template_class, (specialization_type_ref != NULL ? specialization_type_ref : type_ref));
         check_mem(template);
         rc = qip_ast_template_apply(template, generated_class);
         check(rc == 0, "Unable to apply template to generated class");
@@ -441,6 +447,7 @@ int qip_module_generate_template_type(qip_module *module,
         check(rc == 0, "Unable to add generated class to module");
     
         qip_ast_template_free(template);
+        qip_ast_node_free(specialization_type_ref);
         
         // Return generated class.
         *class = generated_class;
@@ -452,6 +459,7 @@ int qip_module_generate_template_type(qip_module *module,
 error:
     bdestroy(generated_class_name);
     qip_ast_template_free(template);
+    qip_ast_node_free(specialization_type_ref);
     *class = NULL;
     return -1;
 }
@@ -1126,6 +1134,33 @@ error:
 }
 
 
+// Checks if a class defines a given method. Optional methods can be checked
+// before they are retrieved so that a missing method isn't logged as an
+// error.
+//
+// module      - The module.
+// class_name  - The name of the class.
+// method_name - The method name.
+//
+// Returns true if the method exists, otherwise returns false.
+bool qip_module_has_class_method(qip_module *module, bstring class_name,
+                                 bstring method_name)
+{
+    check(module != NULL, "Module required");
+    check(class_name != NULL, "Class name required");
+    check(method_name != NULL, "Method name required");
+
+    bstring function_name = bformat("%s.%s", bdata(class_name), bdata(method_name));
+    check_mem(function_name);
+    LLVMValueRef func_value = LLVMGetNamedFunction(module->llvm_module, bdata(function_name));
+    bdestroy(function_name);
+    return (func_value != NULL);
+
+error:
+    return false;
+}
+
+
 //--------------------------------------
 // Module Management
 //--------------------------------------
@@ -1154,6 +1189,83 @@ error:
 }
 
 
+//--------------------------------------
+// Optimization
+//--------------------------------------
+
+// Runs the optimization passes for an optimization level over the generated
+// code. This must be done before any function in the module is executed.
+//
+// Level 1 promotes variables to registers, inlines functions that are marked
+// to always be inlined and cleans up the result. Level 2 also inlines small
+// methods such as Map.get() and Cursor.eof(), removes redundant loads and
+// hoists loop invariant code out of loops. Level 3 inlines again with the
+// higher QIP_OPT_LEVEL_MAX_INLINE_THRESHOLD and unrolls loops. Level 0 runs
+// no passes.
+//
+// module    - The module.
+// opt_level - The optimization level.
+//
+// Returns 0 if successful, otherwise returns -1.
+int qip_module_optimize(qip_module *module, int32_t opt_level)
+{
+    check(module != NULL, "Module required");
+    check(opt_level >= 0 && opt_level <= QIP_OPT_LEVEL_MAX, "Invalid optimization level: %d", opt_level);
+
+    // Replace any previous pipeline.
+    if(module->llvm_pass_manager) LLVMDisposePassManager(module->llvm_pass_manager);
+    module->llvm_pass_manager = NULL;
+    if(opt_level == 0) {
+        return 0;
+    }
+
+    LLVMPassManagerRef pass_manager = LLVMCreatePassManager();
+    module->llvm_pass_manager = pass_manager;
+
+    // Level 1: Registers and forced inlining.
+    LLVMAddPromoteMemoryToRegisterPass(pass_manager);
+    LLVMAddAlwaysInlinerPass(pass_manager);
+    LLVMAddInstructionCombiningPass(pass_manager);
+    LLVMAddCFGSimplificationPass(pass_manager);
+
+    // Level 2: Inlining, redundancy elimination and loop invariant code.
+    if(opt_level >= 2) {
+        LLVMAddFunctionInliningPass(pass_manager);
+        LLVMAddScalarReplAggregatesPass(pass_manager);
+        LLVMAddEarlyCSEPass(pass_manager);
+        LLVMAddInstructionCombiningPass(pass_manager);
+        LLVMAddReassociatePass(pass_manager);
+        LLVMAddCFGSimplificationPass(pass_manager);
+        LLVMAddLoopRotatePass(pass_manager);
+        LLVMAddLICMPass(pass_manager);
+        LLVMAddGVNPass(pass_manager);
+        LLVMAddDeadStoreEliminationPass(pass_manager);
+    }
+
+    // Level 3: Aggressive inlining and loop unrolling.
+    if(opt_level >= 3) {
+        LLVMAddJumpThreadingPass(pass_manager);
+        LLVMPassManagerBuilderRef builder = LLVMPassManagerBuilderCreate();
+        LLVMPassManagerBuilderSetOptLevel(builder, 0);
+        LLVMPassManagerBuilderUseInlinerWithThreshold(builder, QIP_OPT_LEVEL_MAX_INLINE_THRESHOLD);
+        LLVMPassManagerBuilderPopulateModulePassManager(builder, pass_manager);
+        LLVMPassManagerBuilderDispose(builder);
+        LLVMAddLoopUnrollPass(pass_manager);
+        LLVMAddGVNPass(pass_manager);
+    }
+
+    LLVMAddInstructionCombiningPass(pass_manager);
+    LLVMAddCFGSimplificationPass(pass_manager);
+
+    LLVMRunPassManager(pass_manager, module->llvm_module);
+
+    return 0;
+
+error:
+    return -1;
+}
+
+
 //--------------------------------------
 // Error Management
 //--------------------------------------
@@ -6,6 +6,10 @@
 #include <llvm-c/ExecutionEngine.h>
 #include <llvm-c/Target.h>
 #include <llvm-c/Transforms/Scalar.h>
+#include <llvm-c/Transforms/IPO.h>
+#include <llvm-c/Transforms/InstCombine.h>
+#include <llvm-c/Transforms/Utils.h>
+#include <llvm-c/Transforms/PassManagerBuilder.h>
 
 
 //==============================================================================
@@ -160,12 +164,21 @@ int qip_module_execute_string(qip_module *module, qip_string *ret);
 int qip_module_get_class_method(qip_module *module, bstring class_name,
     bstring method_name, void **ret);
 
+bool qip_module_has_class_method(qip_module *module, bstring class_name,
+    bstring method_name);
+
 //--------------------------------------
 // Module Management
 //--------------------------------------
 
 int qip_module_update_module_ref(qip_module *module);
 
+//--------------------------------------
+// Optimization
+//--------------------------------------
+
+int qip_module_optimize(qip_module *module, int32_t opt_level);
+
 //--------------------------------------
 // Error Management
 //--------------------------------------
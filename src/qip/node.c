@@ -117,7 +117,7 @@ error:
     return -1;
 }
 
-// Copies a node and its children.
+// Copies a node and its children along with their source positions.
 //
 // node - The node to copy.
 // ret  - A pointer to where the new copy should be returned to.
@@ -167,6 +167,12 @@ int qip_ast_node_copy(qip_ast_node *node, qip_ast_node **ret)
         case QIP_AST_TYPE_ALLOCA: rc = qip_ast_alloca_copy(node, ret); break;
     }
     check(rc == 0, "Unable to copy node");
+
+    // Keep the source position so errors in copied nodes report their line.
+    if(*ret != NULL) {
+        (*ret)->line_no = node->line_no;
+        (*ret)->char_no = node->char_no;
+    }
     
     return 0;
 
@@ -30,6 +30,7 @@ sky_qip_cursor *sky_qip_cursor_create()
 void sky_qip_cursor_free(sky_qip_cursor *cursor)
 {
     if(cursor) {
+        sky_cursor_free(cursor->cursor);
         cursor->cursor = NULL;
         free(cursor);
     }
@@ -55,17 +56,22 @@ void sky_qip_cursor_next(qip_module *module, sky_qip_cursor *cursor,
     sky_qip_module *_module = (sky_qip_module*)module->context;
     check(_module != NULL, "Wrapped module required");
 
-    // Update the action id on the event.
+    // Update the action id and timestamp on the event.
     sky_action_id_t action_id;
     rc = sky_cursor_get_action_id(cursor->cursor, &action_id);
     check(rc == 0, "Unable to retrieve action id");
     event->action_id = (int64_t)action_id;
+    sky_timestamp_t timestamp;
+    rc = sky_cursor_get_timestamp(cursor->cursor, &timestamp);
+    check(rc == 0, "Unable to retrieve timestamp");
+    event->timestamp = (int64_t)timestamp;
     
     // Localize dynamic property info.
     int64_t property_count = _module->event_property_count;
     sky_property_id_t *property_ids = _module->event_property_ids;
     int64_t *property_offsets = _module->event_property_offsets;
     bstring *property_types = _module->event_property_types;
+    sky_dictionary **property_dictionaries = _module->event_property_dictionaries;
 
     // Read data block if we have properties attached to the wrapped module.
     uint32_t i;
@@ -135,12 +141,9 @@ void sky_qip_cursor_next(qip_module *module, sky_qip_cursor *cursor,
                         break;
                     }
                     else if(property_type == &SKY_DATA_TYPE_STRING) {
-                        qip_string *string_value = (qip_string*)property_value_ptr;
-                        string_value->length = minipack_unpack_raw(ptr, &sz);
+                        sz = sky_qip_cursor_unpack_string(ptr, property_dictionaries[i], (qip_string*)property_value_ptr);
                         check(sz != 0, "Unable to unpack event string data");
                         ptr += sz;
-                        string_value->data = ptr;
-                        ptr += string_value->length;
                         break;
                     }
                 }
@@ -166,6 +169,47 @@ error:
     return;
 }
 
+// Unpacks a string property value. Values of dictionary properties are
+// stored as codes but may also be stored as raw strings. The string points
+// into the event data or the dictionary so it is not copied.
+//
+// ptr        - A pointer to the packed value.
+// dictionary - The dictionary of the property, if it has one.
+// value      - A pointer to the string to update.
+//
+// Returns the number of bytes read if successful, otherwise returns 0.
+size_t sky_qip_cursor_unpack_string(void *ptr, sky_dictionary *dictionary,
+                                    qip_string *value)
+{
+    int rc;
+    size_t sz = 0;
+    check(ptr != NULL, "Pointer required");
+    check(value != NULL, "String required");
+
+    // Look up dictionary codes.
+    if(dictionary != NULL && !minipack_is_raw(ptr)) {
+        uint32_t code = (uint32_t)minipack_unpack_int(ptr, &sz);
+        check(sz != 0, "Unable to unpack event string code");
+        bstring str = NULL;
+        rc = sky_dictionary_get(dictionary, code, &str);
+        check(rc == 0 && str != NULL, "Unable to find dictionary string: %d", code);
+        value->length = blength(str);
+        value->data = bdata(str);
+    }
+    // Otherwise point at the raw string.
+    else {
+        value->length = minipack_unpack_raw(ptr, &sz);
+        check(sz != 0, "Unable to unpack event string data");
+        value->data = ptr + sz;
+        sz += value->length;
+    }
+
+    return sz;
+
+error:
+    return 0;
+}
+
 // Checks whether the cursor is at the end.
 //
 // module - The module.
@@ -4,6 +4,7 @@
 #include <inttypes.h>
 
 #include "cursor.h"
+#include "dictionary.h"
 #include "qip_event.h"
 #include "qip/qip.h"
 
@@ -44,5 +45,8 @@ void sky_qip_cursor_next(qip_module *module, sky_qip_cursor *cursor,
 
 bool sky_qip_cursor_eof(qip_module *module, sky_qip_cursor *cursor);
 
+size_t sky_qip_cursor_unpack_string(void *ptr, sky_dictionary *dictionary,
+    qip_string *value);
+
 
 #endif
@@ -17,6 +17,7 @@ sky_qip_event *sky_qip_event_create()
 {
     sky_qip_event *event = malloc(sizeof(sky_qip_event));
     event->action_id = 0LL;
+    event->timestamp = 0LL;
     return event;
 }
 
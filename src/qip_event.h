@@ -13,6 +13,7 @@
 // The event represents a state change or action at a specific point in time.
 typedef struct {
     int64_t action_id;
+    int64_t timestamp;
 } sky_qip_event;
 
 
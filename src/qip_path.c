@@ -17,18 +17,25 @@
 // Creates a path.
 sky_qip_path *sky_qip_path_create()
 {
-    sky_qip_path *path = malloc(sizeof(sky_qip_path));
-    path->path_ptr = NULL;
+    sky_qip_path *path = calloc(1, sizeof(sky_qip_path)); check_mem(path);
+    path->cursor = sky_qip_cursor_create(); check_mem(path->cursor);
     return path;
+
+error:
+    sky_qip_path_free(path);
+    return NULL;
 }
 
-// Frees a path.
+// Frees a path and its cursor.
 //
 // path - The path to free.
 void sky_qip_path_free(sky_qip_path *path)
 {
     if(path) {
         path->path_ptr = NULL;
+        path->path_ptrs = NULL;
+        sky_qip_cursor_free(path->cursor);
+        path->cursor = NULL;
         free(path);
     }
 }
@@ -38,21 +45,38 @@ void sky_qip_path_free(sky_qip_path *path)
 // Cursor Management
 //--------------------------------------
 
-// Retrieves a cursor for the current path.
+// Resets the path's cursor to the start of the current path. Every segment
+// of a spanned path is passed to the cursor.
 //
 // module - The module.
 // path   - The path.
 //
-// Returns a new cursor.
+// Returns the path's cursor.
 sky_qip_cursor *sky_qip_path_events(qip_module *module, sky_qip_path *path)
 {
+    int rc;
     check(module != NULL, "Module required");
+    check(path->cursor != NULL, "Path cursor required");
     
-    // Initialize cursor with path.
-    sky_qip_cursor *cursor = sky_qip_cursor_create();
-    sky_cursor_set_path(cursor->cursor, path->path_ptr);
+    // Restrict the cursor to the window before setting the paths.
+    sky_cursor *cursor = path->cursor->cursor;
+    cursor->windowed = path->windowed;
+    cursor->window_start = path->window_start;
+    cursor->window_end = path->window_end;
+
+    // Reset the cursor to the path.
+    if(path->path_count > 0) {
+        rc = sky_cursor_set_paths(cursor, path->path_ptrs, path->path_count);
+    }
+    else if(path->path_ptr != NULL) {
+        rc = sky_cursor_set_paths(cursor, &path->path_ptr, 1);
+    }
+    else {
+        rc = sky_cursor_set_paths(cursor, NULL, 0);
+    }
+    check(rc == 0, "Unable to set cursor paths");
     
-    return cursor;
+    return path->cursor;
 
 error:
     return NULL;
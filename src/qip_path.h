@@ -2,6 +2,7 @@
 #define _sky_qip_path_h
 
 #include <inttypes.h>
+#include <stdbool.h>
 
 #include "path_iterator.h"
 #include "qip_cursor.h"
@@ -14,9 +15,23 @@
 //
 //==============================================================================
 
-// The path stores a reference to the current path.
+// The path stores a reference to the current path. A path in spanned blocks
+// is set as a list of segments and `path_ptr` is only used when the list is
+// empty. If the path is windowed then cursors over it only return events in
+// the time window.
+//
+// The path is created once per query and reused for each path in the scan.
+// It owns a single cursor that is reset each time the events are requested
+// so that iterating over a path doesn't allocate memory. The cursor is only
+// valid until the next call to `events()` and is freed with the path.
 typedef struct {
     void *path_ptr;
+    void **path_ptrs;
+    uint32_t path_count;
+    bool windowed;
+    sky_timestamp_t window_start;
+    sky_timestamp_t window_end;
+    sky_qip_cursor *cursor;
 } sky_qip_path;
 
 
@@ -0,0 +1,442 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "dbg.h"
+#include "query_cache.h"
+
+
+//==============================================================================
+//
+// Forward Declarations
+//
+//==============================================================================
+
+int sky_query_cache_add_entry(sky_query_cache *cache, bstring key,
+    int32_t opt_level, sky_qip_module *module);
+
+int sky_query_cache_scan(bstring query_text, bool *verbatim, bstring key,
+    sky_qip_param **params, uint32_t *param_count);
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+// Creates a query cache for a table.
+//
+// table - The table that queries are compiled against.
+// size  - The maximum number of modules to keep.
+//
+// Returns a reference to a new query cache if successful. Otherwise returns
+// null.
+sky_query_cache *sky_query_cache_create(sky_table *table, uint32_t size)
+{
+    sky_query_cache *cache = NULL;
+    check(table != NULL, "Table required");
+
+    cache = calloc(1, sizeof(sky_query_cache)); check_mem(cache);
+    cache->table = table;
+    cache->size = size;
+    return cache;
+
+error:
+    sky_query_cache_free(cache);
+    return NULL;
+}
+
+// Removes a query cache and all of its modules from memory.
+//
+// cache - The query cache to free.
+void sky_query_cache_free(sky_query_cache *cache)
+{
+    if(cache) {
+        sky_query_cache_clear(cache);
+        free(cache);
+    }
+}
+
+// Frees every module in the cache.
+//
+// cache - The query cache.
+void sky_query_cache_clear(sky_query_cache *cache)
+{
+    if(cache) {
+        uint32_t i;
+        for(i=0; i<cache->entry_count; i++) {
+            bdestroy(cache->entries[i].key);
+            sky_qip_module_free(cache->entries[i].module);
+        }
+        free(cache->entries);
+        cache->entries = NULL;
+        cache->entry_count = 0;
+    }
+}
+
+
+//--------------------------------------
+// Modules
+//--------------------------------------
+
+// Retrieves a compiled module for a query. A cached module is reused if
+// another query with the same normalized text has been compiled already and
+// its parameters are updated with the literals of this query. Otherwise the
+// query is compiled and the module is added to the cache if it can be
+// reused.
+//
+// Cached modules are owned by the cache and must not be freed by the caller.
+// Modules that are not cached must be freed by the caller.
+//
+// cache      - The query cache.
+// query_text - The text of the query.
+// opt_level  - The optimization level or -1 for the compiler's default.
+// ret        - A pointer to where the module is returned.
+// cached     - A pointer to where a flag stating if the module is owned by
+//              the cache is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_query_cache_get_module(sky_query_cache *cache, bstring query_text,
+                               int32_t opt_level, sky_qip_module **ret,
+                               bool *cached)
+{
+    int rc;
+    uint32_t i;
+    bstring key = NULL;
+    sky_qip_param *params = NULL;
+    uint32_t param_count = 0;
+    sky_qip_module *module = NULL;
+    bool added = false;
+    check(cache != NULL, "Query cache required");
+    check(query_text != NULL, "Query text required");
+    check(ret != NULL, "Return pointer required");
+    check(cached != NULL, "Cached return pointer required");
+    *ret = NULL;
+    *cached = false;
+
+    // Modules are compiled against the table's actions and properties so
+    // they can't be reused once either of those change.
+    sky_table *table = cache->table;
+    uint32_t action_version = (table->action_file != NULL ? table->action_file->version : 0);
+    uint32_t property_version = (table->property_file != NULL ? table->property_file->version : 0);
+    if(action_version != cache->action_version || property_version != cache->property_version) {
+        sky_query_cache_clear(cache);
+        cache->action_version = action_version;
+        cache->property_version = property_version;
+    }
+
+    rc = sky_query_cache_normalize(query_text, &key, &params, &param_count);
+    check(rc == 0, "Unable to normalize query");
+
+    // Reuse a cached module with the values of this query's literals.
+    for(i=0; i<cache->entry_count; i++) {
+        sky_query_cache_entry *entry = &cache->entries[i];
+        if(entry->opt_level == opt_level && biseq(entry->key, key) == 1) {
+            rc = sky_qip_module_bind_params(entry->module, params, param_count);
+            check(rc == 0, "Unable to bind query parameters");
+            entry->last_used = ++cache->tick;
+            *ret = entry->module;
+            *cached = true;
+
+            bdestroy(key);
+            free(params);
+            return 0;
+        }
+    }
+
+    // Otherwise compile the query with its literals as parameters.
+    module = sky_qip_module_create(); check_mem(module);
+    module->table = table;
+    if(opt_level >= 0) {
+        module->compiler->opt_level = opt_level;
+    }
+    rc = sky_qip_module_set_params(module, params, param_count);
+    check(rc == 0, "Unable to set query parameters");
+    rc = sky_qip_module_compile(module, query_text);
+    check(rc == 0, "Unable to compile query");
+
+    if(module->cacheable && cache->size > 0) {
+        rc = sky_query_cache_add_entry(cache, key, opt_level, module);
+        check(rc == 0, "Unable to add module to query cache");
+        key = NULL;
+        added = true;
+    }
+    *ret = module;
+    *cached = added;
+
+    bdestroy(key);
+    free(params);
+    return 0;
+
+error:
+    if(!added) sky_qip_module_free(module);
+    bdestroy(key);
+    free(params);
+    if(ret) *ret = NULL;
+    if(cached) *cached = false;
+    return -1;
+}
+
+// Adds a compiled module to the cache. The least recently used module is
+// freed if the cache is full. The cache takes ownership of the key and the
+// module.
+//
+// cache     - The query cache.
+// key       - The normalized query text.
+// opt_level - The optimization level the module was compiled with.
+// module    - The compiled module.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_query_cache_add_entry(sky_query_cache *cache, bstring key,
+                              int32_t opt_level, sky_qip_module *module)
+{
+    uint32_t i;
+    check(cache != NULL, "Query cache required");
+    check(cache->size > 0, "Query cache is disabled");
+    check(key != NULL, "Key required");
+    check(module != NULL, "Module required");
+
+    sky_query_cache_entry *entry = NULL;
+    if(cache->entry_count < cache->size) {
+        sky_query_cache_entry *entries = realloc(cache->entries, (cache->entry_count + 1) * sizeof(*cache->entries));
+        check_mem(entries);
+        cache->entries = entries;
+        entry = &cache->entries[cache->entry_count++];
+    }
+    else {
+        entry = &cache->entries[0];
+        for(i=1; i<cache->entry_count; i++) {
+            if(cache->entries[i].last_used < entry->last_used) {
+                entry = &cache->entries[i];
+            }
+        }
+        bdestroy(entry->key);
+        sky_qip_module_free(entry->module);
+    }
+
+    entry->key = key;
+    entry->opt_level = opt_level;
+    entry->module = module;
+    entry->last_used = ++cache->tick;
+    return 0;
+
+error:
+    return -1;
+}
+
+
+//--------------------------------------
+// Normalization
+//--------------------------------------
+
+// Normalizes the text of a query so that queries that only differ by their
+// formatting, comments or the values of their int and float literals have
+// the same key. Each literal that is replaced in the key is returned as a
+// parameter in the order it appears in the query. Literals whose value
+// appears more than once are kept in the key.
+//
+// query_text  - The text of the query.
+// key         - A pointer to where the normalized text is returned.
+// params      - A pointer to where the parameters are returned.
+// param_count - A pointer to where the number of parameters is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_query_cache_normalize(bstring query_text, bstring *key,
+                              sky_qip_param **params, uint32_t *param_count)
+{
+    int rc;
+    uint32_t i, j;
+    sky_qip_param *literals = NULL;
+    uint32_t literal_count = 0;
+    bool *verbatim = NULL;
+    check(query_text != NULL, "Query text required");
+    check(key != NULL, "Key return pointer required");
+    check(params != NULL, "Parameters return pointer required");
+    check(param_count != NULL, "Parameter count return pointer required");
+    *key = NULL;
+    *params = NULL;
+    *param_count = 0;
+
+    // Find all literals.
+    rc = sky_query_cache_scan(query_text, NULL, NULL, &literals, &literal_count);
+    check(rc == 0, "Unable to scan query literals");
+
+    // Literals with the same value can't be matched to their AST nodes so
+    // they stay in the key.
+    if(literal_count > 0) {
+        verbatim = calloc(literal_count, sizeof(*verbatim)); check_mem(verbatim);
+    }
+    for(i=0; i<literal_count; i++) {
+        for(j=i+1; j<literal_count; j++) {
+            if(literals[i].type == literals[j].type &&
+               literals[i].int_value == literals[j].int_value &&
+               literals[i].float_value == literals[j].float_value)
+            {
+                verbatim[i] = verbatim[j] = true;
+            }
+        }
+    }
+
+    // Build the key.
+    *key = bfromcstr(""); check_mem(*key);
+    rc = sky_query_cache_scan(query_text, verbatim, *key, NULL, NULL);
+    check(rc == 0, "Unable to normalize query text");
+
+    // Return the remaining literals as parameters.
+    uint32_t count = 0;
+    for(i=0; i<literal_count; i++) {
+        if(!verbatim[i]) {
+            literals[count++] = literals[i];
+        }
+    }
+    if(count == 0) {
+        free(literals);
+        literals = NULL;
+    }
+    *params = literals;
+    *param_count = count;
+
+    free(verbatim);
+    return 0;
+
+error:
+    bdestroy(*key);
+    *key = NULL;
+    free(literals);
+    free(verbatim);
+    return -1;
+}
+
+// Splits the text of a query into tokens the same way as the Qip lexer.
+// Each int and float literal is appended to the parameters if they are
+// passed in. If a key is passed in then the tokens are appended to it with
+// single spaces in place of whitespace and comments and with placeholders
+// in place of the literals that are not verbatim.
+//
+// query_text  - The text of the query.
+// verbatim    - Flags stating which literals are kept in the key.
+// key         - The key to append to.
+// params      - A pointer to the parameters to append to.
+// param_count - A pointer to the number of parameters.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_query_cache_scan(bstring query_text, bool *verbatim, bstring key,
+                         sky_qip_param **params, uint32_t *param_count)
+{
+    check(query_text != NULL, "Query text required");
+    check(key == NULL || verbatim != NULL, "Verbatim flags required");
+
+    char *text = bdata(query_text);
+    int length = blength(query_text);
+    uint32_t literal_index = 0;
+    bool space = false;
+    int i = 0;
+    while(i < length) {
+        char ch = text[i];
+
+        // Comments and whitespace only separate tokens.
+        if(ch == '/' && i+1 < length && text[i+1] == '/') {
+            while(i < length && text[i] != '\n') {
+                i++;
+            }
+            space = true;
+            continue;
+        }
+        if(ch == '/' && i+1 < length && text[i+1] == '*') {
+            i += 2;
+            while(i < length && !(text[i] == '*' && i+1 < length && text[i+1] == '/')) {
+                i++;
+            }
+            i = (i < length ? i+2 : length);
+            space = true;
+            continue;
+        }
+        if(isspace(ch)) {
+            i++;
+            space = true;
+            continue;
+        }
+
+        // Find the end of the token.
+        int start = i;
+        bool literal = false;
+        sky_qip_param_type_e type = SKY_QIP_PARAM_INT;
+        if(ch == '"') {
+            i++;
+            while(i < length && text[i] != '"') {
+                i += (text[i] == '\\' && i+1 < length ? 2 : 1);
+            }
+            i = (i < length ? i+1 : length);
+        }
+        else if(isalpha(ch) || ch == '_') {
+            while(i < length && (isalnum(text[i]) || text[i] == '_')) {
+                i++;
+            }
+        }
+        else if(isdigit(ch)) {
+            while(i < length && isdigit(text[i])) {
+                i++;
+            }
+            if(i+1 < length && text[i] == '.' && isdigit(text[i+1])) {
+                type = SKY_QIP_PARAM_FLOAT;
+                i++;
+                while(i < length && isdigit(text[i])) {
+                    i++;
+                }
+            }
+
+            // Numbers that run into an identifier are left alone.
+            literal = true;
+            while(i < length && (isalnum(text[i]) || text[i] == '_')) {
+                literal = false;
+                i++;
+            }
+        }
+        else {
+            i++;
+        }
+
+        // Append the token to the key.
+        if(key != NULL) {
+            if(space && blength(key) > 0) {
+                check(bconchar(key, ' ') == BSTR_OK, "Unable to append to key");
+            }
+            if(literal && !verbatim[literal_index]) {
+                check(bcatcstr(key, (type == SKY_QIP_PARAM_INT ? "?" : "?.?")) == BSTR_OK, "Unable to append to key");
+            }
+            else {
+                check(bcatblk(key, &text[start], i-start) == BSTR_OK, "Unable to append to key");
+            }
+        }
+        space = false;
+
+        // Add the literal's value to the parameters.
+        if(literal && params != NULL) {
+            sky_qip_param *new_params = realloc(*params, (*param_count + 1) * sizeof(**params));
+            check_mem(new_params);
+            *params = new_params;
+            sky_qip_param *param = &(*params)[(*param_count)++];
+            memset(param, 0, sizeof(*param));
+            param->type = type;
+            if(type == SKY_QIP_PARAM_INT) {
+                param->int_value = strtoll(&text[start], NULL, 10);
+            }
+            else {
+                param->float_value = strtod(&text[start], NULL);
+            }
+        }
+        if(literal) {
+            literal_index++;
+        }
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
@@ -0,0 +1,91 @@
+#ifndef _query_cache_h
+#define _query_cache_h
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "bstring.h"
+#include "table.h"
+#include "sky_qip_module.h"
+
+
+//==============================================================================
+//
+// Overview
+//
+//==============================================================================
+
+// The query cache holds compiled query modules for a table so that a query
+// that is run more than once is only compiled the first time.
+//
+// Queries are cached by their normalized text. Comments are removed,
+// whitespace is collapsed and int and float literals are replaced with
+// placeholders. The literals are compiled as parameters so one module serves
+// every query that only differs by the values of its literals. A literal
+// whose value appears more than once in the query is kept in the normalized
+// text instead because its parameter couldn't be told apart from the others.
+//
+// Modules are compiled against the table's actions and properties so the
+// cache is cleared whenever either of them changes. Once the cache is full
+// the least recently used module is dropped.
+
+
+//==============================================================================
+//
+// Typedefs
+//
+//==============================================================================
+
+#define SKY_QUERY_CACHE_DEFAULT_SIZE 64
+
+typedef struct sky_query_cache_entry {
+    bstring key;
+    int32_t opt_level;
+    sky_qip_module *module;
+    uint64_t last_used;
+} sky_query_cache_entry;
+
+struct sky_query_cache {
+    sky_table *table;
+    sky_query_cache_entry *entries;
+    uint32_t entry_count;
+    uint32_t size;
+    uint64_t tick;
+    uint32_t action_version;
+    uint32_t property_version;
+};
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+sky_query_cache *sky_query_cache_create(sky_table *table, uint32_t size);
+
+void sky_query_cache_free(sky_query_cache *cache);
+
+void sky_query_cache_clear(sky_query_cache *cache);
+
+
+//--------------------------------------
+// Modules
+//--------------------------------------
+
+int sky_query_cache_get_module(sky_query_cache *cache, bstring query_text,
+    int32_t opt_level, sky_qip_module **ret, bool *cached);
+
+
+//--------------------------------------
+// Normalization
+//--------------------------------------
+
+int sky_query_cache_normalize(bstring query_text, bstring *key,
+    sky_qip_param **params, uint32_t *param_count);
+
+#endif
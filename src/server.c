@@ -2,6 +2,8 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <string.h>
+#include <poll.h>
 
 #include "bstring.h"
 #include "server.h"
@@ -14,6 +16,7 @@
 #include "padd_message.h"
 #include "pget_message.h"
 #include "pall_message.h"
+#include "query_cache.h"
 #include "dbg.h"
 
 
@@ -28,6 +31,24 @@ int sky_server_open_table(sky_server *server, bstring database_name,
 
 int sky_server_close_table(sky_server *server, sky_table *table);
 
+int sky_server_accept_connection(sky_server *server,
+    sky_server_connection *connection);
+
+int sky_server_accept_socket(sky_server *server,
+    sky_server_connection *connection);
+
+int sky_server_read_header(sky_server_connection *connection);
+
+bool sky_server_connection_is_readable(sky_server_connection *connection);
+
+int sky_server_process_connection(sky_server *server,
+    sky_server_connection *connection);
+
+void sky_server_close_connection(sky_server_connection *connection);
+
+int sky_server_defer_connection(sky_server *server,
+    sky_server_connection *connection);
+
 
 //==============================================================================
 //
@@ -66,6 +87,11 @@ void sky_server_free(sky_server *server)
 {
     if(server) {
         if(server->path) bdestroy(server->path);
+        uint32_t i;
+        for(i=0; i<server->pending_count; i++) {
+            sky_server_close_connection(&server->pending[i]);
+        }
+        free(server->pending);
         free(server);
     }
 }
@@ -150,7 +176,8 @@ int sky_server_stop(sky_server *server)
 //--------------------------------------
 
 // Accepts a connection on a running server. Once a connection is accepted then
-// the message is parsed and processed.
+// the message is parsed and processed. Connections that were held back while
+// a query was running are processed afterwards.
 //
 // server - The server to start.
 //
@@ -158,24 +185,185 @@ int sky_server_stop(sky_server *server)
 int sky_server_accept(sky_server *server)
 {
     int rc;
-    sky_message_header *header = NULL;
-    
+    sky_server_connection connection;
+
+    rc = sky_server_accept_connection(server, &connection);
+    check(rc == 0, "Unable to accept connection");
+    rc = sky_server_process_connection(server, &connection);
+
+    // Process held connections in the order they arrived. Queries among them
+    // can hold back more connections.
+    while(server->pending_count > 0) {
+        sky_server_connection pending = server->pending[0];
+        server->pending_count--;
+        memmove(server->pending, server->pending + 1, server->pending_count * sizeof(*server->pending));
+        sky_server_process_connection(server, &pending);
+    }
+    check(rc == 0, "Unable to process connection");
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Handles the connections that are waiting while a query runs. Event
+// additions for the table being queried are processed right away so that
+// inserts aren't blocked by long queries. Everything else, including schema
+// changes and connections that haven't sent their header yet, is held until
+// the query is done. This is the yield function for PEACH messages.
+//
+// _server - The server.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_server_yield(void *_server)
+{
+    int rc;
+    sky_server *server = (sky_server*)_server;
+    check(server != NULL, "Server required");
+
+    struct pollfd pfd;
+    pfd.fd = server->socket;
+    pfd.events = POLLIN;
+    while(poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN)) {
+        sky_server_connection connection;
+        rc = sky_server_accept_socket(server, &connection);
+        check(rc == 0, "Unable to accept connection");
+
+        // Only read the header if it won't block the query.
+        bool defer = true;
+        if(sky_server_connection_is_readable(&connection)) {
+            rc = sky_server_read_header(&connection);
+            if(rc != 0) continue;
+
+            // Only event additions for the queried table run now.
+            if(server->last_table != NULL && biseqcstr(connection.header->name, "eadd") == 1) {
+                bstring path = bformat("%s/%s/%s", bdata(server->path), bdata(connection.header->database_name), bdata(connection.header->table_name));
+                defer = (path == NULL || biseq(server->last_table->path, path) != 1);
+                bdestroy(path);
+            }
+        }
+
+        if(defer) {
+            rc = sky_server_defer_connection(server, &connection);
+            check(rc == 0, "Unable to hold connection");
+        }
+        else {
+            sky_server_process_connection(server, &connection);
+        }
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Accepts the next connection and reads its message header.
+//
+// server     - The server.
+// connection - The connection to initialize.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_server_accept_connection(sky_server *server,
+                                 sky_server_connection *connection)
+{
+    int rc;
+    rc = sky_server_accept_socket(server, connection);
+    check(rc == 0, "Unable to accept socket");
+    rc = sky_server_read_header(connection);
+    check(rc == 0, "Unable to read message header");
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Accepts the next connection without reading from it.
+//
+// server     - The server.
+// connection - The connection to initialize.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_server_accept_socket(sky_server *server,
+                             sky_server_connection *connection)
+{
+    connection->input = NULL;
+    connection->output = NULL;
+    connection->header = NULL;
+
     // Accept the next connection.
     int sockaddr_size = sizeof(struct sockaddr_in);
     int socket = accept(server->socket, (struct sockaddr*)server->sockaddr, (socklen_t *)&sockaddr_size);
     check(socket != -1, "Unable to accept connection");
 
     // Wrap socket in a buffered file reference.
-    FILE *input = fdopen(socket, "r");
-    FILE *output = fdopen(dup(socket), "w");
-    check(input != NULL, "Unable to open buffered socket input");
-    check(output != NULL, "Unable to open buffered socket output");
-    
-    // Parse message header.
-    header = sky_message_header_create(); check_mem(header);
-    rc = sky_message_header_unpack(header, input);
+    connection->input = fdopen(socket, "r");
+    connection->output = fdopen(dup(socket), "w");
+    check(connection->input != NULL, "Unable to open buffered socket input");
+    check(connection->output != NULL, "Unable to open buffered socket output");
+
+    return 0;
+
+error:
+    sky_server_close_connection(connection);
+    return -1;
+}
+
+// Reads the message header of a connection. The connection is closed if the
+// header can't be read.
+//
+// connection - The connection.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_server_read_header(sky_server_connection *connection)
+{
+    int rc;
+    connection->header = sky_message_header_create(); check_mem(connection->header);
+    rc = sky_message_header_unpack(connection->header, connection->input);
     check(rc == 0, "Unable to unpack message header");
 
+    return 0;
+
+error:
+    sky_server_close_connection(connection);
+    return -1;
+}
+
+// Checks if a connection has data waiting to be read.
+//
+// connection - The connection.
+//
+// Returns true if reading from the connection won't block.
+bool sky_server_connection_is_readable(sky_server_connection *connection)
+{
+    struct pollfd pfd;
+    pfd.fd = fileno(connection->input);
+    pfd.events = POLLIN;
+    return (poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN));
+}
+
+// Processes the message on a connection and closes it.
+//
+// server     - The server.
+// connection - The connection.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_server_process_connection(sky_server *server,
+                                  sky_server_connection *connection)
+{
+    int rc;
+
+    // Held connections may not have sent their header yet.
+    if(connection->header == NULL) {
+        rc = sky_server_read_header(connection);
+        check(rc == 0, "Unable to read message header");
+    }
+    sky_message_header *header = connection->header;
+    FILE *input = connection->input;
+    FILE *output = connection->output;
+
     // Open database & table.
     sky_table *table = NULL;
     rc = sky_server_open_table(server, header->database_name, header->table_name, &table);
@@ -211,16 +399,50 @@ int sky_server_accept(sky_server *server)
     }
     
     // Clean up.
-    sky_message_header_free(header);
-    fclose(input);
-    fclose(output);
+    sky_server_close_connection(connection);
+
+    // Flush a full memtable now that the client has its response.
+    rc = sky_table_flush_full_memtable(table);
+    check(rc == 0, "Unable to flush memtable");
 
     return 0;
 
 error:
-    sky_message_header_free(header);
-    fclose(input);
-    fclose(output);
+    sky_server_close_connection(connection);
+    return -1;
+}
+
+// Frees a connection's message header and closes its streams.
+//
+// connection - The connection.
+void sky_server_close_connection(sky_server_connection *connection)
+{
+    sky_message_header_free(connection->header);
+    connection->header = NULL;
+    if(connection->input) fclose(connection->input);
+    connection->input = NULL;
+    if(connection->output) fclose(connection->output);
+    connection->output = NULL;
+}
+
+// Holds a connection until the current query is done. The connection is
+// closed if it can't be held.
+//
+// server     - The server.
+// connection - The connection.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_server_defer_connection(sky_server *server,
+                                sky_server_connection *connection)
+{
+    sky_server_connection *pending = realloc(server->pending, (server->pending_count + 1) * sizeof(*pending));
+    check_mem(pending);
+    server->pending = pending;
+    server->pending[server->pending_count++] = *connection;
+    return 0;
+
+error:
+    sky_server_close_connection(connection);
     return -1;
 }
 
@@ -270,10 +492,15 @@ int sky_server_open_table(sky_server *server, bstring database_name,
         *table = sky_table_create(); check_mem(*table);
         rc = sky_table_set_path(*table, path);
         check(rc == 0, "Unable to set table path");
+        (*table)->defer_memtable_flush = true;
     
         // Open the table.
         rc = sky_table_open(*table);
         check(rc == 0, "Unable to open table");
+
+        // Cache compiled queries while the table is open.
+        (*table)->query_cache = sky_query_cache_create(*table, SKY_QUERY_CACHE_DEFAULT_SIZE);
+        check_mem((*table)->query_cache);
     
         // Save the reference as the currently open table.
         server->last_table = *table;
@@ -301,6 +528,10 @@ int sky_server_close_table(sky_server *server, sky_table *table)
     check(server != NULL, "Server required");
     check(table != NULL, "Table required");
     
+    // Free compiled queries before the properties they reference.
+    sky_query_cache_free(table->query_cache);
+    table->query_cache = NULL;
+
     // Close the table.
     rc = sky_table_close(table);
     check(rc == 0, "Unable to close table");
@@ -383,7 +614,10 @@ int sky_server_process_peach_message(sky_server *server, sky_table *table,
     rc = sky_peach_message_unpack(message, input);
     check(rc == 0, "Unable to parse PEACH message");
     
-    // Process message.
+    // Process message. Other messages for the table are handled while the
+    // query runs.
+    message->yield = sky_server_yield;
+    message->yield_data = server;
     rc = sky_peach_message_process(message, table, output);
     check(rc == 0, "Unable to process PEACH message");
     
@@ -10,6 +10,7 @@
 #include "database.h"
 #include "table.h"
 #include "event.h"
+#include "message_header.h"
 
 
 //==============================================================================
@@ -21,6 +22,12 @@
 // The server acts as the interface to external applications. It communicates
 // over TCP sockets using a specific Sky protocol. See the message.h file for
 // more detail on the protocol.
+//
+// Messages are processed one at a time except while a query runs. At the
+// yield points of a query the server accepts the connections that are waiting and
+// processes the messages that change or read the table being queried so
+// that writers aren't blocked by a long query. Queries and messages for
+// other tables are held until the current query is done.
 
 
 //==============================================================================
@@ -47,6 +54,13 @@ typedef enum sky_server_state_e {
 } sky_server_state_e;
 
 
+// A connection whose message header has been read.
+typedef struct sky_server_connection {
+    FILE *input;
+    FILE *output;
+    sky_message_header *header;
+} sky_server_connection;
+
 typedef struct {
     sky_server_state_e state;
     bstring path;
@@ -55,6 +69,8 @@ typedef struct {
     int socket;
     sky_database *last_database;
     sky_table *last_table;
+    sky_server_connection *pending;
+    uint32_t pending_count;
 } sky_server;
 
 
@@ -90,6 +106,8 @@ int sky_server_stop(sky_server *server);
 
 int sky_server_accept(sky_server *server);
 
+int sky_server_yield(void *server);
+
 
 //--------------------------------------
 // Event Messages
@@ -1,18 +1,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <getopt.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 
 #include "bstring.h"
 #include "dbg.h"
 #include "database.h"
 #include "table.h"
+#include "data_file.h"
 #include "cursor.h"
 #include "path_iterator.h"
+#include "peach_message.h"
 #include "version.h"
 
 #include "qip/qip.h"
 #include "qip_path.h"
+#include "sky_qip_module.h"
 
 
 //==============================================================================
@@ -22,8 +27,13 @@
 //==============================================================================
 
 // The sky-bench application is used for benchmarking databases in different
-// ways. The tool currently only supports basic iteration through the entire
-// database.
+// ways. The tool supports iteration through the entire database (using either
+// the C API or QIP) as well as insertion into a new table.
+//
+// The count benchmark reports its scan rate. By default the table is read
+// from the page cache after the first pass. With the cold option the table is
+// dropped from the page cache before every pass so the scan rate can be
+// compared against disk bandwidth.
 
 
 //==============================================================================
@@ -35,7 +45,19 @@
 typedef struct Options {
     bstring path;
     bstring table_name;
+    bstring benchmark;
     int32_t iterations;
+    int32_t event_count;
+    int32_t object_count;
+    int32_t block_size;
+    int32_t batch_size;
+    int32_t chunk_size;
+    int32_t large_path_threshold;
+    int32_t version;
+    int32_t memtable_size;
+    int32_t worker_count;
+    int32_t opt_level;
+    bool cold;
 } Options;
 
 
@@ -63,18 +85,32 @@ Options *parseopts(int argc, char **argv)
 {
     Options *options = (Options*)calloc(1, sizeof(Options));
     check_mem(options);
+    options->opt_level = -1;
+    options->chunk_size = -1;
     
     // Command line options.
     struct option long_options[] = {
         {"table-name", required_argument, 0, 't'},
         {"iterations", required_argument, 0, 'i'},
+        {"benchmark", required_argument, 0, 'b'},
+        {"event-count", required_argument, 0, 'e'},
+        {"object-count", required_argument, 0, 'c'},
+        {"block-size", required_argument, 0, 's'},
+        {"batch-size", required_argument, 0, 'n'},
+        {"chunk-size", required_argument, 0, 'k'},
+        {"large-path-threshold", required_argument, 0, 'l'},
+        {"format-version", required_argument, 0, 'V'},
+        {"memtable-size", required_argument, 0, 'm'},
+        {"workers", required_argument, 0, 'w'},
+        {"opt-level", required_argument, 0, 'O'},
+        {"cold", no_argument, 0, 'C'},
         {0, 0, 0, 0}
     };
 
     // Parse command line options.
     while(1) {
         int option_index = 0;
-        int c = getopt_long(argc, argv, "o:i:", long_options, &option_index);
+        int c = getopt_long(argc, argv, "o:i:b:e:c:s:n:k:l:V:m:w:O:C", long_options, &option_index);
         
         // Check for end of options.
         if(c == -1) {
@@ -93,6 +129,67 @@ Options *parseopts(int argc, char **argv)
                 options->iterations = atoi(optarg);
                 break;
             }
+
+            case 'b': {
+                options->benchmark = bfromcstr(optarg);
+                check_mem(options->benchmark);
+                break;
+            }
+
+            case 'e': {
+                options->event_count = atoi(optarg);
+                break;
+            }
+
+            case 'c': {
+                options->object_count = atoi(optarg);
+                break;
+            }
+
+            case 's': {
+                options->block_size = atoi(optarg);
+                break;
+            }
+
+            case 'n': {
+                options->batch_size = atoi(optarg);
+                break;
+            }
+
+            case 'k': {
+                options->chunk_size = atoi(optarg);
+                break;
+            }
+
+            case 'l': {
+                options->large_path_threshold = atoi(optarg);
+                break;
+            }
+
+            case 'V': {
+                options->version = atoi(optarg);
+                break;
+            }
+
+            case 'm': {
+                options->memtable_size = atoi(optarg);
+                break;
+            }
+
+            case 'w': {
+                options->worker_count = atoi(optarg);
+                break;
+            }
+
+            case 'O': {
+                options->opt_level = atoi(optarg);
+                break;
+            }
+
+            case 'C': {
+                options->cold = true;
+                break;
+            }
         }
     }
     
@@ -118,6 +215,19 @@ Options *parseopts(int argc, char **argv)
     if(options->iterations <= 0) {
         options->iterations = 1;
     }
+    if(options->benchmark == NULL) {
+        options->benchmark = bfromcstr("count");
+        check_mem(options->benchmark);
+    }
+    if(options->event_count <= 0) {
+        options->event_count = 1000000;
+    }
+    if(options->object_count <= 0) {
+        options->object_count = options->event_count / 10;
+    }
+    if(options->batch_size <= 0) {
+        options->batch_size = 1;
+    }
 
     return options;
     
@@ -131,6 +241,8 @@ void Options_free(Options *options)
         bdestroy(options->path);
         bdestroy(options->table_name);
         options->table_name = NULL;
+        bdestroy(options->benchmark);
+        options->benchmark = NULL;
         free(options);
     }
 }
@@ -151,10 +263,70 @@ void print_version()
 void usage()
 {
     fprintf(stderr, "usage: sky-bench [OPTIONS] [PATH]\n\n");
+    fprintf(stderr, "  -b, --benchmark=NAME     dag, count, peach, paths or insert\n");
+    fprintf(stderr, "                           (default: count)\n");
+    fprintf(stderr, "  -i, --iterations=NUM     number of passes over the table\n");
+    fprintf(stderr, "  -e, --event-count=NUM    number of events to insert\n");
+    fprintf(stderr, "  -c, --object-count=NUM   number of distinct object ids to insert\n");
+    fprintf(stderr, "  -s, --block-size=NUM     block size of the new table\n");
+    fprintf(stderr, "  -n, --batch-size=NUM     number of events inserted per call\n");
+    fprintf(stderr, "  -k, --chunk-size=NUM     bytes to grow the data file by at a time\n");
+    fprintf(stderr, "                           (default: 16MB, 0 sizes files exactly)\n");
+    fprintf(stderr, "  -l, --large-path-threshold=NUM\n");
+    fprintf(stderr, "                           path size at which paths move to extents\n");
+    fprintf(stderr, "  -V, --format-version=NUM data file format version of the new table\n");
+    fprintf(stderr, "  -m, --memtable-size=NUM  bytes of new events to hold in memory\n");
+    fprintf(stderr, "  -w, --workers=NUM        number of threads per query (default: one per CPU)\n");
+    fprintf(stderr, "  -O, --opt-level=NUM      query optimization level from 0 to 3 (default: 2)\n");
+    fprintf(stderr, "  -C, --cold               drop the table from the page cache before each\n");
+    fprintf(stderr, "                           pass of the count benchmark\n\n");
     exit(0);
 }
 
 
+//==============================================================================
+//
+// Page Cache
+//
+//==============================================================================
+
+// Drops a data file's blocks and extents from the OS page cache so that the
+// next scan reads them from disk. Pages that are still mapped or dirty can't
+// be dropped so the data file is synced and unmapped from this process'
+// page tables first. The mapping itself stays valid.
+//
+// data_file - The data file.
+//
+// Returns 0 if successful, otherwise returns -1.
+int evict_data_file(sky_data_file *data_file)
+{
+    int rc;
+    check(data_file != NULL, "Data file required");
+
+    rc = sky_data_file_sync(data_file);
+    check(rc == 0, "Unable to sync data file");
+
+    if(data_file->data != NULL && data_file->data_length > 0) {
+        rc = madvise(data_file->data, data_file->data_length, MADV_DONTNEED);
+        check(rc == 0, "Unable to unmap data file pages");
+        rc = posix_fadvise(data_file->data_fd, 0, 0, POSIX_FADV_DONTNEED);
+        check(rc == 0, "Unable to drop data file from page cache");
+    }
+
+    if(data_file->extent_data != NULL && data_file->extent_data_length > 0) {
+        rc = madvise(data_file->extent_data, data_file->extent_data_length, MADV_DONTNEED);
+        check(rc == 0, "Unable to unmap extent file pages");
+        rc = posix_fadvise(data_file->extent_fd, 0, 0, POSIX_FADV_DONTNEED);
+        check(rc == 0, "Unable to drop extent file from page cache");
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+
 //==============================================================================
 //
 // Benchmark
@@ -272,32 +444,26 @@ error:
 
 
 // Executes the benchmark to count the number of times an action occurred
-// using the QIP language.
+// using the QIP language. Only the scans are timed so the scan rate doesn't
+// include compiling the query or dropping the page cache.
 //
 // options - A list of options to use.
 void benchmark_count_with_qip(Options *options)
 {
     int rc;
     uint32_t path_count = 0;
+    int64_t elapsed = 0;
+    struct timeval tv;
+    sky_qip_module *module = NULL;
+
+    // Initialize table.
+    sky_table *table = sky_table_create(); check_mem(table);
+    rc = sky_table_set_path(table, options->path);
+    check(rc == 0, "Unable to set path on table");
     
-    // Initialize the query.
-    qip_ast_node *type_ref, *var_decl;
-    uint32_t arg_count = 2;
-    qip_ast_node *args[arg_count];
-    
-    // Path arg.
-    struct tagbstring path_str = bsStatic("path");
-    type_ref = qip_ast_type_ref_create_cstr("Path");
-    var_decl = qip_ast_var_decl_create(type_ref, &path_str, NULL);
-    args[0] = qip_ast_farg_create(var_decl);
-    
-    // Map arg.
-    struct tagbstring data_str = bsStatic("data");
-    type_ref = qip_ast_type_ref_create_cstr("Map");
-    qip_ast_type_ref_add_subtype(type_ref, qip_ast_type_ref_create_cstr("Int"));
-    qip_ast_type_ref_add_subtype(type_ref, qip_ast_type_ref_create_cstr("Result"));
-    var_decl = qip_ast_var_decl_create(type_ref, &data_str, NULL);
-    args[1] = qip_ast_farg_create(var_decl);
+    // Open table
+    rc = sky_table_open(table);
+    check(rc == 0, "Unable to open table");
 
     // Initialize query.
     struct tagbstring query = bsStatic(
@@ -313,32 +479,21 @@ void benchmark_count_with_qip(Options *options)
         "}\n"
         "return;"
     );
-    struct tagbstring module_name = bsStatic("qip");
-    struct tagbstring core_class_path = bsStatic("lib/core");
-    struct tagbstring sky_class_path = bsStatic("lib/sky");
-    qip_compiler *compiler = qip_compiler_create();
-    qip_compiler_add_class_path(compiler, &core_class_path);
-    qip_compiler_add_class_path(compiler, &sky_class_path);
-    qip_module *module = qip_module_create(&module_name, compiler);
-    rc = qip_compiler_compile(compiler, module, &query, args, arg_count);
-    check(rc == 0, "Unable to compile");
-    if(module->error_count > 0) fprintf(stderr, "Parse error [line %d] %s\n", module->errors[0]->line_no, bdata(module->errors[0]->message));
-    check(module->error_count == 0, "Compile error");
-    qip_compiler_free(compiler);
-
-    // Retrieve pointer to function.
-    sky_qip_path_map_func process_path = NULL;
-    rc = qip_module_get_main_function(module, (void*)(&process_path));
-    check(rc == 0, "Unable to retrieve main function");
 
-    // Initialize table.
-    sky_table *table = sky_table_create(); check_mem(table);
-    rc = sky_table_set_path(table, options->path);
-    check(rc == 0, "Unable to set path on table");
-    
-    // Open table
-    rc = sky_table_open(table);
-    check(rc == 0, "Unable to open table");
+    // Compile the query against the table. Retrieving the main function
+    // finishes JIT compilation so it is included in the compile time.
+    gettimeofday(&tv, NULL);
+    int64_t t0 = (tv.tv_sec*1000000) + tv.tv_usec;
+    module = sky_qip_module_create(); check_mem(module);
+    module->table = table;
+    if(options->opt_level >= 0) {
+        module->compiler->opt_level = options->opt_level;
+    }
+    rc = sky_qip_module_compile(module, &query);
+    check(rc == 0, "Unable to compile");
+    sky_qip_path_map_func process_path = (sky_qip_path_map_func)module->main_function;
+    gettimeofday(&tv, NULL);
+    int64_t t1 = (tv.tv_sec*1000000) + tv.tv_usec;
 
     // Loop for desired number of iterations.
     int i;
@@ -346,19 +501,28 @@ void benchmark_count_with_qip(Options *options)
         sky_path_iterator iterator;
         sky_path_iterator_init(&iterator);
 
+        // Read the table from disk on every pass of a cold run.
+        if(options->cold) {
+            rc = evict_data_file(table->data_file);
+            check(rc == 0, "Unable to drop table from page cache");
+        }
+
         // Attach data file.
+        gettimeofday(&tv, NULL);
+        int64_t pass_t0 = (tv.tv_sec*1000000) + tv.tv_usec;
         rc = sky_path_iterator_set_data_file(&iterator, table->data_file);
         check(rc == 0, "Unable to initialze path iterator");
 
         // Initialize QIP args.
-        sky_qip_path *path = sky_qip_path_create();
+        sky_qip_path *path = sky_qip_path_create(); check_mem(path);
         qip_map *map = qip_map_create();
+        qip_map_set_dense_count(map, module->map_key_count);
         
         // Iterate over each path.
         while(!iterator.eof) {
-            // Retrieve the path pointer.
-            rc = sky_path_iterator_get_ptr(&iterator, &path->path_ptr);
-            check(rc == 0, "Unable to retrieve the path iterator pointer");
+            // Retrieve the path segments.
+            rc = sky_path_iterator_get_ptrs(&iterator, &path->path_ptrs, &path->path_count);
+            check(rc == 0, "Unable to retrieve the path iterator pointers");
         
             // Execute query.
             process_path(path, map);
@@ -372,19 +536,286 @@ void benchmark_count_with_qip(Options *options)
         
         // Clean up iteration.
         qip_map_free(map);
+        sky_qip_path_free(path);
+        sky_path_iterator_set_partitions(&iterator, NULL, 0);
+        gettimeofday(&tv, NULL);
+        elapsed += ((tv.tv_sec*1000000) + tv.tv_usec) - pass_t0;
     }
+
+    // The scan rate is based on the blocks scanned. Bytes per microsecond
+    // is the same as megabytes per second.
+    double scanned = (double)table->data_file->block_count * table->data_file->block_size * options->iterations;
     
     // Clean up
+    sky_qip_module_free(module);
     rc = sky_table_close(table);
     check(rc == 0, "Unable to close table");
     sky_table_free(table);
 
     // Show stats.
     printf("Total paths processed: %d\n", path_count);
+    printf("Compile time: %.3f ms\n", ((double)(t1-t0))/1000);
+    printf("Run time: %.3f ms\n", ((double)elapsed)/1000);
+    printf("Scan rate: %.1f MB/s (%s cache)\n", (elapsed > 0 ? scanned/elapsed : 0), (options->cold ? "cold" : "warm"));
     
     return;
     
 error:
+    sky_qip_module_free(module);
+    sky_table_free(table);
+}
+
+
+// Executes the benchmark to measure the overhead of moving a QIP cursor to
+// each path. The path's cursor is reset the same way that `path.events()`
+// resets it and the events are counted without being decoded so the time
+// per path is mostly iteration overhead.
+//
+// options - A list of options to use.
+void benchmark_paths(Options *options)
+{
+    int rc;
+    struct timeval tv;
+    uint32_t path_count = 0;
+    uint32_t event_count = 0;
+    int64_t elapsed = 0;
+    sky_qip_path *path = NULL;
+    qip_module *module = NULL;
+    sky_path_iterator iterator;
+    sky_path_iterator_init(&iterator);
+
+    // Initialize table.
+    sky_table *table = sky_table_create(); check_mem(table);
+    rc = sky_table_set_path(table, options->path);
+    check(rc == 0, "Unable to set path on table");
+
+    // Open table
+    rc = sky_table_open(table);
+    check(rc == 0, "Unable to open table");
+
+    // The module is only passed through to the cursor functions.
+    module = qip_module_create(NULL, NULL); check_mem(module);
+    path = sky_qip_path_create(); check_mem(path);
+
+    // Loop for desired number of iterations.
+    int i;
+    for(i=0; i<options->iterations; i++) {
+        rc = sky_path_iterator_set_data_file(&iterator, table->data_file);
+        check(rc == 0, "Unable to initialze path iterator");
+
+        gettimeofday(&tv, NULL);
+        int64_t t0 = (tv.tv_sec*1000000) + tv.tv_usec;
+        while(!iterator.eof) {
+            rc = sky_path_iterator_get_ptrs(&iterator, &path->path_ptrs, &path->path_count);
+            check(rc == 0, "Unable to retrieve the path iterator pointers");
+
+            sky_qip_cursor *cursor = sky_qip_path_events(module, path);
+            check(cursor != NULL, "Unable to retrieve path cursor");
+            while(!cursor->cursor->eof) {
+                event_count++;
+                rc = sky_cursor_next(cursor->cursor);
+                check(rc == 0, "Unable to find next event");
+            }
+
+            rc = sky_path_iterator_next(&iterator);
+            check(rc == 0, "Unable to find next path");
+            path_count++;
+        }
+        gettimeofday(&tv, NULL);
+        elapsed += ((tv.tv_sec*1000000) + tv.tv_usec) - t0;
+    }
+
+    // Clean up
+    sky_path_iterator_set_partitions(&iterator, NULL, 0);
+    sky_qip_path_free(path);
+    qip_module_free(module);
+    rc = sky_table_close(table);
+    check(rc == 0, "Unable to close table");
+    sky_table_free(table);
+
+    // Show stats.
+    printf("Total paths processed: %d\n", path_count);
+    printf("Total events processed: %d\n", event_count);
+    printf("Overhead: %.3f usec/path\n", (path_count > 0 ? ((double)elapsed)/path_count : 0));
+    return;
+
+error:
+    sky_path_iterator_set_partitions(&iterator, NULL, 0);
+    sky_qip_path_free(path);
+    qip_module_free(module);
+    sky_table_free(table);
+}
+
+
+// Executes the count benchmark as a PEACH query so that the query is split
+// between worker threads the same way the server runs it.
+//
+// options - A list of options to use.
+void benchmark_peach(Options *options)
+{
+    int rc;
+    FILE *output = NULL;
+    sky_peach_message *message = NULL;
+
+    // Initialize table.
+    sky_table *table = sky_table_create(); check_mem(table);
+    rc = sky_table_set_path(table, options->path);
+    check(rc == 0, "Unable to set path on table");
+    if(options->worker_count > 0) {
+        table->query_worker_count = options->worker_count;
+    }
+
+    // Open table
+    rc = sky_table_open(table);
+    check(rc == 0, "Unable to open table");
+
+    // Initialize the query. The merge() method lets each worker count into
+    // its own results.
+    message = sky_peach_message_create(); check_mem(message);
+    message->query = bfromcstr(
+        "[Hashable(\"id\")]\n"
+        "class Result {\n"
+        "  public Int id;\n"
+        "  public Int count;\n"
+        "  public void merge(Result other)\n"
+        "  {\n"
+        "    this.count = this.count + other.count;\n"
+        "  }\n"
+        "}\n"
+        "Cursor cursor = path.events();\n"
+        "for each (Event event in cursor) {\n"
+        "  Result item = data.get(event.actionId);\n"
+        "  item.count = item.count + 1;\n"
+        "}\n"
+        "return;"
+    );
+    check_mem(message->query);
+    message->opt_level = options->opt_level;
+    output = fopen("/dev/null", "w");
+    check(output != NULL, "Unable to open output stream");
+
+    // Loop for desired number of iterations.
+    int i;
+    for(i=0; i<options->iterations; i++) {
+        rc = sky_peach_message_process(message, table, output);
+        check(rc == 0, "Unable to process query");
+    }
+
+    // Clean up
+    fclose(output);
+    bdestroy(message->query);
+    sky_peach_message_free(message);
+    rc = sky_table_close(table);
+    check(rc == 0, "Unable to close table");
+    sky_table_free(table);
+    return;
+
+error:
+    if(output) fclose(output);
+    if(message) bdestroy(message->query);
+    sky_peach_message_free(message);
+    sky_table_free(table);
+}
+
+
+// Executes the benchmark to insert events into a new table in random object
+// order. The insertion rate is reported periodically along with the block
+// count so that the cost of insertion can be compared as the table grows.
+// Events are inserted in batches when a batch size is specified.
+//
+// options - A list of options to use.
+void benchmark_insert(Options *options)
+{
+    int rc;
+    struct timeval tv;
+    uint32_t event_count = 0;
+    sky_event **events = NULL;
+    uint32_t report_interval = (options->event_count >= 10 ? options->event_count / 10 : 1);
+    
+    // Initialize table.
+    sky_table *table = sky_table_create(); check_mem(table);
+    rc = sky_table_set_path(table, options->path);
+    check(rc == 0, "Unable to set path on table");
+    if(options->block_size > 0) {
+        table->default_block_size = options->block_size;
+    }
+    if(options->chunk_size >= 0) {
+        table->data_file_chunk_size = options->chunk_size;
+    }
+    if(options->large_path_threshold > 0) {
+        table->large_path_threshold = options->large_path_threshold;
+    }
+    if(options->version > 0) {
+        table->data_file_version = options->version;
+    }
+    if(options->memtable_size > 0) {
+        table->memtable_size = options->memtable_size;
+    }
+    
+    // Open table
+    rc = sky_table_open(table);
+    check(rc == 0, "Unable to open table");
+
+    // Allocate batch.
+    events = calloc(options->batch_size, sizeof(*events));
+    check_mem(events);
+
+    // Insert events using a fixed seed so runs are comparable.
+    srand(0);
+    gettimeofday(&tv, NULL);
+    int64_t t0 = (tv.tv_sec*1000000) + tv.tv_usec;
+    int32_t i;
+    for(i=0; i<options->event_count; i++) {
+        sky_object_id_t object_id = 1 + (rand() % options->object_count);
+        sky_timestamp_t timestamp = rand();
+        sky_action_id_t action_id = 1 + (rand() % 100);
+        events[event_count] = sky_event_create(object_id, timestamp, action_id);
+        check_mem(events[event_count]);
+        event_count++;
+
+        // Insert the batch once it is full or a report is due.
+        bool report = ((i+1) % report_interval == 0);
+        if(event_count == (uint32_t)options->batch_size || report || i+1 == options->event_count) {
+            if(event_count == 1) {
+                rc = sky_table_add_event(table, events[0]);
+            }
+            else {
+                rc = sky_table_add_events(table, events, event_count);
+            }
+            check(rc == 0, "Unable to add events");
+            while(event_count > 0) {
+                sky_event_free(events[--event_count]);
+            }
+        }
+
+        // Report the rate over the last interval.
+        if(report) {
+            gettimeofday(&tv, NULL);
+            int64_t t1 = (tv.tv_sec*1000000) + tv.tv_usec;
+            printf("events: %d, blocks: %d, %.3f usec/event\n", i+1, table->data_file->block_count, ((double)(t1-t0))/report_interval);
+            t0 = t1;
+        }
+    }
+    uint32_t remap_count = table->data_file->remap_count;
+    sky_timestamp_t remap_time = table->data_file->remap_time;
+    
+    // Clean up
+    rc = sky_table_close(table);
+    check(rc == 0, "Unable to close table");
+    sky_table_free(table);
+    free(events);
+
+    // Show stats.
+    printf("Total events inserted: %d\n", options->event_count);
+    printf("Remaps: %d (%.3f msec)\n", remap_count, ((double)remap_time)/1000);
+    
+    return;
+    
+error:
+    while(event_count > 0) {
+        sky_event_free(events[--event_count]);
+    }
+    free(events);
     sky_table_free(table);
 }
 
@@ -406,9 +837,26 @@ int main(int argc, char **argv)
     gettimeofday(&tv, NULL);
     int64_t t0 = (tv.tv_sec*1000) + (tv.tv_usec/1000);
 
-    // Benchmark computation of a DAG.
-    // benchmark_dag(options);
-    benchmark_count_with_qip(options);
+    // Run the selected benchmark.
+    if(biseqcstr(options->benchmark, "dag")) {
+        benchmark_dag(options);
+    }
+    else if(biseqcstr(options->benchmark, "insert")) {
+        benchmark_insert(options);
+    }
+    else if(biseqcstr(options->benchmark, "count")) {
+        benchmark_count_with_qip(options);
+    }
+    else if(biseqcstr(options->benchmark, "peach")) {
+        benchmark_peach(options);
+    }
+    else if(biseqcstr(options->benchmark, "paths")) {
+        benchmark_paths(options);
+    }
+    else {
+        fprintf(stderr, "Error: Unknown benchmark: %s\n\n", bdata(options->benchmark));
+        usage();
+    }
 
     // End time.
     gettimeofday(&tv, NULL);
@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "bstring.h"
+#include "dbg.h"
+#include "mem.h"
+#include "table.h"
+#include "compactor.h"
+#include "version.h"
+
+
+//==============================================================================
+//
+// Overview
+//
+//==============================================================================
+
+// The sky-compact application rewrites a table's data file so that its blocks
+// are stored in object id order and are filled up to a given fill factor.
+// Paths larger than the large path threshold are moved into extents.
+// Blocks can also be compressed to save space.
+// The table must not be opened by a server while it is being compacted.
+
+
+//==============================================================================
+//
+// Typedefs
+//
+//==============================================================================
+
+typedef struct Options {
+    bstring path;
+    double fill_factor;
+    uint32_t large_path_threshold;
+    uint32_t version;
+    bool compress;
+} Options;
+
+
+//==============================================================================
+//
+// Forward Declarations
+//
+//==============================================================================
+
+void usage();
+
+
+//==============================================================================
+//
+// Command Line Arguments
+//
+//==============================================================================
+
+Options *parseopts(int argc, char **argv)
+{
+    Options *options = (Options*)calloc(1, sizeof(Options));
+    check_mem(options);
+
+    // Command line options.
+    struct option long_options[] = {
+        {"fill-factor", required_argument, 0, 'f'},
+        {"large-path-threshold", required_argument, 0, 'l'},
+        {"format-version", required_argument, 0, 'V'},
+        {"compress", no_argument, 0, 'z'},
+        {0, 0, 0, 0}
+    };
+
+    // Parse command line options.
+    while(1) {
+        int option_index = 0;
+        int c = getopt_long(argc, argv, "f:l:V:z", long_options, &option_index);
+
+        // Check for end of options.
+        if(c == -1) {
+            break;
+        }
+
+        // Parse each option.
+        switch(c) {
+            case 'f': {
+                options->fill_factor = atof(optarg);
+                break;
+            }
+
+            case 'l': {
+                options->large_path_threshold = atoi(optarg);
+                break;
+            }
+
+            case 'V': {
+                options->version = atoi(optarg);
+                break;
+            }
+
+            case 'z': {
+                options->compress = true;
+                break;
+            }
+
+            default: {
+                usage();
+            }
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    // Retrieve path as first non-getopts option.
+    if(argc < 1) {
+        fprintf(stderr, "Error: Table path required.\n\n");
+        usage();
+    }
+    options->path = bfromcstr(argv[0]);
+    check_mem(options->path);
+
+    // Default input.
+    if(options->fill_factor == 0) {
+        options->fill_factor = SKY_COMPACTOR_DEFAULT_FILL_FACTOR;
+    }
+    if(options->fill_factor < 0 || options->fill_factor > 1) {
+        fprintf(stderr, "Error: Fill factor must be between 0 and 1.\n\n");
+        exit(1);
+    }
+
+    return options;
+
+error:
+    exit(1);
+}
+
+void Options_free(Options *options)
+{
+    if(options) {
+        bdestroy(options->path);
+        options->path = NULL;
+        free(options);
+    }
+}
+
+
+//==============================================================================
+//
+// Usage & Version
+//
+//==============================================================================
+
+void print_version()
+{
+    printf("sky-compact " SKY_VERSION "\n");
+    exit(0);
+}
+
+void usage()
+{
+    fprintf(stderr, "usage: sky-compact [OPTIONS] PATH\n\n");
+    fprintf(stderr, "  -f, --fill-factor=NUM    fraction of each block to fill (default: 0.9)\n");
+    fprintf(stderr, "  -l, --large-path-threshold=NUM\n");
+    fprintf(stderr, "                           path size at which paths move to extents\n");
+    fprintf(stderr, "  -V, --format-version=NUM rewrite the data file in a format version\n");
+    fprintf(stderr, "  -z, --compress           compress blocks\n\n");
+    exit(1);
+}
+
+
+//==============================================================================
+//
+// Compaction
+//
+//==============================================================================
+
+// Compacts the table at a given path.
+//
+// options - A list of options to use.
+//
+// Returns 0 if successful, otherwise returns -1.
+int compact(Options *options)
+{
+    int rc;
+
+    // Open table.
+    sky_table *table = sky_table_create(); check_mem(table);
+    rc = sky_table_set_path(table, options->path);
+    check(rc == 0, "Unable to set table path");
+    table->large_path_threshold = options->large_path_threshold;
+    table->data_file_version = options->version;
+    table->compressed = options->compress;
+    rc = sky_table_open(table);
+    check(rc == 0, "Unable to open table");
+
+    // Compact.
+    uint32_t block_count = table->data_file->block_count;
+    uint32_t extent_count = table->data_file->extent_count;
+    rc = sky_table_compact(table, options->fill_factor);
+    check(rc == 0, "Unable to compact table");
+    printf("Blocks: %d -> %d\n", block_count, table->data_file->block_count);
+    printf("Extents: %d -> %d\n", extent_count, table->data_file->extent_count);
+
+    // Clean up.
+    rc = sky_table_close(table);
+    check(rc == 0, "Unable to close table");
+    sky_table_free(table);
+
+    return 0;
+
+error:
+    sky_table_free(table);
+    return -1;
+}
+
+
+//==============================================================================
+//
+// Main
+//
+//==============================================================================
+
+int main(int argc, char **argv)
+{
+    // Parse command line options.
+    Options *options = parseopts(argc, argv);
+
+    // Start time.
+    time_t t0 = time(NULL);
+
+    // Compact table.
+    int rc = compact(options);
+
+    // Show wall clock time.
+    printf("Elapsed Time: %ld seconds\n", (time(NULL)-t0));
+
+    // Clean up.
+    Options_free(options);
+
+    return (rc == 0 ? 0 : 1);
+}
@@ -1,9 +1,12 @@
 #include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
 
 #include "sky_qip_module.h"
 #include "property.h"
 #include "constants.h"
 #include "minipack.h"
+#include "cursor.h"
 #include "mem.h"
 #include "dbg.h"
 
@@ -35,6 +38,51 @@ int sky_qip_module_process_dynamic_class_callback(qip_module *module,
 int sky_qip_module_process_event_class(sky_qip_module *module,
     qip_ast_node *class);
 
+int sky_qip_module_rewrite_dictionary_comparisons(sky_qip_module *module,
+    qip_array *var_refs, bstring property_name, sky_dictionary *dictionary,
+    bool *rewritten);
+
+int sky_qip_module_get_compared_literal(qip_ast_node *var_ref,
+    qip_ast_node **literal);
+
+int sky_qip_module_codegen_external_call_callback(qip_module *module,
+    qip_ast_node *function, bstring function_name, LLVMValueRef *args,
+    unsigned int arg_count, bool *generated);
+
+int sky_qip_module_codegen_cursor_next(sky_qip_module *module,
+    LLVMValueRef cursor, LLVMValueRef event);
+
+int sky_qip_module_codegen_cursor_eof(sky_qip_module *module,
+    LLVMValueRef cursor);
+
+int sky_qip_module_codegen_event_properties(sky_qip_module *module,
+    LLVMValueRef cursor_ptr, LLVMValueRef event);
+
+int sky_qip_module_codegen_sky_cursor(sky_qip_module *module,
+    LLVMValueRef cursor, LLVMValueRef *ret);
+
+int sky_qip_module_codegen_field(sky_qip_module *module,
+    LLVMValueRef struct_ptr, size_t offset, LLVMTypeRef type,
+    LLVMValueRef *ret);
+
+int sky_qip_module_codegen_map_find(sky_qip_module *module,
+    LLVMValueRef *args, unsigned int arg_count);
+
+int sky_qip_module_codegen_event_field(sky_qip_module *module,
+    LLVMValueRef event, bstring property_name, LLVMValueRef *ret);
+
+int sky_qip_module_get_external_function(sky_qip_module *module,
+    const char *name, LLVMTypeRef return_type, LLVMTypeRef *params,
+    unsigned int param_count, LLVMValueRef *ret);
+
+int sky_qip_module_codegen_literal_callback(qip_module *module,
+    qip_ast_node *node, LLVMValueRef *value, bool *generated);
+
+int sky_qip_module_get_map_key_count(sky_qip_module *module, int64_t *ret);
+
+int sky_qip_module_get_key_count(sky_qip_module *module, qip_ast_node *key,
+    int64_t *ret);
+
 
 //==============================================================================
 //
@@ -60,6 +108,8 @@ sky_qip_module *sky_qip_module_create()
     // Setup compiler.
     module->compiler = qip_compiler_create(); check_mem(module->compiler);
     module->compiler->process_dynamic_class = sky_qip_module_process_dynamic_class_callback;
+    module->compiler->codegen_external_call = sky_qip_module_codegen_external_call_callback;
+    module->compiler->codegen_literal = sky_qip_module_codegen_literal_callback;
     module->compiler->dependency_count = 1;
     module->compiler->dependencies = calloc(module->compiler->dependency_count, sizeof(*module->compiler->dependencies));
     module->compiler->dependencies[0] = bfromcstr("String");
@@ -84,6 +134,7 @@ void sky_qip_module_free(sky_qip_module *module)
         sky_qip_module_free_event_info(module);
         qip_compiler_free(module->compiler);
         qip_module_free(module->_qip_module);
+        free(module->params);
         free(module);
     }
 }
@@ -98,10 +149,18 @@ void sky_qip_module_free_event_info(sky_qip_module *module)
     if(module) {
         free(module->event_property_ids);
         module->event_property_ids = NULL;
+        int64_t i;
+        for(i=0; i<module->event_property_count; i++) {
+            bdestroy(module->event_property_names[i]);
+        }
+        free(module->event_property_names);
+        module->event_property_names = NULL;
         free(module->event_property_offsets);
         module->event_property_offsets = NULL;
         free(module->event_property_types);
         module->event_property_types = NULL;
+        free(module->event_property_dictionaries);
+        module->event_property_dictionaries = NULL;
         
         module->event_property_count = 0;
     }
@@ -197,9 +256,21 @@ int sky_qip_module_process_event_class(sky_qip_module *module,
                 rc = sky_property_file_find_by_name(module->table->property_file, property_name, &db_property);
                 check(rc == 0 && db_property != NULL, "Unable to find property '%s' in table: %s", bdata(property_name), bdata(module->table->path));
                 
+                // Dictionary properties that are only compared against
+                // string literals are read as their integer codes.
+                bool rewritten = false;
+                bstring data_type = db_property->data_type;
+                if(db_property->dictionary != NULL) {
+                    rc = sky_qip_module_rewrite_dictionary_comparisons(module, var_refs, property_name, db_property->dictionary, &rewritten);
+                    check(rc == 0, "Unable to rewrite dictionary comparisons");
+                    if(rewritten) {
+                        data_type = &SKY_DATA_TYPE_INT;
+                    }
+                }
+
                 // Generate and add property to class.
                 property = qip_ast_property_create(QIP_ACCESS_PUBLIC, 
-                    qip_ast_var_decl_create(qip_ast_type_ref_create(db_property->data_type), property_name, NULL)
+                    qip_ast_var_decl_create(qip_ast_type_ref_create(data_type), property_name, NULL)
                 );
                 rc = qip_ast_class_add_property(class, property);
                 check(rc == 0, "Unable to add property to class");
@@ -222,11 +293,21 @@ int sky_qip_module_process_event_class(sky_qip_module *module,
                 module->event_property_ids = realloc(module->event_property_ids, sizeof(*module->event_property_ids) * module->event_property_count);
                 module->event_property_ids[module->event_property_count-1] = db_property->id;
 
+                // Append to property name array.
+                module->event_property_names = realloc(module->event_property_names, sizeof(*module->event_property_names) * module->event_property_count);
+                module->event_property_names[module->event_property_count-1] = bstrcpy(property_name);
+                check_mem(module->event_property_names[module->event_property_count-1]);
+
                 // Append to property type array.
                 bstring type_name = property->property.var_decl->var_decl.type->type_ref.name;
                 module->event_property_types = realloc(module->event_property_types, sizeof(*module->event_property_types) * module->event_property_count);
                 rc = sky_property_get_standard_data_type_name(type_name, &module->event_property_types[module->event_property_count-1]);
                 check(rc == 0, "Unable to retrieve standard type name: '%s'", bdata(type_name));
+
+                // Append to property dictionary array. Codes are only
+                // decoded for properties that are still read as strings.
+                module->event_property_dictionaries = realloc(module->event_property_dictionaries, sizeof(*module->event_property_dictionaries) * module->event_property_count);
+                module->event_property_dictionaries[module->event_property_count-1] = (rewritten ? NULL : db_property->dictionary);
             }
         }
     }
@@ -243,6 +324,677 @@ error:
     return -1;
 }
 
+// Rewrites equality comparisons between a dictionary property and string
+// literals into comparisons against the literals' dictionary codes. This
+// only happens when every reference to the property is such a comparison so
+// that the property can be read as an integer. Literals that are not in the
+// dictionary are replaced with a code that never matches. The module can't
+// be cached in that case since the literal could be added to the dictionary
+// later.
+//
+// module        - The wrapped module.
+// var_refs      - The Event variable references in the module.
+// property_name - The name of the property.
+// dictionary    - The property's dictionary.
+// rewritten     - A pointer to where a flag stating if the comparisons were
+//                 rewritten is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_qip_module_rewrite_dictionary_comparisons(sky_qip_module *module,
+                                                  qip_array *var_refs,
+                                                  bstring property_name,
+                                                  sky_dictionary *dictionary,
+                                                  bool *rewritten)
+{
+    int rc;
+    uint32_t i;
+    check(module != NULL, "Module required");
+    check(var_refs != NULL, "Variable references required");
+    check(property_name != NULL, "Property name required");
+    check(dictionary != NULL, "Dictionary required");
+    *rewritten = false;
+
+    // Make sure that every reference can be rewritten first.
+    qip_ast_node *literal = NULL;
+    for(i=0; i<var_refs->length; i++) {
+        qip_ast_node *var_ref = (qip_ast_node*)var_refs->elements[i];
+        qip_ast_node *member = var_ref->var_ref.member;
+        if(member != NULL && biseq(member->var_ref.name, property_name)) {
+            rc = sky_qip_module_get_compared_literal(var_ref, &literal);
+            check(rc == 0, "Unable to retrieve compared literal");
+            if(literal == NULL) {
+                return 0;
+            }
+        }
+    }
+
+    // Replace each literal with its code.
+    for(i=0; i<var_refs->length; i++) {
+        qip_ast_node *var_ref = (qip_ast_node*)var_refs->elements[i];
+        qip_ast_node *member = var_ref->var_ref.member;
+        if(member != NULL && biseq(member->var_ref.name, property_name)) {
+            rc = sky_qip_module_get_compared_literal(var_ref, &literal);
+            check(rc == 0 && literal != NULL, "Unable to retrieve compared literal");
+
+            uint32_t code = 0;
+            bstring value = literal->string_literal.value;
+            rc = sky_dictionary_find(dictionary, bdata(value), blength(value), &code);
+            check(rc == 0, "Unable to find dictionary code");
+            if(code == 0) {
+                module->cacheable = false;
+            }
+
+            qip_ast_node *int_literal = qip_ast_int_literal_create(code > 0 ? (int64_t)code : -1);
+            check_mem(int_literal);
+            qip_ast_node *expr = literal->parent;
+            int_literal->parent = expr;
+            if(expr->binary_expr.lhs == literal) {
+                expr->binary_expr.lhs = int_literal;
+            }
+            else {
+                expr->binary_expr.rhs = int_literal;
+            }
+            qip_ast_node_free(literal);
+        }
+    }
+
+    *rewritten = true;
+    return 0;
+
+error:
+    return -1;
+}
+
+// Retrieves the string literal that a property reference is compared to.
+// The property must be the last member of the reference and the reference
+// must be one side of an equality expression with a non-empty string literal
+// on the other side.
+//
+// var_ref - The Event variable reference.
+// literal - A pointer to where the string literal is returned. This is null
+//           if the reference is used any other way.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_qip_module_get_compared_literal(qip_ast_node *var_ref,
+                                        qip_ast_node **literal)
+{
+    check(var_ref != NULL, "Variable reference required");
+    *literal = NULL;
+
+    qip_ast_node *member = var_ref->var_ref.member;
+    if(member == NULL || member->var_ref.type != QIP_AST_VAR_REF_TYPE_VALUE || member->var_ref.member != NULL) {
+        return 0;
+    }
+
+    // Find the root of the reference chain.
+    qip_ast_node *node = var_ref;
+    while(node->parent != NULL && node->parent->type == QIP_AST_TYPE_VAR_REF && node->parent->var_ref.member == node) {
+        node = node->parent;
+    }
+
+    // The root must be compared to a string literal.
+    qip_ast_node *expr = node->parent;
+    if(expr == NULL || expr->type != QIP_AST_TYPE_BINARY_EXPR || expr->binary_expr.operator != QIP_BINOP_EQUALS) {
+        return 0;
+    }
+    qip_ast_node *other = (expr->binary_expr.lhs == node ? expr->binary_expr.rhs : expr->binary_expr.lhs);
+    if(other != NULL && other->type == QIP_AST_TYPE_STRING_LITERAL && blength(other->string_literal.value) > 0) {
+        *literal = other;
+    }
+
+    return 0;
+
+error:
+    *literal = NULL;
+    return -1;
+}
+
+
+//--------------------------------------
+// Cursor Code Generation
+//--------------------------------------
+
+// Generates the bodies of the external cursor functions in place of calls to
+// their C implementations. The generated decoder is specialized to the Event
+// properties that the query references so each property is unpacked with a
+// switch on its id and properties the query doesn't use are skipped. Integer
+// map lookups are also generated so that dense keys are read directly. The
+// functions are marked to always be inlined into the query's loops.
+//
+// module        - The Qip module.
+// function      - The function AST node.
+// function_name - The name of the external C function.
+// args          - The loaded arguments for the C function.
+// arg_count     - The number of arguments.
+// generated     - A pointer to where a flag stating if the body was
+//                 generated is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_qip_module_codegen_external_call_callback(qip_module *module,
+                                                  qip_ast_node *function,
+                                                  bstring function_name,
+                                                  LLVMValueRef *args,
+                                                  unsigned int arg_count,
+                                                  bool *generated)
+{
+    int rc;
+    check(module != NULL, "Module required");
+    check(function != NULL, "Function required");
+    check(function_name != NULL, "Function name required");
+    *generated = false;
+
+    // Extract wrapped module via context.
+    sky_qip_module *wrapped_module = module->context;
+    check(wrapped_module != NULL, "Module context required");
+
+    // Generate Cursor.next() and Cursor.eof() only.
+    if(biseqcstr(function_name, "sky_qip_cursor_next")) {
+        check(arg_count == 3, "Invalid argument count for Cursor.next(): %d", arg_count);
+        rc = sky_qip_module_codegen_cursor_next(wrapped_module, args[1], args[2]);
+        check(rc == 0, "Unable to generate Cursor.next()");
+        *generated = true;
+    }
+    else if(biseqcstr(function_name, "sky_qip_cursor_eof")) {
+        check(arg_count == 2, "Invalid argument count for Cursor.eof(): %d", arg_count);
+        rc = sky_qip_module_codegen_cursor_eof(wrapped_module, args[1]);
+        check(rc == 0, "Unable to generate Cursor.eof()");
+        *generated = true;
+    }
+    else if(biseqcstr(function_name, "qip_map_find_int")) {
+        rc = sky_qip_module_codegen_map_find(wrapped_module, args, arg_count);
+        check(rc == 0, "Unable to generate Map.find()");
+        *generated = true;
+    }
+
+    // Always inline the generated functions.
+    if(*generated) {
+        LLVMBuilderRef builder = module->compiler->llvm_builder;
+        LLVMContextRef context = LLVMGetModuleContext(module->llvm_module);
+        LLVMValueRef func = LLVMGetBasicBlockParent(LLVMGetInsertBlock(builder));
+        unsigned int kind = LLVMGetEnumAttributeKindForName("alwaysinline", 12);
+        LLVMAddAttributeAtIndex(func, LLVMAttributeFunctionIndex, LLVMCreateEnumAttribute(context, kind, 0));
+    }
+    
+    return 0;
+
+error:
+    *generated = false;
+    return -1;
+}
+
+// Generates the body of Cursor.next(). The action id and timestamp are read
+// from the event header that the cursor has already decoded and then the
+// data section is unpacked into the event's dynamic properties.
+//
+// module - The wrapped module.
+// cursor - The Cursor object.
+// event  - The Event object to update.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_qip_module_codegen_cursor_next(sky_qip_module *module,
+                                       LLVMValueRef cursor,
+                                       LLVMValueRef event)
+{
+    int rc;
+    check(module != NULL, "Module required");
+    check(cursor != NULL, "Cursor required");
+    check(event != NULL, "Event required");
+
+    struct tagbstring action_id_str = bsStatic("actionId");
+    struct tagbstring timestamp_str = bsStatic("timestamp");
+
+    LLVMBuilderRef builder = module->compiler->llvm_builder;
+    LLVMContextRef context = LLVMGetModuleContext(module->_qip_module->llvm_module);
+    LLVMTypeRef int64_type = LLVMInt64TypeInContext(context);
+    LLVMTypeRef ptr_type = LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+
+    // Retrieve the underlying Sky cursor.
+    LLVMValueRef cursor_ptr = NULL;
+    rc = sky_qip_module_codegen_sky_cursor(module, cursor, &cursor_ptr);
+    check(rc == 0, "Unable to generate Sky cursor reference");
+
+    // event.actionId = cursor->action_id
+    LLVMValueRef src = NULL, dest = NULL;
+    rc = sky_qip_module_codegen_field(module, cursor_ptr, offsetof(sky_cursor, action_id), LLVMIntTypeInContext(context, sizeof(sky_action_id_t) * 8), &src);
+    check(rc == 0, "Unable to generate cursor action id reference");
+    rc = sky_qip_module_codegen_event_field(module, event, &action_id_str, &dest);
+    check(rc == 0, "Unable to generate event action id reference");
+    LLVMBuildStore(builder, LLVMBuildZExt(builder, LLVMBuildLoad(builder, src, ""), int64_type, ""), dest);
+
+    // event.timestamp = cursor->timestamp
+    rc = sky_qip_module_codegen_field(module, cursor_ptr, offsetof(sky_cursor, timestamp), int64_type, &src);
+    check(rc == 0, "Unable to generate cursor timestamp reference");
+    rc = sky_qip_module_codegen_event_field(module, event, &timestamp_str, &dest);
+    check(rc == 0, "Unable to generate event timestamp reference");
+    LLVMBuildStore(builder, LLVMBuildLoad(builder, src, ""), dest);
+
+    // Unpack the data section if the query uses any properties.
+    if(module->event_property_count > 0) {
+        rc = sky_qip_module_codegen_event_properties(module, cursor_ptr, event);
+        check(rc == 0, "Unable to generate event property decoder");
+    }
+
+    // sky_cursor_next(cursor)
+    LLVMValueRef next_func = NULL;
+    rc = sky_qip_module_get_external_function(module, "sky_cursor_next", LLVMInt32TypeInContext(context), &ptr_type, 1, &next_func);
+    check(rc == 0, "Unable to declare sky_cursor_next()");
+    LLVMBuildCall(builder, next_func, &cursor_ptr, 1, "");
+    LLVMBuildRetVoid(builder);
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Generates the loop that unpacks the data section of the current event into
+// the dynamic properties of the event. Action properties are cleared first.
+// The cursor is set to EOF if the data can't be unpacked.
+//
+// module     - The wrapped module.
+// cursor_ptr - The Sky cursor.
+// event      - The Event object to update.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_qip_module_codegen_event_properties(sky_qip_module *module,
+                                            LLVMValueRef cursor_ptr,
+                                            LLVMValueRef event)
+{
+    int rc;
+    int64_t i;
+    LLVMValueRef *fields = NULL;
+    LLVMValueRef *sz_values = NULL;
+    LLVMBasicBlockRef *sz_blocks = NULL;
+    check(module != NULL, "Module required");
+    check(cursor_ptr != NULL, "Sky cursor required");
+    check(event != NULL, "Event required");
+
+    LLVMBuilderRef builder = module->compiler->llvm_builder;
+    LLVMContextRef context = LLVMGetModuleContext(module->_qip_module->llvm_module);
+    LLVMValueRef func = LLVMGetBasicBlockParent(LLVMGetInsertBlock(builder));
+    LLVMTypeRef int8_type = LLVMInt8TypeInContext(context);
+    LLVMTypeRef int64_type = LLVMInt64TypeInContext(context);
+    LLVMTypeRef ptr_type = LLVMPointerType(int8_type, 0);
+    LLVMTypeRef size_ptr_type = LLVMPointerType(int64_type, 0);
+
+    // Declare the unpacking functions.
+    LLVMValueRef unpack_int_func, unpack_double_func, unpack_bool_func;
+    LLVMValueRef unpack_string_func, sizeof_func;
+    LLVMTypeRef params[3] = {ptr_type, size_ptr_type, ptr_type};
+    rc = sky_qip_module_get_external_function(module, "minipack_unpack_int", int64_type, params, 2, &unpack_int_func);
+    check(rc == 0, "Unable to declare minipack_unpack_int()");
+    rc = sky_qip_module_get_external_function(module, "minipack_unpack_double", LLVMDoubleTypeInContext(context), params, 2, &unpack_double_func);
+    check(rc == 0, "Unable to declare minipack_unpack_double()");
+    rc = sky_qip_module_get_external_function(module, "minipack_unpack_bool", LLVMInt1TypeInContext(context), params, 2, &unpack_bool_func);
+    check(rc == 0, "Unable to declare minipack_unpack_bool()");
+    rc = sky_qip_module_get_external_function(module, "minipack_sizeof_elem_and_data", int64_type, params, 1, &sizeof_func);
+    check(rc == 0, "Unable to declare minipack_sizeof_elem_and_data()");
+    params[1] = ptr_type;
+    rc = sky_qip_module_get_external_function(module, "sky_qip_cursor_unpack_string", int64_type, params, 3, &unpack_string_func);
+    check(rc == 0, "Unable to declare sky_qip_cursor_unpack_string()");
+
+    // Look up the event fields up front.
+    fields = calloc(module->event_property_count, sizeof(*fields)); check_mem(fields);
+    for(i=0; i<module->event_property_count; i++) {
+        rc = sky_qip_module_codegen_event_field(module, event, module->event_property_names[i], &fields[i]);
+        check(rc == 0, "Unable to generate event property reference: %s", bdata(module->event_property_names[i]));
+    }
+
+    // Clear out action properties.
+    for(i=0; i<module->event_property_count; i++) {
+        if(module->event_property_ids[i] < 0) {
+            LLVMBuildStore(builder, LLVMConstNull(LLVMGetElementType(LLVMTypeOf(fields[i]))), fields[i]);
+        }
+    }
+
+    // Find the bounds of the data section.
+    LLVMValueRef sz_alloca = LLVMBuildAlloca(builder, int64_type, "sz");
+    LLVMValueRef data_ptr = NULL, data_length = NULL;
+    rc = sky_qip_module_codegen_field(module, cursor_ptr, offsetof(sky_cursor, data_ptr), ptr_type, &data_ptr);
+    check(rc == 0, "Unable to generate cursor data pointer reference");
+    rc = sky_qip_module_codegen_field(module, cursor_ptr, offsetof(sky_cursor, data_length), LLVMIntTypeInContext(context, sizeof(sky_event_data_length_t) * 8), &data_length);
+    check(rc == 0, "Unable to generate cursor data length reference");
+    data_ptr = LLVMBuildLoad(builder, data_ptr, "data_ptr");
+    data_length = LLVMBuildZExt(builder, LLVMBuildLoad(builder, data_length, ""), int64_type, "data_length");
+    LLVMValueRef end_ptr = LLVMBuildGEP(builder, data_ptr, &data_length, 1, "end_ptr");
+
+    LLVMBasicBlockRef entry_block = LLVMGetInsertBlock(builder);
+    LLVMBasicBlockRef loop_block = LLVMAppendBasicBlockInContext(context, func, "loop");
+    LLVMBasicBlockRef body_block = LLVMAppendBasicBlockInContext(context, func, "body");
+    LLVMBasicBlockRef skip_block = LLVMAppendBasicBlockInContext(context, func, "skip");
+    LLVMBasicBlockRef advance_block = LLVMAppendBasicBlockInContext(context, func, "advance");
+    LLVMBasicBlockRef next_block = LLVMAppendBasicBlockInContext(context, func, "next");
+    LLVMBasicBlockRef error_block = LLVMAppendBasicBlockInContext(context, func, "error");
+    LLVMBasicBlockRef done_block = LLVMAppendBasicBlockInContext(context, func, "done");
+    LLVMBuildBr(builder, loop_block);
+
+    // Loop until we run out of data.
+    LLVMPositionBuilderAtEnd(builder, loop_block);
+    LLVMValueRef ptr = LLVMBuildPhi(builder, ptr_type, "ptr");
+    LLVMBuildCondBr(builder, LLVMBuildICmp(builder, LLVMIntULT, ptr, end_ptr, ""), body_block, done_block);
+
+    // Switch on the property id.
+    LLVMPositionBuilderAtEnd(builder, body_block);
+    LLVMValueRef property_id = LLVMBuildLoad(builder, ptr, "property_id");
+    LLVMValueRef one = LLVMConstInt(int64_type, sizeof(sky_property_id_t), false);
+    LLVMValueRef value_ptr = LLVMBuildGEP(builder, ptr, &one, 1, "value_ptr");
+    LLVMValueRef switch_value = LLVMBuildSwitch(builder, property_id, skip_block, (unsigned int)module->event_property_count);
+
+    // Skip over properties that the query doesn't use.
+    LLVMPositionBuilderAtEnd(builder, skip_block);
+    LLVMValueRef skip_sz = LLVMBuildCall(builder, sizeof_func, &value_ptr, 1, "");
+    LLVMBuildBr(builder, advance_block);
+
+    sz_blocks = calloc(module->event_property_count+1, sizeof(*sz_blocks)); check_mem(sz_blocks);
+    sz_values = calloc(module->event_property_count+1, sizeof(*sz_values)); check_mem(sz_values);
+    sz_blocks[0] = skip_block;
+    sz_values[0] = skip_sz;
+
+    // Unpack each property by the data type set on the database property.
+    for(i=0; i<module->event_property_count; i++) {
+        LLVMBasicBlockRef case_block = LLVMAppendBasicBlockInContext(context, func, "property");
+        LLVMMoveBasicBlockBefore(case_block, advance_block);
+        LLVMAddCase(switch_value, LLVMConstInt(int8_type, (uint64_t)module->event_property_ids[i], true), case_block);
+        LLVMPositionBuilderAtEnd(builder, case_block);
+
+        bstring property_type = module->event_property_types[i];
+        LLVMValueRef call_args[3] = {value_ptr, sz_alloca, NULL};
+        if(property_type == &SKY_DATA_TYPE_STRING) {
+            sky_dictionary *dictionary = module->event_property_dictionaries[i];
+            call_args[1] = LLVMConstIntToPtr(LLVMConstInt(int64_type, (uint64_t)(uintptr_t)dictionary, false), ptr_type);
+            call_args[2] = LLVMBuildBitCast(builder, fields[i], ptr_type, "");
+            sz_values[i+1] = LLVMBuildCall(builder, unpack_string_func, call_args, 3, "");
+        }
+        else {
+            LLVMValueRef unpack_func = NULL;
+            if(property_type == &SKY_DATA_TYPE_INT) {
+                unpack_func = unpack_int_func;
+            }
+            else if(property_type == &SKY_DATA_TYPE_FLOAT) {
+                unpack_func = unpack_double_func;
+            }
+            else if(property_type == &SKY_DATA_TYPE_BOOLEAN) {
+                unpack_func = unpack_bool_func;
+            }
+            else {
+                sentinel("Invalid property type: %s", bdata(property_type));
+            }
+            LLVMBuildStore(builder, LLVMConstInt(int64_type, 0, false), sz_alloca);
+            LLVMBuildStore(builder, LLVMBuildCall(builder, unpack_func, call_args, 2, ""), fields[i]);
+            sz_values[i+1] = LLVMBuildLoad(builder, sz_alloca, "");
+        }
+        sz_blocks[i+1] = case_block;
+        LLVMBuildBr(builder, advance_block);
+    }
+
+    // Move past the value or stop if it couldn't be read.
+    LLVMPositionBuilderAtEnd(builder, advance_block);
+    LLVMValueRef sz = LLVMBuildPhi(builder, int64_type, "sz");
+    LLVMAddIncoming(sz, sz_values, sz_blocks, (unsigned int)module->event_property_count+1);
+    LLVMBuildCondBr(builder, LLVMBuildICmp(builder, LLVMIntEQ, sz, LLVMConstInt(int64_type, 0, false), ""), error_block, next_block);
+
+    LLVMPositionBuilderAtEnd(builder, next_block);
+    LLVMValueRef next_ptr = LLVMBuildGEP(builder, value_ptr, &sz, 1, "next_ptr");
+    LLVMBuildBr(builder, loop_block);
+
+    LLVMValueRef ptr_values[2] = {data_ptr, next_ptr};
+    LLVMBasicBlockRef ptr_blocks[2] = {entry_block, next_block};
+    LLVMAddIncoming(ptr, ptr_values, ptr_blocks, 2);
+
+    // Set the cursor to EOF on invalid data.
+    LLVMPositionBuilderAtEnd(builder, error_block);
+    LLVMValueRef eof = NULL;
+    rc = sky_qip_module_codegen_field(module, cursor_ptr, offsetof(sky_cursor, eof), int8_type, &eof);
+    check(rc == 0, "Unable to generate cursor EOF reference");
+    LLVMBuildStore(builder, LLVMConstInt(int8_type, 1, false), eof);
+    LLVMBuildRetVoid(builder);
+
+    LLVMPositionBuilderAtEnd(builder, done_block);
+
+    free(fields);
+    free(sz_blocks);
+    free(sz_values);
+    return 0;
+
+error:
+    free(fields);
+    free(sz_blocks);
+    free(sz_values);
+    return -1;
+}
+
+// Generates the body of Cursor.eof().
+//
+// module - The wrapped module.
+// cursor - The Cursor object.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_qip_module_codegen_cursor_eof(sky_qip_module *module,
+                                      LLVMValueRef cursor)
+{
+    int rc;
+    check(module != NULL, "Module required");
+    check(cursor != NULL, "Cursor required");
+
+    LLVMBuilderRef builder = module->compiler->llvm_builder;
+    LLVMContextRef context = LLVMGetModuleContext(module->_qip_module->llvm_module);
+    LLVMTypeRef int8_type = LLVMInt8TypeInContext(context);
+
+    // return cursor->eof != 0
+    LLVMValueRef cursor_ptr = NULL, eof = NULL;
+    rc = sky_qip_module_codegen_sky_cursor(module, cursor, &cursor_ptr);
+    check(rc == 0, "Unable to generate Sky cursor reference");
+    rc = sky_qip_module_codegen_field(module, cursor_ptr, offsetof(sky_cursor, eof), int8_type, &eof);
+    check(rc == 0, "Unable to generate cursor EOF reference");
+    eof = LLVMBuildLoad(builder, eof, "");
+    LLVMBuildRet(builder, LLVMBuildICmp(builder, LLVMIntNE, eof, LLVMConstInt(int8_type, 0, false), ""));
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Generates the body of Map<Int,U>.find(). Keys within the map's dense
+// table are read directly from it and any other key is looked up by calling
+// the C function.
+//
+// module    - The wrapped module.
+// args      - The loaded arguments for the C function.
+// arg_count - The number of arguments.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_qip_module_codegen_map_find(sky_qip_module *module,
+                                    LLVMValueRef *args,
+                                    unsigned int arg_count)
+{
+    int rc;
+    check(module != NULL, "Module required");
+    check(args != NULL, "Arguments required");
+    check(arg_count == 3, "Invalid argument count for Map.find(): %d", arg_count);
+
+    LLVMBuilderRef builder = module->compiler->llvm_builder;
+    LLVMContextRef context = LLVMGetModuleContext(module->_qip_module->llvm_module);
+    LLVMTypeRef int8_ptr_type = LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+    LLVMTypeRef int64_type = LLVMInt64TypeInContext(context);
+    LLVMValueRef func = LLVMGetBasicBlockParent(LLVMGetInsertBlock(builder));
+    LLVMTypeRef return_type = LLVMGetReturnType(LLVMGetElementType(LLVMTypeOf(func)));
+    LLVMValueRef map = args[1], key = args[2];
+
+    LLVMValueRef find_func = LLVMGetNamedFunction(module->_qip_module->llvm_module, "qip_map_find_int");
+    check(find_func != NULL, "Unable to find external function: qip_map_find_int");
+
+    LLVMBasicBlockRef dense_block = LLVMAppendBasicBlockInContext(context, func, "dense");
+    LLVMBasicBlockRef hash_block = LLVMAppendBasicBlockInContext(context, func, "hash");
+
+    // if((uint64_t)key < map->dense_count)
+    LLVMValueRef map_ptr = LLVMBuildBitCast(builder, map, int8_ptr_type, "");
+    LLVMValueRef dense_count = NULL;
+    rc = sky_qip_module_codegen_field(module, map_ptr, offsetof(qip_map, dense_count), int64_type, &dense_count);
+    check(rc == 0, "Unable to generate map dense count reference");
+    dense_count = LLVMBuildLoad(builder, dense_count, "dense_count");
+    LLVMBuildCondBr(builder, LLVMBuildICmp(builder, LLVMIntULT, key, dense_count, ""), dense_block, hash_block);
+
+    //   return map->dense[key];
+    LLVMPositionBuilderAtEnd(builder, dense_block);
+    LLVMValueRef dense = NULL;
+    rc = sky_qip_module_codegen_field(module, map_ptr, offsetof(qip_map, dense), LLVMPointerType(int8_ptr_type, 0), &dense);
+    check(rc == 0, "Unable to generate map dense table reference");
+    dense = LLVMBuildLoad(builder, dense, "dense");
+    LLVMValueRef element = LLVMBuildLoad(builder, LLVMBuildGEP(builder, dense, &key, 1, ""), "");
+    LLVMBuildRet(builder, LLVMBuildBitCast(builder, element, return_type, ""));
+
+    // else return qip_map_find_int(module, map, key);
+    LLVMPositionBuilderAtEnd(builder, hash_block);
+    LLVMBuildRet(builder, LLVMBuildCall(builder, find_func, args, arg_count, ""));
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Generates a reference to the Sky cursor wrapped by a Cursor object.
+//
+// module - The wrapped module.
+// cursor - The Cursor object.
+// ret    - A pointer to where the Sky cursor value should be returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_qip_module_codegen_sky_cursor(sky_qip_module *module,
+                                      LLVMValueRef cursor,
+                                      LLVMValueRef *ret)
+{
+    int rc;
+    check(module != NULL, "Module required");
+    check(cursor != NULL, "Cursor required");
+
+    struct tagbstring cursor_str = bsStatic("Cursor");
+    struct tagbstring cursor_property_str = bsStatic("cursor");
+
+    LLVMBuilderRef builder = module->compiler->llvm_builder;
+
+    // Find the index of the Cursor.cursor property.
+    int index = -1;
+    qip_ast_node *class = NULL;
+    rc = qip_module_get_ast_class(module->_qip_module, &cursor_str, &class);
+    check(rc == 0 && class != NULL, "Unable to find Cursor class");
+    rc = qip_ast_class_get_property_index(class, &cursor_property_str, &index);
+    check(rc == 0 && index >= 0, "Unable to find Cursor.cursor property");
+
+    // Cursor objects are sky_qip_cursor structs so the property holds the
+    // Sky cursor.
+    *ret = LLVMBuildLoad(builder, LLVMBuildStructGEP(builder, cursor, (unsigned int)index, ""), "sky_cursor");
+
+    return 0;
+
+error:
+    *ret = NULL;
+    return -1;
+}
+
+// Generates a typed pointer to a field of a C struct, such as a Sky cursor.
+//
+// module     - The wrapped module.
+// struct_ptr - A byte pointer to the struct.
+// offset     - The byte offset of the field.
+// type       - The type of the field.
+// ret        - A pointer to where the field pointer should be returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_qip_module_codegen_field(sky_qip_module *module,
+                                 LLVMValueRef struct_ptr,
+                                 size_t offset,
+                                 LLVMTypeRef type,
+                                 LLVMValueRef *ret)
+{
+    check(module != NULL, "Module required");
+    check(struct_ptr != NULL, "Struct required");
+    check(type != NULL, "Type required");
+
+    LLVMBuilderRef builder = module->compiler->llvm_builder;
+    LLVMContextRef context = LLVMGetModuleContext(module->_qip_module->llvm_module);
+    LLVMValueRef index = LLVMConstInt(LLVMInt64TypeInContext(context), offset, false);
+    LLVMValueRef ptr = LLVMBuildGEP(builder, struct_ptr, &index, 1, "");
+    *ret = LLVMBuildBitCast(builder, ptr, LLVMPointerType(type, 0), "");
+
+    return 0;
+
+error:
+    *ret = NULL;
+    return -1;
+}
+
+// Generates a pointer to a property on an Event object.
+//
+// module        - The wrapped module.
+// event         - The Event object.
+// property_name - The name of the property.
+// ret           - A pointer to where the property pointer should be returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_qip_module_codegen_event_field(sky_qip_module *module,
+                                       LLVMValueRef event,
+                                       bstring property_name,
+                                       LLVMValueRef *ret)
+{
+    int rc;
+    check(module != NULL, "Module required");
+    check(event != NULL, "Event required");
+    check(property_name != NULL, "Property name required");
+
+    struct tagbstring event_str = bsStatic("Event");
+
+    int index = -1;
+    qip_ast_node *class = NULL;
+    rc = qip_module_get_ast_class(module->_qip_module, &event_str, &class);
+    check(rc == 0 && class != NULL, "Unable to find Event class");
+    rc = qip_ast_class_get_property_index(class, property_name, &index);
+    check(rc == 0 && index >= 0, "Unable to find Event property: %s", bdata(property_name));
+
+    *ret = LLVMBuildStructGEP(module->compiler->llvm_builder, event, (unsigned int)index, "");
+    return 0;
+
+error:
+    *ret = NULL;
+    return -1;
+}
+
+// Retrieves a C function from the LLVM module or declares it if it hasn't
+// been declared yet.
+//
+// module      - The wrapped module.
+// name        - The name of the C function.
+// return_type - The return type of the function.
+// params      - The parameter types of the function.
+// param_count - The number of parameters.
+// ret         - A pointer to where the function should be returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_qip_module_get_external_function(sky_qip_module *module,
+                                         const char *name,
+                                         LLVMTypeRef return_type,
+                                         LLVMTypeRef *params,
+                                         unsigned int param_count,
+                                         LLVMValueRef *ret)
+{
+    check(module != NULL, "Module required");
+    check(name != NULL, "Function name required");
+
+    LLVMModuleRef llvm_module = module->_qip_module->llvm_module;
+    *ret = LLVMGetNamedFunction(llvm_module, name);
+    if(*ret == NULL) {
+        *ret = LLVMAddFunction(llvm_module, name, LLVMFunctionType(return_type, params, param_count, false));
+    }
+    check(LLVMCountParams(*ret) == param_count, "Argument mismatch for %s (got %d, expected %d)", name, param_count, LLVMCountParams(*ret));
+
+    return 0;
+
+error:
+    *ret = NULL;
+    return -1;
+}
+
 // Compiles a Qip query against the module. This can only be performed once
 // on a module. Modules cannot be reused.
 //
@@ -282,6 +1034,7 @@ int sky_qip_module_compile(sky_qip_module *module, bstring query_text)
     struct tagbstring module_name = bsStatic("sky");
     module->_qip_module = qip_module_create(&module_name, module->compiler);
     module->_qip_module->context = module;
+    module->cacheable = true;
     rc = qip_compiler_compile(module->compiler, module->_qip_module, query_text, args, 2);
     check(rc == 0, "Unable to compile");
     if(module->_qip_module->error_count > 0) {
@@ -307,9 +1060,316 @@ int sky_qip_module_compile(sky_qip_module *module, bstring query_text)
     rc = qip_module_get_main_function(module->_qip_module, &module->main_function);
     check(rc == 0, "Unable to retrieve main function");
 
+    // Size the dense table of result maps from the keys the query uses.
+    rc = sky_qip_module_get_map_key_count(module, &module->map_key_count);
+    check(rc == 0, "Unable to determine map key count");
+
+    // Parameters that were never generated may have been compiled as
+    // constants so the module can only be run with its original values.
+    uint32_t i;
+    for(i=0; i<module->param_count; i++) {
+        if(module->params[i].global == NULL) {
+            module->cacheable = false;
+        }
+    }
+
     return 0;
 
 error:
     return -1;
 }
  
+
+
+//--------------------------------------
+// Map Keys
+//--------------------------------------
+
+// Determines the number of keys that the query can look up in its result map
+// when every key is small enough to be indexed directly. Only lookups with
+// Event properties that have a known range are bounded. The count is zero
+// if there are no bounded lookups. Lookups with other keys still work since
+// keys outside the dense table are hashed.
+//
+// module - The wrapped module.
+// ret    - A pointer to where the number of keys is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_qip_module_get_map_key_count(sky_qip_module *module, int64_t *ret)
+{
+    int rc;
+    uint32_t i;
+    qip_array *var_refs = NULL;
+    check(module != NULL, "Module required");
+    check(ret != NULL, "Return pointer required");
+    *ret = 0;
+
+    struct tagbstring data_str = bsStatic("data");
+    struct tagbstring get_str = bsStatic("get");
+    struct tagbstring find_str = bsStatic("find");
+
+    // Find references to the result map.
+    var_refs = qip_array_create(); check_mem(var_refs);
+    for(i=0; i<module->_qip_module->ast_module_count; i++) {
+        rc = qip_ast_node_get_var_refs(module->_qip_module->ast_modules[i], &data_str, var_refs);
+        check(rc == 0, "Unable to search for map variable references");
+    }
+
+    // Use the largest bound of the keys passed to get() and find().
+    for(i=0; i<var_refs->length; i++) {
+        qip_ast_node *member = ((qip_ast_node*)var_refs->elements[i])->var_ref.member;
+        if(member != NULL && member->var_ref.type == QIP_AST_VAR_REF_TYPE_INVOKE &&
+           member->var_ref.arg_count == 1 &&
+           (biseq(member->var_ref.name, &get_str) || biseq(member->var_ref.name, &find_str)))
+        {
+            int64_t key_count = 0;
+            rc = sky_qip_module_get_key_count(module, member->var_ref.args[0], &key_count);
+            check(rc == 0, "Unable to determine key count");
+            if(key_count > *ret) {
+                *ret = key_count;
+            }
+        }
+    }
+
+    if(*ret > SKY_QIP_MODULE_MAX_MAP_KEY_COUNT) {
+        *ret = SKY_QIP_MODULE_MAX_MAP_KEY_COUNT;
+    }
+
+    qip_array_free(var_refs);
+    return 0;
+
+error:
+    qip_array_free(var_refs);
+    if(ret) *ret = 0;
+    return -1;
+}
+
+// Determines the number of values a map key can have. Only action ids are
+// bounded, by the table's actions. Other Int properties can hold any value
+// and Boolean properties can't be used as Int keys.
+//
+// module - The wrapped module.
+// key    - The key expression.
+// ret    - A pointer to where the number of values is returned. This is
+//          zero if the key isn't bounded.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_qip_module_get_key_count(sky_qip_module *module, qip_ast_node *key,
+                                 int64_t *ret)
+{
+    int rc;
+    check(module != NULL, "Module required");
+    check(key != NULL, "Key required");
+    check(ret != NULL, "Return pointer required");
+    *ret = 0;
+
+    struct tagbstring event_str = bsStatic("Event");
+    struct tagbstring action_id_str = bsStatic("actionId");
+
+    // Only Event property references can be bounded.
+    if(key->type != QIP_AST_TYPE_VAR_REF || key->var_ref.member == NULL ||
+       key->var_ref.member->var_ref.type != QIP_AST_VAR_REF_TYPE_VALUE ||
+       key->var_ref.member->var_ref.member != NULL)
+    {
+        return 0;
+    }
+    qip_ast_node *var_decl = NULL;
+    rc = qip_ast_var_ref_get_var_decl(key, &var_decl);
+    check(rc == 0, "Unable to retrieve key variable declaration");
+    if(var_decl == NULL || !biseq(var_decl->var_decl.type->type_ref.name, &event_str)) {
+        return 0;
+    }
+
+    // Action ids go up to the id of the last action.
+    bstring property_name = key->var_ref.member->var_ref.name;
+    if(biseq(property_name, &action_id_str)) {
+        sky_action_file *action_file = module->table->action_file;
+        *ret = 1;
+        if(action_file != NULL && action_file->action_count > 0) {
+            *ret = action_file->actions[action_file->action_count-1]->id + 1;
+        }
+        return 0;
+    }
+
+    return 0;
+
+error:
+    if(ret) *ret = 0;
+    return -1;
+}
+
+
+//--------------------------------------
+// Parameters
+//--------------------------------------
+
+// Sets the literals in the query text that should be compiled as parameters.
+// This must be called before the module is compiled. Each parameter must
+// have a different value so that it can be matched to its literal in the
+// AST.
+//
+// module      - The module.
+// params      - The parameters.
+// param_count - The number of parameters.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_qip_module_set_params(sky_qip_module *module, sky_qip_param *params,
+                              uint32_t param_count)
+{
+    uint32_t i;
+    check(module != NULL, "Module required");
+    check(module->_qip_module == NULL, "Parameters must be set before compiling");
+    check(params != NULL || param_count == 0, "Parameters required");
+
+    free(module->params);
+    module->params = NULL;
+    module->param_count = 0;
+
+    if(param_count > 0) {
+        module->params = calloc(param_count, sizeof(*module->params));
+        check_mem(module->params);
+        memcpy(module->params, params, sizeof(*module->params) * param_count);
+        for(i=0; i<param_count; i++) {
+            module->params[i].global = NULL;
+        }
+        module->param_count = param_count;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Updates the values of a compiled module's parameters so that it can be
+// run for another query with the same normalized text.
+//
+// module      - The compiled module.
+// params      - The new parameter values. These must be in the same order
+//               and have the same types as the module's parameters.
+// param_count - The number of parameters.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_qip_module_bind_params(sky_qip_module *module, sky_qip_param *params,
+                               uint32_t param_count)
+{
+    uint32_t i;
+    check(module != NULL, "Module required");
+    check(module->_qip_module != NULL, "Module must be compiled");
+    check(param_count == module->param_count, "Parameter count mismatch: %d != %d", param_count, module->param_count);
+
+    for(i=0; i<param_count; i++) {
+        sky_qip_param *param = &module->params[i];
+        check(params[i].type == param->type, "Parameter type mismatch: %d", i);
+        check(param->global != NULL, "Parameter not generated: %d", i);
+
+        void *ptr = LLVMGetPointerToGlobal(module->_qip_module->llvm_engine, param->global);
+        check(ptr != NULL, "Unable to retrieve parameter: %d", i);
+        if(param->type == SKY_QIP_PARAM_INT) {
+            *((int64_t*)ptr) = params[i].int_value;
+            param->int_value = params[i].int_value;
+        }
+        else {
+            *((double*)ptr) = params[i].float_value;
+            param->float_value = params[i].float_value;
+        }
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Generates int and float literals from the query text as loads from a
+// global that holds the parameter's value. Literals from the standard
+// library and literals added while preprocessing are left as constants.
+//
+// module    - The Qip module.
+// node      - The literal AST node.
+// value     - A pointer to where the generated value is returned.
+// generated - A pointer to where a flag stating if the value was generated
+//             is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_qip_module_codegen_literal_callback(qip_module *module,
+                                            qip_ast_node *node,
+                                            LLVMValueRef *value,
+                                            bool *generated)
+{
+    uint32_t i;
+    bstring name = NULL;
+    check(module != NULL, "Module required");
+    check(node != NULL, "Node required");
+    *generated = false;
+
+    // Extract wrapped module via context.
+    sky_qip_module *wrapped_module = module->context;
+    check(wrapped_module != NULL, "Module context required");
+    if(wrapped_module->param_count == 0 || node->generated || node->line_no <= 0) {
+        return 0;
+    }
+
+    // Only literals in the query module are parameters. The main function
+    // isn't always linked to its module so check for either one.
+    qip_ast_node *root = node;
+    while(root->parent != NULL) {
+        root = root->parent;
+    }
+    if(module->ast_module_count == 0) {
+        return 0;
+    }
+    qip_ast_node *ast_module = module->ast_modules[0];
+    if(root != ast_module && root != ast_module->module.main_function) {
+        return 0;
+    }
+
+    // Find the parameter with the literal's value.
+    sky_qip_param *param = NULL;
+    for(i=0; i<wrapped_module->param_count; i++) {
+        sky_qip_param *p = &wrapped_module->params[i];
+        if((node->type == QIP_AST_TYPE_INT_LITERAL && p->type == SKY_QIP_PARAM_INT && p->int_value == node->int_literal.value) ||
+           (node->type == QIP_AST_TYPE_FLOAT_LITERAL && p->type == SKY_QIP_PARAM_FLOAT && p->float_value == node->float_literal.value))
+        {
+            param = p;
+            break;
+        }
+    }
+    if(param == NULL) {
+        return 0;
+    }
+
+    // A literal that is generated twice can't be tracked by one global so
+    // leave it as a constant and don't reuse the module.
+    if(param->global != NULL) {
+        wrapped_module->cacheable = false;
+        return 0;
+    }
+
+    // Store the value in a global and load it wherever the literal is used.
+    LLVMBuilderRef builder = module->compiler->llvm_builder;
+    LLVMContextRef context = LLVMGetModuleContext(module->llvm_module);
+    LLVMTypeRef type = NULL;
+    LLVMValueRef initializer = NULL;
+    if(param->type == SKY_QIP_PARAM_INT) {
+        type = LLVMInt64TypeInContext(context);
+        initializer = LLVMConstInt(type, param->int_value, true);
+    }
+    else {
+        type = LLVMDoubleTypeInContext(context);
+        initializer = LLVMConstReal(type, param->float_value);
+    }
+    name = bformat("sky.param.%d", i); check_mem(name);
+    param->global = LLVMAddGlobal(module->llvm_module, type, bdata(name));
+    LLVMSetInitializer(param->global, initializer);
+    *value = LLVMBuildLoad(builder, param->global, "");
+    *generated = true;
+
+    bdestroy(name);
+    return 0;
+
+error:
+    bdestroy(name);
+    *generated = false;
+    return -1;
+}
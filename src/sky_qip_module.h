@@ -2,6 +2,7 @@
 #define _sky_qip_module_h
 
 #include <inttypes.h>
+#include <stdbool.h>
 
 #include "table.h"
 #include "qip/qip.h"
@@ -13,8 +14,29 @@
 //
 //==============================================================================
 
+// The types of literal parameters.
+typedef enum {
+    SKY_QIP_PARAM_INT,
+    SKY_QIP_PARAM_FLOAT
+} sky_qip_param_type_e;
+
+// A literal in the query text that is compiled as a parameter. The global
+// that holds the parameter's value is set once the literal is generated so
+// the same module can be run again with a different value.
+typedef struct {
+    sky_qip_param_type_e type;
+    int64_t int_value;
+    double float_value;
+    LLVMValueRef global;
+} sky_qip_param;
+
+// The largest number of keys that are directly indexed in a result map.
+#define SKY_QIP_MODULE_MAX_MAP_KEY_COUNT 0x10000
+
 // This struct wraps the Qip module to provide some additional information
-// around dynamic Event properties.
+// around dynamic Event properties. The map key count is the number of keys
+// the query can look up in its result map when they are known to be small,
+// such as action ids, or zero otherwise.
 typedef struct {
     qip_module *_qip_module;
     qip_compiler *compiler;
@@ -22,8 +44,14 @@ typedef struct {
     sky_table *table;
     int64_t event_property_count;
     sky_property_id_t *event_property_ids;
+    bstring *event_property_names;
     int64_t *event_property_offsets;
     bstring *event_property_types;
+    sky_dictionary **event_property_dictionaries;
+    sky_qip_param *params;
+    uint32_t param_count;
+    bool cacheable;
+    int64_t map_key_count;
 } sky_qip_module;
 
 
@@ -49,4 +77,14 @@ void sky_qip_module_free_event_info(sky_qip_module *module);
 
 int sky_qip_module_compile(sky_qip_module *module, bstring query_text);
 
+//--------------------------------------
+// Parameters
+//--------------------------------------
+
+int sky_qip_module_set_params(sky_qip_module *module, sky_qip_param *params,
+    uint32_t param_count);
+
+int sky_qip_module_bind_params(sky_qip_module *module, sky_qip_param *params,
+    uint32_t param_count);
+
 #endif
@@ -0,0 +1,415 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbg.h"
+#include "path.h"
+#include "snapshot.h"
+
+
+//==============================================================================
+//
+// Forward Declarations
+//
+//==============================================================================
+
+int sky_snapshot_get_block_position(sky_snapshot *snapshot, sky_block *block,
+    sky_snapshot_block **ret);
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+// Creates a snapshot.
+//
+// Returns a reference to a new snapshot if successful. Otherwise returns
+// null.
+sky_snapshot *sky_snapshot_create()
+{
+    sky_snapshot *snapshot = calloc(1, sizeof(sky_snapshot));
+    check_mem(snapshot);
+    return snapshot;
+
+error:
+    sky_snapshot_free(snapshot);
+    return NULL;
+}
+
+// Removes a snapshot from memory. The snapshot is closed first if it is
+// still open.
+//
+// snapshot - The snapshot to free.
+void sky_snapshot_free(sky_snapshot *snapshot)
+{
+    if(snapshot) {
+        sky_snapshot_close(snapshot);
+        free(snapshot);
+    }
+}
+
+
+//--------------------------------------
+// State
+//--------------------------------------
+
+// Opens a snapshot of a data file and, optionally, a memtable.
+//
+// snapshot  - The snapshot.
+// data_file - The data file to take a snapshot of.
+// memtable  - The memtable to copy. This can be null.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_snapshot_open(sky_snapshot *snapshot, sky_data_file *data_file,
+                      sky_memtable *memtable)
+{
+    int rc;
+    uint32_t i;
+    check(snapshot != NULL, "Snapshot required");
+    check(snapshot->data_file == NULL, "Snapshot is already open");
+    check(data_file != NULL, "Data file required");
+    check(data_file->data != NULL, "Data file must be loaded");
+
+    snapshot->data_file = data_file;
+
+    // Record the block list. Blocks are found by their position in the data
+    // file when they are preserved.
+    if(data_file->block_count > 0) {
+        snapshot->blocks = calloc(data_file->block_count, sizeof(*snapshot->blocks));
+        check_mem(snapshot->blocks);
+        snapshot->block_positions = calloc(data_file->block_count, sizeof(*snapshot->block_positions));
+        check_mem(snapshot->block_positions);
+    }
+    snapshot->block_count = data_file->block_count;
+    snapshot->block_position_count = data_file->block_count;
+    for(i=0; i<data_file->block_count; i++) {
+        sky_block *block = data_file->blocks[i];
+        check(block->index < snapshot->block_position_count, "Block index out of range: %d", block->index);
+        snapshot->blocks[i].block = block;
+        snapshot->blocks[i].min_object_id = block->min_object_id;
+        snapshot->blocks[i].max_object_id = block->max_object_id;
+        snapshot->blocks[i].min_timestamp = block->min_timestamp;
+        snapshot->blocks[i].max_timestamp = block->max_timestamp;
+        snapshot->blocks[i].spanned = block->spanned;
+        snapshot->block_positions[block->index] = i;
+    }
+
+    // Record the extent list.
+    if(data_file->extent_count > 0) {
+        snapshot->extents = calloc(data_file->extent_count, sizeof(*snapshot->extents));
+        check_mem(snapshot->extents);
+    }
+    snapshot->extent_count = data_file->extent_count;
+    for(i=0; i<data_file->extent_count; i++) {
+        snapshot->extents[i].extent = data_file->extents[i];
+    }
+
+    // Copy the memtable.
+    if(memtable != NULL) {
+        rc = sky_memtable_copy(memtable, &snapshot->memtable);
+        check(rc == 0, "Unable to copy memtable");
+    }
+
+    // Register with the data file and start a new epoch so that the next
+    // change to each block is preserved.
+    snapshot->epoch = data_file->epoch++;
+    snapshot->next = data_file->snapshots;
+    data_file->snapshots = snapshot;
+
+    return 0;
+
+error:
+    if(snapshot->data_file == data_file) {
+        snapshot->data_file = NULL;
+        sky_snapshot_close(snapshot);
+    }
+    return -1;
+}
+
+// Closes a snapshot and frees the blocks and extents that were preserved
+// for it.
+//
+// snapshot - The snapshot.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_snapshot_close(sky_snapshot *snapshot)
+{
+    uint32_t i;
+    check(snapshot != NULL, "Snapshot required");
+
+    // Unregister from the data file.
+    if(snapshot->data_file != NULL) {
+        sky_snapshot **ptr = &snapshot->data_file->snapshots;
+        while(*ptr != NULL) {
+            if(*ptr == snapshot) {
+                *ptr = snapshot->next;
+                break;
+            }
+            ptr = &(*ptr)->next;
+        }
+    }
+    snapshot->data_file = NULL;
+    snapshot->next = NULL;
+
+    for(i=0; i<snapshot->block_count; i++) {
+        free(snapshot->blocks[i].data);
+    }
+    free(snapshot->blocks);
+    snapshot->blocks = NULL;
+    snapshot->block_count = 0;
+    free(snapshot->block_positions);
+    snapshot->block_positions = NULL;
+    snapshot->block_position_count = 0;
+
+    for(i=0; i<snapshot->extent_count; i++) {
+        free(snapshot->extents[i].data);
+    }
+    free(snapshot->extents);
+    snapshot->extents = NULL;
+    snapshot->extent_count = 0;
+
+    sky_memtable_free(snapshot->memtable);
+    snapshot->memtable = NULL;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+
+//--------------------------------------
+// Copy-on-Write
+//--------------------------------------
+
+// Copies the current contents of a block into the snapshot if the snapshot
+// reads the block and it hasn't been copied yet. This is called before the
+// block is changed.
+//
+// snapshot - The snapshot.
+// block    - The block that is about to change.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_snapshot_preserve_block(sky_snapshot *snapshot, sky_block *block)
+{
+    int rc;
+    check(snapshot != NULL, "Snapshot required");
+    check(block != NULL, "Block required");
+
+    sky_snapshot_block *snapshot_block;
+    rc = sky_snapshot_get_block_position(snapshot, block, &snapshot_block);
+    check(rc == 0, "Unable to find snapshot block");
+    if(snapshot_block == NULL || snapshot_block->data != NULL) {
+        return 0;
+    }
+
+    // Copy the decompressed block so it can be read without the cache.
+    void *ptr;
+    uint32_t block_size = snapshot->data_file->block_size;
+    rc = sky_block_get_ptr(block, &ptr);
+    check(rc == 0, "Unable to retrieve block pointer");
+    snapshot_block->data = malloc(block_size);
+    check_mem(snapshot_block->data);
+    memcpy(snapshot_block->data, ptr, block_size);
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Copies the current path of an extent into the snapshot if the snapshot
+// reads the extent and it hasn't been copied yet. This is called before the
+// extent is changed.
+//
+// snapshot - The snapshot.
+// extent   - The extent that is about to change.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_snapshot_preserve_extent(sky_snapshot *snapshot, sky_extent *extent)
+{
+    int rc;
+    check(snapshot != NULL, "Snapshot required");
+    check(extent != NULL, "Extent required");
+
+    uint32_t i;
+    for(i=0; i<snapshot->extent_count; i++) {
+        sky_snapshot_extent *snapshot_extent = &snapshot->extents[i];
+        if(snapshot_extent->extent == extent) {
+            if(snapshot_extent->data == NULL) {
+                void *ptr;
+                rc = sky_extent_get_ptr(extent, &ptr);
+                check(rc == 0, "Unable to retrieve extent pointer");
+                size_t path_length = sky_path_sizeof_raw(ptr);
+                snapshot_extent->data = malloc(path_length);
+                check_mem(snapshot_extent->data);
+                memcpy(snapshot_extent->data, ptr, path_length);
+            }
+            break;
+        }
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Finds the snapshot's record of a block.
+//
+// snapshot - The snapshot.
+// block    - The block.
+// ret      - A pointer to where the record is returned. This is null if the
+//            block was created after the snapshot was opened.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_snapshot_get_block_position(sky_snapshot *snapshot, sky_block *block,
+                                    sky_snapshot_block **ret)
+{
+    *ret = NULL;
+    if(block->index < snapshot->block_position_count) {
+        sky_snapshot_block *snapshot_block = &snapshot->blocks[snapshot->block_positions[block->index]];
+        if(snapshot_block->block == block) {
+            *ret = snapshot_block;
+        }
+    }
+    return 0;
+}
+
+
+//--------------------------------------
+// Paths
+//--------------------------------------
+
+// Retrieves a pointer to a block as it was when the snapshot was opened.
+//
+// snapshot - The snapshot.
+// index    - The position of the block in the snapshot.
+// ptr      - A pointer to where the block pointer is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_snapshot_get_block_ptr(sky_snapshot *snapshot, uint32_t index,
+                               void **ptr)
+{
+    int rc;
+    check(snapshot != NULL, "Snapshot required");
+    check(index < snapshot->block_count, "Block index out of range: %d", index);
+
+    sky_snapshot_block *snapshot_block = &snapshot->blocks[index];
+    if(snapshot_block->data != NULL) {
+        *ptr = snapshot_block->data;
+    }
+    else {
+        rc = sky_block_get_ptr(snapshot_block->block, ptr);
+        check(rc == 0, "Unable to retrieve block pointer");
+    }
+
+    return 0;
+
+error:
+    *ptr = NULL;
+    return -1;
+}
+
+// Calculates the number of bytes in a block that can hold paths as it was
+// when the snapshot was opened.
+//
+// snapshot - The snapshot.
+// index    - The position of the block in the snapshot.
+// capacity - A pointer to where the capacity is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_snapshot_get_block_capacity(sky_snapshot *snapshot, uint32_t index,
+                                    size_t *capacity)
+{
+    int rc;
+    check(snapshot != NULL, "Snapshot required");
+    check(index < snapshot->block_count, "Block index out of range: %d", index);
+
+    sky_snapshot_block *snapshot_block = &snapshot->blocks[index];
+    if(snapshot_block->data != NULL) {
+        uint32_t block_size = snapshot->data_file->block_size;
+        *capacity = block_size;
+        if(sky_block_has_directory(snapshot_block->block)) {
+            uint32_t count = *((uint32_t*)(snapshot_block->data + block_size - SKY_BLOCK_DIRECTORY_HEADER_SIZE));
+            check(SKY_BLOCK_DIRECTORY_SIZE(count) <= block_size, "Block directory is corrupt: %d", index);
+            *capacity -= SKY_BLOCK_DIRECTORY_SIZE(count);
+        }
+    }
+    else {
+        rc = sky_block_get_capacity(snapshot_block->block, capacity);
+        check(rc == 0, "Unable to determine block capacity");
+    }
+
+    return 0;
+
+error:
+    *capacity = 0;
+    return -1;
+}
+
+// Calculates the number of blocks that a spanned path covers starting from
+// a given block.
+//
+// snapshot - The snapshot.
+// index    - The position of the first block in the snapshot.
+// count    - A pointer to where the number of blocks is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_snapshot_get_span_count(sky_snapshot *snapshot, uint32_t index,
+                                uint32_t *count)
+{
+    check(snapshot != NULL, "Snapshot required");
+    check(index < snapshot->block_count, "Block index out of range: %d", index);
+
+    uint32_t end = index + 1;
+    if(snapshot->blocks[index].spanned) {
+        sky_object_id_t object_id = snapshot->blocks[index].min_object_id;
+        while(end < snapshot->block_count && snapshot->blocks[end].min_object_id == object_id) {
+            end++;
+        }
+    }
+    *count = end - index;
+
+    return 0;
+
+error:
+    *count = 0;
+    return -1;
+}
+
+// Retrieves a pointer to the path in an extent as it was when the snapshot
+// was opened.
+//
+// snapshot - The snapshot.
+// index    - The position of the extent in the snapshot.
+// ptr      - A pointer to where the path pointer is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_snapshot_get_extent_ptr(sky_snapshot *snapshot, uint32_t index,
+                                void **ptr)
+{
+    int rc;
+    check(snapshot != NULL, "Snapshot required");
+    check(index < snapshot->extent_count, "Extent index out of range: %d", index);
+
+    sky_snapshot_extent *snapshot_extent = &snapshot->extents[index];
+    if(snapshot_extent->data != NULL) {
+        *ptr = snapshot_extent->data;
+    }
+    else {
+        rc = sky_extent_get_ptr(snapshot_extent->extent, ptr);
+        check(rc == 0, "Unable to retrieve extent pointer");
+    }
+
+    return 0;
+
+error:
+    *ptr = NULL;
+    return -1;
+}
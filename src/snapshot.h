@@ -0,0 +1,129 @@
+#ifndef _snapshot_h
+#define _snapshot_h
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+typedef struct sky_snapshot sky_snapshot;
+
+#include "types.h"
+#include "data_file.h"
+#include "block.h"
+#include "extent.h"
+#include "memtable.h"
+
+
+//==============================================================================
+//
+// Overview
+//
+//==============================================================================
+
+// A snapshot is a consistent view of a data file that stays the same while
+// events are added to the data file. It is used by queries so that a scan
+// sees every path exactly once even when a block splits partway through it.
+// The server adds events at the yield points of a running query so a long
+// query doesn't hold up writers.
+//
+// Opening a snapshot records the data file's block list and extent list and
+// starts a new epoch on the data file. Each block and extent stores the
+// epoch that it was last changed in. The first time a block or extent is
+// changed after a snapshot is opened, its contents are copied into every
+// open snapshot that still reads it. The snapshot reads the copy from then
+// on and every other block is read from the data file. Blocks that are
+// created after the snapshot is opened are not seen by it.
+//
+// The copies are freed when the snapshot is closed so old versions of a block
+// only use memory while a reader needs them. The data file can't be unloaded
+// or compacted while a snapshot is open.
+//
+// If a memtable is given then the snapshot also holds a copy of it since the
+// memtable is cleared when it is flushed into the data file.
+
+
+//==============================================================================
+//
+// Typedefs
+//
+//==============================================================================
+
+typedef struct sky_snapshot_block {
+    sky_block *block;
+    sky_object_id_t min_object_id;
+    sky_object_id_t max_object_id;
+    sky_timestamp_t min_timestamp;
+    sky_timestamp_t max_timestamp;
+    bool spanned;
+    void *data;
+} sky_snapshot_block;
+
+typedef struct sky_snapshot_extent {
+    sky_extent *extent;
+    void *data;
+} sky_snapshot_extent;
+
+struct sky_snapshot {
+    sky_data_file *data_file;
+    uint32_t epoch;
+    sky_snapshot_block *blocks;
+    uint32_t block_count;
+    uint32_t *block_positions;
+    uint32_t block_position_count;
+    sky_snapshot_extent *extents;
+    uint32_t extent_count;
+    sky_memtable *memtable;
+    sky_snapshot *next;
+};
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+sky_snapshot *sky_snapshot_create();
+
+void sky_snapshot_free(sky_snapshot *snapshot);
+
+
+//--------------------------------------
+// State
+//--------------------------------------
+
+int sky_snapshot_open(sky_snapshot *snapshot, sky_data_file *data_file,
+    sky_memtable *memtable);
+
+int sky_snapshot_close(sky_snapshot *snapshot);
+
+
+//--------------------------------------
+// Copy-on-Write
+//--------------------------------------
+
+int sky_snapshot_preserve_block(sky_snapshot *snapshot, sky_block *block);
+
+int sky_snapshot_preserve_extent(sky_snapshot *snapshot, sky_extent *extent);
+
+
+//--------------------------------------
+// Paths
+//--------------------------------------
+
+int sky_snapshot_get_block_ptr(sky_snapshot *snapshot, uint32_t index,
+    void **ptr);
+
+int sky_snapshot_get_block_capacity(sky_snapshot *snapshot, uint32_t index,
+    size_t *capacity);
+
+int sky_snapshot_get_span_count(sky_snapshot *snapshot, uint32_t index,
+    uint32_t *count);
+
+int sky_snapshot_get_extent_ptr(sky_snapshot *snapshot, uint32_t index,
+    void **ptr);
+
+#endif
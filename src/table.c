@@ -1,10 +1,12 @@
 #include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
 #include <inttypes.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <math.h>
+#include <dirent.h>
 
 #include "dbg.h"
 #include "mem.h"
@@ -14,6 +16,8 @@
 #include "database.h"
 #include "block.h"
 #include "table.h"
+#include "compactor.h"
+#include "path_iterator.h"
 
 //==============================================================================
 //
@@ -38,6 +42,50 @@ int sky_table_load_data_file(sky_table *table);
 
 int sky_table_unload_data_file(sky_table *table);
 
+int sky_table_init_data_file(sky_table *table, sky_data_file *data_file,
+    bstring dir);
+
+
+//--------------------------------------
+// Partitions
+//--------------------------------------
+
+int sky_table_load_partitions(sky_table *table);
+
+int sky_table_unload_partitions(sky_table *table);
+
+int sky_table_load_partition(sky_table *table, sky_table_partition *partition);
+
+int64_t sky_table_get_partition_index(sky_table *table,
+    sky_timestamp_t timestamp);
+
+int sky_table_partition_cmp(const void *a, const void *b);
+
+
+//--------------------------------------
+// Event Management
+//--------------------------------------
+
+int sky_table_write_events(sky_table *table, sky_event **events,
+    uint32_t count);
+
+int sky_table_sort_events(sky_table *table, sky_event **events,
+    uint32_t count, sky_event **ret);
+
+int sky_table_write_sorted_events(sky_table *table, sky_event **events,
+    uint32_t count, uint32_t *applied_count);
+
+int sky_table_event_ref_cmp(const void *a, const void *b);
+
+
+//--------------------------------------
+// Write-ahead log
+//--------------------------------------
+
+int sky_table_load_wal(sky_table *table);
+
+int sky_table_unload_wal(sky_table *table);
+
 
 //--------------------------------------
 // Action file
@@ -74,6 +122,7 @@ int sky_table_unload_property_file(sky_table *table);
 sky_table *sky_table_create()
 {
     sky_table *table = calloc(sizeof(sky_table), 1); check_mem(table);
+    table->data_file_chunk_size = SKY_DATA_FILE_DEFAULT_CHUNK_SIZE;
     return table;
     
 error:
@@ -91,6 +140,9 @@ void sky_table_free(sky_table *table)
         table->name = NULL;
         bdestroy(table->path);
         table->path = NULL;
+        sky_table_unload_wal(table);
+        sky_table_unload_data_file(table);
+        sky_table_unload_partitions(table);
         sky_table_unload_action_file(table);
         sky_table_unload_property_file(table);
         free(table);
@@ -147,29 +199,32 @@ int sky_table_load_data_file(sky_table *table)
     
     // Initialize table space (0).
     bstring tablespace_path = bformat("%s/0", bdata(table->path));
+    check_mem(tablespace_path);
     if(!sky_file_exists(tablespace_path)) {
         rc = mkdir(bdata(tablespace_path), S_IRWXU);
         check(rc == 0, "Unable to create tablespace directory: %s", bdata(tablespace_path));
     }
-    bdestroy(tablespace_path);
     
     // Initialize data file.
     table->data_file = sky_data_file_create();
     check_mem(table->data_file);
-    table->data_file->path = bformat("%s/0/data", bdata(table->path));
-    check_mem(table->data_file->path);
-    table->data_file->header_path = bformat("%s/0/header", bdata(table->path));
-    check_mem(table->data_file->header_path);
-    
-    // Initialize settings on the block.
-    if(table->default_block_size > 0) {
-        table->data_file->block_size = table->default_block_size;
-    }
+    rc = sky_table_init_data_file(table, table->data_file, tablespace_path);
+    check(rc == 0, "Unable to initialize data file");
     
     // Load data
     rc = sky_data_file_load(table->data_file);
     check(rc == 0, "Unable to load data file");
 
+    // Partitioned tables store all of their events in partitions.
+    if(table->partition_duration > 0) {
+        sky_path_iterator iterator;
+        sky_path_iterator_init(&iterator);
+        rc = sky_path_iterator_set_data_file(&iterator, table->data_file);
+        check(rc == 0, "Unable to initialize path iterator");
+        check(iterator.eof, "Table has unpartitioned events: %s", bdata(table->path));
+    }
+
+    bdestroy(tablespace_path);
     return 0;
 error:
     bdestroy(tablespace_path);
@@ -197,6 +252,482 @@ error:
 }
 
 
+// Sets the file paths and the table's data file settings on a data file
+// that is stored in a given directory.
+//
+// table     - The table.
+// data_file - The data file to initialize.
+// dir       - The directory that holds the data file.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_table_init_data_file(sky_table *table, sky_data_file *data_file,
+                             bstring dir)
+{
+    check(table != NULL, "Table required");
+    check(data_file != NULL, "Data file required");
+    check(dir != NULL, "Directory required");
+
+    data_file->path = bformat("%s/data", bdata(dir));
+    check_mem(data_file->path);
+    data_file->header_path = bformat("%s/header", bdata(dir));
+    check_mem(data_file->header_path);
+    data_file->extent_path = bformat("%s/extents", bdata(dir));
+    check_mem(data_file->extent_path);
+    
+    // Initialize settings on the block.
+    if(table->default_block_size > 0) {
+        data_file->block_size = table->default_block_size;
+    }
+    data_file->chunk_size = table->data_file_chunk_size;
+    if(table->data_file_version > 0) {
+        data_file->version = table->data_file_version;
+    }
+    data_file->large_path_threshold = table->large_path_threshold;
+    data_file->block_cache_size = table->block_cache_size;
+
+    // Blocks only need to be synced on every write until the log is open.
+    if(table->wal != NULL) {
+        data_file->autosync = false;
+    }
+
+    return 0;
+error:
+    return -1;
+}
+
+
+//--------------------------------------
+// Partition management
+//--------------------------------------
+
+// Finds the partitions stored in the table's 'partitions' directory. The
+// data files of the partitions are loaded the first time they are used.
+//
+// table - The table.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_table_load_partitions(sky_table *table)
+{
+    DIR *dir = NULL;
+    bstring path = NULL;
+    check(table != NULL, "Table required");
+    check(table->path != NULL, "Table path required");
+
+    sky_table_unload_partitions(table);
+
+    path = bformat("%s/partitions", bdata(table->path)); check_mem(path);
+    if(sky_file_exists(path)) {
+        check(table->partition_duration > 0, "Table is partitioned but no partition duration is set: %s", bdata(table->path));
+
+        dir = opendir(bdata(path));
+        check(dir != NULL, "Unable to open partitions directory: %s", bdata(path));
+
+        struct dirent *ent;
+        while((ent = readdir(dir))) {
+            char *endptr;
+            int64_t index = strtoll(ent->d_name, &endptr, 10);
+            if(ent->d_name[0] == '\0' || ent->d_name[0] == '.' || *endptr != '\0') {
+                continue;
+            }
+
+            sky_table_partition *partitions = realloc(table->partitions, sizeof(*partitions) * (table->partition_count + 1));
+            check_mem(partitions);
+            table->partitions = partitions;
+            table->partitions[table->partition_count].index = index;
+            table->partitions[table->partition_count].data_file = NULL;
+            table->partition_count++;
+        }
+        closedir(dir);
+        dir = NULL;
+
+        qsort(table->partitions, table->partition_count, sizeof(*table->partitions), sky_table_partition_cmp);
+    }
+
+    bdestroy(path);
+    return 0;
+
+error:
+    if(dir) closedir(dir);
+    bdestroy(path);
+    sky_table_unload_partitions(table);
+    return -1;
+}
+
+// Unloads the data files of all partitions and clears the partition list.
+//
+// table - The table.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_table_unload_partitions(sky_table *table)
+{
+    uint32_t i;
+    check(table != NULL, "Table required");
+
+    for(i=0; i<table->partition_count; i++) {
+        sky_data_file_free(table->partitions[i].data_file);
+        table->partitions[i].data_file = NULL;
+    }
+    free(table->partitions);
+    table->partitions = NULL;
+    table->partition_count = 0;
+
+    return 0;
+error:
+    return -1;
+}
+
+// Loads the data file of a partition, creating the partition's directory if
+// it doesn't exist yet.
+//
+// table     - The table.
+// partition - The partition to load.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_table_load_partition(sky_table *table, sky_table_partition *partition)
+{
+    int rc;
+    sky_data_file *data_file = NULL;
+    bstring path = NULL;
+    check(table != NULL, "Table required");
+    check(partition != NULL, "Partition required");
+
+    if(partition->data_file != NULL) {
+        return 0;
+    }
+
+    path = bformat("%s/partitions", bdata(table->path)); check_mem(path);
+    if(!sky_file_exists(path)) {
+        rc = mkdir(bdata(path), S_IRWXU);
+        check(rc == 0, "Unable to create partitions directory: %s", bdata(path));
+    }
+    bdestroy(path);
+    path = bformat("%s/partitions/%lld", bdata(table->path), (long long)partition->index);
+    check_mem(path);
+    if(!sky_file_exists(path)) {
+        rc = mkdir(bdata(path), S_IRWXU);
+        check(rc == 0, "Unable to create partition directory: %s", bdata(path));
+    }
+
+    data_file = sky_data_file_create(); check_mem(data_file);
+    rc = sky_table_init_data_file(table, data_file, path);
+    check(rc == 0, "Unable to initialize partition data file");
+    rc = sky_data_file_load(data_file);
+    check(rc == 0, "Unable to load partition data file: %s", bdata(path));
+
+    partition->data_file = data_file;
+    bdestroy(path);
+    return 0;
+
+error:
+    sky_data_file_free(data_file);
+    bdestroy(path);
+    return -1;
+}
+
+// Calculates the index of the partition that holds a given timestamp.
+// Partition 0 starts at the epoch.
+//
+// table     - The table.
+// timestamp - The timestamp.
+//
+// Returns the partition index.
+int64_t sky_table_get_partition_index(sky_table *table,
+                                      sky_timestamp_t timestamp)
+{
+    int64_t index = timestamp / table->partition_duration;
+    if(timestamp % table->partition_duration != 0 && timestamp < 0) {
+        index--;
+    }
+    return index;
+}
+
+// Compares two partitions by index.
+//
+// a - The first partition.
+// b - The second partition.
+//
+// Returns -1 if the first partition comes first, 1 if the second partition
+// comes first.
+int sky_table_partition_cmp(const void *a, const void *b)
+{
+    sky_table_partition *x = (sky_table_partition*)a;
+    sky_table_partition *y = (sky_table_partition*)b;
+    if(x->index != y->index) {
+        return (x->index < y->index ? -1 : 1);
+    }
+    return 0;
+}
+
+// Retrieves the data file of the partition that holds a given timestamp. The
+// data file is loaded if it isn't already.
+//
+// table     - The table.
+// timestamp - The timestamp.
+// create    - Whether to create the partition if it doesn't exist.
+// ret       - A pointer to where the data file is returned. This is null if
+//             the partition doesn't exist and create is false.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_table_get_partition(sky_table *table, sky_timestamp_t timestamp,
+                            bool create, sky_data_file **ret)
+{
+    int rc;
+    check(table != NULL, "Table required");
+    check(table->partition_duration > 0, "Table is not partitioned");
+    check(ret != NULL, "Return address required");
+
+    *ret = NULL;
+
+    // Find the partition or the position to insert it at.
+    int64_t index = sky_table_get_partition_index(table, timestamp);
+    uint32_t min = 0, max = table->partition_count;
+    while(min < max) {
+        uint32_t mid = min + ((max - min) / 2);
+        if(table->partitions[mid].index < index) {
+            min = mid + 1;
+        }
+        else {
+            max = mid;
+        }
+    }
+
+    if(min == table->partition_count || table->partitions[min].index != index) {
+        if(!create) {
+            return 0;
+        }
+
+        sky_table_partition *partitions = realloc(table->partitions, sizeof(*partitions) * (table->partition_count + 1));
+        check_mem(partitions);
+        table->partitions = partitions;
+        memmove(&table->partitions[min+1], &table->partitions[min], sizeof(*partitions) * (table->partition_count - min));
+        table->partitions[min].index = index;
+        table->partitions[min].data_file = NULL;
+        table->partition_count++;
+    }
+
+    sky_table_partition *partition = &table->partitions[min];
+    rc = sky_table_load_partition(table, partition);
+    check(rc == 0, "Unable to load partition: %lld", (long long)index);
+
+    *ret = partition->data_file;
+    return 0;
+
+error:
+    if(ret) *ret = NULL;
+    return -1;
+}
+
+// Retrieves the data files of the partitions that overlap a time range in
+// time order. Only these partitions are loaded. The caller owns the returned
+// array.
+//
+// table         - The table.
+// min_timestamp - The earliest timestamp in the range.
+// max_timestamp - The latest timestamp in the range.
+// ret           - A pointer to where the array of data files is returned.
+// count         - A pointer to where the number of data files is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_table_get_partitions(sky_table *table, sky_timestamp_t min_timestamp,
+                             sky_timestamp_t max_timestamp,
+                             sky_data_file ***ret, uint32_t *count)
+{
+    int rc;
+    uint32_t i;
+    sky_data_file **data_files = NULL;
+    check(table != NULL, "Table required");
+    check(table->partition_duration > 0, "Table is not partitioned");
+    check(ret != NULL, "Return address required");
+    check(count != NULL, "Count address required");
+
+    *ret = NULL;
+    *count = 0;
+
+    int64_t min_index = sky_table_get_partition_index(table, min_timestamp);
+    int64_t max_index = sky_table_get_partition_index(table, max_timestamp);
+    uint32_t data_file_count = 0;
+    for(i=0; i<table->partition_count; i++) {
+        sky_table_partition *partition = &table->partitions[i];
+        if(partition->index < min_index || partition->index > max_index) {
+            continue;
+        }
+
+        rc = sky_table_load_partition(table, partition);
+        check(rc == 0, "Unable to load partition: %lld", (long long)partition->index);
+
+        sky_data_file **new_data_files = realloc(data_files, sizeof(*data_files) * (data_file_count + 1));
+        check_mem(new_data_files);
+        data_files = new_data_files;
+        data_files[data_file_count++] = partition->data_file;
+    }
+
+    *ret = data_files;
+    *count = data_file_count;
+    return 0;
+
+error:
+    free(data_files);
+    return -1;
+}
+
+// Removes every partition that ends at or before a given timestamp. The
+// table is checkpointed first so that no buffered events for the partitions
+// are written back afterward. Each partition is removed by deleting its
+// directory so the events in it are never read.
+//
+// table     - The table.
+// timestamp - The retention cutoff.
+// count     - A pointer to where the number of dropped partitions is
+//             returned. This can be null.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_table_drop_partitions(sky_table *table, sky_timestamp_t timestamp,
+                              uint32_t *count)
+{
+    int rc;
+    bstring path = NULL;
+    check(table != NULL, "Table required");
+    check(table->opened, "Table must be open to drop partitions");
+    check(table->partition_duration > 0, "Table is not partitioned");
+
+    if(count != NULL) *count = 0;
+
+    rc = sky_table_checkpoint(table);
+    check(rc == 0, "Unable to checkpoint table");
+
+    // Partitions are sorted so the dropped partitions are at the front.
+    int64_t index = sky_table_get_partition_index(table, timestamp);
+    while(table->partition_count > 0 && table->partitions[0].index < index) {
+        sky_table_partition *partition = &table->partitions[0];
+        if(partition->data_file != NULL) {
+            check(partition->data_file->snapshots == NULL, "Cannot drop a partition while a snapshot is open");
+            sky_data_file_free(partition->data_file);
+            partition->data_file = NULL;
+        }
+
+        path = bformat("%s/partitions/%lld", bdata(table->path), (long long)partition->index);
+        check_mem(path);
+        rc = sky_file_rm_r(path);
+        check(rc == 0, "Unable to remove partition: %s", bdata(path));
+        bdestroy(path);
+        path = NULL;
+
+        table->partition_count--;
+        memmove(&table->partitions[0], &table->partitions[1], sizeof(*table->partitions) * table->partition_count);
+        if(count != NULL) (*count)++;
+    }
+
+    return 0;
+
+error:
+    bdestroy(path);
+    return -1;
+}
+
+
+//--------------------------------------
+// Write-ahead log management
+//--------------------------------------
+
+// Opens the write-ahead log for the table and replays any events left over
+// from an unclean shutdown. The data file must be loaded before the log.
+//
+// table - The table to initialize the log for.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_table_load_wal(sky_table *table)
+{
+    int rc;
+    uint32_t i;
+    sky_event **events = NULL;
+    uint32_t event_count = 0;
+    check(table != NULL, "Table required");
+    check(table->path != NULL, "Table path required");
+    check(table->data_file != NULL, "Data file must be loaded before WAL");
+
+    // Unload any existing log.
+    sky_table_unload_wal(table);
+
+    // Initialize log.
+    table->wal = sky_wal_create(); check_mem(table->wal);
+    table->wal->path = bformat("%s/0/wal", bdata(table->path));
+    check_mem(table->wal->path);
+    rc = sky_wal_open(table->wal);
+    check(rc == 0, "Unable to open WAL");
+
+    // Replay the unapplied records into the data file and checkpoint.
+    // Partitioned tables replay each event into the partition that holds it.
+    if(table->wal->length > SKY_WAL_HEADER_LENGTH) {
+        uint32_t count = 0;
+        if(table->partition_duration > 0) {
+            rc = sky_wal_read_events(table->wal, &events, &event_count);
+            check(rc == 0, "Unable to read WAL");
+            for(i=0; i<event_count; i++) {
+                sky_data_file *data_file = NULL;
+                rc = sky_table_get_partition(table, events[i]->timestamp, true, &data_file);
+                check(rc == 0, "Unable to retrieve partition");
+                rc = sky_data_file_add_event(data_file, events[i]);
+                check(rc == 0, "Unable to replay WAL event");
+            }
+            sky_wal_set_applied_lsn(table->wal, table->wal->lsn);
+            count = event_count;
+            for(i=0; i<event_count; i++) {
+                sky_event_free(events[i]);
+            }
+            free(events);
+            events = NULL;
+            event_count = 0;
+        }
+        else {
+            rc = sky_wal_replay(table->wal, table->data_file, &count);
+            check(rc == 0, "Unable to replay WAL");
+        }
+        if(count > 0) {
+            log_info("Replayed %d events from WAL: %s", count, bdata(table->wal->path));
+        }
+
+        rc = sky_table_checkpoint(table);
+        check(rc == 0, "Unable to checkpoint table after WAL replay");
+    }
+
+    // Blocks no longer need to be synced on every write.
+    table->data_file->autosync = false;
+    for(i=0; i<table->partition_count; i++) {
+        if(table->partitions[i].data_file != NULL) {
+            table->partitions[i].data_file->autosync = false;
+        }
+    }
+
+    return 0;
+error:
+    for(i=0; i<event_count; i++) {
+        sky_event_free(events[i]);
+    }
+    free(events);
+    sky_table_unload_wal(table);
+    return -1;
+}
+
+// Closes the write-ahead log on the table.
+//
+// table - The table.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_table_unload_wal(sky_table *table)
+{
+    check(table != NULL, "Table required");
+
+    if(table->wal) {
+        sky_wal_free(table->wal);
+        table->wal = NULL;
+    }
+
+    return 0;
+error:
+    return -1;
+}
+
+
 //--------------------------------------
 // Action file management
 //--------------------------------------
@@ -335,6 +866,14 @@ int sky_table_open(sky_table *table)
     rc = sky_table_load_data_file(table);
     check(rc == 0, "Unable to load data file");
     
+    // Find partitions.
+    rc = sky_table_load_partitions(table);
+    check(rc == 0, "Unable to load partitions");
+    
+    // Load write-ahead log.
+    rc = sky_table_load_wal(table);
+    check(rc == 0, "Unable to load WAL");
+
     // Load action file.
     rc = sky_table_load_action_file(table);
     check(rc == 0, "Unable to load action file");
@@ -343,6 +882,12 @@ int sky_table_open(sky_table *table)
     rc = sky_table_load_property_file(table);
     check(rc == 0, "Unable to load property file");
     
+    // Create the memtable.
+    if(table->memtable_size > 0) {
+        table->memtable = sky_memtable_create();
+        check_mem(table->memtable);
+    }
+
     // Flag the table as open.
     table->opened = true;
 
@@ -363,10 +908,28 @@ int sky_table_close(sky_table *table)
     int rc;
     check(table != NULL, "Table required to close");
 
+    // Flush outstanding changes before unloading.
+    if(table->opened) {
+        rc = sky_table_checkpoint(table);
+        check(rc == 0, "Unable to checkpoint table");
+    }
+
+    // Free the memtable. It is empty after the checkpoint.
+    sky_memtable_free(table->memtable);
+    table->memtable = NULL;
+
+    // Unload write-ahead log.
+    rc = sky_table_unload_wal(table);
+    check(rc == 0, "Unable to unload WAL");
+
     // Unload data file.
     rc = sky_table_unload_data_file(table);
     check(rc == 0, "Unable to unload data file");
 
+    // Unload partitions.
+    rc = sky_table_unload_partitions(table);
+    check(rc == 0, "Unable to unload partitions");
+
     // Unload action data.
     rc = sky_table_unload_action_file(table);
     check(rc == 0, "Unable to unload action file");
@@ -388,6 +951,162 @@ error:
     return -1;
 }
 
+// Flushes the memtable, syncs the data file and every loaded partition to
+// disk and truncates the write-ahead log. All events logged before the
+// checkpoint are durable in the data files afterward.
+//
+// table - The table to checkpoint.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_table_checkpoint(sky_table *table)
+{
+    int rc;
+    check(table != NULL, "Table required");
+    check(table->data_file != NULL, "Table data file required");
+
+    rc = sky_table_flush_memtable(table);
+    check(rc == 0, "Unable to flush memtable");
+
+    if(table->wal != NULL) {
+        rc = sky_wal_sync(table->wal);
+        check(rc == 0, "Unable to sync WAL");
+    }
+
+    rc = sky_data_file_sync(table->data_file);
+    check(rc == 0, "Unable to sync data file");
+
+    uint32_t i;
+    for(i=0; i<table->partition_count; i++) {
+        if(table->partitions[i].data_file != NULL) {
+            rc = sky_data_file_sync(table->partitions[i].data_file);
+            check(rc == 0, "Unable to sync partition: %lld", (long long)table->partitions[i].index);
+        }
+    }
+
+    if(table->wal != NULL) {
+        rc = sky_wal_truncate(table->wal);
+        check(rc == 0, "Unable to truncate WAL");
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Adds the events in the memtable to the data file as a single batch. The
+// events of partitioned tables are split into one batch per partition. The
+// write-ahead log is left as-is since the data file has not been synced.
+//
+// table - The table.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_table_flush_memtable(sky_table *table)
+{
+    int rc;
+    uint32_t i;
+    sky_event **events = NULL;
+    uint32_t count = 0;
+    check(table != NULL, "Table required");
+
+    if(table->memtable != NULL && table->partition_duration > 0) {
+        rc = sky_memtable_get_events(table->memtable, &events, &count);
+        check(rc == 0, "Unable to retrieve memtable events");
+        rc = sky_table_write_events(table, events, count);
+        check(rc == 0, "Unable to write memtable events");
+        rc = sky_memtable_clear(table->memtable);
+        check(rc == 0, "Unable to clear memtable");
+    }
+    else if(table->memtable != NULL) {
+        rc = sky_memtable_flush(table->memtable, table->data_file);
+        check(rc == 0, "Unable to flush memtable");
+    }
+
+    // Every logged event is in the data file now.
+    if(table->memtable != NULL && table->wal != NULL) {
+        sky_wal_set_applied_lsn(table->wal, table->wal->lsn);
+    }
+
+    for(i=0; i<count; i++) {
+        sky_event_free(events[i]);
+    }
+    free(events);
+    return 0;
+
+error:
+    for(i=0; i<count; i++) {
+        sky_event_free(events[i]);
+    }
+    free(events);
+    return -1;
+}
+
+// Flushes the memtable if it has reached the memtable size.
+//
+// table - The table.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_table_flush_full_memtable(sky_table *table)
+{
+    int rc;
+    check(table != NULL, "Table required");
+
+    if(table->memtable != NULL && table->memtable->data_length >= table->memtable_size) {
+        rc = sky_table_flush_memtable(table);
+        check(rc == 0, "Unable to flush memtable");
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Rewrites the table's data file so that blocks are stored in object id order
+// and filled up to a given fill factor. Each partition of a partitioned
+// table is compacted separately. The table is checkpointed first so
+// that the write-ahead log does not reference the old data file. If the table
+// has a data file version set then the data file is rewritten in that format.
+// Compressed tables compress the compacted blocks.
+//
+// table       - The table to compact.
+// fill_factor - The fraction of each block to fill.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_table_compact(sky_table *table, double fill_factor)
+{
+    int rc;
+    sky_compactor *compactor = NULL;
+    check(table != NULL, "Table required");
+    check(table->opened, "Table must be open to compact");
+
+    rc = sky_table_checkpoint(table);
+    check(rc == 0, "Unable to checkpoint table");
+
+    compactor = sky_compactor_create(); check_mem(compactor);
+    compactor->fill_factor = fill_factor;
+    compactor->version = table->data_file_version;
+    compactor->compress = table->compressed;
+    rc = sky_compactor_compact(compactor, table->data_file);
+    check(rc == 0, "Unable to compact data file");
+
+    uint32_t i;
+    for(i=0; i<table->partition_count; i++) {
+        sky_table_partition *partition = &table->partitions[i];
+        rc = sky_table_load_partition(table, partition);
+        check(rc == 0, "Unable to load partition: %lld", (long long)partition->index);
+        rc = sky_compactor_compact(compactor, partition->data_file);
+        check(rc == 0, "Unable to compact partition: %lld", (long long)partition->index);
+    }
+
+    sky_compactor_free(compactor);
+    return 0;
+
+error:
+    sky_compactor_free(compactor);
+    return -1;
+}
+
 
 //--------------------------------------
 // Locking
@@ -486,13 +1205,306 @@ int sky_table_add_event(sky_table *table, sky_event *event)
     check(event != NULL, "Event required");
     check(table->opened, "Table must be open to add an event");
 
-    // Delegate to the data file.
-    rc = sky_data_file_add_event(table->data_file, event);
-    check(rc == 0, "Unable to add event to data file");
-    
+    // Replace dictionary strings with their codes. New strings are synced
+    // before the event that uses them is logged.
+    rc = sky_property_file_encode_event(table->property_file, event);
+    check(rc == 0, "Unable to encode event");
+    rc = sky_property_file_sync_dictionaries(table->property_file);
+    check(rc == 0, "Unable to sync dictionaries");
+
+    // Log the event before applying it.
+    if(table->wal != NULL) {
+        rc = sky_wal_append(table->wal, event);
+        check(rc == 0, "Unable to append event to WAL");
+    }
+
+    // Hold the event in the memtable or add it to the data file. The log
+    // record is discarded if the event can't be applied.
+    if(table->memtable != NULL) {
+        rc = sky_memtable_add_event(table->memtable, event);
+    }
+    else {
+        rc = sky_table_write_events(table, &event, 1);
+    }
+    if(rc != 0 && table->wal != NULL) {
+        sky_wal_rollback(table->wal);
+    }
+    check(rc == 0, "Unable to add event to table");
+    if(table->memtable == NULL && table->wal != NULL) {
+        sky_wal_set_applied_lsn(table->wal, table->wal->lsn);
+    }
+
+    // Sync the log before the insert is acknowledged and checkpoint once it
+    // grows too large.
+    if(table->wal != NULL) {
+        rc = sky_wal_commit(table->wal);
+        check(rc == 0, "Unable to commit WAL");
+
+        if(sky_wal_needs_checkpoint(table->wal)) {
+            rc = sky_table_checkpoint(table);
+            check(rc == 0, "Unable to checkpoint table");
+        }
+    }
+
+    // Flush the memtable once it is full unless the owner flushes it later.
+    if(!table->defer_memtable_flush) {
+        rc = sky_table_flush_full_memtable(table);
+        check(rc == 0, "Unable to flush memtable");
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Adds a batch of events to the table. The whole batch is logged and then
+// applied to the data file at once so that each touched block is only
+// rewritten once and the log is committed once. Partitioned batches are
+// logged in the order they are applied. If the batch fails partway then only
+// the records of the events that weren't applied are discarded.
+//
+// table  - The table to add the events to.
+// events - An array of events to add.
+// count  - The number of events.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_table_add_events(sky_table *table, sky_event **events, uint32_t count)
+{
+    int rc;
+    sky_event **sorted = NULL;
+    check(table != NULL, "Table required");
+    check(events != NULL || count == 0, "Events required");
+    check(table->opened, "Table must be open to add events");
+
+    // Replace dictionary strings with their codes. New strings are synced
+    // before the events that use them are logged.
+    uint32_t i;
+    for(i=0; i<count; i++) {
+        rc = sky_property_file_encode_event(table->property_file, events[i]);
+        check(rc == 0, "Unable to encode event");
+    }
+    rc = sky_property_file_sync_dictionaries(table->property_file);
+    check(rc == 0, "Unable to sync dictionaries");
+
+    // Sort partitioned batches so that the applied events are always the
+    // first ones logged.
+    if(table->memtable == NULL && table->partition_duration > 0 && count > 1) {
+        sorted = calloc(count, sizeof(*sorted)); check_mem(sorted);
+        rc = sky_table_sort_events(table, events, count, sorted);
+        check(rc == 0, "Unable to sort events");
+        events = sorted;
+    }
+
+    // Log the events before applying them.
+    sky_wal_lsn_t lsn = 0;
+    if(table->wal != NULL) {
+        lsn = table->wal->lsn;
+        for(i=0; i<count; i++) {
+            rc = sky_wal_append(table->wal, events[i]);
+            if(rc != 0) sky_wal_rollback_to(table->wal, lsn);
+            check(rc == 0, "Unable to append event to WAL");
+        }
+    }
+
+    // Hold the events in the memtable or add them to the data file.
+    uint32_t applied_count = 0;
+    if(table->memtable != NULL) {
+        for(i=0; i<count; i++) {
+            rc = sky_memtable_add_event(table->memtable, events[i]);
+            if(rc != 0) break;
+        }
+        applied_count = i;
+    }
+    else {
+        rc = sky_table_write_sorted_events(table, events, count, &applied_count);
+    }
+    int apply_rc = rc;
+
+    // Discard the records of the events that weren't applied. The records of
+    // the applied events are committed even if the batch failed. The insert
+    // is only acknowledged after the log is synced and the table is
+    // checkpointed once the log grows too large.
+    if(table->wal != NULL) {
+        if(apply_rc != 0) {
+            rc = sky_wal_rollback_to(table->wal, lsn + applied_count);
+            check(rc == 0, "Unable to roll back WAL");
+        }
+        if(table->memtable == NULL) {
+            sky_wal_set_applied_lsn(table->wal, table->wal->lsn);
+        }
+        rc = sky_wal_commit(table->wal);
+        check(rc == 0, "Unable to commit WAL");
+    }
+    check(apply_rc == 0, "Unable to add events to table");
+    if(table->wal != NULL && sky_wal_needs_checkpoint(table->wal)) {
+        rc = sky_table_checkpoint(table);
+        check(rc == 0, "Unable to checkpoint table");
+    }
+
+    // Flush the memtable once it is full unless the owner flushes it later.
+    if(!table->defer_memtable_flush) {
+        rc = sky_table_flush_full_memtable(table);
+        check(rc == 0, "Unable to flush memtable");
+    }
+
+    free(sorted);
+    return 0;
+
+error:
+    free(sorted);
+    return -1;
+}
+
+// Adds events to the data file. The events of partitioned tables are added
+// to the partition that holds their timestamp with one batch per partition.
+//
+// table  - The table.
+// events - An array of events to add.
+// count  - The number of events.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_table_write_events(sky_table *table, sky_event **events,
+                           uint32_t count)
+{
+    int rc;
+    sky_event **sorted = NULL;
+    check(table != NULL, "Table required");
+
+    if(table->partition_duration > 0 && count > 1) {
+        sorted = calloc(count, sizeof(*sorted)); check_mem(sorted);
+        rc = sky_table_sort_events(table, events, count, sorted);
+        check(rc == 0, "Unable to sort events");
+        events = sorted;
+    }
+
+    uint32_t applied_count = 0;
+    rc = sky_table_write_sorted_events(table, events, count, &applied_count);
+    check(rc == 0, "Unable to write events");
+
+    free(sorted);
+    return 0;
+
+error:
+    free(sorted);
+    return -1;
+}
+
+// Sorts a batch of events by partition. Events keep their order within each
+// partition.
+//
+// table  - The table.
+// events - An array of events to sort.
+// count  - The number of events.
+// ret    - An array of at least the same size to store the sorted events in.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_table_sort_events(sky_table *table, sky_event **events,
+                          uint32_t count, sky_event **ret)
+{
+    sky_table_event_ref *refs = NULL;
+    check(table != NULL, "Table required");
+    check(ret != NULL, "Return array required");
+
+    refs = calloc(count, sizeof(*refs));
+    if(count > 0) check_mem(refs);
+    uint32_t i;
+    for(i=0; i<count; i++) {
+        refs[i].event = events[i];
+        refs[i].partition_index = sky_table_get_partition_index(table, events[i]->timestamp);
+        refs[i].index = i;
+    }
+    qsort(refs, count, sizeof(*refs), sky_table_event_ref_cmp);
+    for(i=0; i<count; i++) {
+        ret[i] = refs[i].event;
+    }
+
+    free(refs);
     return 0;
 
 error:
+    free(refs);
     return -1;
 }
 
+// Adds events that are sorted by partition to the data file. Each
+// partition's events are added as one batch. If a batch fails then the
+// events of the earlier partitions have already been added.
+//
+// table         - The table.
+// events        - An array of events sorted by partition.
+// count         - The number of events.
+// applied_count - A pointer to where the number of leading events that were
+//                 added is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_table_write_sorted_events(sky_table *table, sky_event **events,
+                                  uint32_t count, uint32_t *applied_count)
+{
+    int rc;
+    check(table != NULL, "Table required");
+    check(applied_count != NULL, "Applied count required");
+    *applied_count = 0;
+
+    // Unpartitioned tables go straight to one data file.
+    if(table->partition_duration == 0) {
+        if(count == 1) {
+            rc = sky_data_file_add_event(table->data_file, events[0]);
+        }
+        else {
+            rc = sky_data_file_add_events(table->data_file, events, count);
+        }
+        check(rc == 0, "Unable to add events to data file");
+        *applied_count = count;
+        return 0;
+    }
+
+    // Add each partition's events as one batch.
+    uint32_t i = 0;
+    while(i < count) {
+        uint32_t batch_count = 1;
+        int64_t partition_index = sky_table_get_partition_index(table, events[i]->timestamp);
+        while(i + batch_count < count && sky_table_get_partition_index(table, events[i+batch_count]->timestamp) == partition_index) {
+            batch_count++;
+        }
+
+        sky_data_file *data_file = NULL;
+        rc = sky_table_get_partition(table, events[i]->timestamp, true, &data_file);
+        check(rc == 0, "Unable to retrieve partition");
+        if(batch_count == 1) {
+            rc = sky_data_file_add_event(data_file, events[i]);
+        }
+        else {
+            rc = sky_data_file_add_events(data_file, &events[i], batch_count);
+        }
+        check(rc == 0, "Unable to add events to partition");
+        i += batch_count;
+        *applied_count = i;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Compares two event references by partition and then by their position in
+// the batch.
+//
+// a - The first event reference.
+// b - The second event reference.
+//
+// Returns -1 if the first event comes first, 1 if the second event comes
+// first.
+int sky_table_event_ref_cmp(const void *a, const void *b)
+{
+    sky_table_event_ref *x = (sky_table_event_ref*)a;
+    sky_table_event_ref *y = (sky_table_event_ref*)b;
+    if(x->partition_index != y->partition_index) {
+        return (x->partition_index < y->partition_index ? -1 : 1);
+    }
+    if(x->index != y->index) {
+        return (x->index < y->index ? -1 : 1);
+    }
+    return 0;
+}
@@ -7,6 +7,7 @@
 #include <sys/mman.h>
 
 typedef struct sky_table sky_table;
+typedef struct sky_query_cache sky_query_cache;
 
 #include "bstring.h"
 #include "database.h"
@@ -16,6 +17,8 @@ typedef struct sky_table sky_table;
 #include "data_file.h"
 #include "action_file.h"
 #include "property_file.h"
+#include "wal.h"
+#include "memtable.h"
 
 //==============================================================================
 //
@@ -38,6 +41,59 @@ typedef struct sky_table sky_table;
 // is used to store a range of object ids for each block and serves as an index
 // when looking up a single object.
 //
+// If a large path threshold is set then the paths of very active objects are
+// moved out of the blocks and into variable sized extents in the 'extents'
+// file so that they don't form long chains of spanned blocks.
+//
+// New data files use the original block layout unless a data file version
+// is set on the table. Version 2 blocks store a path directory so that paths
+// can be found without walking the block. Existing data files keep their
+// version until they are compacted.
+//
+// Tables that are mostly historical can be set to compressed. Compaction then
+// compresses each block and compressed blocks are read through a cache of
+// decompressed blocks. The block cache size sets how many blocks are cached.
+// Tables are not compressed by default since scanning a compressed table
+// decompresses every block that doesn't fit in the cache.
+//
+// Events are appended to a write-ahead log ('wal') before they are added to
+// the data file. Data file blocks are synced lazily and the log is replayed
+// into the data file if the table was not closed cleanly.
+//
+// If a memtable size is set then new events are held in an in-memory
+// memtable instead of being inserted into blocks one at a time. The memtable
+// is flushed into the data file in a single batch once it reaches that size
+// and whenever the table is checkpointed. Queries merge the memtable into the
+// data file's paths so new events are visible right away.
+//
+// The flush rewrites every block that the memtable touches so the insert that
+// fills the memtable takes much longer than the others. Larger memtables
+// flush less often but make each flush longer. Setting the table to defer
+// the flush leaves a full memtable in place after an insert and the owner of
+// the table flushes it with `sky_table_flush_full_memtable()` once the insert
+// has been acknowledged. The server defers the flush until the connection is
+// closed.
+//
+// If a partition duration is set then events are stored in one data file per
+// span of time instead of in tablespace 0. Partition N holds the events from
+// N * duration up to the next partition and is stored in the
+// 'partitions/<N>' directory. Partitions are found when the table is opened
+// but each data file is only loaded once it is used so queries that only
+// cover recent events don't load older partitions. Old events are removed by
+// dropping whole partitions, which deletes their directories instead of
+// rewriting blocks. The write-ahead log and memtable stay shared by all
+// partitions.
+//
+// Queries are split into ranges of object ids and run on one worker thread
+// per CPU unless a query worker count is set. Each worker scans its own
+// snapshots of the table into its own results and the results are merged
+// once every range has been scanned.
+//
+// The server attaches a query cache to the table while it is open so that
+// compiled queries are reused. Queries that only differ by their literal
+// values share one compiled module. Tables without a query cache compile
+// every query.
+//
 // Because of the redundancy of action names and data keys, those strings are
 // cached and converted into integer identifiers. The action cache is located
 // in the 'actions' file and the data keys cache is located in the 'keys' file.
@@ -51,6 +107,20 @@ typedef struct sky_table sky_table;
 
 #define SKY_LOCK_NAME ".skylock"
 
+typedef struct sky_table_partition {
+    int64_t index;
+    sky_data_file *data_file;
+} sky_table_partition;
+
+// This structure is used for splitting a batch of events by partition. It
+// stores the original position of the event in the batch so that events
+// stay in order within each partition.
+typedef struct sky_table_event_ref {
+    sky_event *event;
+    int64_t partition_index;
+    uint32_t index;
+} sky_table_event_ref;
+
 // The table is a reference to the disk location where data is stored. The
 // table also maintains a cache of block info and predefined actions and
 // properties.
@@ -59,10 +129,24 @@ struct sky_table {
     sky_data_file *data_file;
     sky_action_file *action_file;
     sky_property_file *property_file;
+    sky_wal *wal;
     bstring name;
     bstring path;
     bool opened;
     uint32_t default_block_size;
+    size_t data_file_chunk_size;
+    uint32_t data_file_version;
+    bool compressed;
+    uint32_t block_cache_size;
+    uint32_t large_path_threshold;
+    size_t memtable_size;
+    bool defer_memtable_flush;
+    sky_memtable *memtable;
+    sky_timestamp_t partition_duration;
+    sky_table_partition *partitions;
+    uint32_t partition_count;
+    uint32_t query_worker_count;
+    sky_query_cache *query_cache;
 };
 
 
@@ -96,6 +180,28 @@ int sky_table_open(sky_table *table);
 
 int sky_table_close(sky_table *table);
 
+int sky_table_checkpoint(sky_table *table);
+
+int sky_table_flush_memtable(sky_table *table);
+
+int sky_table_flush_full_memtable(sky_table *table);
+
+int sky_table_compact(sky_table *table, double fill_factor);
+
+
+//--------------------------------------
+// Partitions
+//--------------------------------------
+
+int sky_table_get_partition(sky_table *table, sky_timestamp_t timestamp,
+    bool create, sky_data_file **ret);
+
+int sky_table_get_partitions(sky_table *table, sky_timestamp_t min_timestamp,
+    sky_timestamp_t max_timestamp, sky_data_file ***ret, uint32_t *count);
+
+int sky_table_drop_partitions(sky_table *table, sky_timestamp_t timestamp,
+    uint32_t *count);
+
 
 //--------------------------------------
 // Event Management
@@ -103,4 +209,6 @@ int sky_table_close(sky_table *table);
 
 int sky_table_add_event(sky_table *table, sky_event *event);
 
+int sky_table_add_events(sky_table *table, sky_event **events, uint32_t count);
+
 #endif
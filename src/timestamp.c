@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 
 #include "timestamp.h"
@@ -29,6 +30,7 @@ int sky_timestamp_parse(bstring str, sky_timestamp_t *ret)
     
     // Parse date.
     struct tm tp;
+    memset(&tp, 0, sizeof(tp));
     char *ch;
     ch = strptime(bdata(str2), "%Y-%m-%dT%H:%M:%SZ %Z", &tp);
     check(ch != NULL, "Unable to parse timestamp");
@@ -0,0 +1,735 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "dbg.h"
+#include "mem.h"
+#include "bstring.h"
+#include "file.h"
+#include "wal.h"
+
+//==============================================================================
+//
+// Forward Declarations
+//
+//==============================================================================
+
+int sky_wal_flush(sky_wal *wal);
+
+void sky_wal_unmap_header(sky_wal *wal);
+
+int sky_wal_read(sky_wal *wal, void **ret, size_t *length);
+
+size_t sky_wal_validate_record(void *ptr, void *endptr);
+
+uint32_t sky_wal_checksum(void *ptr, size_t sz);
+
+uint64_t sky_wal_get_boot_id();
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+// Creates a reference to a write-ahead log.
+//
+// Returns a reference to the new log if successful. Otherwise returns null.
+sky_wal *sky_wal_create()
+{
+    sky_wal *wal = calloc(sizeof(sky_wal), 1);
+    check_mem(wal);
+    wal->fd = -1;
+    wal->checkpoint_length = SKY_WAL_DEFAULT_CHECKPOINT_LENGTH;
+    return wal;
+
+error:
+    sky_wal_free(wal);
+    return NULL;
+}
+
+// Removes a write-ahead log reference from memory. Any buffered records are
+// synced to disk before the log is closed.
+//
+// wal - The log to free.
+void sky_wal_free(sky_wal *wal)
+{
+    if(wal) {
+        sky_wal_close(wal);
+        if(wal->path) bdestroy(wal->path);
+        wal->path = NULL;
+        free(wal->buffer);
+        wal->buffer = NULL;
+        free(wal);
+    }
+}
+
+
+//--------------------------------------
+// Path
+//--------------------------------------
+
+// Sets the file path of the log.
+//
+// wal  - The log.
+// path - The file path to set.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_wal_set_path(sky_wal *wal, bstring path)
+{
+    check(wal != NULL, "WAL required");
+
+    if(wal->path) {
+        bdestroy(wal->path);
+    }
+
+    wal->path = bstrcpy(path);
+    if(path) check_mem(wal->path);
+
+    return 0;
+
+error:
+    wal->path = NULL;
+    return -1;
+}
+
+
+//--------------------------------------
+// Persistence
+//--------------------------------------
+
+// Opens the log file for appending. The log file is created with an empty
+// header if it does not exist. Any incomplete or corrupt records at the end
+// of the log are removed so that new records can be appended after the last
+// complete one.
+//
+// wal - The log.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_wal_open(sky_wal *wal)
+{
+    int rc;
+    void *data = NULL;
+    check(wal != NULL, "WAL required");
+    check(wal->path != NULL, "WAL path required");
+    check(wal->fd == -1, "WAL is already open");
+
+    wal->fd = open(bdata(wal->path), O_RDWR | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+    check(wal->fd != -1, "Unable to open WAL file: %s", bdata(wal->path));
+
+    // Write the header to a new log.
+    struct stat st;
+    check(fstat(wal->fd, &st) == 0, "Unable to stat WAL file: %s", bdata(wal->path));
+    if(st.st_size == 0) {
+        uint32_t header[SKY_WAL_HEADER_LENGTH / sizeof(uint32_t)];
+        memset(header, 0, sizeof(header));
+        header[0] = SKY_WAL_MAGIC;
+        header[1] = SKY_WAL_VERSION;
+        check(write(wal->fd, header, sizeof(header)) == sizeof(header), "Unable to write WAL header: %s", bdata(wal->path));
+        rc = fsync(wal->fd);
+        check(rc == 0, "Unable to sync WAL file: %s", bdata(wal->path));
+        st.st_size = sizeof(header);
+    }
+    check(st.st_size >= (off_t)SKY_WAL_HEADER_LENGTH, "WAL file is truncated: %s", bdata(wal->path));
+    wal->length = st.st_size;
+    wal->pending_count = 0;
+    wal->buffer_length = 0;
+
+    // Map the header and validate it.
+    wal->header = mmap(0, SKY_WAL_HEADER_LENGTH, PROT_READ | PROT_WRITE, MAP_SHARED, wal->fd, 0);
+    check(wal->header != MAP_FAILED, "Unable to memory map WAL header: %s", bdata(wal->path));
+    check(*((uint32_t*)wal->header) == SKY_WAL_MAGIC, "Invalid WAL file: %s", bdata(wal->path));
+    check(*((uint32_t*)(wal->header + sizeof(uint32_t))) == SKY_WAL_VERSION, "Unsupported WAL version: %s", bdata(wal->path));
+
+    // The applied LSN can only be trusted if the page cache that held the
+    // applied blocks survived. Otherwise fall back to the checkpoint.
+    uint64_t boot_id = sky_wal_get_boot_id();
+    uint64_t *header_boot_id = (uint64_t*)(wal->header + SKY_WAL_HEADER_BOOT_ID_OFFSET);
+    if(boot_id == 0 || *header_boot_id != boot_id) {
+        sky_wal_set_applied_lsn(wal, sky_wal_get_checkpoint_lsn(wal));
+        *header_boot_id = boot_id;
+    }
+
+    // Find the end of the last complete record and continue numbering from
+    // the highest LSN in the log.
+    size_t length = 0;
+    rc = sky_wal_read(wal, &data, &length);
+    check(rc == 0, "Unable to read WAL");
+    wal->lsn = sky_wal_get_applied_lsn(wal);
+    void *ptr = data + SKY_WAL_HEADER_LENGTH;
+    void *endptr = data + length;
+    size_t record_length;
+    while((record_length = sky_wal_validate_record(ptr, endptr)) > 0) {
+        sky_wal_lsn_t lsn = *((sky_wal_lsn_t*)(ptr + sizeof(uint32_t) + sizeof(uint32_t)));
+        if(lsn > wal->lsn) wal->lsn = lsn;
+        ptr += record_length;
+    }
+
+    // Remove a torn record from the end of the log.
+    if(ptr < endptr) {
+        log_warn("Discarding incomplete WAL record at offset %ld", (long)(ptr - data));
+        rc = ftruncate(wal->fd, ptr - data);
+        check(rc == 0, "Unable to truncate WAL file: %s", bdata(wal->path));
+        rc = fsync(wal->fd);
+        check(rc == 0, "Unable to sync WAL file: %s", bdata(wal->path));
+        wal->length = ptr - data;
+    }
+
+    free(data);
+    return 0;
+
+error:
+    free(data);
+    sky_wal_close(wal);
+    return -1;
+}
+
+// Syncs any buffered records and closes the log file.
+//
+// wal - The log.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_wal_close(sky_wal *wal)
+{
+    int rc;
+    check(wal != NULL, "WAL required");
+
+    if(wal->fd != -1 && wal->header != NULL && wal->header != MAP_FAILED) {
+        rc = sky_wal_sync(wal);
+        check(rc == 0, "Unable to sync WAL before close");
+    }
+    sky_wal_unmap_header(wal);
+    if(wal->fd != -1) close(wal->fd);
+    wal->fd = -1;
+    wal->length = 0;
+    wal->buffer_length = 0;
+    wal->pending_count = 0;
+    wal->lsn = 0;
+
+    return 0;
+
+error:
+    sky_wal_unmap_header(wal);
+    if(wal->fd != -1) close(wal->fd);
+    wal->fd = -1;
+    return -1;
+}
+
+// Unmaps the log header.
+//
+// wal - The log.
+void sky_wal_unmap_header(sky_wal *wal)
+{
+    if(wal->header != NULL && wal->header != MAP_FAILED) {
+        munmap(wal->header, SKY_WAL_HEADER_LENGTH);
+    }
+    wal->header = NULL;
+}
+
+// Reads the whole log file into memory. The caller owns the returned buffer.
+//
+// wal    - The log.
+// ret    - A pointer to where the buffer is returned.
+// length - A pointer to where the length of the buffer is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_wal_read(sky_wal *wal, void **ret, size_t *length)
+{
+    void *data = NULL;
+    check(wal != NULL, "WAL required");
+    check(wal->fd != -1, "WAL must be open to read");
+    check(ret != NULL, "Return address required");
+    check(length != NULL, "Length address required");
+
+    data = malloc(wal->length); check_mem(data);
+    size_t offset = 0;
+    while(offset < wal->length) {
+        ssize_t n = pread(wal->fd, data + offset, wal->length - offset, offset);
+        check(n > 0, "Unable to read WAL file: %s", bdata(wal->path));
+        offset += n;
+    }
+
+    *ret = data;
+    *length = wal->length;
+    return 0;
+
+error:
+    free(data);
+    *ret = NULL;
+    *length = 0;
+    return -1;
+}
+
+
+//--------------------------------------
+// Logging
+//--------------------------------------
+
+// Appends an event to the log's in-memory buffer and assigns it the next
+// LSN. The record is not written to the log file until the next commit.
+//
+// wal   - The log.
+// event - The event to log.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_wal_append(sky_wal *wal, sky_event *event)
+{
+    int rc;
+    size_t sz;
+    check(wal != NULL, "WAL required");
+    check(wal->fd != -1, "WAL must be open to append");
+    check(event != NULL, "Event required");
+
+    // Calculate the record size.
+    uint32_t length = sizeof(sky_object_id_t) + sky_event_sizeof(event);
+    size_t record_length = SKY_WAL_RECORD_HEADER_LENGTH + length;
+
+    // Grow the buffer if needed.
+    if(wal->buffer_length + record_length > wal->buffer_capacity) {
+        size_t capacity = (wal->buffer_capacity > 0 ? wal->buffer_capacity : 0x1000);
+        while(capacity < wal->buffer_length + record_length) {
+            capacity *= 2;
+        }
+        wal->buffer = realloc(wal->buffer, capacity);
+        check_mem(wal->buffer);
+        wal->buffer_capacity = capacity;
+    }
+
+    // Write the object id and event after the record header.
+    void *ptr = wal->buffer + wal->buffer_length;
+    void *body = ptr + SKY_WAL_RECORD_HEADER_LENGTH;
+    *((sky_object_id_t*)body) = event->object_id;
+    rc = sky_event_pack(event, body + sizeof(sky_object_id_t), &sz);
+    check(rc == 0, "Unable to pack event into WAL record");
+
+    // Write the record header. The checksum covers the LSN and the body.
+    void *lsnptr = ptr + sizeof(uint32_t) + sizeof(uint32_t);
+    *((uint32_t*)ptr) = length;
+    *((sky_wal_lsn_t*)lsnptr) = wal->lsn + 1;
+    *((uint32_t*)(ptr + sizeof(uint32_t))) = sky_wal_checksum(lsnptr, sizeof(sky_wal_lsn_t) + length);
+
+    wal->buffer_length += record_length;
+    wal->pending_count++;
+    wal->lsn++;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Writes any buffered records to the log file and syncs the log to disk. All
+// records appended since the last commit share the sync so callers should
+// append a whole batch before committing. An insert should only be
+// acknowledged after its commit returns.
+//
+// wal - The log.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_wal_commit(sky_wal *wal)
+{
+    int rc;
+    check(wal != NULL, "WAL required");
+
+    rc = sky_wal_sync(wal);
+    check(rc == 0, "Unable to sync WAL");
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Discards the records appended since the last commit. This is used when the
+// events in those records could not be applied to the table so that they are
+// not replayed later.
+//
+// wal - The log.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_wal_rollback(sky_wal *wal)
+{
+    check(wal != NULL, "WAL required");
+
+    if(wal->buffer_length > 0) {
+        sky_wal_lsn_t lsn = *((sky_wal_lsn_t*)(wal->buffer + sizeof(uint32_t) + sizeof(uint32_t)));
+        return sky_wal_rollback_to(wal, lsn - 1);
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Discards the uncommitted records after a given LSN. This is used when only
+// the first events of a batch could be applied so that the records of the
+// applied events are still committed.
+//
+// wal - The log.
+// lsn - The LSN of the last record to keep.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_wal_rollback_to(sky_wal *wal, sky_wal_lsn_t lsn)
+{
+    check(wal != NULL, "WAL required");
+    check(lsn <= wal->lsn, "Unable to roll back to a later LSN");
+
+    // Find the first buffered record after the LSN.
+    void *ptr = wal->buffer;
+    void *endptr = wal->buffer + wal->buffer_length;
+    while(ptr < endptr && *((sky_wal_lsn_t*)(ptr + sizeof(uint32_t) + sizeof(uint32_t))) <= lsn) {
+        ptr += SKY_WAL_RECORD_HEADER_LENGTH + *((uint32_t*)ptr);
+    }
+
+    // Only records that haven't been written to the log file can be removed.
+    uint32_t count = 0;
+    void *recptr = ptr;
+    while(recptr < endptr) {
+        recptr += SKY_WAL_RECORD_HEADER_LENGTH + *((uint32_t*)recptr);
+        count++;
+    }
+    check(count == wal->lsn - lsn, "Unable to roll back written WAL records");
+
+    // Reuse the LSNs of the discarded records.
+    wal->buffer_length = ptr - wal->buffer;
+    wal->pending_count -= count;
+    wal->lsn = lsn;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Writes buffered records to the log file and syncs the log to disk.
+//
+// wal - The log.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_wal_sync(sky_wal *wal)
+{
+    int rc;
+    check(wal != NULL, "WAL required");
+
+    rc = sky_wal_flush(wal);
+    check(rc == 0, "Unable to flush WAL");
+
+    if(wal->pending_count > 0) {
+        rc = fdatasync(wal->fd);
+        check(rc == 0, "Unable to sync WAL file: %s", bdata(wal->path));
+        wal->pending_count = 0;
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Writes buffered records to the log file without syncing.
+//
+// wal - The log.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_wal_flush(sky_wal *wal)
+{
+    check(wal != NULL, "WAL required");
+
+    size_t offset = 0;
+    while(offset < wal->buffer_length) {
+        ssize_t n = write(wal->fd, wal->buffer + offset, wal->buffer_length - offset);
+        check(n > 0, "Unable to write to WAL file: %s", bdata(wal->path));
+        offset += n;
+    }
+    wal->length += wal->buffer_length;
+    wal->buffer_length = 0;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Advances the checkpoint LSN, syncs the log header and removes all records
+// from the log. This should only be performed after the data file has been
+// synced to disk and every record has been applied to it.
+//
+// wal - The log.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_wal_truncate(sky_wal *wal)
+{
+    int rc;
+    check(wal != NULL, "WAL required");
+    check(wal->fd != -1, "WAL must be open to truncate");
+    check(sky_wal_get_applied_lsn(wal) == wal->lsn, "Unable to truncate unapplied WAL records");
+
+    rc = sky_wal_flush(wal);
+    check(rc == 0, "Unable to flush WAL");
+    *((sky_wal_lsn_t*)(wal->header + SKY_WAL_HEADER_CHECKPOINT_LSN_OFFSET)) = wal->lsn;
+    rc = msync(wal->header, SKY_WAL_HEADER_LENGTH, MS_SYNC);
+    check(rc == 0, "Unable to sync WAL header: %s", bdata(wal->path));
+    rc = ftruncate(wal->fd, SKY_WAL_HEADER_LENGTH);
+    check(rc == 0, "Unable to truncate WAL file: %s", bdata(wal->path));
+    rc = fsync(wal->fd);
+    check(rc == 0, "Unable to sync WAL file: %s", bdata(wal->path));
+
+    wal->length = SKY_WAL_HEADER_LENGTH;
+    wal->pending_count = 0;
+
+    return 0;
+
+error:
+    return -1;
+}
+
+// Checks whether the log has grown large enough that the data file should be
+// checkpointed and the log truncated.
+//
+// wal - The log.
+//
+// Returns true if a checkpoint is needed.
+bool sky_wal_needs_checkpoint(sky_wal *wal)
+{
+    return (wal != NULL && wal->length + wal->buffer_length >= wal->checkpoint_length);
+}
+
+// Retrieves the LSN of the last record applied to the data file.
+//
+// wal - The log.
+//
+// Returns the applied LSN.
+sky_wal_lsn_t sky_wal_get_applied_lsn(sky_wal *wal)
+{
+    return *((sky_wal_lsn_t*)(wal->header + SKY_WAL_HEADER_APPLIED_LSN_OFFSET));
+}
+
+// Records the LSN of the last record applied to the data file. The header is
+// shared with the OS page cache so the LSN survives a process crash without
+// a sync. It is only used for replay during the same boot.
+//
+// wal - The log.
+// lsn - The applied LSN.
+void sky_wal_set_applied_lsn(sky_wal *wal, sky_wal_lsn_t lsn)
+{
+    *((sky_wal_lsn_t*)(wal->header + SKY_WAL_HEADER_APPLIED_LSN_OFFSET)) = lsn;
+}
+
+// Retrieves the LSN of the last record in the data file as of the last
+// checkpoint.
+//
+// wal - The log.
+//
+// Returns the checkpoint LSN.
+sky_wal_lsn_t sky_wal_get_checkpoint_lsn(sky_wal *wal)
+{
+    return *((sky_wal_lsn_t*)(wal->header + SKY_WAL_HEADER_CHECKPOINT_LSN_OFFSET));
+}
+
+// Retrieves an identifier for the current boot of the system. Two logs
+// opened with the same boot id share the same page cache.
+//
+// Returns the boot id or zero if it is not available.
+uint64_t sky_wal_get_boot_id()
+{
+    char buffer[64];
+    FILE *file = fopen(SKY_WAL_BOOT_ID_PATH, "r");
+    if(file == NULL) {
+        return 0;
+    }
+    size_t sz = fread(buffer, 1, sizeof(buffer), file);
+    fclose(file);
+    if(sz == 0) {
+        return 0;
+    }
+
+    // Hash the id with 64-bit FNV-1a.
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i;
+    for(i=0; i<sz; i++) {
+        hash ^= (uint8_t)buffer[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+
+//--------------------------------------
+// Recovery
+//--------------------------------------
+
+// Checks that the record at a given position is complete and that its
+// checksum matches.
+//
+// ptr    - A pointer to the start of the record.
+// endptr - A pointer to the end of the log data.
+//
+// Returns the length of the record if it is valid. Otherwise returns 0.
+size_t sky_wal_validate_record(void *ptr, void *endptr)
+{
+    if(ptr + SKY_WAL_RECORD_HEADER_LENGTH > endptr) {
+        return 0;
+    }
+
+    uint32_t length = *((uint32_t*)ptr);
+    uint32_t checksum = *((uint32_t*)(ptr + sizeof(uint32_t)));
+    void *lsnptr = ptr + sizeof(uint32_t) + sizeof(uint32_t);
+    if(length <= sizeof(sky_object_id_t) || lsnptr + sizeof(sky_wal_lsn_t) + length > endptr) {
+        return 0;
+    }
+    if(sky_wal_checksum(lsnptr, sizeof(sky_wal_lsn_t) + length) != checksum) {
+        return 0;
+    }
+
+    return SKY_WAL_RECORD_HEADER_LENGTH + length;
+}
+
+// Reads every record in the log that has not been applied to the data file.
+// The caller owns the returned events and the array.
+//
+// wal    - The log.
+// ret    - A pointer to where the array of events is returned.
+// count  - A pointer to where the number of events is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_wal_read_events(sky_wal *wal, sky_event ***ret, uint32_t *count)
+{
+    int rc;
+    uint32_t i;
+    size_t sz;
+    void *data = NULL;
+    size_t length = 0;
+    sky_event **events = NULL;
+    uint32_t event_count = 0;
+    check(wal != NULL, "WAL required");
+    check(wal->fd != -1, "WAL must be open to read");
+    check(ret != NULL, "Return address required");
+    check(count != NULL, "Count address required");
+
+    *ret = NULL;
+    *count = 0;
+
+    // Read the whole log into memory.
+    rc = sky_wal_read(wal, &data, &length);
+    check(rc == 0, "Unable to read WAL");
+
+    // Unpack each record after the applied LSN.
+    sky_wal_lsn_t applied_lsn = sky_wal_get_applied_lsn(wal);
+    uint32_t capacity = 0;
+    void *ptr = data + SKY_WAL_HEADER_LENGTH;
+    void *endptr = data + length;
+    size_t record_length;
+    while((record_length = sky_wal_validate_record(ptr, endptr)) > 0) {
+        sky_wal_lsn_t lsn = *((sky_wal_lsn_t*)(ptr + sizeof(uint32_t) + sizeof(uint32_t)));
+        void *body = ptr + SKY_WAL_RECORD_HEADER_LENGTH;
+        ptr += record_length;
+        if(lsn <= applied_lsn) {
+            continue;
+        }
+
+        if(event_count == capacity) {
+            capacity = (capacity > 0 ? capacity * 2 : 256);
+            sky_event **new_events = realloc(events, sizeof(*events) * capacity);
+            check_mem(new_events);
+            events = new_events;
+        }
+
+        sky_object_id_t object_id = *((sky_object_id_t*)body);
+        events[event_count] = sky_event_create(object_id, 0, 0);
+        check_mem(events[event_count]);
+        event_count++;
+        rc = sky_event_unpack(events[event_count-1], body + sizeof(sky_object_id_t), &sz);
+        check(rc == 0, "Unable to unpack WAL event");
+    }
+
+    free(data);
+    *ret = events;
+    *count = event_count;
+    return 0;
+
+error:
+    for(i=0; i<event_count; i++) {
+        sky_event_free(events[i]);
+    }
+    free(events);
+    free(data);
+    return -1;
+}
+
+// Replays the records that have not been applied yet into a data file and
+// marks them as applied.
+//
+// wal       - The log.
+// data_file - The data file to apply events to.
+// count     - A pointer to where the number of replayed events is returned.
+//
+// Returns 0 if successful, otherwise returns -1.
+int sky_wal_replay(sky_wal *wal, sky_data_file *data_file, uint32_t *count)
+{
+    int rc;
+    uint32_t i;
+    sky_event **events = NULL;
+    uint32_t event_count = 0;
+    check(wal != NULL, "WAL required");
+    check(wal->fd != -1, "WAL must be open to replay");
+    check(data_file != NULL, "Data file required");
+
+    if(count != NULL) *count = 0;
+
+    rc = sky_wal_read_events(wal, &events, &event_count);
+    check(rc == 0, "Unable to read WAL");
+
+    for(i=0; i<event_count; i++) {
+        rc = sky_data_file_add_event(data_file, events[i]);
+        check(rc == 0, "Unable to replay WAL event");
+    }
+    sky_wal_set_applied_lsn(wal, wal->lsn);
+    if(count != NULL) *count = event_count;
+
+    for(i=0; i<event_count; i++) {
+        sky_event_free(events[i]);
+    }
+    free(events);
+    return 0;
+
+error:
+    for(i=0; i<event_count; i++) {
+        sky_event_free(events[i]);
+    }
+    free(events);
+    return -1;
+}
+
+
+//--------------------------------------
+// Checksum
+//--------------------------------------
+
+// Calculates a 32-bit FNV-1a checksum over a record body.
+//
+// ptr - A pointer to the record body.
+// sz  - The length of the record body.
+//
+// Returns the checksum.
+uint32_t sky_wal_checksum(void *ptr, size_t sz)
+{
+    uint32_t hash = 2166136261U;
+    uint8_t *bytes = (uint8_t*)ptr;
+    size_t i;
+    for(i=0; i<sz; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
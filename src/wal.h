@@ -0,0 +1,153 @@
+#ifndef _wal_h
+#define _wal_h
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+typedef struct sky_wal sky_wal;
+
+typedef uint64_t sky_wal_lsn_t;
+
+#include "bstring.h"
+#include "types.h"
+#include "event.h"
+#include "data_file.h"
+
+//==============================================================================
+//
+// Overview
+//
+//==============================================================================
+
+// The write-ahead log (WAL) is an append-only file that sits next to the
+// table's data and header files. Every event added to the table is appended
+// to the log before it is applied to the data file. This allows the data file
+// blocks to be written back to disk lazily instead of being synced on every
+// insert.
+//
+// Log records are buffered in memory and are written and synced to disk on
+// commit. A table commits once per insert call and the insert is only
+// acknowledged after the commit returns, so every event in a batch shares a
+// single fsync (group commit) and an acknowledged event is always on disk.
+//
+// Each record is numbered with a log sequence number (LSN). The log file
+// starts with a small memory mapped header that holds two LSNs. The
+// checkpoint LSN is the last record that was in the data file when it was
+// last synced. It is only written on checkpoint, after the data file sync,
+// so it never gets ahead of the data on disk. The applied LSN is updated as
+// events are applied and lives in the page cache along with the unsynced
+// data blocks. The header also records the boot id of the system that wrote
+// it. If the log is reopened during the same boot then the page cache still
+// holds the applied blocks and replay starts after the applied LSN.
+// Otherwise replay starts after the checkpoint LSN. Replay goes by LSN so
+// events are never compared by content and identical events are all kept.
+//
+// Once the log grows past the checkpoint length, the data file is synced to
+// disk and the log records are truncated. If the server crashes before a
+// checkpoint then the log is replayed into the data file when the table is
+// reopened.
+
+
+//==============================================================================
+//
+// Typedefs
+//
+//==============================================================================
+
+#define SKY_WAL_DEFAULT_CHECKPOINT_LENGTH 0x1000000
+
+#define SKY_WAL_MAGIC 0x4C41574B
+
+#define SKY_WAL_VERSION 2
+
+#define SKY_WAL_HEADER_LENGTH (sizeof(uint32_t) + sizeof(uint32_t) + sizeof(sky_wal_lsn_t) + sizeof(sky_wal_lsn_t) + sizeof(uint64_t))
+
+#define SKY_WAL_HEADER_CHECKPOINT_LSN_OFFSET (sizeof(uint32_t) + sizeof(uint32_t))
+
+#define SKY_WAL_HEADER_APPLIED_LSN_OFFSET (SKY_WAL_HEADER_CHECKPOINT_LSN_OFFSET + sizeof(sky_wal_lsn_t))
+
+#define SKY_WAL_HEADER_BOOT_ID_OFFSET (SKY_WAL_HEADER_APPLIED_LSN_OFFSET + sizeof(sky_wal_lsn_t))
+
+#define SKY_WAL_BOOT_ID_PATH "/proc/sys/kernel/random/boot_id"
+
+#define SKY_WAL_RECORD_HEADER_LENGTH (sizeof(uint32_t) + sizeof(uint32_t) + sizeof(sky_wal_lsn_t))
+
+struct sky_wal {
+    bstring path;
+    int fd;
+    void *header;
+    size_t length;
+    void *buffer;
+    size_t buffer_length;
+    size_t buffer_capacity;
+    uint32_t pending_count;
+    sky_wal_lsn_t lsn;
+    size_t checkpoint_length;
+};
+
+
+//==============================================================================
+//
+// Functions
+//
+//==============================================================================
+
+//--------------------------------------
+// Lifecycle
+//--------------------------------------
+
+sky_wal *sky_wal_create();
+
+void sky_wal_free(sky_wal *wal);
+
+
+//--------------------------------------
+// Path
+//--------------------------------------
+
+int sky_wal_set_path(sky_wal *wal, bstring path);
+
+
+//--------------------------------------
+// Persistence
+//--------------------------------------
+
+int sky_wal_open(sky_wal *wal);
+
+int sky_wal_close(sky_wal *wal);
+
+
+//--------------------------------------
+// Logging
+//--------------------------------------
+
+int sky_wal_append(sky_wal *wal, sky_event *event);
+
+int sky_wal_commit(sky_wal *wal);
+
+int sky_wal_rollback(sky_wal *wal);
+
+int sky_wal_rollback_to(sky_wal *wal, sky_wal_lsn_t lsn);
+
+int sky_wal_sync(sky_wal *wal);
+
+int sky_wal_truncate(sky_wal *wal);
+
+bool sky_wal_needs_checkpoint(sky_wal *wal);
+
+sky_wal_lsn_t sky_wal_get_applied_lsn(sky_wal *wal);
+
+sky_wal_lsn_t sky_wal_get_checkpoint_lsn(sky_wal *wal);
+
+void sky_wal_set_applied_lsn(sky_wal *wal, sky_wal_lsn_t lsn);
+
+
+//--------------------------------------
+// Recovery
+//--------------------------------------
+
+int sky_wal_read_events(sky_wal *wal, sky_event ***ret, uint32_t *count);
+
+int sky_wal_replay(sky_wal *wal, sky_data_file *data_file, uint32_t *count);
+
+#endif
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dbg.h>
+#include <mem.h>
+#include <lz.h>
+#include <block.h>
+#include <block_cache.h>
+
+#include "minunit.h"
+
+
+//==============================================================================
+//
+// Helpers
+//
+//==============================================================================
+
+#define BLOCK_SIZE 64
+
+#define BLOCK_COUNT 6
+
+#define GET_BLOCK(INDEX) do { \
+    void *_ptr = NULL; \
+    mu_assert_int_equals(sky_block_cache_get(cache, blocks[INDEX], compressed[INDEX], &_ptr), 0); \
+    mu_assert_int_equals(*((uint8_t*)_ptr), INDEX); \
+} while(0)
+
+
+//==============================================================================
+//
+// Test Cases
+//
+//==============================================================================
+
+//--------------------------------------
+// Cache Management
+//--------------------------------------
+
+int test_sky_block_cache_get() {
+    uint32_t i;
+    size_t sz;
+    sky_block *blocks[BLOCK_COUNT];
+    char compressed[BLOCK_COUNT][SKY_BLOCK_COMPRESSED_HEADER_SIZE + SKY_LZ_BOUND(BLOCK_SIZE)];
+    for(i=0; i<BLOCK_COUNT; i++) {
+        char data[BLOCK_SIZE];
+        memset(data, i, BLOCK_SIZE);
+        blocks[i] = sky_block_create(NULL);
+        blocks[i]->index = i;
+        mu_assert_int_equals(sky_block_compress(data, BLOCK_SIZE, compressed[i], sizeof(compressed[i]), &sz), 0);
+    }
+    sky_block_cache *cache = sky_block_cache_create(4, BLOCK_SIZE);
+
+    // The first pass misses on every block.
+    for(i=0; i<BLOCK_COUNT; i++) {
+        GET_BLOCK(i);
+    }
+    mu_assert_int_equals(cache->count, 4);
+    mu_assert_long_equals((long)cache->miss_count, 6L);
+
+    // The two most recently used blocks stay cached.
+    GET_BLOCK(5);
+    GET_BLOCK(4);
+    mu_assert_long_equals((long)cache->hit_count, 2L);
+
+    // The next pass reuses the blocks kept from the first pass. LRU would
+    // miss on every block.
+    for(i=0; i<BLOCK_COUNT; i++) {
+        GET_BLOCK(i);
+    }
+    mu_assert_long_equals((long)cache->hit_count, 4L);
+    mu_assert_long_equals((long)cache->miss_count, 10L);
+
+    // Removed blocks are read again.
+    mu_assert_int_equals(sky_block_cache_remove(cache, blocks[5]), 0);
+    mu_assert_bool(blocks[5]->cache_entry == NULL);
+    GET_BLOCK(5);
+    mu_assert_long_equals((long)cache->miss_count, 11L);
+
+    sky_block_cache_free(cache);
+    for(i=0; i<BLOCK_COUNT; i++) {
+        sky_block_free(blocks[i]);
+    }
+    return 0;
+}
+
+
+//==============================================================================
+//
+// Setup
+//
+//==============================================================================
+
+int all_tests() {
+    mu_run_test(test_sky_block_cache_get);
+    return 0;
+}
+
+RUN_TESTS()
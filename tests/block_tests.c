@@ -134,6 +134,40 @@ int test_sky_block_get_ptr() {
 }
 
 
+int test_sky_block_prefetch() {
+    cleantmp();
+    sky_data_file *data_file = sky_data_file_create();
+    data_file->block_size = 128;
+    data_file->path = bfromcstr("tmp/data");
+    data_file->header_path = bfromcstr("tmp/header");
+    mu_assert_int_equals(sky_data_file_load(data_file), 0);
+    int64_t i;
+    for(i=1; i<20; i++) {
+        sky_event *event = sky_event_create(i, 1LL, 20);
+        mu_assert_int_equals(sky_data_file_add_event(data_file, event), 0);
+        sky_event_free(event);
+    }
+    mu_assert_bool(data_file->block_count > 1);
+
+    // Blocks that don't start on a page boundary can be prefetched.
+    uint32_t j;
+    for(j=0; j<data_file->block_count; j++) {
+        mu_assert_int_equals(sky_block_prefetch(data_file->blocks[j], 1), 0);
+    }
+
+    // Runs of blocks are prefetched together but can't pass the last block.
+    sky_block *first = NULL;
+    for(j=0; j<data_file->block_count; j++) {
+        if(data_file->blocks[j]->index == 0) first = data_file->blocks[j];
+    }
+    mu_assert_int_equals(sky_block_prefetch(first, data_file->block_count), 0);
+    mu_assert_int_equals(sky_block_prefetch(first, data_file->block_count + 1), -1);
+    mu_assert_int_equals(sky_block_prefetch(first, 0), -1);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+
 //--------------------------------------
 // Spanning
 //--------------------------------------
@@ -256,6 +290,84 @@ int test_sky_block_get_path_stats_with_event_in_new_ending_path() {
 }
 
 
+//--------------------------------------
+// Directory
+//--------------------------------------
+
+#define ADD_EVENT(OBJECT_ID, TIMESTAMP, ACTION_ID) do { \
+    sky_event *event = sky_event_create(OBJECT_ID, TIMESTAMP, ACTION_ID); \
+    mu_assert_int_equals(sky_data_file_add_event(data_file, event), 0); \
+    sky_event_free(event); \
+} while (0)
+
+#define ASSERT_DIRECTORY_ENTRY(ENTRY, OBJECT_ID, OFFSET) do { \
+    mu_assert_int_equals(ENTRY.object_id, OBJECT_ID); \
+    mu_assert_int_equals(ENTRY.offset, OFFSET); \
+} while(0)
+
+int test_sky_block_directory() {
+    cleantmp();
+    sky_data_file *data_file = sky_data_file_create();
+    data_file->version = SKY_DATA_FILE_DIRECTORY_VERSION;
+    data_file->block_size = 128;
+    data_file->path = bfromcstr("tmp/data");
+    data_file->header_path = bfromcstr("tmp/header");
+    mu_assert_int_equals(sky_data_file_load(data_file), 0);
+    ADD_EVENT(3, 1LL, 20);
+    ADD_EVENT(1, 1LL, 20);
+    ADD_EVENT(2, 2LL, 20);
+    ADD_EVENT(2, 1LL, 20);
+
+    // Entries are kept in object id order as paths are inserted.
+    sky_block_directory_entry *entries;
+    uint32_t count;
+    mu_assert_int_equals(sky_block_get_directory(data_file->blocks[0], &entries, &count), 0);
+    mu_assert_int_equals(count, 3);
+    ASSERT_DIRECTORY_ENTRY(entries[0], 1, 0);
+    ASSERT_DIRECTORY_ENTRY(entries[1], 2, 19);
+    ASSERT_DIRECTORY_ENTRY(entries[2], 3, 49);
+
+    size_t capacity;
+    mu_assert_int_equals(sky_block_get_capacity(data_file->blocks[0], &capacity), 0);
+    mu_assert_long_equals(capacity, 100L);
+
+    // Path stats are read from the directory.
+    sky_block_path_stat *paths = NULL;
+    uint32_t path_count = 0;
+    sky_event *event = sky_event_create(4, 1LL, 20);
+    mu_assert_int_equals(sky_block_get_path_stats(data_file->blocks[0], event, &paths, &path_count), 0);
+    mu_assert_int_equals(path_count, 4);
+    ASSERT_PATH_STAT(paths[1], 2, 19L, 49L, 30L);
+    ASSERT_PATH_STAT(paths[3], 4, 68L, 68L, 19L);
+    sky_event_free(event);
+    free(paths);
+
+    // Blocks that split rebuild their directories.
+    sky_object_id_t object_id;
+    for(object_id=4; object_id<=6; object_id++) {
+        ADD_EVENT(object_id, 1LL, 20);
+    }
+    mu_assert_int_equals(data_file->block_count, 2);
+    uint32_t i;
+    for(i=0; i<data_file->block_count; i++) {
+        sky_block *block = data_file->blocks[i];
+        mu_assert_int_equals(sky_block_get_directory(block, &entries, &count), 0);
+        mu_assert_int_equals(count, block->max_object_id - block->min_object_id + 1);
+        ASSERT_DIRECTORY_ENTRY(entries[0], block->min_object_id, 0);
+    }
+
+    // The version is read back from the header file.
+    mu_assert_int_equals(sky_data_file_unload(data_file), 0);
+    data_file->version = SKY_DATA_FILE_VERSION;
+    mu_assert_int_equals(sky_data_file_load(data_file), 0);
+    mu_assert_int_equals(data_file->version, SKY_DATA_FILE_DIRECTORY_VERSION);
+    mu_assert_bool(sky_block_has_directory(data_file->blocks[0]));
+
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+
 
 //==============================================================================
 //
@@ -268,6 +380,7 @@ int all_tests() {
     mu_run_test(test_sky_block_unpack);
     mu_run_test(test_sky_block_get_offset);
     mu_run_test(test_sky_block_get_ptr);
+    mu_run_test(test_sky_block_prefetch);
     mu_run_test(test_sky_block_get_span_count);
 
     mu_run_test(test_sky_block_get_path_stats_with_no_event);
@@ -276,6 +389,8 @@ int all_tests() {
     mu_run_test(test_sky_block_get_path_stats_with_event_in_new_middle_path);
     mu_run_test(test_sky_block_get_path_stats_with_event_in_new_ending_path);
 
+    mu_run_test(test_sky_block_directory);
+
     return 0;
 }
 
@@ -0,0 +1,323 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <dbg.h>
+#include <mem.h>
+#include <compactor.h>
+
+#include "minunit.h"
+
+
+//==============================================================================
+//
+// Helpers
+//
+//==============================================================================
+
+#define INIT_DATA_FILE() \
+    cleantmp(); \
+    data_file = sky_data_file_create(); \
+    data_file->block_size = 64; \
+    data_file->path = bfromcstr("tmp/data"); \
+    data_file->header_path = bfromcstr("tmp/header"); \
+    mu_assert_int_equals(sky_data_file_load(data_file), 0);
+
+#define ADD_EVENT(OBJECT_ID, TIMESTAMP, ACTION_ID) do { \
+    sky_event *event = sky_event_create(OBJECT_ID, TIMESTAMP, ACTION_ID); \
+    mu_assert_int_equals(sky_data_file_add_event(data_file, event), 0); \
+    sky_event_free(event); \
+} while (0)
+
+#define ASSERT_CONTAINS_EVENT(OBJECT_ID, TIMESTAMP, ACTION_ID) do { \
+    bool _ret = false; \
+    sky_event *event = sky_event_create(OBJECT_ID, TIMESTAMP, ACTION_ID); \
+    mu_assert_int_equals(sky_data_file_contains_event(data_file, event, &_ret), 0); \
+    mu_assert(_ret, "Event not found"); \
+    sky_event_free(event); \
+} while (0)
+
+#define ASSERT_BLOCK(NUM, MIN_OBJECT_ID, MAX_OBJECT_ID, SPANNED) do {\
+    sky_block *_block = data_file->blocks[NUM]; \
+    mu_assert_int_equals(_block->index, NUM); \
+    mu_assert_int_equals(_block->min_object_id, MIN_OBJECT_ID); \
+    mu_assert_int_equals(_block->max_object_id, MAX_OBJECT_ID); \
+    mu_assert(_block->spanned == SPANNED, ""); \
+} while(0)
+
+
+//==============================================================================
+//
+// Test Cases
+//
+//==============================================================================
+
+//--------------------------------------
+// Compaction
+//--------------------------------------
+
+int test_sky_compactor_compact() {
+    sky_data_file *data_file;
+    INIT_DATA_FILE();
+    uint32_t i;
+    for(i=10; i>0; i--) {
+        ADD_EVENT(i, 10LL, 20);
+    }
+    mu_assert(data_file->block_count > 4, "Expected block splits");
+
+    // Each 19 byte path fits three to a block.
+    sky_compactor *compactor = sky_compactor_create();
+    compactor->fill_factor = 1;
+    mu_assert_int_equals(sky_compactor_compact(compactor, data_file), 0);
+    mu_assert_int_equals(data_file->block_count, 4);
+    ASSERT_BLOCK(0, 1, 3, false);
+    ASSERT_BLOCK(1, 4, 6, false);
+    ASSERT_BLOCK(2, 7, 9, false);
+    ASSERT_BLOCK(3, 10, 10, false);
+    for(i=1; i<=10; i++) {
+        ASSERT_CONTAINS_EVENT(i, 10LL, 20);
+    }
+
+    // Lower fill factors leave room in each block.
+    compactor->fill_factor = 0.5;
+    mu_assert_int_equals(sky_compactor_compact(compactor, data_file), 0);
+    mu_assert_int_equals(data_file->block_count, 10);
+    ASSERT_BLOCK(9, 10, 10, false);
+
+    sky_compactor_free(compactor);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+int test_sky_compactor_compact_upgrade_version() {
+    sky_data_file *data_file;
+    INIT_DATA_FILE();
+    uint32_t i;
+    for(i=10; i>0; i--) {
+        ADD_EVENT(i, 10LL, 20);
+    }
+
+    // Each 19 byte path needs an 8 byte directory entry so only two fit.
+    sky_compactor *compactor = sky_compactor_create();
+    compactor->fill_factor = 1;
+    compactor->version = SKY_DATA_FILE_DIRECTORY_VERSION;
+    mu_assert_int_equals(sky_compactor_compact(compactor, data_file), 0);
+    mu_assert_int_equals(data_file->version, SKY_DATA_FILE_DIRECTORY_VERSION);
+    mu_assert_int_equals(data_file->block_count, 5);
+    for(i=0; i<5; i++) {
+        sky_block_directory_entry *entries;
+        uint32_t count;
+        ASSERT_BLOCK(i, (i*2)+1, (i*2)+2, false);
+        mu_assert_int_equals(sky_block_get_directory(data_file->blocks[i], &entries, &count), 0);
+        mu_assert_int_equals(count, 2);
+    }
+    for(i=1; i<=10; i++) {
+        ASSERT_CONTAINS_EVENT(i, 10LL, 20);
+    }
+
+    // New events are added through the directory.
+    ADD_EVENT(11, 10LL, 20);
+    ADD_EVENT(3, 11LL, 20);
+    ASSERT_CONTAINS_EVENT(11, 10LL, 20);
+    ASSERT_CONTAINS_EVENT(3, 11LL, 20);
+
+    sky_compactor_free(compactor);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+int test_sky_compactor_compact_compact_encoding() {
+    sky_data_file *data_file;
+    INIT_DATA_FILE();
+    uint32_t i;
+    for(i=10; i>0; i--) {
+        ADD_EVENT(i, 10LL, 20);
+    }
+
+    // Each 19 byte path shrinks to 12 bytes so three fit instead of two.
+    sky_compactor *compactor = sky_compactor_create();
+    compactor->fill_factor = 1;
+    compactor->version = SKY_DATA_FILE_COMPACT_VERSION;
+    mu_assert_int_equals(sky_compactor_compact(compactor, data_file), 0);
+    mu_assert_int_equals(data_file->version, SKY_DATA_FILE_COMPACT_VERSION);
+    mu_assert_int_equals(data_file->block_count, 4);
+    for(i=0; i<3; i++) {
+        ASSERT_BLOCK(i, (i*3)+1, (i*3)+3, false);
+    }
+    ASSERT_BLOCK(3, 10, 10, false);
+    for(i=0; i<4; i++) {
+        mu_assert_bool(sky_block_is_compact(data_file->blocks[i]));
+    }
+    for(i=1; i<=10; i++) {
+        ASSERT_CONTAINS_EVENT(i, 10LL, 20);
+    }
+
+    // Adding an event expands the block back into rows and splits it since
+    // the expanded paths no longer fit.
+    ADD_EVENT(3, 11LL, 20);
+    mu_assert_int_equals(data_file->block_count, 5);
+    for(i=0; i<data_file->block_count; i++) {
+        sky_block *block = data_file->blocks[i];
+        mu_assert_bool(sky_block_is_compact(block) == (block->min_object_id > 3));
+    }
+    for(i=1; i<=10; i++) {
+        ASSERT_CONTAINS_EVENT(i, 10LL, 20);
+    }
+    ASSERT_CONTAINS_EVENT(3, 11LL, 20);
+
+    // Recompacting encodes the new blocks as well.
+    mu_assert_int_equals(sky_compactor_compact(compactor, data_file), 0);
+    for(i=0; i<data_file->block_count; i++) {
+        mu_assert_bool(sky_block_is_compact(data_file->blocks[i]));
+    }
+    ASSERT_CONTAINS_EVENT(3, 10LL, 20);
+    ASSERT_CONTAINS_EVENT(3, 11LL, 20);
+
+    sky_compactor_free(compactor);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+int test_sky_compactor_compact_compressed() {
+    sky_data_file *data_file;
+    INIT_DATA_FILE();
+    data_file->block_cache_size = 2;
+    uint32_t i;
+    for(i=10; i>0; i--) {
+        ADD_EVENT(i, 10LL, 20);
+    }
+
+    sky_compactor *compactor = sky_compactor_create();
+    compactor->fill_factor = 1;
+    compactor->compress = true;
+    mu_assert_int_equals(sky_compactor_compact(compactor, data_file), 0);
+    mu_assert_int_equals(data_file->block_count, 4);
+    for(i=0; i<3; i++) {
+        ASSERT_BLOCK(i, (i*3)+1, (i*3)+3, false);
+    }
+    ASSERT_BLOCK(3, 10, 10, false);
+    for(i=0; i<4; i++) {
+        mu_assert_bool(sky_block_is_compressed(data_file->blocks[i]));
+    }
+
+    // Compressed blocks are read through the cache.
+    for(i=1; i<=10; i++) {
+        ASSERT_CONTAINS_EVENT(i, 10LL, 20);
+    }
+    mu_assert_int_equals(data_file->block_cache->count, 2);
+    mu_assert_bool(data_file->block_cache->miss_count >= 4);
+
+    // Adding an event decompresses the block.
+    ADD_EVENT(2, 11LL, 20);
+    for(i=0; i<data_file->block_count; i++) {
+        sky_block *block = data_file->blocks[i];
+        mu_assert_bool(sky_block_is_compressed(block) == (block->min_object_id > 3));
+    }
+    ASSERT_CONTAINS_EVENT(2, 10LL, 20);
+    ASSERT_CONTAINS_EVENT(2, 11LL, 20);
+    ASSERT_CONTAINS_EVENT(4, 10LL, 20);
+
+    // Uncompressed compaction decompresses the remaining blocks.
+    compactor->compress = false;
+    mu_assert_int_equals(sky_compactor_compact(compactor, data_file), 0);
+    for(i=0; i<data_file->block_count; i++) {
+        mu_assert_bool(!sky_block_is_compressed(data_file->blocks[i]));
+    }
+    for(i=1; i<=10; i++) {
+        ASSERT_CONTAINS_EVENT(i, 10LL, 20);
+    }
+
+    sky_compactor_free(compactor);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+int test_sky_compactor_compact_spanned_path() {
+    sky_data_file *data_file;
+    INIT_DATA_FILE();
+    uint32_t i;
+    ADD_EVENT(1LL, 1LL, 20);
+    ADD_EVENT(3LL, 1LL, 20);
+    for(i=0; i<12; i++) {
+        ADD_EVENT(2LL, (sky_timestamp_t)(100-i), 20);
+    }
+
+    // The 140 byte path is stored in three consecutive blocks.
+    sky_compactor *compactor = sky_compactor_create();
+    compactor->fill_factor = 1;
+    mu_assert_int_equals(sky_compactor_compact(compactor, data_file), 0);
+    mu_assert_int_equals(data_file->block_count, 5);
+    ASSERT_BLOCK(0, 1, 1, false);
+    ASSERT_BLOCK(1, 2, 2, true);
+    ASSERT_BLOCK(2, 2, 2, true);
+    ASSERT_BLOCK(3, 2, 2, true);
+    ASSERT_BLOCK(4, 3, 3, false);
+    mu_assert_long_equals(data_file->blocks[1]->min_timestamp, 89LL);
+    mu_assert_long_equals(data_file->blocks[3]->max_timestamp, 100LL);
+    for(i=0; i<12; i++) {
+        ASSERT_CONTAINS_EVENT(2LL, (sky_timestamp_t)(100-i), 20);
+    }
+
+    sky_compactor_free(compactor);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+int test_sky_compactor_compact_large_path() {
+    sky_data_file *data_file;
+    INIT_DATA_FILE();
+    data_file->extent_path = bfromcstr("tmp/extents");
+    uint32_t i;
+    ADD_EVENT(1LL, 1LL, 20);
+    ADD_EVENT(3LL, 1LL, 20);
+    for(i=0; i<12; i++) {
+        ADD_EVENT(2LL, (sky_timestamp_t)(100-i), 20);
+    }
+    mu_assert_int_equals(data_file->extent_count, 0);
+
+    // The spanned path is moved into an extent.
+    sky_compactor *compactor = sky_compactor_create();
+    compactor->fill_factor = 0.5;
+    data_file->large_path_threshold = 40;
+    mu_assert_int_equals(sky_compactor_compact(compactor, data_file), 0);
+    mu_assert_int_equals(data_file->block_count, 2);
+    ASSERT_BLOCK(0, 1, 1, false);
+    ASSERT_BLOCK(1, 3, 3, false);
+    mu_assert_int_equals(data_file->extent_count, 1);
+    mu_assert_int_equals(data_file->extents[0]->object_id, 2);
+    mu_assert_long_equals(data_file->extents[0]->capacity, 280L);
+    mu_assert_long_equals(data_file->extents[0]->min_timestamp, 89LL);
+    mu_assert_long_equals(data_file->extents[0]->max_timestamp, 100LL);
+    for(i=0; i<12; i++) {
+        ASSERT_CONTAINS_EVENT(2LL, (sky_timestamp_t)(100-i), 20);
+    }
+
+    // Paths stay in extents when there is no threshold.
+    data_file->large_path_threshold = 0;
+    mu_assert_int_equals(sky_compactor_compact(compactor, data_file), 0);
+    mu_assert_int_equals(data_file->extent_count, 1);
+    mu_assert_int_equals(data_file->block_count, 2);
+    ASSERT_CONTAINS_EVENT(1LL, 1LL, 20);
+
+    sky_compactor_free(compactor);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+
+//==============================================================================
+//
+// Setup
+//
+//==============================================================================
+
+int all_tests() {
+    mu_run_test(test_sky_compactor_compact);
+    mu_run_test(test_sky_compactor_compact_upgrade_version);
+    mu_run_test(test_sky_compactor_compact_compact_encoding);
+    mu_run_test(test_sky_compactor_compact_compressed);
+    mu_run_test(test_sky_compactor_compact_spanned_path);
+    mu_run_test(test_sky_compactor_compact_large_path);
+    return 0;
+}
+
+RUN_TESTS()
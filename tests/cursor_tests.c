@@ -71,6 +71,95 @@ int test_sky_cursor_next() {
     return 0;
 }
 
+int test_sky_cursor_next_compact() {
+    size_t sz;
+    sky_timestamp_t timestamp;
+    sky_action_id_t action_id;
+    void *data_ptr;
+    uint32_t data_length;
+    char event[DATA_LENGTH];
+    void *compact = calloc(DATA_LENGTH, 1);
+    mu_assert_int_equals(sky_path_pack_compact(&DATA, compact, &sz), 0);
+    sky_cursor *cursor = sky_cursor_create();
+
+    // Event 1
+    int rc = sky_cursor_set_path(cursor, compact);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_int_equals(cursor->event_index, 0);
+    mu_assert_int_equals(sky_cursor_get_timestamp(cursor, &timestamp), 0);
+    mu_assert_int64_equals(timestamp, 160LL);
+    mu_assert_int_equals(sky_cursor_get_action_id(cursor, &action_id), 0);
+    mu_assert_int_equals(action_id, 11);
+    mu_assert_int_equals(sky_cursor_get_data_ptr(cursor, &data_ptr, &data_length), 0);
+    mu_assert_long_equals(data_length, 0L);
+    mu_assert_int_equals(sky_cursor_pack_event(cursor, event, &sz), 0);
+    mu_assert_long_equals(sz, 11L);
+    mu_assert_mem(event, &DATA[8], 11);
+
+    // Event 2
+    rc = sky_cursor_next(cursor);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_int_equals(cursor->event_index, 1);
+    mu_assert_int_equals(sky_cursor_get_timestamp(cursor, &timestamp), 0);
+    mu_assert_int64_equals(timestamp, 161LL);
+    mu_assert_int_equals(sky_cursor_get_action_id(cursor, &action_id), 0);
+    mu_assert_int_equals(action_id, 0);
+    mu_assert_int_equals(sky_cursor_get_data_ptr(cursor, &data_ptr, &data_length), 0);
+    mu_assert_long_equals(data_length, 5L);
+    mu_assert_mem(data_ptr, &DATA[32], 5);
+    mu_assert_int_equals(sky_cursor_pack_event(cursor, event, &sz), 0);
+    mu_assert_long_equals(sz, 18L);
+    mu_assert_mem(event, &DATA[19], 18);
+
+    // Event 3
+    rc = sky_cursor_next(cursor);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_int_equals(cursor->event_index, 2);
+    mu_assert_int_equals(sky_cursor_get_timestamp(cursor, &timestamp), 0);
+    mu_assert_int64_equals(timestamp, 162LL);
+    mu_assert_int_equals(sky_cursor_pack_event(cursor, event, &sz), 0);
+    mu_assert_long_equals(sz, 20L);
+    mu_assert_mem(event, &DATA[37], 20);
+
+    // EOF
+    rc = sky_cursor_next(cursor);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_bool(cursor->eof);
+
+    sky_cursor_free(cursor);
+    free(compact);
+    return 0;
+}
+
+int test_sky_cursor_next_window() {
+    sky_timestamp_t timestamp;
+    sky_cursor *cursor = sky_cursor_create();
+
+    // Events before the window are skipped.
+    int rc = sky_cursor_set_window(cursor, 161LL, 162LL);
+    mu_assert_int_equals(rc, 0);
+    rc = sky_cursor_set_path(cursor, &DATA);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_bool(!cursor->eof);
+    mu_assert_long_equals(cursor->ptr-((void*)&DATA), 19L);
+    mu_assert_int_equals(sky_cursor_get_timestamp(cursor, &timestamp), 0);
+    mu_assert_long_equals((long)timestamp, 161L);
+
+    // The cursor stops at the end of the window.
+    rc = sky_cursor_next(cursor);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_bool(cursor->eof);
+
+    // A window after every event leaves the cursor at EOF.
+    sky_cursor_set_window(cursor, 200LL, 300LL);
+    rc = sky_cursor_set_path(cursor, &DATA);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_bool(cursor->eof);
+
+    sky_cursor_free(cursor);
+    return 0;
+}
+
 
 //==============================================================================
 //
@@ -80,6 +169,8 @@ int test_sky_cursor_next() {
 
 int all_tests() {
     mu_run_test(test_sky_cursor_next);
+    mu_run_test(test_sky_cursor_next_compact);
+    mu_run_test(test_sky_cursor_next_window);
     return 0;
 }
 
@@ -1,8 +1,10 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 
 #include <dbg.h>
 #include <mem.h>
+#include <file.h>
 #include <data_file.h>
 
 #include "minunit.h"
@@ -18,6 +20,7 @@
     loadtmp(PATH); \
     data_file = sky_data_file_create(); \
     data_file->block_size = 64; \
+    data_file->chunk_size = 0; \
     data_file->path = bfromcstr("tmp/data"); \
     data_file->header_path = bfromcstr("tmp/header"); \
     sky_data_file_load(data_file);
@@ -103,11 +106,12 @@ int test_sky_data_file_load_empty() {
     mu_assert_long_equals(data_file->data_length, 128L);
     mu_assert_bool(data_file->blocks != NULL);
     mu_assert_int_equals(data_file->block_count, 1);
-    mu_assert_file("tmp/data", "tests/fixtures/data_files/0/data");
-    mu_assert_file("tmp/header", "tests/fixtures/data_files/0/header");
 
+    // The files are trimmed to their exact lengths when unloaded.
     rc = sky_data_file_unload(data_file);
     mu_assert_int_equals(rc, 0);
+    mu_assert_file("tmp/data", "tests/fixtures/data_files/0/data");
+    mu_assert_file("tmp/header", "tests/fixtures/data_files/0/header");
     
     mu_assert_bool(data_file->data == NULL);
     mu_assert_bool(data_file->data_fd == 0);
@@ -119,6 +123,82 @@ int test_sky_data_file_load_empty() {
     return 0;
 }
 
+int test_sky_data_file_load_chunked() {
+    cleantmp();
+    
+    int rc;
+    sky_block *block;
+    sky_data_file *data_file = sky_data_file_create();
+    data_file->block_size = 128;
+    data_file->chunk_size = 0x1000;
+    data_file->path = bfromcstr("tmp/data");
+    data_file->header_path = bfromcstr("tmp/header");
+    
+    rc = sky_data_file_load(data_file);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_long_equals(data_file->file_length, 0x1000L);
+    mu_assert_long_equals(sky_file_get_size(data_file->path), 0x1000L);
+
+    // Adding blocks past the first chunk grows the file without remapping.
+    void *data = data_file->data;
+    uint32_t i;
+    for(i=0; i<40; i++) {
+        rc = sky_data_file_create_block(data_file, &block);
+        mu_assert_int_equals(rc, 0);
+    }
+    mu_assert_int_equals(data_file->block_count, 41);
+    mu_assert_long_equals(data_file->data_length, 41*128L);
+    mu_assert_long_equals(data_file->file_length, 0x2000L);
+    mu_assert_bool(data_file->data == data);
+    mu_assert_int_equals(data_file->remap_count, 0);
+
+    // The header file is grown a chunk at a time as well.
+    mu_assert_long_equals(data_file->header_length, 8+(41*24L));
+    mu_assert_long_equals(sky_file_get_size(data_file->header_path), (long)SKY_HEADER_FILE_CHUNK_SIZE);
+
+    // A copy of the untrimmed files loads the same number of blocks.
+    struct tagbstring copy_path = bsStatic("tmp/copy/data");
+    struct tagbstring copy_header_path = bsStatic("tmp/copy/header");
+    mkdir("tmp/copy", S_IRWXU);
+    mu_assert_int_equals(sky_file_cp(data_file->path, &copy_path), 0);
+    mu_assert_int_equals(sky_file_cp(data_file->header_path, &copy_header_path), 0);
+    sky_data_file *copy = sky_data_file_create();
+    copy->chunk_size = 0x1000;
+    copy->path = bstrcpy(&copy_path);
+    copy->header_path = bstrcpy(&copy_header_path);
+    mu_assert_int_equals(sky_data_file_load(copy), 0);
+    mu_assert_int_equals(copy->block_count, 41);
+    mu_assert_long_equals(copy->data_length, 41*128L);
+    sky_data_file_free(copy);
+
+    // Both files are trimmed when the data file is unloaded.
+    sky_data_file_free(data_file);
+    mu_assert_long_equals(sky_file_get_size(&copy_path), 41*128L);
+    mu_assert_long_equals(sky_file_get_size(&copy_header_path), 8+(41*24L));
+    struct tagbstring header_path = bsStatic("tmp/header");
+    mu_assert_long_equals(sky_file_get_size(&header_path), 8+(41*24L));
+    return 0;
+}
+
+
+//--------------------------------------
+// Header
+//--------------------------------------
+
+int test_sky_data_file_flush_header() {
+    sky_data_file *data_file;
+    INIT_DATA_FILE("", 64);
+    data_file->autosync = false;
+    ADD_EVENT(3LL, 10LL, 20);
+    mu_assert_long_equals(data_file->header_dirty_start, 8L);
+    mu_assert_long_equals(data_file->header_dirty_end, 32L);
+    mu_assert_file("tmp/header", "tests/fixtures/data_files/1/a/header");
+    mu_assert_int_equals(sky_data_file_flush_header(data_file), 0);
+    mu_assert_long_equals(data_file->header_dirty_end, 0L);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
 
 //--------------------------------------
 // Add Event (New Block)
@@ -180,6 +260,39 @@ int test_sky_data_file_add_event_with_prepending_path() {
 }
 
 
+//--------------------------------------
+// Add Events (Batch)
+//--------------------------------------
+
+int test_sky_data_file_add_events_to_new_block() {
+    sky_data_file *data_file;
+    INIT_DATA_FILE("", 64);
+    sky_event *events[2];
+    events[0] = sky_event_create(3LL, 10LL, 20);
+    events[1] = sky_event_create(3LL, 8LL, 21);
+    mu_assert_int_equals(sky_data_file_add_events(data_file, events, 2), 0);
+    ASSERT_DATA_FILE("tests/fixtures/data_files/1/b");
+    sky_event_free(events[0]);
+    sky_event_free(events[1]);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+int test_sky_data_file_add_events_to_existing_block() {
+    sky_data_file *data_file;
+    INIT_DATA_FILE("tests/fixtures/data_files/1/a", 0);
+    sky_event *events[2];
+    events[0] = sky_event_create(4LL, 11LL, 22);
+    events[1] = sky_event_create(3LL, 8LL, 21);
+    mu_assert_int_equals(sky_data_file_add_events(data_file, events, 2), 0);
+    ASSERT_DATA_FILE("tests/fixtures/data_files/1/d");
+    sky_event_free(events[0]);
+    sky_event_free(events[1]);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+
 //--------------------------------------
 // Add Event (Block Splits)
 //--------------------------------------
@@ -399,6 +512,8 @@ int all_tests() {
     mu_run_test(test_sky_data_file_set_path);
     mu_run_test(test_sky_data_file_set_header_path);
     mu_run_test(test_sky_data_file_load_empty);
+    mu_run_test(test_sky_data_file_load_chunked);
+    mu_run_test(test_sky_data_file_flush_header);
 
     mu_run_test(test_sky_data_file_add_event_to_new_block);
     mu_run_test(test_sky_data_file_prepend_event_to_existing_path);
@@ -407,6 +522,9 @@ int all_tests() {
     mu_run_test(test_sky_data_file_add_event_with_appending_path);
     mu_run_test(test_sky_data_file_add_event_with_prepending_path);
 
+    mu_run_test(test_sky_data_file_add_events_to_new_block);
+    mu_run_test(test_sky_data_file_add_events_to_existing_block);
+
     mu_run_test(test_sky_data_file_add_event_to_starting_path_causing_block_split);
     mu_run_test(test_sky_data_file_add_event_to_ending_path_causing_block_split);
     mu_run_test(test_sky_data_file_add_event_to_new_starting_path_causing_block_split);
@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <dictionary.h>
+#include <mem.h>
+#include <bstring.h>
+#include <file.h>
+
+#include "minunit.h"
+
+
+//==============================================================================
+//
+// Test Cases
+//
+//==============================================================================
+
+//--------------------------------------
+// Lookup
+//--------------------------------------
+
+int test_sky_dictionary_add() {
+    uint32_t code;
+    bstring str;
+    struct tagbstring foo = bsStatic("foo");
+    struct tagbstring bar = bsStatic("bar");
+
+    sky_dictionary *dictionary = sky_dictionary_create();
+    mu_assert_int_equals(sky_dictionary_add(dictionary, &foo, &code), 0);
+    mu_assert_int_equals(code, 1);
+    mu_assert_int_equals(sky_dictionary_add(dictionary, &bar, &code), 0);
+    mu_assert_int_equals(code, 2);
+    mu_assert_int_equals(sky_dictionary_add(dictionary, &foo, &code), 0);
+    mu_assert_int_equals(code, 1);
+    mu_assert_int_equals(dictionary->count, 2);
+
+    mu_assert_int_equals(sky_dictionary_find(dictionary, "bar", 3, &code), 0);
+    mu_assert_int_equals(code, 2);
+    mu_assert_int_equals(sky_dictionary_find(dictionary, "ba", 2, &code), 0);
+    mu_assert_int_equals(code, 0);
+
+    mu_assert_int_equals(sky_dictionary_get(dictionary, 2, &str), 0);
+    mu_assert_bstring(str, "bar");
+    mu_assert_int_equals(sky_dictionary_get(dictionary, 3, &str), 0);
+    mu_assert(str == NULL, "Expected no string for an unknown code");
+    mu_assert_int_equals(sky_dictionary_get(dictionary, 0, &str), 0);
+    mu_assert(str == NULL, "Expected no string for code zero");
+
+    sky_dictionary_free(dictionary);
+    return 0;
+}
+
+int test_sky_dictionary_resize() {
+    uint32_t i, code;
+    sky_dictionary *dictionary = sky_dictionary_create();
+    for(i=0; i<1000; i++) {
+        bstring str = bformat("value%d", i);
+        mu_assert_int_equals(sky_dictionary_add(dictionary, str, &code), 0);
+        mu_assert_int_equals(code, i+1);
+        bdestroy(str);
+    }
+    mu_assert_int_equals(dictionary->count, 1000);
+    mu_assert_int_equals(dictionary->bucket_count, 2048);
+
+    for(i=0; i<1000; i++) {
+        bstring str = bformat("value%d", i);
+        mu_assert_int_equals(sky_dictionary_find(dictionary, bdata(str), blength(str), &code), 0);
+        mu_assert_int_equals(code, i+1);
+        bdestroy(str);
+    }
+
+    sky_dictionary_free(dictionary);
+    return 0;
+}
+
+
+//--------------------------------------
+// Persistence
+//--------------------------------------
+
+int test_sky_dictionary_load() {
+    uint32_t code;
+    bstring str;
+    struct tagbstring path = bsStatic("tmp/dictionary");
+    struct tagbstring foo = bsStatic("foo");
+    struct tagbstring bar = bsStatic("bar");
+    cleantmp();
+
+    sky_dictionary *dictionary = sky_dictionary_create();
+    sky_dictionary_set_path(dictionary, &path);
+    mu_assert_int_equals(sky_dictionary_load(dictionary), 0);
+    mu_assert_int_equals(dictionary->count, 0);
+    mu_assert_int_equals(sky_dictionary_add(dictionary, &foo, &code), 0);
+    mu_assert_int_equals(sky_dictionary_add(dictionary, &bar, &code), 0);
+    mu_assert_int_equals(sky_dictionary_add(dictionary, &foo, &code), 0);
+    sky_dictionary_free(dictionary);
+
+    dictionary = sky_dictionary_create();
+    sky_dictionary_set_path(dictionary, &path);
+    mu_assert_int_equals(sky_dictionary_load(dictionary), 0);
+    mu_assert_int_equals(dictionary->count, 2);
+    mu_assert_int_equals(sky_dictionary_get(dictionary, 1, &str), 0);
+    mu_assert_bstring(str, "foo");
+    mu_assert_int_equals(sky_dictionary_find(dictionary, "bar", 3, &code), 0);
+    mu_assert_int_equals(code, 2);
+    sky_dictionary_free(dictionary);
+    return 0;
+}
+
+
+int test_sky_dictionary_sync() {
+    uint32_t code;
+    struct tagbstring path = bsStatic("tmp/dictionary");
+    struct tagbstring foo = bsStatic("foo");
+    struct tagbstring bar = bsStatic("bar");
+    cleantmp();
+
+    // New strings are written to the open file and synced together.
+    sky_dictionary *dictionary = sky_dictionary_create();
+    sky_dictionary_set_path(dictionary, &path);
+    mu_assert_int_equals(sky_dictionary_load(dictionary), 0);
+    mu_assert_int_equals(sky_dictionary_add(dictionary, &foo, &code), 0);
+    mu_assert_int_equals(sky_dictionary_add(dictionary, &bar, &code), 0);
+    mu_assert_bool(dictionary->file != NULL);
+    mu_assert_bool(dictionary->dirty);
+    mu_assert_int_equals(sky_dictionary_sync(dictionary), 0);
+    mu_assert_bool(!dictionary->dirty);
+    mu_assert_long_equals((long)sky_file_get_size(&path), 8L);
+    sky_dictionary_free(dictionary);
+    return 0;
+}
+
+int test_sky_dictionary_load_torn() {
+    uint32_t code;
+    bstring str;
+    struct tagbstring path = bsStatic("tmp/dictionary");
+    struct tagbstring foo = bsStatic("foo");
+    struct tagbstring bar = bsStatic("bar");
+    struct tagbstring baz = bsStatic("baz");
+    cleantmp();
+
+    sky_dictionary *dictionary = sky_dictionary_create();
+    sky_dictionary_set_path(dictionary, &path);
+    mu_assert_int_equals(sky_dictionary_load(dictionary), 0);
+    mu_assert_int_equals(sky_dictionary_add(dictionary, &foo, &code), 0);
+    mu_assert_int_equals(sky_dictionary_add(dictionary, &bar, &code), 0);
+    sky_dictionary_free(dictionary);
+
+    // Simulate a partially written string.
+    FILE *file = fopen("tmp/dictionary", "a");
+    fwrite("\xa5\x62\x61", 3, 1, file);
+    fclose(file);
+
+    // The torn string is removed and new strings follow the last full one.
+    dictionary = sky_dictionary_create();
+    sky_dictionary_set_path(dictionary, &path);
+    mu_assert_int_equals(sky_dictionary_load(dictionary), 0);
+    mu_assert_int_equals(dictionary->count, 2);
+    mu_assert_long_equals((long)sky_file_get_size(&path), 8L);
+    mu_assert_int_equals(sky_dictionary_add(dictionary, &baz, &code), 0);
+    mu_assert_int_equals(code, 3);
+    sky_dictionary_free(dictionary);
+
+    dictionary = sky_dictionary_create();
+    sky_dictionary_set_path(dictionary, &path);
+    mu_assert_int_equals(sky_dictionary_load(dictionary), 0);
+    mu_assert_int_equals(dictionary->count, 3);
+    mu_assert_int_equals(sky_dictionary_get(dictionary, 3, &str), 0);
+    mu_assert_bstring(str, "baz");
+    sky_dictionary_free(dictionary);
+    return 0;
+}
+
+
+//==============================================================================
+//
+// Setup
+//
+//==============================================================================
+
+int all_tests() {
+    mu_run_test(test_sky_dictionary_add);
+    mu_run_test(test_sky_dictionary_resize);
+    mu_run_test(test_sky_dictionary_load);
+    mu_run_test(test_sky_dictionary_sync);
+    mu_run_test(test_sky_dictionary_load_torn);
+    return 0;
+}
+
+RUN_TESTS()
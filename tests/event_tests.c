@@ -260,6 +260,38 @@ int test_sky_event_action_data_event_unpack() {
 }
 
 
+//--------------------------------------
+// Compact Encoding
+//--------------------------------------
+
+int test_sky_event_compact_hdr() {
+    size_t sz, hdrsz;
+    sky_timestamp_t timestamp;
+    sky_action_id_t action_id;
+    sky_event_data_length_t data_length;
+    char compact[ACTION_DATA_EVENT_DATA_LENGTH + 8];
+
+    // A negative delta needs a multi-byte varint.
+    mu_assert_int_equals(sky_event_pack_compact(&ACTION_DATA_EVENT_DATA, 100000LL, compact, &sz), 0);
+    mu_assert_long_equals(sz, (long)sky_event_sizeof_compact_raw(compact));
+    mu_assert_int_equals(sky_event_unpack_compact_hdr(compact, 100000LL, &timestamp, &action_id, &data_length, &hdrsz), 0);
+    mu_assert_int64_equals(timestamp, 30LL);
+    mu_assert_int_equals(action_id, 20);
+    mu_assert_int_equals(data_length, 10);
+    mu_assert_long_equals(hdrsz + data_length, (long)sz);
+    mu_assert_mem(compact + hdrsz, &ACTION_DATA_EVENT_DATA[15], 10);
+
+    // A small positive delta fits in a single byte.
+    mu_assert_int_equals(sky_event_pack_compact(&ACTION_EVENT_DATA, 29LL, compact, &sz), 0);
+    mu_assert_long_equals(sz, 4L);
+    mu_assert_int_equals(sky_event_unpack_compact_hdr(compact, 29LL, &timestamp, &action_id, &data_length, &hdrsz), 0);
+    mu_assert_int64_equals(timestamp, 30LL);
+    mu_assert_int_equals(action_id, 20);
+    mu_assert_int_equals(data_length, 0);
+    return 0;
+}
+
+
 
 //==============================================================================
 //
@@ -287,6 +319,8 @@ int all_tests() {
     mu_run_test(test_sky_event_data_event_unpack);
     mu_run_test(test_sky_event_action_data_event_unpack);
 
+    mu_run_test(test_sky_event_compact_hdr);
+
     return 0;
 }
 
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <dbg.h>
+#include <mem.h>
+#include <file.h>
+#include <path.h>
+#include <path_iterator.h>
+#include <cursor.h>
+#include <extent.h>
+
+#include "minunit.h"
+
+
+//==============================================================================
+//
+// Helpers
+//
+//==============================================================================
+
+#define INIT_DATA_FILE() \
+    cleantmp(); \
+    data_file = sky_data_file_create(); \
+    data_file->block_size = 64; \
+    data_file->large_path_threshold = 40; \
+    data_file->path = bfromcstr("tmp/data"); \
+    data_file->header_path = bfromcstr("tmp/header"); \
+    data_file->extent_path = bfromcstr("tmp/extents"); \
+    mu_assert_int_equals(sky_data_file_load(data_file), 0);
+
+#define ADD_EVENT(OBJECT_ID, TIMESTAMP, ACTION_ID) do { \
+    sky_event *event = sky_event_create(OBJECT_ID, TIMESTAMP, ACTION_ID); \
+    mu_assert_int_equals(sky_data_file_add_event(data_file, event), 0); \
+    sky_event_free(event); \
+} while (0)
+
+#define ASSERT_CONTAINS_EVENT(OBJECT_ID, TIMESTAMP, ACTION_ID, EXPECTED) do { \
+    bool _ret = false; \
+    sky_event *event = sky_event_create(OBJECT_ID, TIMESTAMP, ACTION_ID); \
+    mu_assert_int_equals(sky_data_file_contains_event(data_file, event, &_ret), 0); \
+    mu_assert(_ret == EXPECTED, "Unexpected contains result"); \
+    sky_event_free(event); \
+} while (0)
+
+// Counts the events in a path and checks that they are in timestamp order.
+int count_path_events(void *path_ptr, uint32_t *count)
+{
+    sky_cursor cursor;
+    sky_cursor_init(&cursor);
+    sky_cursor_set_path(&cursor, path_ptr);
+
+    *count = 0;
+    sky_timestamp_t last_timestamp = 0;
+    while(!cursor.eof) {
+        sky_timestamp_t timestamp;
+        sky_action_id_t action_id;
+        sky_event_data_length_t data_length;
+        size_t sz;
+        sky_event_unpack_hdr(&timestamp, &action_id, &data_length, cursor.ptr, &sz);
+        if(*count > 0 && timestamp < last_timestamp) {
+            sky_cursor_set_path(&cursor, NULL);
+            return -1;
+        }
+        last_timestamp = timestamp;
+        (*count)++;
+        sky_cursor_next(&cursor);
+    }
+    sky_cursor_set_path(&cursor, NULL);
+    return 0;
+}
+
+
+//==============================================================================
+//
+// Test Cases
+//
+//==============================================================================
+
+//--------------------------------------
+// Large Paths
+//--------------------------------------
+
+int test_sky_extent_move_large_path() {
+    sky_data_file *data_file;
+    INIT_DATA_FILE();
+    ADD_EVENT(1, 1LL, 20);
+    ADD_EVENT(3, 1LL, 20);
+    ADD_EVENT(2, 1LL, 20);
+    ADD_EVENT(2, 2LL, 20);
+    mu_assert_int_equals(data_file->extent_count, 0);
+    mu_assert_bool(!sky_file_exists(data_file->extent_path));
+
+    // The 41 byte path is over the threshold so it is moved to an extent.
+    ADD_EVENT(2, 3LL, 20);
+    mu_assert_int_equals(data_file->extent_count, 1);
+    sky_extent *extent = data_file->extents[0];
+    mu_assert_int_equals(extent->object_id, 2);
+    mu_assert_long_equals(extent->min_timestamp, 1LL);
+    mu_assert_long_equals(extent->max_timestamp, 3LL);
+    mu_assert_long_equals(extent->capacity, 82L);
+
+    // Events before the end of the path are inserted in order.
+    ADD_EVENT(2, 0LL, 20);
+    ASSERT_CONTAINS_EVENT(2, 0LL, 20, true);
+    ASSERT_CONTAINS_EVENT(2, 3LL, 20, true);
+    ASSERT_CONTAINS_EVENT(2, 4LL, 20, false);
+    ASSERT_CONTAINS_EVENT(1, 1LL, 20, true);
+
+    // Paths are iterated in object id order across blocks and extents and
+    // the moved path is only found in the extent.
+    uint32_t count = 0;
+    sky_object_id_t object_ids[3] = {1, 2, 3};
+    uint32_t event_counts[3] = {1, 4, 1};
+    sky_path_iterator iterator;
+    sky_path_iterator_init(&iterator);
+    mu_assert_int_equals(sky_path_iterator_set_data_file(&iterator, data_file), 0);
+    while(!iterator.eof) {
+        void *path_ptr;
+        uint32_t event_count;
+        mu_assert_int_equals(sky_path_iterator_get_ptr(&iterator, &path_ptr), 0);
+        mu_assert_int_equals(iterator.current_object_id, object_ids[count]);
+        mu_assert_bool((iterator.extent != NULL) == (count == 1));
+        mu_assert_int_equals(count_path_events(path_ptr, &event_count), 0);
+        mu_assert_int_equals(event_count, event_counts[count]);
+        mu_assert_int_equals(sky_path_iterator_next(&iterator), 0);
+        count++;
+    }
+    mu_assert_int_equals(count, 3);
+
+    // Extents are restored when the data file is reloaded.
+    mu_assert_int_equals(sky_data_file_unload(data_file), 0);
+    mu_assert_int_equals(sky_data_file_load(data_file), 0);
+    mu_assert_int_equals(data_file->extent_count, 1);
+    mu_assert_long_equals(data_file->extents[0]->min_timestamp, 0LL);
+    mu_assert_long_equals(data_file->extents[0]->max_timestamp, 3LL);
+    ASSERT_CONTAINS_EVENT(2, 2LL, 20, true);
+
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+int test_sky_extent_resize() {
+    sky_data_file *data_file;
+    INIT_DATA_FILE();
+    uint32_t i;
+    for(i=1; i<=3; i++) {
+        ADD_EVENT(2, (sky_timestamp_t)i, 20);
+    }
+    mu_assert_int_equals(data_file->extent_count, 1);
+    sky_extent *extent = data_file->extents[0];
+
+    // Appends fill the spare capacity without moving the extent.
+    for(i=4; i<=6; i++) {
+        ADD_EVENT(2, (sky_timestamp_t)i, 20);
+    }
+    mu_assert_long_equals(extent->offset, 0L);
+
+    // The extent moves to the end of the file once it is full.
+    ADD_EVENT(2, 7LL, 20);
+    mu_assert_long_equals(extent->offset, (long)(SKY_EXTENT_HEADER_SIZE + 82));
+    mu_assert_long_equals(extent->capacity, 164L);
+    mu_assert_long_equals(data_file->extent_data_length, (long)(SKY_EXTENT_HEADER_SIZE*2 + 82 + 164));
+
+    // The old record is skipped on reload.
+    mu_assert_int_equals(sky_data_file_unload(data_file), 0);
+    mu_assert_int_equals(sky_data_file_load(data_file), 0);
+    mu_assert_int_equals(data_file->extent_count, 1);
+    void *path_ptr;
+    uint32_t event_count;
+    mu_assert_int_equals(sky_extent_get_ptr(data_file->extents[0], &path_ptr), 0);
+    mu_assert_int_equals(count_path_events(path_ptr, &event_count), 0);
+    mu_assert_int_equals(event_count, 7);
+
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+
+//==============================================================================
+//
+// Setup
+//
+//==============================================================================
+
+int all_tests() {
+    mu_run_test(test_sky_extent_move_large_path);
+    mu_run_test(test_sky_extent_resize);
+    return 0;
+}
+
+RUN_TESTS()
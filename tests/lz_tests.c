@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <lz.h>
+
+#include "minunit.h"
+
+
+//==============================================================================
+//
+// Helpers
+//
+//==============================================================================
+
+#define ASSERT_ROUND_TRIP(DATA, LENGTH, MAX_SZ) do { \
+    size_t _sz; \
+    size_t _capacity = SKY_LZ_BOUND(LENGTH); \
+    char *_compressed = calloc(_capacity, 1); \
+    char *_decompressed = calloc((LENGTH) + 1, 1); \
+    mu_assert_int_equals(sky_lz_compress(DATA, LENGTH, _compressed, _capacity, &_sz), 0); \
+    mu_assert(_sz <= (MAX_SZ), "Compressed data too large"); \
+    mu_assert_int_equals(sky_lz_decompress(_compressed, _sz, _decompressed, LENGTH), 0); \
+    mu_assert_mem(_decompressed, DATA, LENGTH); \
+    free(_compressed); \
+    free(_decompressed); \
+} while(0)
+
+
+//==============================================================================
+//
+// Test Cases
+//
+//==============================================================================
+
+int test_sky_lz_empty() {
+    char data[1];
+    ASSERT_ROUND_TRIP(data, 0, 1);
+    return 0;
+}
+
+int test_sky_lz_zeros() {
+    char *data = calloc(65536, 1);
+    ASSERT_ROUND_TRIP(data, 65536, 300);
+    free(data);
+    return 0;
+}
+
+int test_sky_lz_repeated() {
+    char data[] = "foo bar baz foo bar baz foo bar baz foo bar baz foo";
+    ASSERT_ROUND_TRIP(data, sizeof(data), 24);
+    return 0;
+}
+
+int test_sky_lz_random() {
+    uint32_t i;
+    char *data = calloc(10000, 1);
+    srand(1);
+    for(i=0; i<10000; i++) {
+        data[i] = rand() % 256;
+    }
+    ASSERT_ROUND_TRIP(data, 10000, SKY_LZ_BOUND(10000));
+    free(data);
+    return 0;
+}
+
+int test_sky_lz_compress_too_large() {
+    size_t sz;
+    char data[] = "abcdefghijklmnopqrstuvwxyz";
+    char compressed[16];
+    mu_assert_int_equals(sky_lz_compress(data, sizeof(data), compressed, sizeof(compressed), &sz), -1);
+    return 0;
+}
+
+int test_sky_lz_decompress_corrupt() {
+    char decompressed[16];
+
+    // Match offset before the start of the output.
+    char data0[] = "\x10\x61\x05\x00";
+    mu_assert_int_equals(sky_lz_decompress(data0, 4, decompressed, 16), -1);
+
+    // Literals past the end of the input.
+    char data1[] = "\x50\x61";
+    mu_assert_int_equals(sky_lz_decompress(data1, 2, decompressed, 16), -1);
+
+    // Output shorter than expected.
+    char data2[] = "\x10\x61";
+    mu_assert_int_equals(sky_lz_decompress(data2, 2, decompressed, 16), -1);
+    return 0;
+}
+
+
+//==============================================================================
+//
+// Setup
+//
+//==============================================================================
+
+int all_tests() {
+    mu_run_test(test_sky_lz_empty);
+    mu_run_test(test_sky_lz_zeros);
+    mu_run_test(test_sky_lz_repeated);
+    mu_run_test(test_sky_lz_random);
+    mu_run_test(test_sky_lz_compress_too_large);
+    mu_run_test(test_sky_lz_decompress_corrupt);
+    return 0;
+}
+
+RUN_TESTS()
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memtable.h>
+#include <path_iterator.h>
+#include <cursor.h>
+#include <path.h>
+#include <mem.h>
+
+#include "minunit.h"
+
+
+//==============================================================================
+//
+// Helpers
+//
+//==============================================================================
+
+#define INIT_DATA_FILE() \
+    cleantmp(); \
+    data_file = sky_data_file_create(); \
+    data_file->block_size = 128; \
+    data_file->path = bfromcstr("tmp/data"); \
+    data_file->header_path = bfromcstr("tmp/header"); \
+    mu_assert_int_equals(sky_data_file_load(data_file), 0);
+
+#define ADD_EVENT(OBJECT_ID, TIMESTAMP, ACTION_ID) do { \
+    sky_event *event = sky_event_create(OBJECT_ID, TIMESTAMP, ACTION_ID); \
+    mu_assert_int_equals(sky_data_file_add_event(data_file, event), 0); \
+    sky_event_free(event); \
+} while (0)
+
+#define ADD_MEMTABLE_EVENT(OBJECT_ID, TIMESTAMP, ACTION_ID) do { \
+    sky_event *event = sky_event_create(OBJECT_ID, TIMESTAMP, ACTION_ID); \
+    mu_assert_int_equals(sky_memtable_add_event(memtable, event), 0); \
+    sky_event_free(event); \
+} while (0)
+
+#define ASSERT_ENTRY(INDEX, OBJECT_ID, TIMESTAMP) do { \
+    mu_assert_long_equals((long)memtable->entries[INDEX].object_id, (long)OBJECT_ID); \
+    mu_assert_long_equals((long)memtable->entries[INDEX].timestamp, (long)TIMESTAMP); \
+} while (0)
+
+#define ASSERT_CURSOR_EVENT(TIMESTAMP, ACTION_ID) do { \
+    sky_timestamp_t _timestamp; \
+    sky_action_id_t _action_id; \
+    mu_assert_bool(!cursor.eof); \
+    mu_assert_int_equals(sky_cursor_get_timestamp(&cursor, &_timestamp), 0); \
+    mu_assert_int_equals(sky_cursor_get_action_id(&cursor, &_action_id), 0); \
+    mu_assert_long_equals((long)_timestamp, (long)TIMESTAMP); \
+    mu_assert_int_equals(_action_id, ACTION_ID); \
+    mu_assert_int_equals(sky_cursor_next(&cursor), 0); \
+} while (0)
+
+
+//==============================================================================
+//
+// Test Cases
+//
+//==============================================================================
+
+//--------------------------------------
+// Sorting
+//--------------------------------------
+
+int test_sky_memtable_sort() {
+    sky_memtable *memtable = sky_memtable_create();
+    ADD_MEMTABLE_EVENT(3, 20LL, 1);
+    ADD_MEMTABLE_EVENT(1, 10LL, 1);
+    ADD_MEMTABLE_EVENT(3, 10LL, 1);
+    ADD_MEMTABLE_EVENT(3, 20LL, 2);
+    mu_assert_int_equals(sky_memtable_sort(memtable), 0);
+    ASSERT_ENTRY(0, 1, 10);
+    ASSERT_ENTRY(1, 3, 10);
+    ASSERT_ENTRY(2, 3, 20);
+    ASSERT_ENTRY(3, 3, 20);
+    mu_assert_int_equals(memtable->entries[2].offset < memtable->entries[3].offset, 1);
+    mu_assert_int_equals(memtable->path_count, 2);
+    mu_assert_int_equals(memtable->paths[1].object_id, 3);
+    mu_assert_int_equals(memtable->paths[1].entry_index, 1);
+    mu_assert_int_equals(memtable->paths[1].entry_count, 3);
+
+    // New entries are merged into the sorted entries.
+    ADD_MEMTABLE_EVENT(2, 5LL, 1);
+    ADD_MEMTABLE_EVENT(3, 15LL, 1);
+    mu_assert_int_equals(sky_memtable_sort(memtable), 0);
+    ASSERT_ENTRY(0, 1, 10);
+    ASSERT_ENTRY(1, 2, 5);
+    ASSERT_ENTRY(2, 3, 10);
+    ASSERT_ENTRY(3, 3, 15);
+    ASSERT_ENTRY(4, 3, 20);
+    ASSERT_ENTRY(5, 3, 20);
+    mu_assert_int_equals(memtable->path_count, 3);
+
+    mu_assert_int_equals(sky_memtable_clear(memtable), 0);
+    mu_assert_int_equals(memtable->entry_count, 0);
+    mu_assert_int_equals(memtable->data_length, 0);
+    sky_memtable_free(memtable);
+    return 0;
+}
+
+
+//--------------------------------------
+// Paths
+//--------------------------------------
+
+int test_sky_memtable_get_path_ptr() {
+    void *ptr;
+    sky_cursor cursor;
+    sky_data_file *data_file;
+    INIT_DATA_FILE();
+    ADD_EVENT(3, 10LL, 1);
+    ADD_EVENT(3, 30LL, 3);
+
+    sky_memtable_buffer buffer;
+    memset(&buffer, 0, sizeof(buffer));
+    sky_memtable *memtable = sky_memtable_create();
+    ADD_MEMTABLE_EVENT(3, 30LL, 4);
+    ADD_MEMTABLE_EVENT(3, 20LL, 2);
+    mu_assert_int_equals(sky_memtable_sort(memtable), 0);
+
+    // Memtable only.
+    mu_assert_int_equals(sky_memtable_get_path_ptr(memtable, &buffer, 0, NULL, 0, &ptr), 0);
+    mu_assert_long_equals((long)*((sky_object_id_t*)ptr), 3L);
+    sky_cursor_init(&cursor);
+    mu_assert_int_equals(sky_cursor_set_path(&cursor, ptr), 0);
+    ASSERT_CURSOR_EVENT(20, 2);
+    ASSERT_CURSOR_EVENT(30, 4);
+    mu_assert_bool(cursor.eof);
+
+    // Merged with the data file.
+    sky_path_iterator *iterator = sky_path_iterator_create();
+    sky_path_iterator_set_data_file(iterator, data_file);
+    mu_assert_int_equals(sky_path_iterator_get_ptr(iterator, &ptr), 0);
+    mu_assert_int_equals(sky_memtable_get_path_ptr(memtable, &buffer, 0, &ptr, 1, &ptr), 0);
+    mu_assert_int_equals(sky_cursor_set_path(&cursor, ptr), 0);
+    ASSERT_CURSOR_EVENT(10, 1);
+    ASSERT_CURSOR_EVENT(20, 2);
+    ASSERT_CURSOR_EVENT(30, 3);
+    ASSERT_CURSOR_EVENT(30, 4);
+    mu_assert_bool(cursor.eof);
+    sky_cursor_set_path(&cursor, NULL);
+
+    sky_path_iterator_free(iterator);
+    sky_memtable_release_buffer(&buffer);
+    sky_memtable_free(memtable);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+
+int test_sky_memtable_get_path_ptrs_chunked() {
+    void **ptrs;
+    uint32_t i, count;
+    sky_cursor cursor;
+    sky_data_file *data_file;
+    INIT_DATA_FILE();
+    ADD_EVENT(3, 10LL, 1);
+    ADD_EVENT(3, 30LL, 3);
+    ADD_EVENT(3, 50LL, 5);
+
+    sky_memtable_buffer buffer;
+    memset(&buffer, 0, sizeof(buffer));
+    sky_memtable *memtable = sky_memtable_create();
+    ADD_MEMTABLE_EVENT(3, 20LL, 2);
+    ADD_MEMTABLE_EVENT(3, 40LL, 4);
+    mu_assert_int_equals(sky_memtable_sort(memtable), 0);
+    memtable->max_path_length = 32;
+
+    // Large merged paths are split into chunks instead of failing.
+    sky_path_iterator *iterator = sky_path_iterator_create();
+    sky_path_iterator_set_data_file(iterator, data_file);
+    void *ptr;
+    mu_assert_int_equals(sky_path_iterator_get_ptr(iterator, &ptr), 0);
+    mu_assert_int_equals(sky_memtable_get_path_ptrs(memtable, &buffer, 0, &ptr, 1, &ptrs, &count), 0);
+    mu_assert_bool(count > 1);
+    for(i=0; i<count; i++) {
+        mu_assert_long_equals((long)*((sky_object_id_t*)ptrs[i]), 3L);
+        mu_assert_bool(sky_path_sizeof_raw(ptrs[i]) - SKY_PATH_HEADER_LENGTH <= 32);
+    }
+    mu_assert_int_equals(sky_memtable_get_path_ptr(memtable, &buffer, 0, &ptr, 1, &ptr), -1);
+
+    // The cursor stitches the chunks together.
+    sky_cursor_init(&cursor);
+    mu_assert_int_equals(sky_cursor_set_paths(&cursor, ptrs, count), 0);
+    ASSERT_CURSOR_EVENT(10, 1);
+    ASSERT_CURSOR_EVENT(20, 2);
+    ASSERT_CURSOR_EVENT(30, 3);
+    ASSERT_CURSOR_EVENT(40, 4);
+    ASSERT_CURSOR_EVENT(50, 5);
+    mu_assert_bool(cursor.eof);
+    sky_cursor_set_path(&cursor, NULL);
+
+    sky_path_iterator_free(iterator);
+    sky_memtable_release_buffer(&buffer);
+    sky_memtable_free(memtable);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+
+//--------------------------------------
+// Flush
+//--------------------------------------
+
+int test_sky_memtable_flush() {
+    bool ret;
+    sky_data_file *data_file;
+    INIT_DATA_FILE();
+    ADD_EVENT(2, 10LL, 1);
+
+    sky_memtable *memtable = sky_memtable_create();
+    ADD_MEMTABLE_EVENT(4, 10LL, 1);
+    ADD_MEMTABLE_EVENT(2, 20LL, 2);
+    ADD_MEMTABLE_EVENT(1, 30LL, 3);
+    mu_assert_int_equals(sky_memtable_flush(memtable, data_file), 0);
+    mu_assert_int_equals(memtable->entry_count, 0);
+
+    sky_event *event = sky_event_create(2, 20LL, 2);
+    mu_assert_int_equals(sky_data_file_contains_event(data_file, event, &ret), 0);
+    mu_assert_bool(ret);
+    sky_event_free(event);
+    event = sky_event_create(1, 30LL, 3);
+    mu_assert_int_equals(sky_data_file_contains_event(data_file, event, &ret), 0);
+    mu_assert_bool(ret);
+    sky_event_free(event);
+
+    sky_memtable_free(memtable);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+
+//==============================================================================
+//
+// Setup
+//
+//==============================================================================
+
+int all_tests() {
+    mu_run_test(test_sky_memtable_sort);
+    mu_run_test(test_sky_memtable_get_path_ptr);
+    mu_run_test(test_sky_memtable_get_path_ptrs_chunked);
+    mu_run_test(test_sky_memtable_flush);
+    return 0;
+}
+
+RUN_TESTS()
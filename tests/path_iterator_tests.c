@@ -4,6 +4,7 @@
 #include <dbg.h>
 #include <mem.h>
 #include <path_iterator.h>
+#include <path.h>
 
 #include "minunit.h"
 
@@ -138,6 +139,399 @@ int test_sky_path_iterator_data_file_next() {
     return 0;
 }
 
+int test_sky_path_iterator_object_id_with_zero_byte() {
+    cleantmp();
+    int rc;
+    sky_data_file *data_file = sky_data_file_create();
+    data_file->block_size = 128;
+    data_file->path = bfromcstr("tmp/data");
+    data_file->header_path = bfromcstr("tmp/header");
+    sky_data_file_load(data_file);
+
+    // Object id 256 has a zero low byte.
+    sky_event *event = sky_event_create(256, 10LL, 20);
+    rc = sky_data_file_add_event(data_file, event);
+    mu_assert_int_equals(rc, 0);
+    sky_event_free(event);
+    event = sky_event_create(300, 10LL, 20);
+    rc = sky_data_file_add_event(data_file, event);
+    mu_assert_int_equals(rc, 0);
+    sky_event_free(event);
+
+    sky_path_iterator *iterator = sky_path_iterator_create();
+    sky_path_iterator_set_data_file(iterator, data_file);
+    mu_assert_int_equals(iterator->current_object_id, 256);
+    mu_assert_bool(!iterator->eof);
+    rc = sky_path_iterator_next(iterator);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_int_equals(iterator->current_object_id, 300);
+    mu_assert_bool(!iterator->eof);
+    rc = sky_path_iterator_next(iterator);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_bool(iterator->eof);
+
+    sky_path_iterator_free(iterator);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+
+int test_sky_path_iterator_memtable_next() {
+    cleantmp();
+    int rc;
+    void *ptr;
+    sky_data_file *data_file = sky_data_file_create();
+    data_file->block_size = 128;
+    data_file->path = bfromcstr("tmp/data");
+    data_file->header_path = bfromcstr("tmp/header");
+    sky_data_file_load(data_file);
+
+    sky_event *event = sky_event_create(2, 10LL, 20);
+    rc = sky_data_file_add_event(data_file, event);
+    mu_assert_int_equals(rc, 0);
+    sky_event_free(event);
+    event = sky_event_create(4, 10LL, 20);
+    rc = sky_data_file_add_event(data_file, event);
+    mu_assert_int_equals(rc, 0);
+    sky_event_free(event);
+
+    // Object 2 is merged and objects 1 & 5 are only in the memtable.
+    sky_memtable *memtable = sky_memtable_create();
+    event = sky_event_create(5, 10LL, 20);
+    sky_memtable_add_event(memtable, event);
+    sky_event_free(event);
+    event = sky_event_create(1, 10LL, 20);
+    sky_memtable_add_event(memtable, event);
+    sky_event_free(event);
+    event = sky_event_create(2, 20LL, 20);
+    sky_memtable_add_event(memtable, event);
+
+    sky_path_iterator *iterator = sky_path_iterator_create();
+    sky_path_iterator_set_data_file(iterator, data_file);
+    rc = sky_path_iterator_set_memtable(iterator, memtable);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_int_equals(iterator->current_object_id, 1);
+    mu_assert_bool(!iterator->eof);
+    rc = sky_path_iterator_get_ptr(iterator, &ptr);
+    mu_assert_int_equals(rc, 0);
+    mu_assert(ptr == iterator->memtable_buffer.data, "");
+
+    rc = sky_path_iterator_next(iterator);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_int_equals(iterator->current_object_id, 2);
+    rc = sky_path_iterator_get_ptr(iterator, &ptr);
+    mu_assert_int_equals(rc, 0);
+    mu_assert(ptr == iterator->memtable_buffer.data, "");
+    mu_assert_long_equals(sky_path_sizeof_raw(ptr), SKY_PATH_HEADER_LENGTH + 2 * sky_event_sizeof(event));
+
+    rc = sky_path_iterator_next(iterator);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_int_equals(iterator->current_object_id, 4);
+    rc = sky_path_iterator_get_ptr(iterator, &ptr);
+    mu_assert_int_equals(rc, 0);
+    mu_assert(ptr != iterator->memtable_buffer.data, "");
+
+    rc = sky_path_iterator_next(iterator);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_int_equals(iterator->current_object_id, 5);
+    mu_assert_bool(!iterator->eof);
+
+    rc = sky_path_iterator_next(iterator);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_bool(iterator->eof);
+
+    sky_path_iterator_free(iterator);
+    sky_event_free(event);
+    sky_memtable_free(memtable);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+
+//--------------------------------------
+// Time Window
+//--------------------------------------
+
+int test_sky_path_iterator_window_next() {
+    cleantmp();
+    int rc;
+    sky_data_file *data_file = sky_data_file_create();
+    data_file->block_size = 64;
+    data_file->path = bfromcstr("tmp/data");
+    data_file->header_path = bfromcstr("tmp/header");
+    sky_data_file_load(data_file);
+
+    int64_t i;
+    for(i=1; i<10; i++) {
+        sky_event *event = sky_event_create(i, i * 10LL, 20);
+        rc = sky_data_file_add_event(data_file, event);
+        mu_assert_int_equals(rc, 0);
+        sky_event_free(event);
+    }
+    mu_assert_bool(data_file->block_count > 2);
+
+    // Only blocks that overlap the window are read.
+    sky_path_iterator iterator;
+    sky_path_iterator_init(&iterator);
+    rc = sky_path_iterator_set_window(&iterator, 50LL, 70LL);
+    mu_assert_int_equals(rc, 0);
+    rc = sky_path_iterator_set_data_file(&iterator, data_file);
+    mu_assert_int_equals(rc, 0);
+    uint32_t count = 0;
+    bool found = false;
+    while(!iterator.eof) {
+        uint32_t j;
+        sky_block *block = NULL;
+        for(j=0; j<data_file->block_count; j++) {
+            if(data_file->blocks[j]->min_object_id <= iterator.current_object_id && data_file->blocks[j]->max_object_id >= iterator.current_object_id) {
+                block = data_file->blocks[j];
+            }
+        }
+        mu_assert_bool(block != NULL && block->max_timestamp >= 50 && block->min_timestamp < 70);
+        if(iterator.current_object_id == 6) found = true;
+        count++;
+        rc = sky_path_iterator_next(&iterator);
+        mu_assert_int_equals(rc, 0);
+    }
+    mu_assert_bool(found);
+    mu_assert_bool(count < 9);
+
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+
+//--------------------------------------
+// Object Id Range
+//--------------------------------------
+
+int test_sky_path_iterator_range_next() {
+    cleantmp();
+    int rc;
+    sky_data_file *data_file = sky_data_file_create();
+    data_file->block_size = 64;
+    data_file->path = bfromcstr("tmp/data");
+    data_file->header_path = bfromcstr("tmp/header");
+    sky_data_file_load(data_file);
+
+    int64_t i;
+    for(i=1; i<10; i++) {
+        sky_event *event = sky_event_create(i, i * 10LL, 20);
+        rc = sky_data_file_add_event(data_file, event);
+        mu_assert_int_equals(rc, 0);
+        sky_event_free(event);
+    }
+    mu_assert_bool(data_file->block_count > 2);
+
+    sky_memtable *memtable = sky_memtable_create();
+    sky_event *event = sky_event_create(5, 100LL, 20);
+    mu_assert_int_equals(sky_memtable_add_event(memtable, event), 0);
+    sky_event_free(event);
+    event = sky_event_create(12, 100LL, 20);
+    mu_assert_int_equals(sky_memtable_add_event(memtable, event), 0);
+    sky_event_free(event);
+
+    // Only paths in the range are returned.
+    sky_path_iterator iterator;
+    sky_path_iterator_init(&iterator);
+    rc = sky_path_iterator_set_range(&iterator, 3, 6);
+    mu_assert_int_equals(rc, 0);
+    rc = sky_path_iterator_set_data_file(&iterator, data_file);
+    mu_assert_int_equals(rc, 0);
+    rc = sky_path_iterator_set_memtable(&iterator, memtable);
+    mu_assert_int_equals(rc, 0);
+    for(i=3; i<=6; i++) {
+        mu_assert_bool(!iterator.eof);
+        mu_assert_int_equals(iterator.current_object_id, i);
+        mu_assert_bool(iterator.memtable_path == (i == 5));
+        rc = sky_path_iterator_next(&iterator);
+        mu_assert_int_equals(rc, 0);
+    }
+    mu_assert_bool(iterator.eof);
+
+    // Changing the range moves back to the first path in the new range.
+    rc = sky_path_iterator_set_range(&iterator, 8, 20);
+    mu_assert_int_equals(rc, 0);
+    sky_object_id_t object_ids[] = {8, 9, 12};
+    for(i=0; i<3; i++) {
+        mu_assert_bool(!iterator.eof);
+        mu_assert_int_equals(iterator.current_object_id, object_ids[i]);
+        rc = sky_path_iterator_next(&iterator);
+        mu_assert_int_equals(rc, 0);
+    }
+    mu_assert_bool(iterator.eof);
+
+    sky_memtable_free(memtable);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+
+//--------------------------------------
+// Spanned Paths
+//--------------------------------------
+
+int test_sky_path_iterator_spanned_get_ptrs() {
+    cleantmp();
+    int rc;
+    void **ptrs;
+    uint32_t count;
+    sky_data_file *data_file = sky_data_file_create();
+    data_file->block_size = 64;
+    data_file->path = bfromcstr("tmp/data");
+    data_file->header_path = bfromcstr("tmp/header");
+    sky_data_file_load(data_file);
+
+    int64_t i;
+    for(i=0; i<20; i++) {
+        sky_event *event = sky_event_create(1, i, 20);
+        rc = sky_data_file_add_event(data_file, event);
+        mu_assert_int_equals(rc, 0);
+        sky_event_free(event);
+    }
+    sky_event *event = sky_event_create(2, 0LL, 20);
+    mu_assert_int_equals(sky_data_file_add_event(data_file, event), 0);
+    sky_event_free(event);
+    mu_assert_bool(data_file->blocks[0]->spanned);
+
+    sky_snapshot *snapshot = sky_snapshot_create();
+    mu_assert_int_equals(sky_snapshot_open(snapshot, data_file, NULL), 0);
+    sky_path_iterator iterator;
+    sky_path_iterator_init(&iterator);
+    sky_cursor cursor;
+    sky_cursor_init(&cursor);
+
+    // Each block of a spanned path is returned as a segment.
+    int j;
+    for(j=0; j<2; j++) {
+        if(j == 0) {
+            rc = sky_path_iterator_set_data_file(&iterator, data_file);
+        }
+        else {
+            rc = sky_path_iterator_set_snapshot(&iterator, snapshot);
+        }
+        mu_assert_int_equals(rc, 0);
+        mu_assert_int_equals(iterator.current_object_id, 1);
+        rc = sky_path_iterator_get_ptrs(&iterator, &ptrs, &count);
+        mu_assert_int_equals(rc, 0);
+        mu_assert_bool(count > 1);
+        mu_assert(ptrs == iterator.span_ptrs, "");
+
+        // The cursor stitches the segments together.
+        mu_assert_int_equals(sky_cursor_set_paths(&cursor, ptrs, count), 0);
+        for(i=0; i<20; i++) {
+            sky_timestamp_t timestamp;
+            mu_assert_bool(!cursor.eof);
+            mu_assert_int_equals(sky_cursor_get_timestamp(&cursor, &timestamp), 0);
+            mu_assert_long_equals(timestamp, i);
+            mu_assert_int_equals(sky_cursor_next(&cursor), 0);
+        }
+        mu_assert_bool(cursor.eof);
+
+        // Unspanned paths are returned as a list of one.
+        void **list = cursor.paths;
+        mu_assert_int_equals(sky_path_iterator_next(&iterator), 0);
+        mu_assert_int_equals(iterator.current_object_id, 2);
+        rc = sky_path_iterator_get_ptrs(&iterator, &ptrs, &count);
+        mu_assert_int_equals(rc, 0);
+        mu_assert_int_equals(count, 1);
+        mu_assert_int_equals(sky_cursor_set_paths(&cursor, ptrs, count), 0);
+        mu_assert(cursor.paths == list, "Expected path list to be reused");
+        mu_assert_bool(!cursor.eof);
+    }
+
+    sky_cursor_set_path(&cursor, NULL);
+    mu_assert(cursor.paths == NULL, "");
+    sky_path_iterator_set_partitions(&iterator, NULL, 0);
+    mu_assert(iterator.span_ptrs == NULL, "");
+    sky_snapshot_free(snapshot);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+
+int test_sky_path_iterator_spanned_memtable_get_ptrs() {
+    cleantmp();
+    int rc;
+    void **ptrs;
+    uint32_t count;
+    sky_data_file *data_file = sky_data_file_create();
+    data_file->block_size = 64;
+    data_file->path = bfromcstr("tmp/data");
+    data_file->header_path = bfromcstr("tmp/header");
+    sky_data_file_load(data_file);
+
+    int64_t i;
+    for(i=0; i<40; i+=2) {
+        sky_event *event = sky_event_create(1, i, 20);
+        mu_assert_int_equals(sky_data_file_add_event(data_file, event), 0);
+        sky_event_free(event);
+    }
+    sky_event *event = sky_event_create(2, 0LL, 20);
+    mu_assert_int_equals(sky_data_file_add_event(data_file, event), 0);
+    sky_event_free(event);
+    mu_assert_bool(data_file->blocks[0]->spanned);
+    mu_assert_bool(data_file->blocks[1]->spanned);
+
+    // Add events between the events in each block of the span.
+    sky_memtable *memtable = sky_memtable_create();
+    for(i=1; i<40; i+=2) {
+        event = sky_event_create(1, i, 21);
+        mu_assert_int_equals(sky_memtable_add_event(memtable, event), 0);
+        sky_event_free(event);
+    }
+    mu_assert_int_equals(sky_memtable_sort(memtable), 0);
+
+    sky_snapshot *snapshot = sky_snapshot_create();
+    mu_assert_int_equals(sky_snapshot_open(snapshot, data_file, memtable), 0);
+    sky_path_iterator iterator;
+    sky_path_iterator_init(&iterator);
+    sky_cursor cursor;
+    sky_cursor_init(&cursor);
+
+    // Every segment of the span is merged with the memtable.
+    int j;
+    for(j=0; j<2; j++) {
+        if(j == 0) {
+            rc = sky_path_iterator_set_data_file(&iterator, data_file);
+            mu_assert_int_equals(rc, 0);
+            rc = sky_path_iterator_set_memtable(&iterator, memtable);
+        }
+        else {
+            rc = sky_path_iterator_set_snapshot(&iterator, snapshot);
+        }
+        mu_assert_int_equals(rc, 0);
+        mu_assert_int_equals(iterator.current_object_id, 1);
+        mu_assert_bool(iterator.memtable_path);
+        rc = sky_path_iterator_get_ptrs(&iterator, &ptrs, &count);
+        mu_assert_int_equals(rc, 0);
+        mu_assert_int_equals(count, 1);
+
+        mu_assert_int_equals(sky_cursor_set_paths(&cursor, ptrs, count), 0);
+        for(i=0; i<40; i++) {
+            sky_timestamp_t timestamp;
+            mu_assert_bool(!cursor.eof);
+            mu_assert_int_equals(sky_cursor_get_timestamp(&cursor, &timestamp), 0);
+            mu_assert_long_equals(timestamp, i);
+            mu_assert_int_equals(sky_cursor_next(&cursor), 0);
+        }
+        mu_assert_bool(cursor.eof);
+
+        // The iterator skips the rest of the span.
+        mu_assert_int_equals(sky_path_iterator_next(&iterator), 0);
+        mu_assert_int_equals(iterator.current_object_id, 2);
+        mu_assert_int_equals(sky_path_iterator_next(&iterator), 0);
+        mu_assert_bool(iterator.eof);
+    }
+
+    sky_cursor_set_path(&cursor, NULL);
+    sky_path_iterator_set_partitions(&iterator, NULL, 0);
+    sky_snapshot_free(snapshot);
+    sky_memtable_free(memtable);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
 
 //==============================================================================
 //
@@ -148,6 +542,12 @@ int test_sky_path_iterator_data_file_next() {
 int all_tests() {
     mu_run_test(test_sky_path_iterator_single_block_next);
     mu_run_test(test_sky_path_iterator_data_file_next);
+    mu_run_test(test_sky_path_iterator_object_id_with_zero_byte);
+    mu_run_test(test_sky_path_iterator_memtable_next);
+    mu_run_test(test_sky_path_iterator_window_next);
+    mu_run_test(test_sky_path_iterator_range_next);
+    mu_run_test(test_sky_path_iterator_spanned_get_ptrs);
+    mu_run_test(test_sky_path_iterator_spanned_memtable_get_ptrs);
     return 0;
 }
 
@@ -190,6 +190,35 @@ int test_sky_path_unpack() {
 }
 
 
+//--------------------------------------
+// Compact Encoding
+//--------------------------------------
+
+int test_sky_path_compact() {
+    size_t sz;
+    void *compact = calloc(DATA_LENGTH, 1);
+    void *row = calloc(DATA_LENGTH, 1);
+    mu_assert_bool(!sky_path_is_compact(&DATA));
+
+    // Pack into the compact encoding.
+    mu_assert_int_equals(sky_path_pack_compact(&DATA, compact, &sz), 0);
+    mu_assert_long_equals(sz, 34L);
+    mu_assert_bool(sky_path_is_compact(compact));
+    mu_assert_long_equals(sky_path_sizeof_raw(compact), 34L);
+    mu_assert_long_equals(sky_path_sizeof_expanded(compact), DATA_LENGTH);
+    mu_assert_int_equals(sky_path_pack_compact(compact, row, &sz), -1);
+
+    // Expand back into the original row-wise path.
+    mu_assert_int_equals(sky_path_expand(compact, row, &sz), 0);
+    mu_assert_long_equals(sz, DATA_LENGTH);
+    mu_assert_mem(row, &DATA, DATA_LENGTH);
+
+    free(compact);
+    free(row);
+    return 0;
+}
+
+
 //--------------------------------------
 // Event Stats
 //--------------------------------------
@@ -268,6 +297,7 @@ int all_tests() {
     mu_run_test(test_sky_path_sizeof);
     mu_run_test(test_sky_path_pack);
     mu_run_test(test_sky_path_unpack);
+    mu_run_test(test_sky_path_compact);
 
     mu_run_test(test_sky_path_get_event_stats_with_no_event);
     mu_run_test(test_sky_path_get_event_stats_with_starting_event);
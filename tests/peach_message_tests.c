@@ -8,6 +8,60 @@
 #include "minunit.h"
 
 
+//==============================================================================
+//
+// Helpers
+//
+//==============================================================================
+
+#define COUNT_QUERY \
+    "[Hashable(\"id\")]\n" \
+    "[Serializable]\n" \
+    "class Result {\n" \
+    "  public Int id;\n" \
+    "  public Int count;\n" \
+    "  public void merge(Result other)\n" \
+    "  {\n" \
+    "    this.count = this.count + other.count;\n" \
+    "  }\n" \
+    "}\n" \
+    "Cursor cursor = path.events();\n" \
+    "for each (Event event in cursor) {\n" \
+    "  Result item = data.get(event.actionId);\n" \
+    "  item.count = item.count + 1;\n" \
+    "}\n" \
+    "return;"
+
+int yield_count = 0;
+int yield_snapshot_count = 0;
+
+// Adds an event to every object and to some new objects at the yield points
+// of a query so that blocks split while the query runs. The number of
+// snapshots that the query has open on the table's data file is recorded.
+int add_events_on_yield(void *_table) {
+    sky_table *table = (sky_table*)_table;
+    sky_object_id_t object_id;
+    sky_snapshot *snapshot;
+    yield_snapshot_count = 0;
+    for(snapshot=table->data_file->snapshots; snapshot!=NULL; snapshot=snapshot->next) {
+        yield_snapshot_count++;
+    }
+    for(object_id=1; object_id<=80; object_id++) {
+        sky_event *event = sky_event_create(object_id * (object_id > 60 ? 10 : 1), 1000LL + yield_count, 1);
+        if(sky_table_add_event(table, event) != 0) return -1;
+        sky_event_free(event);
+    }
+    yield_count++;
+    return 0;
+}
+
+// Fails the query at its first yield point.
+int fail_on_yield(void *data) {
+    yield_count++;
+    return -1;
+}
+
+
 //==============================================================================
 //
 // Test Cases
@@ -43,6 +97,74 @@ int test_sky_peach_message_unpack() {
 }
 
 
+int test_sky_peach_message_pack_window() {
+    cleantmp();
+    sky_peach_message *message = sky_peach_message_create();
+    message->query = bfromcstr("return;");
+    message->windowed = true;
+    message->window_start = 1000LL;
+    message->window_end = 2000LL;
+
+    FILE *file = fopen("tmp/message", "w");
+    mu_assert_bool(sky_peach_message_pack(message, file) == 0);
+    fclose(file);
+    sky_peach_message_free(message);
+
+    file = fopen("tmp/message", "r");
+    message = sky_peach_message_create();
+    mu_assert_bool(sky_peach_message_unpack(message, file) == 0);
+    fclose(file);
+    mu_assert_bool(message->windowed);
+    mu_assert_int64_equals(message->window_start, 1000LL);
+    mu_assert_int64_equals(message->window_end, 2000LL);
+    mu_assert_int_equals(message->opt_level, -1);
+    mu_assert_bstring(message->query, "return;");
+    sky_peach_message_free(message);
+    return 0;
+}
+
+int test_sky_peach_message_pack_opt_level() {
+    cleantmp();
+    sky_peach_message *message = sky_peach_message_create();
+    message->query = bfromcstr("return;");
+    message->opt_level = 0;
+
+    FILE *file = fopen("tmp/message", "w");
+    mu_assert_bool(sky_peach_message_pack(message, file) == 0);
+    fclose(file);
+    sky_peach_message_free(message);
+
+    file = fopen("tmp/message", "r");
+    message = sky_peach_message_create();
+    mu_assert_bool(sky_peach_message_unpack(message, file) == 0);
+    fclose(file);
+    mu_assert_bool(!message->windowed);
+    mu_assert_int_equals(message->opt_level, 0);
+    mu_assert_bstring(message->query, "return;");
+
+    // Windowed messages put the level after the window.
+    message->windowed = true;
+    message->window_start = 1000LL;
+    message->window_end = 2000LL;
+    message->opt_level = 3;
+    file = fopen("tmp/message", "w");
+    mu_assert_bool(sky_peach_message_pack(message, file) == 0);
+    fclose(file);
+    sky_peach_message_free(message);
+
+    file = fopen("tmp/message", "r");
+    message = sky_peach_message_create();
+    mu_assert_bool(sky_peach_message_unpack(message, file) == 0);
+    fclose(file);
+    mu_assert_bool(message->windowed);
+    mu_assert_int64_equals(message->window_start, 1000LL);
+    mu_assert_int64_equals(message->window_end, 2000LL);
+    mu_assert_int_equals(message->opt_level, 3);
+    sky_peach_message_free(message);
+    return 0;
+}
+
+
 //--------------------------------------
 // Processing
 //--------------------------------------
@@ -75,10 +197,15 @@ int test_sky_peach_message_process() {
         "return;"
     );
 
-    FILE *output = fopen("tmp/output", "w");
-    mu_assert(sky_peach_message_process(message, table, output) == 0, "");
-    fclose(output);
-    mu_assert_file("tmp/output", "tests/fixtures/peach_message/1/output");
+    // Every optimization level returns the same results.
+    int32_t opt_level;
+    for(opt_level=-1; opt_level<=QIP_OPT_LEVEL_MAX; opt_level++) {
+        message->opt_level = opt_level;
+        FILE *output = fopen("tmp/output", "w");
+        mu_assert(sky_peach_message_process(message, table, output) == 0, "");
+        fclose(output);
+        mu_assert_file("tmp/output", "tests/fixtures/peach_message/1/output");
+    }
 
     sky_peach_message_free(message);
     sky_table_free(table);
@@ -86,6 +213,133 @@ int test_sky_peach_message_process() {
 }
 
 
+int test_sky_peach_message_process_yield() {
+    int i;
+    for(i=0; i<2; i++) {
+        cleantmp();
+        sky_table *table = sky_table_create();
+        table->path = bfromcstr("tmp");
+        table->default_block_size = 128;
+        table->query_worker_count = 2;
+        table->memtable_size = (i == 0 ? 0 : 256);
+        mu_assert_int_equals(sky_table_open(table), 0);
+
+        sky_object_id_t object_id;
+        int64_t timestamp;
+        for(object_id=1; object_id<=60; object_id++) {
+            for(timestamp=0; timestamp<4; timestamp++) {
+                sky_event *event = sky_event_create(object_id, timestamp, (sky_action_id_t)(1 + (object_id + timestamp) % 3));
+                mu_assert_int_equals(sky_table_add_event(table, event), 0);
+                sky_event_free(event);
+            }
+        }
+        mu_assert_bool(table->data_file->block_count > 4);
+
+        sky_peach_message *message = sky_peach_message_create();
+        message->query = bfromcstr(COUNT_QUERY);
+        FILE *output = fopen("tmp/expected", "w");
+        mu_assert_int_equals(sky_peach_message_process(message, table, output), 0);
+        fclose(output);
+
+        // Events added at yield points aren't seen by the running query.
+        // The workers stop between every range without a yield interval.
+        yield_count = 0;
+        message->yield = add_events_on_yield;
+        message->yield_data = table;
+        message->yield_interval = 0;
+        output = fopen("tmp/output", "w");
+        mu_assert_int_equals(sky_peach_message_process(message, table, output), 0);
+        fclose(output);
+        mu_assert_bool(yield_count > 0);
+        mu_assert_file("tmp/output", "tmp/expected");
+
+        // Both workers read the same snapshot.
+        mu_assert_int_equals(yield_snapshot_count, 1);
+
+        // A failed yield stops the workers.
+        yield_count = 0;
+        message->yield = fail_on_yield;
+        output = fopen("tmp/output", "w");
+        mu_assert_int_equals(sky_peach_message_process(message, table, output), -1);
+        fclose(output);
+        mu_assert_int_equals(yield_count, 1);
+
+        // The events are seen by the next query.
+        sky_event *event = sky_event_create(700, 1000LL, 1);
+        bool ret;
+        mu_assert_int_equals(sky_table_flush_memtable(table), 0);
+        mu_assert_int_equals(sky_data_file_contains_event(table->data_file, event, &ret), 0);
+        mu_assert_bool(ret);
+        sky_event_free(event);
+
+        sky_peach_message_free(message);
+        mu_assert_int_equals(sky_table_close(table), 0);
+        sky_table_free(table);
+    }
+    return 0;
+}
+
+
+int test_sky_peach_message_process_workers() {
+    int i;
+    uint32_t worker_count;
+    for(i=0; i<2; i++) {
+        cleantmp();
+        sky_table *table = sky_table_create();
+        table->path = bfromcstr("tmp");
+        table->default_block_size = 128;
+        table->partition_duration = (i == 0 ? 0 : 20LL);
+        mu_assert_int_equals(sky_table_open(table), 0);
+
+        // Every tenth object has a path that spans several blocks so that
+        // range boundaries fall on spanned blocks.
+        sky_object_id_t object_id;
+        int64_t timestamp;
+        for(object_id=1; object_id<=100; object_id++) {
+            int64_t event_count = (object_id % 10 == 0 ? 60 : 3);
+            for(timestamp=0; timestamp<event_count; timestamp++) {
+                sky_event *event = sky_event_create(object_id, timestamp, (sky_action_id_t)(1 + (object_id + timestamp) % 4));
+                mu_assert_int_equals(sky_table_add_event(table, event), 0);
+                sky_event_free(event);
+            }
+        }
+        sky_data_file *data_file = table->data_file;
+        if(table->partition_duration > 0) {
+            mu_assert_bool(table->partition_count > 1);
+            data_file = table->partitions[0].data_file;
+        }
+        bool spanned = false;
+        uint32_t j;
+        for(j=0; j<data_file->block_count; j++) {
+            spanned = spanned || data_file->blocks[j]->spanned;
+        }
+        mu_assert_bool(spanned);
+
+        // A single worker gives the expected results.
+        sky_peach_message *message = sky_peach_message_create();
+        message->query = bfromcstr(COUNT_QUERY);
+        table->query_worker_count = 1;
+        FILE *output = fopen("tmp/expected", "w");
+        mu_assert_int_equals(sky_peach_message_process(message, table, output), 0);
+        fclose(output);
+
+        // Merged results from several workers are the same.
+        for(worker_count=2; worker_count<=16; worker_count*=2) {
+            table->query_worker_count = worker_count;
+            output = fopen("tmp/output", "w");
+            mu_assert_int_equals(sky_peach_message_process(message, table, output), 0);
+            fclose(output);
+            mu_assert_file("tmp/output", "tmp/expected");
+        }
+
+        sky_peach_message_free(message);
+        mu_assert_int_equals(sky_table_close(table), 0);
+        sky_table_free(table);
+    }
+    return 0;
+}
+
+
 //==============================================================================
 //
 // Setup
@@ -95,7 +349,11 @@ int test_sky_peach_message_process() {
 int all_tests() {
     mu_run_test(test_sky_peach_message_pack);
     mu_run_test(test_sky_peach_message_unpack);
+    mu_run_test(test_sky_peach_message_pack_window);
+    mu_run_test(test_sky_peach_message_pack_opt_level);
     mu_run_test(test_sky_peach_message_process);
+    mu_run_test(test_sky_peach_message_process_yield);
+    mu_run_test(test_sky_peach_message_process_workers);
     return 0;
 }
 
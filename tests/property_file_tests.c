@@ -100,6 +100,67 @@ int test_sky_property_file_load() {
 }
 
 
+//--------------------------------------
+// Dictionaries
+//--------------------------------------
+
+int test_sky_property_file_encode_event() {
+    int rc;
+    struct tagbstring path = bsStatic("tmp/properties");
+    struct tagbstring us = bsStatic("US");
+    struct tagbstring ca = bsStatic("CA");
+    cleantmp();
+
+    sky_property_file *property_file = sky_property_file_create();
+    sky_property_file_set_path(property_file, &path);
+    sky_property *property = sky_property_create();
+    property->data_type = bfromcstr("String");
+    property->name = bfromcstr("country");
+    property->dictionary = sky_dictionary_create();
+    rc = sky_property_file_add_property(property_file, property);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_int_equals(sky_property_file_save(property_file), 0);
+
+    // Strings are replaced by their codes.
+    sky_event *event = sky_event_create(1, 10, 0);
+    sky_event_set_data(event, 1, &ca);
+    sky_event_set_data(event, 2, &us);
+    mu_assert_int_equals(sky_property_file_encode_event(property_file, event), 0);
+    mu_assert(event->data[0]->data_type == &SKY_DATA_TYPE_INT, "Expected dictionary code");
+    mu_assert_long_equals(event->data[0]->int_value, 1L);
+    mu_assert(event->data[1]->data_type == &SKY_DATA_TYPE_STRING, "Expected string");
+    sky_event_free(event);
+    sky_property_file_free(property_file);
+
+    // The dictionary is reloaded with the property file.
+    property_file = sky_property_file_create();
+    sky_property_file_set_path(property_file, &path);
+    mu_assert_int_equals(sky_property_file_load(property_file), 0);
+    mu_assert(property_file->properties[0]->dictionary != NULL, "Expected dictionary");
+    mu_assert_int_equals(property_file->properties[0]->dictionary->count, 1);
+    event = sky_event_create(1, 20, 0);
+    sky_event_set_data(event, 1, &us);
+    sky_event_set_data(event, 1, &ca);
+    mu_assert_int_equals(sky_property_file_encode_event(property_file, event), 0);
+    mu_assert_long_equals(event->data[0]->int_value, 1L);
+    sky_event_free(event);
+    sky_property_file_free(property_file);
+    return 0;
+}
+
+int test_sky_property_file_dictionary_requires_string() {
+    sky_property_file *property_file = sky_property_file_create();
+    sky_property *property = sky_property_create();
+    property->data_type = bfromcstr("Int");
+    property->name = bfromcstr("foo");
+    property->dictionary = sky_dictionary_create();
+    mu_assert_int_equals(sky_property_file_add_property(property_file, property), -1);
+    sky_property_free(property);
+    sky_property_file_free(property_file);
+    return 0;
+}
+
+
 //==============================================================================
 //
 // Setup
@@ -110,6 +171,8 @@ int all_tests() {
     mu_run_test(test_sky_property_file_path);
     mu_run_test(test_sky_property_file_save);
     mu_run_test(test_sky_property_file_load);
+    mu_run_test(test_sky_property_file_encode_event);
+    mu_run_test(test_sky_property_file_dictionary_requires_string);
     return 0;
 }
 
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <utime.h>
+
+#include <qip/qip.h>
+#include <qip/ast_cache.h>
+
+#include "minunit.h"
+#include "qip_test_util.h"
+
+
+//==============================================================================
+//
+// Helpers
+//
+//==============================================================================
+
+#define WRITE_FILE(PATH, TEXT) do {\
+    FILE *_file = fopen(PATH, "w"); \
+    mu_assert(_file != NULL, "Unable to open file"); \
+    fputs(TEXT, _file); \
+    fclose(_file); \
+} while(0)
+
+#define FOO_CLASS \
+    "\n" \
+    "class Foo {\n" \
+    "  public Int x;\n" \
+    "  public Int get()\n" \
+    "  {\n" \
+    "    return this.x;\n" \
+    "  }\n" \
+    "}\n"
+
+#define RETURN_STMT(MODULE) \
+    ((MODULE)->module.classes[0]->class.methods[0]->method.function->function.body->block.exprs[0])
+
+#define SET_MTIME(PATH, MTIME) do {\
+    struct utimbuf _times; \
+    _times.actime = MTIME; \
+    _times.modtime = MTIME; \
+    mu_assert_int_equals(utime(PATH, &_times), 0); \
+} while(0)
+
+
+//==============================================================================
+//
+// Test Cases
+//
+//==============================================================================
+
+//--------------------------------------
+// Loading
+//--------------------------------------
+
+int test_qip_ast_cache_load() {
+    cleantmp();
+    qip_ast_node *module = NULL;
+    qip_ast_node *module2 = NULL;
+    struct tagbstring name = bsStatic("Foo");
+    struct tagbstring path = bsStatic("tmp/Foo.qip");
+    WRITE_FILE("tmp/Foo.qip", FOO_CLASS);
+    SET_MTIME("tmp/Foo.qip", 1000);
+
+    // The first load parses the file and returns a copy.
+    qip_ast_cache *cache = qip_ast_cache_create();
+    mu_assert_int_equals(qip_ast_cache_load(cache, &name, &path, &module), 0);
+    mu_assert(module != NULL, "Expected module");
+    mu_assert_int_equals(cache->entry_count, 1);
+    qip_ast_node *cached = cache->entries[0].module;
+    mu_assert(module != cached, "Expected a copy of the cached module");
+    mu_assert_int_equals(module->module.class_count, 1);
+    mu_assert_bstring(module->module.classes[0]->class.name, "Foo");
+
+    // The copy keeps the source positions of the cached nodes.
+    mu_assert(RETURN_STMT(module) != RETURN_STMT(cached), "");
+    mu_assert_int_equals(RETURN_STMT(cached)->line_no, 6);
+    mu_assert_int_equals(RETURN_STMT(module)->line_no, 6);
+    mu_assert_int_equals(RETURN_STMT(module)->char_no, RETURN_STMT(cached)->char_no);
+
+    // The next load is a cache hit.
+    mu_assert_int_equals(qip_ast_cache_load(cache, &name, &path, &module2), 0);
+    mu_assert(module2 != NULL && module2 != module, "Expected a new copy");
+    mu_assert(cache->entries[0].module == cached, "Expected the cached module to be reused");
+    mu_assert_int_equals(cache->entry_count, 1);
+    qip_ast_node_free(module2);
+    module2 = NULL;
+
+    // A change in modification time parses the file again.
+    WRITE_FILE("tmp/Foo.qip", "\n\nclass Foo {\n  public Int y;\n}\n");
+    SET_MTIME("tmp/Foo.qip", 2000);
+    mu_assert_int_equals(qip_ast_cache_load(cache, &name, &path, &module2), 0);
+    mu_assert(cache->entries[0].module != cached, "Expected the module to be parsed again");
+    mu_assert_bstring(module2->module.classes[0]->class.properties[0]->property.var_decl->var_decl.name, "y");
+    mu_assert_int_equals(cache->entry_count, 1);
+    qip_ast_node_free(module2);
+    module2 = NULL;
+
+    // A change in size parses the file again.
+    cached = cache->entries[0].module;
+    WRITE_FILE("tmp/Foo.qip", "\n\nclass Foo {\n  public Int zz;\n}\n");
+    SET_MTIME("tmp/Foo.qip", 2000);
+    mu_assert_int_equals(qip_ast_cache_load(cache, &name, &path, &module2), 0);
+    mu_assert(cache->entries[0].module != cached, "Expected the module to be parsed again");
+    mu_assert_bstring(module2->module.classes[0]->class.properties[0]->property.var_decl->var_decl.name, "zz");
+    qip_ast_node_free(module2);
+    module2 = NULL;
+
+    qip_ast_node_free(module);
+    qip_ast_cache_free(cache);
+    return 0;
+}
+
+int test_qip_ast_cache_load_uncached() {
+    cleantmp();
+    qip_ast_node *module = NULL;
+    struct tagbstring name = bsStatic("Foo");
+    struct tagbstring path = bsStatic("tmp/Foo.qip");
+    qip_ast_cache *cache = qip_ast_cache_create();
+
+    // Missing files aren't cached.
+    mu_assert_int_equals(qip_ast_cache_load(cache, &name, &path, &module), 0);
+    mu_assert(module == NULL, "Expected no module");
+    mu_assert_int_equals(cache->entry_count, 0);
+
+    // Files with syntax errors aren't cached.
+    WRITE_FILE("tmp/Foo.qip", "class Foo {\n  public Int x\n");
+    mu_assert_int_equals(qip_ast_cache_load(cache, &name, &path, &module), 0);
+    mu_assert(module == NULL, "Expected no module");
+    mu_assert_int_equals(cache->entry_count, 0);
+
+    qip_ast_cache_free(cache);
+    return 0;
+}
+
+int test_qip_ast_cache_compile_syntax_error() {
+    cleantmp();
+    WRITE_FILE("tmp/Foo.qip", "class Foo {\n  public Int x\n");
+
+    // The compiler loads the file as source and reports its error.
+    struct tagbstring query = bsStatic("Foo foo = null;\nreturn;");
+    struct tagbstring class_path = bsStatic("tmp");
+    struct tagbstring core_class_path = bsStatic("lib/core");
+    qip_module *module = qip_module_create(NULL, NULL);
+    qip_compiler *compiler = qip_compiler_create();
+    compiler->ast_cache = qip_ast_cache_create();
+    qip_compiler_add_class_path(compiler, &class_path);
+    qip_compiler_add_class_path(compiler, &core_class_path);
+    module->compiler = compiler;
+    qip_compiler_compile(compiler, module, &query, NULL, 0);
+    mu_assert(module->error_count > 0, "Expected a syntax error");
+    mu_assert_int_equals(compiler->ast_cache->entry_count, 0);
+
+    qip_ast_cache_free(compiler->ast_cache);
+    qip_compiler_free(compiler);
+    qip_module_free(module);
+    return 0;
+}
+
+
+//==============================================================================
+//
+// Setup
+//
+//==============================================================================
+
+int all_tests() {
+    mu_run_test(test_qip_ast_cache_load);
+    mu_run_test(test_qip_ast_cache_load_uncached);
+    mu_run_test(test_qip_ast_cache_compile_syntax_error);
+    return 0;
+}
+
+RUN_TESTS()
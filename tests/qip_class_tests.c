@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <qip/qip.h>
+
+#include "minunit.h"
+
+
+//==============================================================================
+//
+// Helpers
+//
+//==============================================================================
+
+// Creates a class with a name and a list of template variable names.
+qip_ast_node *create_template_class(const char *name, const char **vars,
+                                    unsigned int var_count)
+{
+    bstring class_name = bfromcstr(name);
+    qip_ast_node *class = qip_ast_class_create(class_name, NULL, 0, NULL, 0);
+    bdestroy(class_name);
+
+    unsigned int i;
+    for(i=0; i<var_count; i++) {
+        bstring var_name = bfromcstr(vars[i]);
+        qip_ast_class_add_template_var(class, qip_ast_template_var_create(var_name));
+        bdestroy(var_name);
+    }
+    return class;
+}
+
+// Creates a type reference with a list of subtype names.
+qip_ast_node *create_type_ref(const char *name, const char **subtypes,
+                              unsigned int subtype_count)
+{
+    qip_ast_node *type_ref = qip_ast_type_ref_create_cstr((char*)name);
+    unsigned int i;
+    for(i=0; i<subtype_count; i++) {
+        qip_ast_type_ref_add_subtype(type_ref, qip_ast_type_ref_create_cstr((char*)subtypes[i]));
+    }
+    return type_ref;
+}
+
+// Asserts that a class doesn't specialize a type reference.
+#define ASSERT_NO_SPECIALIZATION(CLASS, TYPE_REF) do {\
+    qip_ast_node *_ret = NULL; \
+    mu_assert_int_equals(qip_ast_class_get_specialization_type_ref(CLASS, TYPE_REF, &_ret), 0); \
+    mu_assert(_ret == NULL, "Expected no specialization"); \
+    qip_ast_node_free(TYPE_REF); \
+} while(0)
+
+
+//==============================================================================
+//
+// Test Cases
+//
+//==============================================================================
+
+//--------------------------------------
+// Specialization
+//--------------------------------------
+
+int test_qip_ast_class_get_specialization_type_ref() {
+    qip_ast_node *type_ref = NULL, *ret = NULL;
+    qip_ast_node *class = create_template_class("Map<Int,U>", (const char*[]){"U"}, 1);
+
+    // Fixed subtypes that match bind the rest to the template variables.
+    type_ref = create_type_ref("Map", (const char*[]){"Int", "Result"}, 2);
+    mu_assert_int_equals(qip_ast_class_get_specialization_type_ref(class, type_ref, &ret), 0);
+    mu_assert(ret != NULL, "Expected specialization");
+    mu_assert_bstring(ret->type_ref.name, "Map<Int,U>");
+    mu_assert_int_equals(ret->type_ref.subtype_count, 1);
+    mu_assert_bstring(ret->type_ref.subtypes[0]->type_ref.name, "Result");
+    qip_ast_node_free(ret);
+    qip_ast_node_free(type_ref);
+
+    // Fixed subtypes that differ don't match.
+    type_ref = create_type_ref("Map", (const char*[]){"String", "Result"}, 2);
+    ASSERT_NO_SPECIALIZATION(class, type_ref);
+
+    // The number of subtypes must match.
+    type_ref = create_type_ref("Map", (const char*[]){"Int"}, 1);
+    ASSERT_NO_SPECIALIZATION(class, type_ref);
+    type_ref = create_type_ref("Map", (const char*[]){"Int", "Result", "Int"}, 3);
+    ASSERT_NO_SPECIALIZATION(class, type_ref);
+    type_ref = create_type_ref("Map", NULL, 0);
+    ASSERT_NO_SPECIALIZATION(class, type_ref);
+
+    // The class must specialize the referenced class.
+    type_ref = create_type_ref("Ma", (const char*[]){"Int", "Result"}, 2);
+    ASSERT_NO_SPECIALIZATION(class, type_ref);
+    type_ref = create_type_ref("Set", (const char*[]){"Int", "Result"}, 2);
+    ASSERT_NO_SPECIALIZATION(class, type_ref);
+    qip_ast_node_free(class);
+
+    // Generic classes are not specializations.
+    class = create_template_class("Map", (const char*[]){"T", "U"}, 2);
+    type_ref = create_type_ref("Map", (const char*[]){"Int", "Result"}, 2);
+    ASSERT_NO_SPECIALIZATION(class, type_ref);
+    qip_ast_node_free(class);
+
+    return 0;
+}
+
+int test_qip_ast_class_get_specialization_type_ref_binds_in_order() {
+    qip_ast_node *type_ref = NULL, *ret = NULL;
+    qip_ast_node *class = create_template_class("Table<K,Int,V>", (const char*[]){"K", "V"}, 2);
+
+    type_ref = create_type_ref("Table", (const char*[]){"String", "Int", "Result"}, 3);
+    mu_assert_int_equals(qip_ast_class_get_specialization_type_ref(class, type_ref, &ret), 0);
+    mu_assert(ret != NULL, "Expected specialization");
+    mu_assert_int_equals(ret->type_ref.subtype_count, 2);
+    mu_assert_bstring(ret->type_ref.subtypes[0]->type_ref.name, "String");
+    mu_assert_bstring(ret->type_ref.subtypes[1]->type_ref.name, "Result");
+    qip_ast_node_free(ret);
+    qip_ast_node_free(type_ref);
+
+    type_ref = create_type_ref("Table", (const char*[]){"String", "Float", "Result"}, 3);
+    ASSERT_NO_SPECIALIZATION(class, type_ref);
+
+    qip_ast_node_free(class);
+    return 0;
+}
+
+
+//==============================================================================
+//
+// Setup
+//
+//==============================================================================
+
+int all_tests() {
+    mu_run_test(test_qip_ast_class_get_specialization_type_ref);
+    mu_run_test(test_qip_ast_class_get_specialization_type_ref_binds_in_order);
+    return 0;
+}
+
+RUN_TESTS()
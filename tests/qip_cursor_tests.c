@@ -4,6 +4,7 @@
 #include <qip/qip.h>
 #include <qip_path.h>
 #include <qip_cursor.h>
+#include <minipack.h>
 
 #include "minunit.h"
 #include "qip_test_util.h"
@@ -128,6 +129,7 @@ int test_sky_qip_cursor_execute_with_map() {
 
     // Validate the contents of the map.
     struct Result *result;
+    qip_map_sort(map);
     mu_assert_int64_equals(map->count, 3LL);
     result = map->elements[0];
     mu_assert_int64_equals(result->id, 0LL);
@@ -148,6 +150,41 @@ int test_sky_qip_cursor_execute_with_map() {
 }
 
 
+//--------------------------------------
+// String Properties
+//--------------------------------------
+
+int test_sky_qip_cursor_unpack_string() {
+    size_t sz;
+    uint32_t code;
+    qip_string value;
+    uint8_t data[16];
+    struct tagbstring foo = bsStatic("foo");
+    sky_dictionary *dictionary = sky_dictionary_create();
+    mu_assert_int_equals(sky_dictionary_add(dictionary, &foo, &code), 0);
+
+    // Raw strings point into the data.
+    minipack_pack_raw(data, 3, &sz);
+    memcpy(data + sz, "bar", 3);
+    mu_assert_long_equals((long)sky_qip_cursor_unpack_string(data, dictionary, &value), (long)(sz + 3));
+    mu_assert_int64_equals(value.length, 3LL);
+    mu_assert(value.data == (char*)data + sz, "");
+
+    // Codes are looked up in the dictionary.
+    minipack_pack_int(data, code, &sz);
+    mu_assert_long_equals((long)sky_qip_cursor_unpack_string(data, dictionary, &value), (long)sz);
+    mu_assert_int64_equals(value.length, 3LL);
+    mu_assert(value.data == bdata(dictionary->strings[0]), "");
+
+    // Unknown codes can't be read.
+    minipack_pack_int(data, code + 1, &sz);
+    mu_assert_long_equals((long)sky_qip_cursor_unpack_string(data, dictionary, &value), 0L);
+
+    sky_dictionary_free(dictionary);
+    return 0;
+}
+
+
 //==============================================================================
 //
 // Setup
@@ -157,6 +194,7 @@ int test_sky_qip_cursor_execute_with_map() {
 int all_tests() {
     mu_run_test(test_sky_qip_cursor_execute_simple);
     mu_run_test(test_sky_qip_cursor_execute_with_map);
+    mu_run_test(test_sky_qip_cursor_unpack_string);
     return 0;
 }
 
@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <qip/qip.h>
+#include <qip/map.h>
+
+#include "minunit.h"
+
+int64_t qip_map_hash(int64_t key);
+
+
+//==============================================================================
+//
+// Fixtures
+//
+//==============================================================================
+
+typedef struct {
+    int64_t key;
+    int64_t value;
+} test_elem;
+
+// Adds an element to a map with a given key and value.
+#define MAP_ADD(MODULE, MAP, KEY, VALUE) do {\
+    test_elem *_elem = qip_map_elalloc(MODULE, MAP); \
+    mu_assert(_elem != NULL, "Unable to allocate element"); \
+    _elem->key = KEY; \
+    _elem->value = VALUE; \
+    qip_map_refresh(MODULE, MAP); \
+} while(0)
+
+// Asserts that a key is found in a map with a given value.
+#define MAP_ASSERT_VALUE(MODULE, MAP, KEY, VALUE) do {\
+    test_elem *_elem = qip_map_find(MODULE, MAP, KEY); \
+    mu_assert(_elem != NULL, "Expected element"); \
+    mu_assert_int64_equals(_elem->key, (int64_t)(KEY)); \
+    mu_assert_int64_equals(_elem->value, (int64_t)(VALUE)); \
+} while(0)
+
+// Creates a map the way QIP code does, with every field zeroed.
+qip_map *create_zeroed_map()
+{
+    qip_map *map = calloc(1, sizeof(qip_map));
+    map->elemsz = sizeof(test_elem);
+    return map;
+}
+
+void sum_merge(void *_elem, void *_other)
+{
+    ((test_elem*)_elem)->value += ((test_elem*)_other)->value;
+}
+
+
+//==============================================================================
+//
+// Test Cases
+//
+//==============================================================================
+
+//--------------------------------------
+// Element Management
+//--------------------------------------
+
+int test_qip_map_elalloc_without_pool() {
+    qip_module *module = qip_module_create(NULL, NULL);
+    qip_map *map = create_zeroed_map();
+    mu_assert(map->pool == NULL, "Expected no pool");
+    MAP_ADD(module, map, 10, 100);
+    mu_assert(map->pool != NULL, "Expected pool");
+    MAP_ASSERT_VALUE(module, map, 10, 100);
+    mu_assert_int64_equals(map->count, 1LL);
+    qip_map_free(map);
+
+    // Unused maps can be freed without a pool.
+    qip_map_free(create_zeroed_map());
+    qip_module_free(module);
+    return 0;
+}
+
+int test_qip_map_find_collisions() {
+    int64_t keys[4];
+    int64_t key, key_count = 0;
+    qip_module *module = qip_module_create(NULL, NULL);
+    qip_map *map = create_zeroed_map();
+
+    // Find keys that start probing from the same bucket.
+    int64_t mask = QIP_MAP_INITIAL_BUCKET_COUNT - 1;
+    for(key=0; key_count<4; key++) {
+        if((qip_map_hash(key) & mask) == (qip_map_hash(0) & mask)) {
+            keys[key_count++] = key;
+        }
+    }
+
+    int64_t i;
+    for(i=0; i<key_count; i++) {
+        MAP_ADD(module, map, keys[i], i + 1);
+    }
+    mu_assert_int64_equals(map->bucket_count, (int64_t)QIP_MAP_INITIAL_BUCKET_COUNT);
+    for(i=0; i<key_count; i++) {
+        MAP_ASSERT_VALUE(module, map, keys[i], i + 1);
+    }
+    mu_assert(qip_map_find(module, map, key) == NULL, "Expected missing key");
+
+    qip_map_free(map);
+    qip_module_free(module);
+    return 0;
+}
+
+int test_qip_map_find_after_growth() {
+    qip_module *module = qip_module_create(NULL, NULL);
+    qip_map *map = create_zeroed_map();
+
+    // The table doubles once three quarters of its buckets would be used.
+    int64_t i;
+    for(i=0; i<12; i++) {
+        MAP_ADD(module, map, i * 7, i);
+    }
+    mu_assert_int64_equals(map->bucket_count, 16LL);
+    MAP_ADD(module, map, 12 * 7, 12);
+    mu_assert_int64_equals(map->bucket_count, 32LL);
+
+    for(i=13; i<1000; i++) {
+        MAP_ADD(module, map, i * 7, i);
+    }
+    mu_assert_int64_equals(map->bucket_count, 2048LL);
+    for(i=0; i<1000; i++) {
+        MAP_ASSERT_VALUE(module, map, i * 7, i);
+        mu_assert(qip_map_find(module, map, i * 7 + 1) == NULL, "Expected missing key");
+    }
+
+    qip_map_free(map);
+    qip_module_free(module);
+    return 0;
+}
+
+int test_qip_map_find_negative_keys() {
+    qip_module *module = qip_module_create(NULL, NULL);
+    qip_map *map = create_zeroed_map();
+    mu_assert_int_equals(qip_map_set_dense_count(map, 8), 0);
+
+    // Negative keys are hashed rather than indexed densely.
+    MAP_ADD(module, map, -1, 1);
+    MAP_ADD(module, map, INT64_MIN, 2);
+    MAP_ADD(module, map, 3, 3);
+    MAP_ADD(module, map, 8, 4);
+    mu_assert(map->dense[3] != NULL, "Expected dense element");
+    mu_assert_int64_equals(map->indexed_count, 4LL);
+    MAP_ASSERT_VALUE(module, map, -1, 1);
+    MAP_ASSERT_VALUE(module, map, INT64_MIN, 2);
+    MAP_ASSERT_VALUE(module, map, 3, 3);
+    MAP_ASSERT_VALUE(module, map, 8, 4);
+    mu_assert(qip_map_find(module, map, -2) == NULL, "Expected missing key");
+    mu_assert(qip_map_find(module, map, 2) == NULL, "Expected missing key");
+
+    qip_map_sort(map);
+    mu_assert_int64_equals(((test_elem*)map->elements[0])->key, INT64_MIN);
+    mu_assert_int64_equals(((test_elem*)map->elements[1])->key, -1LL);
+
+    qip_map_free(map);
+    qip_module_free(module);
+    return 0;
+}
+
+
+//--------------------------------------
+// Merge
+//--------------------------------------
+
+int test_qip_map_merge() {
+    qip_module *module = qip_module_create(NULL, NULL);
+    qip_map *map = create_zeroed_map();
+    qip_map *other = qip_map_create();
+    other->elemsz = sizeof(test_elem);
+
+    MAP_ADD(module, map, 1, 10);
+    MAP_ADD(module, map, -5, 20);
+    MAP_ADD(module, other, 1, 1);
+    MAP_ADD(module, other, 2, 2);
+    MAP_ADD(module, other, -5, 3);
+    qip_map_merge(module, map, other, sum_merge);
+
+    mu_assert_int64_equals(map->count, 3LL);
+    MAP_ASSERT_VALUE(module, map, 1, 11);
+    MAP_ASSERT_VALUE(module, map, 2, 2);
+    MAP_ASSERT_VALUE(module, map, -5, 23);
+
+    // The other map is left empty and can be reused.
+    mu_assert_int64_equals(other->count, 0LL);
+    mu_assert(qip_map_find(module, other, 1) == NULL, "Expected empty map");
+    MAP_ADD(module, other, 7, 7);
+    MAP_ASSERT_VALUE(module, other, 7, 7);
+
+    // Merging into a map that has never allocated takes its element size.
+    qip_map *empty = calloc(1, sizeof(qip_map));
+    qip_map_merge(module, empty, other, sum_merge);
+    mu_assert_int64_equals(empty->elemsz, (int64_t)sizeof(test_elem));
+    MAP_ASSERT_VALUE(module, empty, 7, 7);
+
+    // Merging from a map without a pool leaves both maps intact.
+    qip_map *unused = create_zeroed_map();
+    qip_map_merge(module, map, unused, sum_merge);
+    mu_assert_int64_equals(map->count, 3LL);
+    mu_assert(unused->pool == NULL, "Expected no pool");
+
+    qip_map_free(unused);
+    qip_map_free(empty);
+    qip_map_free(other);
+    qip_map_free(map);
+    qip_module_free(module);
+    return 0;
+}
+
+
+//==============================================================================
+//
+// Setup
+//
+//==============================================================================
+
+int all_tests() {
+    mu_run_test(test_qip_map_elalloc_without_pool);
+    mu_run_test(test_qip_map_find_collisions);
+    mu_run_test(test_qip_map_find_after_growth);
+    mu_run_test(test_qip_map_find_negative_keys);
+    mu_run_test(test_qip_map_merge);
+    return 0;
+}
+
+RUN_TESTS()
@@ -54,9 +54,11 @@ int test_sky_qip_path_execute() {
     // Validate that the cursor pointer starts at the first event.
     mu_assert_long_equals(cursor->cursor->ptr - path->path_ptr, 8L);
 
+    // The path's cursor is reused for each call.
+    mu_assert(f(path) == cursor, "Expected cursor to be reused");
+
     // Clean up.
     sky_qip_path_free(path);
-    sky_qip_cursor_free(cursor);
     qip_module_free(module);
     return 0;
 }
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <query_cache.h>
+#include <peach_message.h>
+#include <property.h>
+#include <mem.h>
+#include <dbg.h>
+
+#include "minunit.h"
+
+
+//==============================================================================
+//
+// Fixtures
+//
+//==============================================================================
+
+#define QUERY_TEXT \
+    "[Hashable(\"id\")]\n" \
+    "[Serializable]\n" \
+    "class Result {\n" \
+    "  public Int id;\n" \
+    "  public Int count;\n" \
+    "}\n" \
+    "Cursor cursor = path.events();\n" \
+    "for each (Event event in cursor) {\n" \
+    "  Result item = data.get(event.actionId);\n" \
+    "  item.count = item.count + %d;%s\n" \
+    "}\n" \
+    "return;"
+
+
+//==============================================================================
+//
+// Test Cases
+//
+//==============================================================================
+
+//--------------------------------------
+// Normalization
+//--------------------------------------
+
+int test_sky_query_cache_normalize() {
+    bstring key = NULL;
+    sky_qip_param *params = NULL;
+    uint32_t param_count = 0;
+    struct tagbstring query = bsStatic(
+        "Int x = 10;  // ten\n"
+        "Float y = 2.5; /* 1 */ String s = \"a \\\" 1\";\n"
+        "Int z = x + 10 + 300 + v2;"
+    );
+    mu_assert_int_equals(sky_query_cache_normalize(&query, &key, &params, &param_count), 0);
+    mu_assert_bstring(key, "Int x = 10; Float y = ?.?; String s = \"a \\\" 1\"; Int z = x + 10 + ? + v2;");
+    mu_assert_int_equals(param_count, 2);
+    mu_assert_bool(params[0].type == SKY_QIP_PARAM_FLOAT);
+    mu_assert_bool(params[0].float_value == 2.5);
+    mu_assert_bool(params[1].type == SKY_QIP_PARAM_INT);
+    mu_assert_long_equals(params[1].int_value, 300LL);
+    bdestroy(key);
+    free(params);
+    return 0;
+}
+
+
+//--------------------------------------
+// Modules
+//--------------------------------------
+
+int test_sky_query_cache_get_module() {
+    importtmp("tests/fixtures/peach_message/1/import.json");
+    sky_table *table = sky_table_create();
+    table->path = bfromcstr("tmp");
+    sky_table_open(table);
+    sky_query_cache *cache = sky_query_cache_create(table, 2);
+
+    // Queries that only differ by literals and formatting share a module.
+    bool cached = false;
+    sky_qip_module *module = NULL, *module2 = NULL;
+    bstring query = bformat(QUERY_TEXT, 1, "");
+    mu_assert_int_equals(sky_query_cache_get_module(cache, query, -1, &module, &cached), 0);
+    mu_assert_bool(cached);
+    bdestroy(query);
+    query = bformat(QUERY_TEXT, 2, "  // two");
+    mu_assert_int_equals(sky_query_cache_get_module(cache, query, -1, &module2, &cached), 0);
+    mu_assert_bool(cached);
+    mu_assert_bool(module == module2);
+    mu_assert_int_equals(cache->entry_count, 1);
+    mu_assert_long_equals(module->params[0].int_value, 2LL);
+    bdestroy(query);
+
+    // Action ids are looked up directly in the result map.
+    mu_assert_long_equals(module->map_key_count, 4LL);
+
+    // Cached modules return the same results as a fresh compile.
+    int32_t value;
+    for(value=1; value<=3; value++) {
+        sky_peach_message *message = sky_peach_message_create();
+        message->query = bformat(QUERY_TEXT, value, "");
+        table->query_cache = cache;
+        FILE *output = fopen("tmp/output_cached", "w");
+        mu_assert_int_equals(sky_peach_message_process(message, table, output), 0);
+        fclose(output);
+        table->query_cache = NULL;
+        output = fopen("tmp/output_compiled", "w");
+        mu_assert_int_equals(sky_peach_message_process(message, table, output), 0);
+        fclose(output);
+        mu_assert_file("tmp/output_cached", "tmp/output_compiled");
+        sky_peach_message_free(message);
+    }
+    mu_assert_int_equals(cache->entry_count, 1);
+
+    // Adding a property clears the cache.
+    sky_property *property = sky_property_create();
+    property->type = SKY_PROPERTY_TYPE_OBJECT;
+    property->data_type = bfromcstr("Int");
+    property->name = bfromcstr("new_prop");
+    mu_assert_int_equals(sky_property_file_add_property(table->property_file, property), 0);
+    query = bformat(QUERY_TEXT, 1, "");
+    mu_assert_int_equals(sky_query_cache_get_module(cache, query, -1, &module2, &cached), 0);
+    mu_assert_bool(cached);
+    mu_assert_int_equals(cache->entry_count, 1);
+    bdestroy(query);
+
+    // The least recently used module is dropped once the cache is full.
+    query = bformat(QUERY_TEXT, 1, " item.id = item.id;");
+    mu_assert_int_equals(sky_query_cache_get_module(cache, query, -1, &module, &cached), 0);
+    mu_assert_int_equals(sky_query_cache_get_module(cache, query, 0, &module, &cached), 0);
+    mu_assert_int_equals(cache->entry_count, 2);
+    mu_assert_bool(cache->entries[0].module == module || cache->entries[1].module == module);
+    bdestroy(query);
+
+    sky_query_cache_free(cache);
+    sky_table_free(table);
+    return 0;
+}
+
+
+//==============================================================================
+//
+// Setup
+//
+//==============================================================================
+
+int all_tests() {
+    mu_run_test(test_sky_query_cache_normalize);
+    mu_run_test(test_sky_query_cache_get_module);
+    return 0;
+}
+
+RUN_TESTS()
@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <sky_qip_module.h>
+#include <qip_path.h>
+#include <dbg.h>
+
+#include "minunit.h"
+
+
+//==============================================================================
+//
+// Fixtures
+//
+//==============================================================================
+
+#define RESULT_CLASS \
+    "[Hashable(\"id\")]\n" \
+    "class Result {\n" \
+    "  public Int id;\n" \
+    "  public Int count;\n" \
+    "}\n"
+
+struct Result {
+    int64_t hash_code;
+    int64_t id;
+    int64_t count;
+};
+
+typedef void (*sky_qip_path_map_func)(sky_qip_path *path, qip_map *map);
+
+// Compiles a query against a table with a given optimization level or the
+// compiler's default if it is -1.
+#define COMPILE_MODULE(TABLE, OPT_LEVEL, QUERY, MODULE) do {\
+    struct tagbstring _query = bsStatic(QUERY); \
+    MODULE = sky_qip_module_create(); \
+    MODULE->table = TABLE; \
+    if(OPT_LEVEL >= 0) MODULE->compiler->opt_level = OPT_LEVEL; \
+    mu_assert_int_equals(sky_qip_module_compile(MODULE, &_query), 0); \
+} while(0)
+
+// Asserts the number of keys that a query uses in its result map.
+#define ASSERT_MAP_KEY_COUNT(TABLE, QUERY, COUNT) do {\
+    sky_qip_module *_module = NULL; \
+    COMPILE_MODULE(TABLE, -1, RESULT_CLASS QUERY, _module); \
+    mu_assert_long_equals(_module->map_key_count, COUNT); \
+    sky_qip_module_free(_module); \
+} while(0)
+
+// Checks if a function has a basic block with a given name.
+bool has_basic_block(LLVMValueRef func, const char *name)
+{
+    LLVMBasicBlockRef block;
+    for(block=LLVMGetFirstBasicBlock(func); block!=NULL; block=LLVMGetNextBasicBlock(block)) {
+        if(strcmp(LLVMGetBasicBlockName(block), name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Adds an element to a result map.
+#define ADD_RESULT(MODULE, MAP, KEY, COUNT) do {\
+    struct Result *_result = qip_map_elalloc(MODULE, MAP); \
+    _result->hash_code = _result->id = KEY; \
+    _result->count = COUNT; \
+    qip_map_refresh(MODULE, MAP); \
+} while(0)
+
+// Asserts the count of an element in a result map.
+#define ASSERT_RESULT(MODULE, MAP, KEY, COUNT) do {\
+    struct Result *_result = qip_map_find(MODULE, MAP, KEY); \
+    mu_assert(_result != NULL, "Expected result"); \
+    mu_assert_long_equals(_result->count, COUNT); \
+} while(0)
+
+
+//==============================================================================
+//
+// Test Cases
+//
+//==============================================================================
+
+//--------------------------------------
+// Map Keys
+//--------------------------------------
+
+int test_sky_qip_module_get_map_key_count() {
+    importtmp("tests/fixtures/peach_message/1/import.json");
+    sky_table *table = sky_table_create();
+    table->path = bfromcstr("tmp");
+    mu_assert_int_equals(sky_table_open(table), 0);
+
+    // Action ids are bounded by the last action id.
+    ASSERT_MAP_KEY_COUNT(table,
+        "Cursor cursor = path.events();\n"
+        "for each (Event event in cursor) {\n"
+        "  Result item = data.get(event.actionId);\n"
+        "  item.count = item.count + 1;\n"
+        "}\n"
+        "return;",
+        4LL
+    );
+
+    // Unbounded lookups use the hash table alongside bounded ones.
+    ASSERT_MAP_KEY_COUNT(table,
+        "Cursor cursor = path.events();\n"
+        "for each (Event event in cursor) {\n"
+        "  Result item = data.get(event.object_prop);\n"
+        "  item = data.find(event.actionId);\n"
+        "}\n"
+        "return;",
+        4LL
+    );
+
+    // Other keys are unbounded.
+    ASSERT_MAP_KEY_COUNT(table,
+        "Cursor cursor = path.events();\n"
+        "for each (Event event in cursor) {\n"
+        "  Result item = data.get(event.object_prop);\n"
+        "  item = data.get(event.actionId + 1);\n"
+        "  item = data.get(10);\n"
+        "}\n"
+        "return;",
+        0LL
+    );
+    ASSERT_MAP_KEY_COUNT(table, "return;", 0LL);
+
+    sky_table_free(table);
+    return 0;
+}
+
+
+//--------------------------------------
+// Map Find
+//--------------------------------------
+
+int test_sky_qip_module_codegen_map_find() {
+    importtmp("tests/fixtures/peach_message/1/import.json");
+    sky_table *table = sky_table_create();
+    table->path = bfromcstr("tmp");
+    mu_assert_int_equals(sky_table_open(table), 0);
+
+    int opt_level;
+    for(opt_level=0; opt_level<=QIP_OPT_LEVEL_MAX; opt_level++) {
+        sky_qip_module *module = NULL;
+        COMPILE_MODULE(table, opt_level,
+            RESULT_CLASS
+            "Result item = data.get(2);\n"
+            "item.count = item.count + 1;\n"
+            "item = data.get(1);\n"
+            "item.count = item.count + 1;\n"
+            "item = data.get(0 - 3);\n"
+            "item.count = item.count + 1;\n"
+            "item = data.get(100);\n"
+            "item.count = item.count + 1;\n"
+            "return;",
+            module
+        );
+        qip_module *qmodule = module->_qip_module;
+
+        // Unoptimized modules keep the generated lookup as its own function.
+        if(opt_level == 0) {
+            LLVMValueRef find = LLVMGetNamedFunction(qmodule->llvm_module, "Map<Int,Result>.find");
+            mu_assert(find != NULL, "Expected Map<Int,Result>.find()");
+            mu_assert(has_basic_block(find, "dense"), "Expected inline dense lookup");
+            mu_assert(has_basic_block(find, "hash"), "Expected hash lookup fallback");
+            unsigned int kind = LLVMGetEnumAttributeKindForName("alwaysinline", 12);
+            mu_assert(LLVMGetEnumAttributeAtIndex(find, LLVMAttributeFunctionIndex, kind) != NULL, "Expected alwaysinline");
+        }
+
+        // Existing elements are found in the dense table and by hashing.
+        qip_map *map = qip_map_create();
+        map->elemsz = sizeof(struct Result);
+        mu_assert_int_equals(qip_map_set_dense_count(map, 4), 0);
+        ADD_RESULT(qmodule, map, 2, 10);
+        ADD_RESULT(qmodule, map, -3, 20);
+        ADD_RESULT(qmodule, map, 100, 30);
+
+        sky_qip_path *path = sky_qip_path_create();
+        sky_qip_path_map_func f = (sky_qip_path_map_func)module->main_function;
+        f(path, map);
+        f(path, map);
+        mu_assert_long_equals(map->count, 4LL);
+        mu_assert(map->dense[1] != NULL && map->dense[2] != NULL, "Expected dense elements");
+        ASSERT_RESULT(qmodule, map, 2, 12LL);
+        ASSERT_RESULT(qmodule, map, 1, 2LL);
+        ASSERT_RESULT(qmodule, map, -3, 22LL);
+        ASSERT_RESULT(qmodule, map, 100, 32LL);
+        qip_map_free(map);
+
+        // Maps without a dense table hash every key.
+        map = qip_map_create();
+        f(path, map);
+        f(path, map);
+        mu_assert_long_equals(map->count, 4LL);
+        mu_assert_long_equals(map->indexed_count, 4LL);
+        ASSERT_RESULT(qmodule, map, 2, 2LL);
+        ASSERT_RESULT(qmodule, map, -3, 2LL);
+        qip_map_free(map);
+
+        sky_qip_path_free(path);
+        sky_qip_module_free(module);
+    }
+
+    sky_table_free(table);
+    return 0;
+}
+
+
+//==============================================================================
+//
+// Setup
+//
+//==============================================================================
+
+int all_tests() {
+    mu_run_test(test_sky_qip_module_get_map_key_count);
+    mu_run_test(test_sky_qip_module_codegen_map_find);
+    return 0;
+}
+
+RUN_TESTS()
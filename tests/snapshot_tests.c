@@ -0,0 +1,287 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <snapshot.h>
+#include <path_iterator.h>
+#include <cursor.h>
+#include <mem.h>
+
+#include "minunit.h"
+
+
+//==============================================================================
+//
+// Helpers
+//
+//==============================================================================
+
+#define INIT_DATA_FILE() \
+    cleantmp(); \
+    data_file = sky_data_file_create(); \
+    data_file->block_size = 64; \
+    data_file->large_path_threshold = 40; \
+    data_file->path = bfromcstr("tmp/data"); \
+    data_file->header_path = bfromcstr("tmp/header"); \
+    data_file->extent_path = bfromcstr("tmp/extents"); \
+    mu_assert_int_equals(sky_data_file_load(data_file), 0);
+
+#define ADD_EVENT(OBJECT_ID, TIMESTAMP, ACTION_ID) do { \
+    sky_event *event = sky_event_create(OBJECT_ID, TIMESTAMP, ACTION_ID); \
+    mu_assert_int_equals(sky_data_file_add_event(data_file, event), 0); \
+    sky_event_free(event); \
+} while (0)
+
+#define ADD_MEMTABLE_EVENT(OBJECT_ID, TIMESTAMP, ACTION_ID) do { \
+    sky_event *event = sky_event_create(OBJECT_ID, TIMESTAMP, ACTION_ID); \
+    mu_assert_int_equals(sky_memtable_add_event(memtable, event), 0); \
+    sky_event_free(event); \
+} while (0)
+
+#define ASSERT_SCAN(ITERATOR, EXPECTED) do { \
+    char _str[1024]; \
+    mu_assert_int_equals(scan(ITERATOR, _str), 0); \
+    mu_assert_with_msg(strcmp(_str, EXPECTED) == 0, "Expected: %s; Received: %s", EXPECTED, _str); \
+} while (0)
+
+// Writes the object id and event count of every path in an iterator to a
+// string as "id:count" pairs.
+int scan(sky_path_iterator *iterator, char *str)
+{
+    str[0] = '\0';
+    while(!iterator->eof) {
+        void *ptr;
+        if(sky_path_iterator_get_ptr(iterator, &ptr) != 0) return -1;
+
+        sky_cursor cursor;
+        sky_cursor_init(&cursor);
+        sky_cursor_set_path(&cursor, ptr);
+        uint32_t count = 0;
+        while(!cursor.eof) {
+            count++;
+            sky_cursor_next(&cursor);
+        }
+        sky_cursor_set_path(&cursor, NULL);
+
+        sprintf(str + strlen(str), "%s%lld:%d", (str[0] ? " " : ""), (long long)iterator->current_object_id, count);
+        if(sky_path_iterator_next(iterator) != 0) return -1;
+    }
+    return 0;
+}
+
+
+//==============================================================================
+//
+// Test Cases
+//
+//==============================================================================
+
+//--------------------------------------
+// Blocks
+//--------------------------------------
+
+int test_sky_snapshot_block_split() {
+    sky_data_file *data_file;
+    sky_path_iterator iterator;
+    INIT_DATA_FILE();
+    data_file->large_path_threshold = 0;
+    ADD_EVENT(1, 1LL, 20);
+    ADD_EVENT(2, 1LL, 20);
+    ADD_EVENT(3, 1LL, 20);
+    mu_assert_int_equals(data_file->block_count, 1);
+
+    sky_snapshot *snapshot = sky_snapshot_create();
+    mu_assert_int_equals(sky_snapshot_open(snapshot, data_file, NULL), 0);
+    mu_assert(data_file->snapshots == snapshot, "");
+
+    // Split the block while the snapshot is open.
+    int64_t i;
+    ADD_EVENT(1, 2LL, 20);
+    for(i=4; i<10; i++) {
+        ADD_EVENT(i, 1LL, 20);
+    }
+    mu_assert_bool(data_file->block_count > 1);
+    mu_assert(snapshot->blocks[0].data != NULL, "Expected block to be preserved");
+
+    sky_path_iterator_init(&iterator);
+    mu_assert_int_equals(sky_path_iterator_set_snapshot(&iterator, snapshot), 0);
+    ASSERT_SCAN(&iterator, "1:1 2:1 3:1");
+    mu_assert_int_equals(sky_path_iterator_set_data_file(&iterator, data_file), 0);
+    ASSERT_SCAN(&iterator, "1:2 2:1 3:1 4:1 5:1 6:1 7:1 8:1 9:1");
+
+    // Closing the snapshot frees the preserved block.
+    mu_assert_int_equals(sky_snapshot_close(snapshot), 0);
+    mu_assert(data_file->snapshots == NULL, "");
+    mu_assert(snapshot->blocks == NULL, "");
+
+    sky_snapshot_free(snapshot);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+
+//--------------------------------------
+// Extents
+//--------------------------------------
+
+int test_sky_snapshot_extent() {
+    sky_data_file *data_file;
+    sky_path_iterator iterator;
+    INIT_DATA_FILE();
+    ADD_EVENT(1, 1LL, 20);
+    int64_t i;
+    for(i=1; i<5; i++) {
+        ADD_EVENT(2, i, 20);
+    }
+    mu_assert_int_equals(data_file->extent_count, 1);
+
+    // A second snapshot opened later sees the events added in between.
+    sky_snapshot *snapshot1 = sky_snapshot_create();
+    mu_assert_int_equals(sky_snapshot_open(snapshot1, data_file, NULL), 0);
+    ADD_EVENT(2, 5LL, 20);
+    sky_snapshot *snapshot2 = sky_snapshot_create();
+    mu_assert_int_equals(sky_snapshot_open(snapshot2, data_file, NULL), 0);
+    for(i=6; i<20; i++) {
+        ADD_EVENT(2, i, 20);
+    }
+    ADD_EVENT(1, 2LL, 20);
+
+    sky_path_iterator_init(&iterator);
+    mu_assert_int_equals(sky_path_iterator_set_snapshot(&iterator, snapshot1), 0);
+    ASSERT_SCAN(&iterator, "1:1 2:4");
+    mu_assert_int_equals(sky_path_iterator_set_snapshot(&iterator, snapshot2), 0);
+    ASSERT_SCAN(&iterator, "1:1 2:5");
+    mu_assert_int_equals(sky_path_iterator_set_data_file(&iterator, data_file), 0);
+    ASSERT_SCAN(&iterator, "1:2 2:19");
+
+    sky_snapshot_free(snapshot1);
+    mu_assert(data_file->snapshots == snapshot2, "");
+    sky_snapshot_free(snapshot2);
+    mu_assert(data_file->snapshots == NULL, "");
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+
+//--------------------------------------
+// Memtable
+//--------------------------------------
+
+int test_sky_snapshot_memtable() {
+    sky_data_file *data_file;
+    sky_path_iterator iterator;
+    INIT_DATA_FILE();
+    ADD_EVENT(1, 1LL, 20);
+
+    sky_memtable *memtable = sky_memtable_create();
+    ADD_MEMTABLE_EVENT(3, 1LL, 20);
+    ADD_MEMTABLE_EVENT(1, 2LL, 20);
+
+    sky_snapshot *snapshot = sky_snapshot_create();
+    mu_assert_int_equals(sky_snapshot_open(snapshot, data_file, memtable), 0);
+
+    // Flushing the memtable doesn't change the snapshot's copy.
+    ADD_MEMTABLE_EVENT(2, 1LL, 20);
+    mu_assert_int_equals(sky_memtable_flush(memtable, data_file), 0);
+
+    sky_path_iterator_init(&iterator);
+    mu_assert_int_equals(sky_path_iterator_set_snapshot(&iterator, snapshot), 0);
+    ASSERT_SCAN(&iterator, "1:2 3:1");
+    mu_assert_int_equals(sky_path_iterator_set_data_file(&iterator, data_file), 0);
+    ASSERT_SCAN(&iterator, "1:2 2:1 3:1");
+
+    sky_snapshot_free(snapshot);
+    sky_memtable_free(memtable);
+    sky_data_file_free(data_file);
+    return 0;
+}
+
+
+//--------------------------------------
+// Partitions
+//--------------------------------------
+
+int test_sky_snapshot_partitions() {
+    void *ptr;
+    sky_data_file *data_file;
+    sky_path_iterator iterator;
+    INIT_DATA_FILE();
+    ADD_EVENT(1, 1LL, 20);
+    ADD_EVENT(2, 2LL, 20);
+    sky_data_file *data_file1 = data_file;
+
+    data_file = sky_data_file_create();
+    data_file->path = bfromcstr("tmp/data2");
+    data_file->header_path = bfromcstr("tmp/header2");
+    mu_assert_int_equals(sky_data_file_load(data_file), 0);
+    ADD_EVENT(1, 11LL, 21);
+    ADD_EVENT(3, 12LL, 20);
+    sky_data_file *data_file2 = data_file;
+
+    sky_memtable *memtable = sky_memtable_create();
+    ADD_MEMTABLE_EVENT(1, 5LL, 22);
+    ADD_MEMTABLE_EVENT(4, 13LL, 20);
+
+    sky_snapshot *snapshots[2];
+    snapshots[0] = sky_snapshot_create();
+    mu_assert_int_equals(sky_snapshot_open(snapshots[0], data_file1, NULL), 0);
+    snapshots[1] = sky_snapshot_create();
+    mu_assert_int_equals(sky_snapshot_open(snapshots[1], data_file2, memtable), 0);
+
+    sky_path_iterator_init(&iterator);
+    mu_assert_int_equals(sky_path_iterator_set_partitions(&iterator, snapshots, 2), 0);
+    mu_assert_int_equals(iterator.current_object_id, 1);
+
+    // Paths in several partitions are merged by timestamp.
+    mu_assert_int_equals(sky_path_iterator_get_ptr(&iterator, &ptr), 0);
+    mu_assert(ptr == iterator.buffer, "");
+    sky_cursor cursor;
+    sky_cursor_init(&cursor);
+    sky_cursor_set_path(&cursor, ptr);
+    sky_action_id_t action_ids[] = {20, 22, 21};
+    int i;
+    for(i=0; i<3; i++) {
+        sky_action_id_t action_id;
+        mu_assert_bool(!cursor.eof);
+        mu_assert_int_equals(sky_cursor_get_action_id(&cursor, &action_id), 0);
+        mu_assert_int_equals(action_id, action_ids[i]);
+        sky_cursor_next(&cursor);
+    }
+    mu_assert_bool(cursor.eof);
+    sky_cursor_set_path(&cursor, NULL);
+
+    // Paths in one partition are returned as-is.
+    mu_assert_int_equals(sky_path_iterator_next(&iterator), 0);
+    mu_assert_int_equals(iterator.current_object_id, 2);
+    mu_assert_int_equals(sky_path_iterator_get_ptr(&iterator, &ptr), 0);
+    mu_assert(ptr != iterator.buffer, "");
+
+    mu_assert_int_equals(sky_path_iterator_set_partitions(&iterator, snapshots, 2), 0);
+    ASSERT_SCAN(&iterator, "1:3 2:1 3:1 4:1");
+
+    mu_assert_int_equals(sky_path_iterator_set_partitions(&iterator, NULL, 0), 0);
+    mu_assert(iterator.partitions == NULL, "");
+    mu_assert(iterator.buffer == NULL, "");
+    sky_snapshot_free(snapshots[0]);
+    sky_snapshot_free(snapshots[1]);
+    sky_memtable_free(memtable);
+    sky_data_file_free(data_file1);
+    sky_data_file_free(data_file2);
+    return 0;
+}
+
+
+//==============================================================================
+//
+// Setup
+//
+//==============================================================================
+
+int all_tests() {
+    mu_run_test(test_sky_snapshot_block_split);
+    mu_run_test(test_sky_snapshot_extent);
+    mu_run_test(test_sky_snapshot_memtable);
+    mu_run_test(test_sky_snapshot_partitions);
+    return 0;
+}
+
+RUN_TESTS()
@@ -2,10 +2,12 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
+#include <sys/stat.h>
 
 #include <dbg.h>
 #include <table.h>
 #include <bstring.h>
+#include <file.h>
 
 #include "minunit.h"
 
@@ -49,6 +51,234 @@ int test_sky_table_open() {
 }
 
 
+//--------------------------------------
+// Memtable
+//--------------------------------------
+
+int test_sky_table_memtable() {
+    cleantmp();
+
+    int rc;
+    bool ret;
+    sky_table *table = sky_table_create();
+    table->path = bfromcstr("tmp");
+    table->memtable_size = 64;
+    rc = sky_table_open(table);
+    mu_assert_int_equals(rc, 0);
+
+    // Events are held until the memtable is full.
+    sky_event *event = sky_event_create(10, 1000LL, 20);
+    rc = sky_table_add_event(table, event);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_int_equals(table->memtable->entry_count, 1);
+    uint32_t block_count = table->data_file->block_count;
+    rc = sky_data_file_contains_event(table->data_file, event, &ret);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_bool(!ret);
+    mu_assert_int_equals(table->data_file->block_count, block_count);
+
+    // Closing the table flushes the memtable.
+    rc = sky_table_close(table);
+    mu_assert_int_equals(rc, 0);
+    table->memtable_size = 0;
+    rc = sky_table_open(table);
+    mu_assert_int_equals(rc, 0);
+    rc = sky_data_file_contains_event(table->data_file, event, &ret);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_bool(ret);
+    rc = sky_table_close(table);
+    mu_assert_int_equals(rc, 0);
+
+    sky_event_free(event);
+    sky_table_free(table);
+    return 0;
+}
+
+
+int test_sky_table_deferred_memtable_flush() {
+    cleantmp();
+
+    int rc;
+    bool ret;
+    sky_table *table = sky_table_create();
+    table->path = bfromcstr("tmp");
+    table->memtable_size = 16;
+    table->defer_memtable_flush = true;
+    rc = sky_table_open(table);
+    mu_assert_int_equals(rc, 0);
+
+    // A full memtable is left in place by the insert.
+    sky_event *event = sky_event_create(10, 1000LL, 20);
+    rc = sky_table_add_event(table, event);
+    mu_assert_int_equals(rc, 0);
+    rc = sky_table_add_event(table, event);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_bool(table->memtable->data_length >= table->memtable_size);
+    mu_assert_int_equals(table->memtable->entry_count, 2);
+
+    // The owner flushes it afterwards.
+    rc = sky_table_flush_full_memtable(table);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_int_equals(table->memtable->entry_count, 0);
+    rc = sky_data_file_contains_event(table->data_file, event, &ret);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_bool(ret);
+
+    // A memtable that isn't full is left alone.
+    rc = sky_table_add_event(table, event);
+    mu_assert_int_equals(rc, 0);
+    rc = sky_table_flush_full_memtable(table);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_int_equals(table->memtable->entry_count, 1);
+
+    rc = sky_table_close(table);
+    mu_assert_int_equals(rc, 0);
+    sky_event_free(event);
+    sky_table_free(table);
+    return 0;
+}
+
+
+//--------------------------------------
+// Partitions
+//--------------------------------------
+
+int test_sky_table_partitions() {
+    cleantmp();
+
+    int rc;
+    bool ret;
+    uint32_t count;
+    sky_data_file *data_file;
+    sky_table *table = sky_table_create();
+    table->path = bfromcstr("tmp");
+    table->partition_duration = 10LL;
+    rc = sky_table_open(table);
+    mu_assert_int_equals(rc, 0);
+
+    // Events are added to the partition that holds their timestamp.
+    sky_event *events[3];
+    events[0] = sky_event_create(10, 25LL, 20);
+    events[1] = sky_event_create(10, 5LL, 20);
+    events[2] = sky_event_create(11, 15LL, 20);
+    rc = sky_table_add_events(table, events, 3);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_int_equals(table->partition_count, 3);
+    mu_assert_long_equals((long)table->partitions[0].index, 0L);
+    mu_assert_long_equals((long)table->partitions[2].index, 2L);
+    rc = sky_data_file_contains_event(table->data_file, events[2], &ret);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_bool(!ret);
+    rc = sky_data_file_contains_event(table->partitions[1].data_file, events[2], &ret);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_bool(ret);
+    struct tagbstring partition_path = bsStatic("tmp/partitions/1/data");
+    mu_assert_bool(sky_file_exists(&partition_path));
+
+    // Partitions are found on open but only loaded when they are used.
+    rc = sky_table_close(table);
+    mu_assert_int_equals(rc, 0);
+    rc = sky_table_open(table);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_int_equals(table->partition_count, 3);
+    mu_assert(table->partitions[0].data_file == NULL, "");
+    rc = sky_table_get_partition(table, 29LL, false, &data_file);
+    mu_assert_int_equals(rc, 0);
+    mu_assert(data_file == table->partitions[2].data_file, "");
+    mu_assert(table->partitions[0].data_file == NULL, "");
+    rc = sky_data_file_contains_event(data_file, events[0], &ret);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_bool(ret);
+    rc = sky_table_get_partition(table, 35LL, false, &data_file);
+    mu_assert_int_equals(rc, 0);
+    mu_assert(data_file == NULL, "");
+
+    // Dropping removes every partition that ends before the cutoff.
+    rc = sky_table_drop_partitions(table, 20LL, &count);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_int_equals(count, 2);
+    mu_assert_int_equals(table->partition_count, 1);
+    mu_assert_long_equals((long)table->partitions[0].index, 2L);
+    mu_assert_bool(!sky_file_exists(&partition_path));
+
+    rc = sky_table_close(table);
+    mu_assert_int_equals(rc, 0);
+
+    int i;
+    for(i=0; i<3; i++) {
+        sky_event_free(events[i]);
+    }
+    sky_table_free(table);
+    return 0;
+}
+
+
+int test_sky_table_add_events_partial_failure() {
+    cleantmp();
+
+    int rc;
+    bool ret;
+    uint32_t count;
+    sky_event **wal_events;
+    sky_data_file *data_file;
+    sky_table *table = sky_table_create();
+    table->path = bfromcstr("tmp");
+    table->partition_duration = 10LL;
+    rc = sky_table_open(table);
+    mu_assert_int_equals(rc, 0);
+
+    // Block the second partition with a file where its directory goes.
+    mkdir("tmp/partitions", S_IRWXU);
+    FILE *file = fopen("tmp/partitions/2", "w");
+    fclose(file);
+
+    // The first partition is applied and only its records are kept.
+    sky_event *events[3];
+    events[0] = sky_event_create(10, 25LL, 20);
+    events[1] = sky_event_create(10, 5LL, 20);
+    events[2] = sky_event_create(11, 6LL, 20);
+    rc = sky_table_add_events(table, events, 3);
+    mu_assert_int_equals(rc, -1);
+    rc = sky_table_get_partition(table, 5LL, false, &data_file);
+    mu_assert_int_equals(rc, 0);
+    rc = sky_data_file_contains_event(data_file, events[2], &ret);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_bool(ret);
+    mu_assert_int64_equals(table->wal->lsn, 2LL);
+    mu_assert_int64_equals(sky_wal_get_applied_lsn(table->wal), 2LL);
+    mu_assert_long_equals(table->wal->buffer_length, 0L);
+    mu_assert_int_equals(table->wal->pending_count, 0);
+
+    // The committed records are the applied events.
+    sky_wal_set_applied_lsn(table->wal, 0);
+    rc = sky_wal_read_events(table->wal, &wal_events, &count);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_int_equals(count, 2);
+    mu_assert_int64_equals(wal_events[0]->timestamp, 5LL);
+    mu_assert_int64_equals(wal_events[1]->timestamp, 6LL);
+    sky_event_free(wal_events[0]);
+    sky_event_free(wal_events[1]);
+    free(wal_events);
+    sky_wal_set_applied_lsn(table->wal, 2);
+
+    // The failed event can be added once the partition is available.
+    unlink("tmp/partitions/2");
+    rc = sky_table_add_events(table, events, 1);
+    mu_assert_int_equals(rc, 0);
+    mu_assert_int64_equals(table->wal->lsn, 3LL);
+
+    rc = sky_table_close(table);
+    mu_assert_int_equals(rc, 0);
+
+    int i;
+    for(i=0; i<3; i++) {
+        sky_event_free(events[i]);
+    }
+    sky_table_free(table);
+    return 0;
+}
+
+
 //==============================================================================
 //
 // Setup
@@ -57,6 +287,10 @@ int test_sky_table_open() {
 
 int all_tests() {
     mu_run_test(test_sky_table_open);
+    mu_run_test(test_sky_table_memtable);
+    mu_run_test(test_sky_table_deferred_memtable_flush);
+    mu_run_test(test_sky_table_partitions);
+    mu_run_test(test_sky_table_add_events_partial_failure);
     return 0;
 }
 
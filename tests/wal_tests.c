@@ -0,0 +1,271 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <dbg.h>
+#include <mem.h>
+#include <wal.h>
+#include <data_file.h>
+#include <path.h>
+#include <path_iterator.h>
+
+#include "minunit.h"
+
+
+//==============================================================================
+//
+// Helpers
+//
+//==============================================================================
+
+#define INIT_WAL() \
+    cleantmp(); \
+    wal = sky_wal_create(); \
+    wal->path = bfromcstr("tmp/wal"); \
+    mu_assert_int_equals(sky_wal_open(wal), 0);
+
+#define INIT_DATA_FILE() \
+    data_file = sky_data_file_create(); \
+    data_file->block_size = 64; \
+    data_file->path = bfromcstr("tmp/data"); \
+    data_file->header_path = bfromcstr("tmp/header"); \
+    mu_assert_int_equals(sky_data_file_load(data_file), 0);
+
+#define APPEND_EVENT(OBJECT_ID, TIMESTAMP, ACTION_ID) do { \
+    sky_event *event = sky_event_create(OBJECT_ID, TIMESTAMP, ACTION_ID); \
+    mu_assert_int_equals(sky_wal_append(wal, event), 0); \
+    sky_event_free(event); \
+} while (0)
+
+#define ASSERT_CONTAINS_EVENT(OBJECT_ID, TIMESTAMP, ACTION_ID, EXPECTED) do { \
+    bool _ret = !EXPECTED; \
+    sky_event *event = sky_event_create(OBJECT_ID, TIMESTAMP, ACTION_ID); \
+    mu_assert_int_equals(sky_data_file_contains_event(data_file, event, &_ret), 0); \
+    mu_assert(_ret == EXPECTED, ""); \
+    sky_event_free(event); \
+} while (0)
+
+
+//==============================================================================
+//
+// Test Cases
+//
+//==============================================================================
+
+//--------------------------------------
+// Logging
+//--------------------------------------
+
+int test_sky_wal_open() {
+    sky_wal *wal;
+    INIT_WAL();
+    mu_assert_long_equals(wal->length, 32L);
+    APPEND_EVENT(3LL, 11LL, 20);
+    APPEND_EVENT(3LL, 12LL, 20);
+    mu_assert_int_equals(sky_wal_commit(wal), 0);
+    sky_wal_set_applied_lsn(wal, 1);
+    sky_wal_free(wal);
+
+    // Reopening continues numbering after the last record.
+    wal = sky_wal_create();
+    wal->path = bfromcstr("tmp/wal");
+    mu_assert_int_equals(sky_wal_open(wal), 0);
+    mu_assert_long_equals(wal->length, 94L);
+    mu_assert_int64_equals(wal->lsn, 2LL);
+    mu_assert_int64_equals(sky_wal_get_applied_lsn(wal), 1LL);
+    sky_wal_free(wal);
+    return 0;
+}
+
+int test_sky_wal_open_after_reboot() {
+    uint32_t count;
+    sky_event **events;
+    sky_wal *wal;
+    INIT_WAL();
+    APPEND_EVENT(3LL, 11LL, 20);
+    mu_assert_int_equals(sky_wal_commit(wal), 0);
+    sky_wal_set_applied_lsn(wal, 1);
+    mu_assert_int_equals(sky_wal_truncate(wal), 0);
+    APPEND_EVENT(3LL, 12LL, 20);
+    APPEND_EVENT(3LL, 13LL, 20);
+    mu_assert_int_equals(sky_wal_commit(wal), 0);
+    sky_wal_set_applied_lsn(wal, 3);
+    sky_wal_free(wal);
+
+    // Simulate a log header written during an earlier boot.
+    uint64_t boot_id = 1;
+    int fd = open("tmp/wal", O_WRONLY);
+    mu_assert_bool(fd != -1);
+    mu_assert_bool(pwrite(fd, &boot_id, sizeof(boot_id), SKY_WAL_HEADER_BOOT_ID_OFFSET) == sizeof(boot_id));
+    close(fd);
+
+    // Records applied since the checkpoint are replayed.
+    wal = sky_wal_create();
+    wal->path = bfromcstr("tmp/wal");
+    mu_assert_int_equals(sky_wal_open(wal), 0);
+    mu_assert_int64_equals(wal->lsn, 3LL);
+    mu_assert_int64_equals(sky_wal_get_checkpoint_lsn(wal), 1LL);
+    mu_assert_int64_equals(sky_wal_get_applied_lsn(wal), 1LL);
+    mu_assert_int_equals(sky_wal_read_events(wal, &events, &count), 0);
+    mu_assert_int_equals(count, 2);
+    mu_assert_int64_equals(events[0]->timestamp, 12LL);
+    mu_assert_int64_equals(events[1]->timestamp, 13LL);
+    sky_event_free(events[0]);
+    sky_event_free(events[1]);
+    free(events);
+    sky_wal_free(wal);
+    return 0;
+}
+
+int test_sky_wal_commit() {
+    sky_wal *wal;
+    INIT_WAL();
+    APPEND_EVENT(3LL, 11LL, 20);
+    mu_assert_long_equals(wal->buffer_length, 31L);
+    mu_assert_int_equals(sky_wal_commit(wal), 0);
+    mu_assert_int_equals(wal->pending_count, 0);
+    mu_assert_long_equals(wal->buffer_length, 0L);
+    mu_assert_long_equals(wal->length, 63L);
+    APPEND_EVENT(3LL, 12LL, 20);
+    mu_assert_int_equals(sky_wal_commit(wal), 0);
+    mu_assert_int_equals(wal->pending_count, 0);
+    mu_assert_long_equals(wal->length, 94L);
+    mu_assert_int64_equals(wal->lsn, 2LL);
+
+    // Records can only be truncated once they've been applied.
+    mu_assert_int_equals(sky_wal_truncate(wal), -1);
+    sky_wal_set_applied_lsn(wal, 2);
+    mu_assert_int64_equals(sky_wal_get_checkpoint_lsn(wal), 0LL);
+    mu_assert_int_equals(sky_wal_truncate(wal), 0);
+    mu_assert_long_equals(wal->length, 32L);
+    mu_assert_int64_equals(wal->lsn, 2LL);
+    mu_assert_int64_equals(sky_wal_get_checkpoint_lsn(wal), 2LL);
+    sky_wal_free(wal);
+    return 0;
+}
+
+int test_sky_wal_rollback() {
+    sky_wal *wal;
+    INIT_WAL();
+    APPEND_EVENT(3LL, 11LL, 20);
+    mu_assert_int_equals(sky_wal_commit(wal), 0);
+    APPEND_EVENT(3LL, 12LL, 20);
+    APPEND_EVENT(3LL, 13LL, 20);
+    mu_assert_int64_equals(wal->lsn, 3LL);
+    mu_assert_int_equals(wal->pending_count, 2);
+    mu_assert_int_equals(sky_wal_rollback(wal), 0);
+    mu_assert_int64_equals(wal->lsn, 1LL);
+    mu_assert_int_equals(wal->pending_count, 0);
+    mu_assert_long_equals(wal->buffer_length, 0L);
+    mu_assert_int_equals(sky_wal_commit(wal), 0);
+    mu_assert_long_equals(wal->length, 63L);
+
+    // Only the committed record is read back.
+    uint32_t count;
+    sky_event **events;
+    mu_assert_int_equals(sky_wal_read_events(wal, &events, &count), 0);
+    mu_assert_int_equals(count, 1);
+    mu_assert_int64_equals(events[0]->timestamp, 11LL);
+    sky_event_free(events[0]);
+    free(events);
+    sky_wal_free(wal);
+    return 0;
+}
+
+
+//--------------------------------------
+// Recovery
+//--------------------------------------
+
+int test_sky_wal_replay() {
+    void *ptr;
+    uint32_t count;
+    sky_wal *wal;
+    sky_data_file *data_file;
+    INIT_WAL();
+    APPEND_EVENT(3LL, 11LL, 20);
+    APPEND_EVENT(3LL, 11LL, 20);
+    APPEND_EVENT(10LL, 12LL, 21);
+    mu_assert_int_equals(sky_wal_sync(wal), 0);
+    INIT_DATA_FILE();
+
+    // Replay into an empty data file. Identical events are both kept.
+    mu_assert_int_equals(sky_wal_replay(wal, data_file, &count), 0);
+    mu_assert_int_equals(count, 3);
+    mu_assert_int64_equals(sky_wal_get_applied_lsn(wal), 3LL);
+    ASSERT_CONTAINS_EVENT(3LL, 11LL, 20, true);
+    ASSERT_CONTAINS_EVENT(10LL, 12LL, 21, true);
+    ASSERT_CONTAINS_EVENT(10LL, 12LL, 22, false);
+    sky_event *event = sky_event_create(3LL, 11LL, 20);
+    sky_path_iterator *iterator = sky_path_iterator_create();
+    sky_path_iterator_set_data_file(iterator, data_file);
+    mu_assert_int_equals(sky_path_iterator_get_ptr(iterator, &ptr), 0);
+    mu_assert_long_equals(sky_path_sizeof_raw(ptr), (long)(SKY_PATH_HEADER_LENGTH + (sky_event_sizeof(event) * 2)));
+    sky_path_iterator_free(iterator);
+    sky_event_free(event);
+
+    // Replaying again should not duplicate events.
+    mu_assert_int_equals(sky_wal_replay(wal, data_file, &count), 0);
+    mu_assert_int_equals(count, 0);
+
+    // Only records after the applied LSN are replayed.
+    APPEND_EVENT(10LL, 13LL, 21);
+    mu_assert_int_equals(sky_wal_sync(wal), 0);
+    mu_assert_int_equals(sky_wal_replay(wal, data_file, &count), 0);
+    mu_assert_int_equals(count, 1);
+    ASSERT_CONTAINS_EVENT(10LL, 13LL, 21, true);
+
+    sky_data_file_free(data_file);
+    sky_wal_free(wal);
+    return 0;
+}
+
+int test_sky_wal_replay_with_torn_record() {
+    uint32_t count;
+    sky_wal *wal;
+    sky_data_file *data_file;
+    INIT_WAL();
+    APPEND_EVENT(3LL, 11LL, 20);
+    mu_assert_int_equals(sky_wal_sync(wal), 0);
+    sky_wal_free(wal);
+
+    // Simulate a partially written record.
+    FILE *file = fopen("tmp/wal", "a");
+    fwrite("\x20\x00\x00\x00\x01\x02", 6, 1, file);
+    fclose(file);
+
+    // The torn record is removed when the log is opened.
+    wal = sky_wal_create();
+    wal->path = bfromcstr("tmp/wal");
+    mu_assert_int_equals(sky_wal_open(wal), 0);
+    mu_assert_long_equals(wal->length, 63L);
+    mu_assert_int64_equals(wal->lsn, 1LL);
+    INIT_DATA_FILE();
+    mu_assert_int_equals(sky_wal_replay(wal, data_file, &count), 0);
+    mu_assert_int_equals(count, 1);
+    ASSERT_CONTAINS_EVENT(3LL, 11LL, 20, true);
+
+    sky_data_file_free(data_file);
+    sky_wal_free(wal);
+    return 0;
+}
+
+
+//==============================================================================
+//
+// Setup
+//
+//==============================================================================
+
+int all_tests() {
+    mu_run_test(test_sky_wal_open);
+    mu_run_test(test_sky_wal_open_after_reboot);
+    mu_run_test(test_sky_wal_commit);
+    mu_run_test(test_sky_wal_rollback);
+    mu_run_test(test_sky_wal_replay);
+    mu_run_test(test_sky_wal_replay_with_torn_record);
+    return 0;
+}
+
+RUN_TESTS()